@@ -239,6 +239,22 @@
     #define G_INLINE inline
 #endif
 
+/**
+ * \def G_CONSTEXPR
+ * Keyword definition for functions and constructors that can be evaluated at
+ * compile time, if the compiler supports it.
+ */
+
+#ifdef G_CONSTEXPR
+    #undef G_CONSTEXPR
+#endif
+
+#if defined(G_COMP_MSVC) && _MSC_VER<1900
+    #define G_CONSTEXPR inline
+#else
+    #define G_CONSTEXPR constexpr
+#endif
+
 /**
  * \def G_NO_VTABLE
  * Compiler-specific keyword definition to force a class to have no virtual
@@ -257,6 +273,23 @@
     #define G_NO_VTABLE
 #endif
 
+/**
+ * \def G_TARGET
+ * Compiler-specific keyword definition to compile a function for an instruction
+ * set extension, like "avx,fma", that is not enabled for the whole build. Such
+ * functions may only be called if the CPU supports the extension.
+ */
+
+#ifdef G_TARGET
+    #undef G_TARGET
+#endif
+
+#ifdef G_COMP_GNUC
+    #define G_TARGET(x) __attribute__ ((target(x)))
+#else
+    #define G_TARGET(x)
+#endif
+
 /**
  * \def G_UNREF_PARAM
  * Macro to mark unreferenced parameters in order to avoid compiler warnings.
@@ -257,6 +257,22 @@ class DynamicArray
         m_size=0;
     }
 
+    /// Exchanges the contents of this array with those of the \a other array
+    /// without copying any items.
+    void swap(DynamicArray& other) {
+        T* data=m_data;
+        m_data=other.m_data;
+        other.m_data=data;
+
+        int size=m_size;
+        m_size=other.m_size;
+        other.m_size=size;
+
+        int capacity=m_capacity;
+        m_capacity=other.m_capacity;
+        other.m_capacity=capacity;
+    }
+
     /// Inserts an \a item at the given \a position into the array. If \a position
     /// is -1, the item gets appended at the end of the array. Returns the index
     /// of the newly added item.
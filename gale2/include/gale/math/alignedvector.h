@@ -0,0 +1,669 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#pragma once
+
+/**
+ * \file
+ * A 3-vector of floats padded to 16 bytes for use with SIMD instructions
+ */
+
+#include "vector.h"
+
+#ifdef GALE_USE_SSE
+    #include <xmmintrin.h>
+#endif
+
+namespace gale {
+
+namespace math {
+
+/**
+ * A 3-vector of floats that carries a hidden fourth element which is always 0.
+ * In contrast to the tightly packed Vec3f, which is only 12 bytes in size and
+ * not aligned, instances are 16 bytes in size. If \c GALE_USE_SSE is defined,
+ * all operators work on a single SSE register. This trades 33% more memory for
+ * faster arithmetics, so whether it pays off depends on the workload. Use pack()
+ * and unpack() to convert arrays from and to the Vec3f layout, e.g. for
+ * uploading vertices to OpenGL.
+ *
+ * On 64-bit platforms, where heap memory is 16-byte aligned, instances are also
+ * 16-byte aligned and the register is accessed directly. Elsewhere, e.g. in a
+ * DynamicArray on 32-bit platforms, alignment cannot be guaranteed, so the
+ * register is loaded and stored unaligned instead.
+ */
+class AlignedVec3f
+{
+  public:
+
+    /// Definition for external access to the data type.
+    typedef float Type;
+
+    /**
+     * \name Predefined constants
+     */
+    //@{
+
+    /// Returns a vector which has all components set to 0.
+    static AlignedVec3f ZERO() {
+        return AlignedVec3f(0,0,0);
+    }
+
+    /// Returns a vector which has the x-component set to 1, all others to 0.
+    static AlignedVec3f X() {
+        return AlignedVec3f(1,0,0);
+    }
+
+    /// Returns a vector which has the y-component set to 1, all others to 0.
+    static AlignedVec3f Y() {
+        return AlignedVec3f(0,1,0);
+    }
+
+    /// Returns a vector which has the z-component set to 1, all others to 0.
+    static AlignedVec3f Z() {
+        return AlignedVec3f(0,0,1);
+    }
+
+    //@}
+
+    /**
+     * \name Constructors
+     */
+    //@{
+
+#ifdef GALE_USE_SSE
+
+    /// Creates a vector with all components set to 0. Unlike for Vector, this
+    /// is done independently of \c GALE_INIT_DATA as the hidden element has to
+    /// be 0.
+    AlignedVec3f() {
+        store(_mm_setzero_ps());
+    }
+
+    /// Allows to initialize the vector directly.
+    AlignedVec3f(float const x,float const y,float const z) {
+        store(_mm_setr_ps(x,y,z,0));
+    }
+
+#else
+
+    /// Creates a vector with all components set to 0. Unlike for Vector, this
+    /// is done independently of \c GALE_INIT_DATA as the hidden element has to
+    /// be 0.
+    AlignedVec3f() {
+        m_data[0]=m_data[1]=m_data[2]=m_data[3]=0;
+    }
+
+    /// Allows to initialize the vector directly.
+    AlignedVec3f(float const x,float const y,float const z) {
+        m_data[0]=x; m_data[1]=y; m_data[2]=z; m_data[3]=0;
+    }
+
+#endif
+
+    /// Converts a vector in the packed layout to this type.
+    AlignedVec3f(Vec3f const& v) {
+        set(v.getX(),v.getY(),v.getZ());
+    }
+
+    /// Returns a copy of this vector in the packed layout.
+    Vec3f packed() const {
+        return Vec3f(m_data[0],m_data[1],m_data[2]);
+    }
+
+    //@}
+
+    /**
+     * \name Element access methods
+     */
+    //@{
+
+    /// Returns a pointer to the internal data array. The fourth element must
+    /// not be changed.
+    float* data() {
+        return m_data;
+    }
+
+    /// Returns a constant pointer to the internal data array.
+    float const* data() const {
+        return m_data;
+    }
+
+    /// Casts \c this vector to a pointer of type \c float. As an intended side
+    /// effect, this also provides indexed data access.
+    operator float*() {
+        return data();
+    }
+
+    /// Casts \c this vector to a constant pointer of type \c float. As an
+    /// intended side effect, this also provides indexed data access.
+    operator float const*() const {
+        return data();
+    }
+
+    /// Returns the x-component.
+    float const& getX() const {
+        return m_data[0];
+    }
+
+    /// Returns the y-component.
+    float const& getY() const {
+        return m_data[1];
+    }
+
+    /// Returns the z-component.
+    float const& getZ() const {
+        return m_data[2];
+    }
+
+    /// Sets the x-component to \a x.
+    void setX(float const x) {
+        m_data[0]=x;
+    }
+
+    /// Sets the y-component to \a y.
+    void setY(float const y) {
+        m_data[1]=y;
+    }
+
+    /// Sets the z-component to \a z.
+    void setZ(float const z) {
+        m_data[2]=z;
+    }
+
+    /// Assigns new values to all components.
+    void set(float const x,float const y,float const z) {
+        *this=AlignedVec3f(x,y,z);
+    }
+
+    //@}
+
+    /**
+     * \name Array conversion methods
+     */
+    //@{
+
+    /// Converts \a count vectors at \a src to the packed layout at \a dst, e.g.
+    /// for uploading them to OpenGL.
+    static void pack(Vec3f* const dst,AlignedVec3f const* const src,int const count) {
+#ifdef GALE_USE_SSE
+        // Store all four elements and let the next vector overwrite the hidden
+        // one, except for the last vector which must not write past the end.
+        int i=0;
+        for (;i<count-1;++i) {
+            _mm_storeu_ps(dst[i].data(),src[i].load());
+        }
+        for (;i<count;++i) {
+            dst[i]=src[i].packed();
+        }
+#else
+        for (int i=0;i<count;++i) {
+            dst[i]=src[i].packed();
+        }
+#endif
+    }
+
+    /// Converts \a count vectors in the packed layout at \a src to this type at
+    /// \a dst.
+    static void unpack(AlignedVec3f* const dst,Vec3f const* const src,int const count) {
+#ifdef GALE_USE_SSE
+        // Load four elements and clear the one that belongs to the next vector,
+        // except for the last vector which must not read past the end.
+        __m128 const mask=xyzMask();
+        int i=0;
+        for (;i<count-1;++i) {
+            dst[i].store(_mm_and_ps(_mm_loadu_ps(src[i].data()),mask));
+        }
+        for (;i<count;++i) {
+            dst[i]=src[i];
+        }
+#else
+        for (int i=0;i<count;++i) {
+            dst[i]=src[i];
+        }
+#endif
+    }
+
+    //@}
+
+#ifdef GALE_USE_SSE
+
+    /**
+     * \name Arithmetic vector / vector operators
+     */
+    //@{
+
+    /// Element-wise increments \c this vector by vector \a v.
+    G_INLINE AlignedVec3f const& operator+=(AlignedVec3f const& v) {
+        store(_mm_add_ps(load(),v.load()));
+        return *this;
+    }
+
+    /// Element-wise decrements \c this vector by vector \a v.
+    G_INLINE AlignedVec3f const& operator-=(AlignedVec3f const& v) {
+        store(_mm_sub_ps(load(),v.load()));
+        return *this;
+    }
+
+    /// Element-wise multiplies \c this vector by vector \a v.
+    G_INLINE AlignedVec3f const& operator*=(AlignedVec3f const& v) {
+        store(_mm_mul_ps(load(),v.load()));
+        return *this;
+    }
+
+    /// Element-wise divides \c this vector by vector \a v.
+    G_INLINE AlignedVec3f const& operator/=(AlignedVec3f const& v) {
+        // Clear the hidden element, which is 0/0 now.
+        store(_mm_and_ps(_mm_div_ps(load(),v.load()),xyzMask()));
+        return *this;
+    }
+
+    /// Returns the element-wise negation of vector \a v.
+    friend G_INLINE AlignedVec3f operator-(AlignedVec3f const& v) {
+        return AlignedVec3f(_mm_sub_ps(_mm_setzero_ps(),v.load()));
+    }
+
+    //@}
+
+    /**
+     * \name Arithmetic vector / scalar operators
+     */
+    //@{
+
+    /// Multiplies each element of \c this vector by a scalar \a s.
+    G_INLINE AlignedVec3f const& operator*=(float const s) {
+        store(_mm_mul_ps(load(),_mm_set1_ps(s)));
+        return *this;
+    }
+
+    /// Divides each element of \c this vector by a scalar \a s.
+    G_INLINE AlignedVec3f const& operator/=(float const s) {
+        G_ASSERT(abs(s)>Numf::ZERO_TOLERANCE())
+        store(_mm_div_ps(load(),_mm_set1_ps(s)));
+        return *this;
+    }
+
+    //@}
+
+    /**
+     * \name Extremes determination methods
+     */
+    //@{
+
+    /// Calculates the element-wise minimum of \c this vector and vector \a v.
+    G_INLINE AlignedVec3f minElements(AlignedVec3f const& v) const {
+        return AlignedVec3f(_mm_min_ps(load(),v.load()));
+    }
+
+    /// Calculates the element-wise maximum of \c this vector and vector \a v.
+    G_INLINE AlignedVec3f maxElements(AlignedVec3f const& v) const {
+        return AlignedVec3f(_mm_max_ps(load(),v.load()));
+    }
+
+    //@}
+
+    /**
+     * \name Comparison operators
+     */
+    //@{
+
+    /// Returns whether all elements in \a v are less than their counterparts
+    /// in \a w.
+    friend G_INLINE bool operator<(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return (_mm_movemask_ps(_mm_cmplt_ps(v.load(),w.load()))&0x7)==0x7;
+    }
+
+    /// Returns whether all elements in \a v are less than or equal to their
+    /// counterparts in \a w.
+    friend G_INLINE bool operator<=(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return (_mm_movemask_ps(_mm_cmple_ps(v.load(),w.load()))&0x7)==0x7;
+    }
+
+    /// Returns whether all elements in \a v equal their counterparts in \a w
+    /// with regard to a tolerance depending on the precision of type \c float.
+    friend G_INLINE bool operator==(AlignedVec3f const& v,AlignedVec3f const& w) {
+        // Clear the sign bits to get the absolute differences.
+        __m128 diff=_mm_andnot_ps(_mm_set1_ps(-0.0f),_mm_sub_ps(w.load(),v.load()));
+        __m128 tol=_mm_set1_ps(Numf::ZERO_TOLERANCE());
+        return (_mm_movemask_ps(_mm_cmple_ps(diff,tol))&0x7)==0x7;
+    }
+
+    //@}
+
+    /**
+     * \name Vector methods
+     */
+    //@{
+
+    /// Returns the dot product between this vector and vector \a v.
+    G_INLINE float dot(AlignedVec3f const& v) const {
+        // The hidden elements contribute 0 to the sum.
+        __m128 p=_mm_mul_ps(load(),v.load());
+        p=_mm_add_ps(p,_mm_movehl_ps(p,p));
+        p=_mm_add_ss(p,_mm_shuffle_ps(p,p,_MM_SHUFFLE(1,1,1,1)));
+        return _mm_cvtss_f32(p);
+    }
+
+    /// Returns the cross product between vectors \a v and \a w.
+    friend G_INLINE AlignedVec3f operator^(AlignedVec3f const& v,AlignedVec3f const& w) {
+        // Calculate v*w.yzx-v.yzx*w, whose elements are in zxy order. The
+        // hidden elements cancel out.
+        __m128 vxyz=v.load(),wxyz=w.load();
+        __m128 vyzx=_mm_shuffle_ps(vxyz,vxyz,_MM_SHUFFLE(3,0,2,1));
+        __m128 wyzx=_mm_shuffle_ps(wxyz,wxyz,_MM_SHUFFLE(3,0,2,1));
+        __m128 c=_mm_sub_ps(_mm_mul_ps(vxyz,wyzx),_mm_mul_ps(vyzx,wxyz));
+        return AlignedVec3f(_mm_shuffle_ps(c,c,_MM_SHUFFLE(3,0,2,1)));
+    }
+
+    //@}
+
+  private:
+
+    /// Creates a vector from an SSE register \a m whose fourth element is 0.
+    explicit AlignedVec3f(__m128 const m) {
+        store(m);
+    }
+
+    /// Returns all elements in an SSE register.
+    G_INLINE __m128 load() const {
+#ifdef G_ARCH_X86_64
+        return m_simd;
+#else
+        return _mm_loadu_ps(m_data);
+#endif
+    }
+
+    /// Sets all elements from the SSE register \a m.
+    G_INLINE void store(__m128 const m) {
+#ifdef G_ARCH_X86_64
+        m_simd=m;
+#else
+        _mm_storeu_ps(m_data,m);
+#endif
+    }
+
+    /// Returns a mask with all bits of the first three elements set.
+    static G_INLINE __m128 xyzMask() {
+        __m128 zero=_mm_setzero_ps(),ones=_mm_cmpeq_ps(zero,zero);
+        return _mm_shuffle_ps(ones,_mm_movelh_ps(zero,ones),_MM_SHUFFLE(0,2,1,0));
+    }
+
+  public:
+
+#else
+
+    /**
+     * \name Arithmetic vector / vector operators
+     */
+    //@{
+
+    /// Element-wise increments \c this vector by vector \a v.
+    G_INLINE AlignedVec3f const& operator+=(AlignedVec3f const& v) {
+        m_data[0]+=v.m_data[0]; m_data[1]+=v.m_data[1]; m_data[2]+=v.m_data[2];
+        return *this;
+    }
+
+    /// Element-wise decrements \c this vector by vector \a v.
+    G_INLINE AlignedVec3f const& operator-=(AlignedVec3f const& v) {
+        m_data[0]-=v.m_data[0]; m_data[1]-=v.m_data[1]; m_data[2]-=v.m_data[2];
+        return *this;
+    }
+
+    /// Element-wise multiplies \c this vector by vector \a v.
+    G_INLINE AlignedVec3f const& operator*=(AlignedVec3f const& v) {
+        m_data[0]*=v.m_data[0]; m_data[1]*=v.m_data[1]; m_data[2]*=v.m_data[2];
+        return *this;
+    }
+
+    /// Element-wise divides \c this vector by vector \a v.
+    G_INLINE AlignedVec3f const& operator/=(AlignedVec3f const& v) {
+        m_data[0]/=v.m_data[0]; m_data[1]/=v.m_data[1]; m_data[2]/=v.m_data[2];
+        return *this;
+    }
+
+    /// Returns the element-wise negation of vector \a v.
+    friend G_INLINE AlignedVec3f operator-(AlignedVec3f const& v) {
+        return AlignedVec3f(-v.m_data[0],-v.m_data[1],-v.m_data[2]);
+    }
+
+    //@}
+
+    /**
+     * \name Arithmetic vector / scalar operators
+     */
+    //@{
+
+    /// Multiplies each element of \c this vector by a scalar \a s.
+    G_INLINE AlignedVec3f const& operator*=(float const s) {
+        m_data[0]*=s; m_data[1]*=s; m_data[2]*=s;
+        return *this;
+    }
+
+    /// Divides each element of \c this vector by a scalar \a s.
+    G_INLINE AlignedVec3f const& operator/=(float const s) {
+        G_ASSERT(abs(s)>Numf::ZERO_TOLERANCE())
+        m_data[0]/=s; m_data[1]/=s; m_data[2]/=s;
+        return *this;
+    }
+
+    //@}
+
+    /**
+     * \name Extremes determination methods
+     */
+    //@{
+
+    /// Calculates the element-wise minimum of \c this vector and vector \a v.
+    G_INLINE AlignedVec3f minElements(AlignedVec3f const& v) const {
+        return AlignedVec3f(min(m_data[0],v.m_data[0]),min(m_data[1],v.m_data[1]),min(m_data[2],v.m_data[2]));
+    }
+
+    /// Calculates the element-wise maximum of \c this vector and vector \a v.
+    G_INLINE AlignedVec3f maxElements(AlignedVec3f const& v) const {
+        return AlignedVec3f(max(m_data[0],v.m_data[0]),max(m_data[1],v.m_data[1]),max(m_data[2],v.m_data[2]));
+    }
+
+    //@}
+
+    /**
+     * \name Comparison operators
+     */
+    //@{
+
+    /// Returns whether all elements in \a v are less than their counterparts
+    /// in \a w.
+    friend G_INLINE bool operator<(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return v.m_data[0]<w.m_data[0] && v.m_data[1]<w.m_data[1] && v.m_data[2]<w.m_data[2];
+    }
+
+    /// Returns whether all elements in \a v are less than or equal to their
+    /// counterparts in \a w.
+    friend G_INLINE bool operator<=(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return v.m_data[0]<=w.m_data[0] && v.m_data[1]<=w.m_data[1] && v.m_data[2]<=w.m_data[2];
+    }
+
+    /// Returns whether all elements in \a v equal their counterparts in \a w
+    /// with regard to a tolerance depending on the precision of type \c float.
+    friend G_INLINE bool operator==(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return meta::OpCmpEqual::evaluate(v.m_data[0],w.m_data[0])
+            && meta::OpCmpEqual::evaluate(v.m_data[1],w.m_data[1])
+            && meta::OpCmpEqual::evaluate(v.m_data[2],w.m_data[2]);
+    }
+
+    //@}
+
+    /**
+     * \name Vector methods
+     */
+    //@{
+
+    /// Returns the dot product between this vector and vector \a v.
+    G_INLINE float dot(AlignedVec3f const& v) const {
+        return m_data[0]*v.m_data[0]+m_data[1]*v.m_data[1]+m_data[2]*v.m_data[2];
+    }
+
+    /// Returns the cross product between vectors \a v and \a w.
+    friend G_INLINE AlignedVec3f operator^(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return AlignedVec3f(
+            v.m_data[1]*w.m_data[2]-v.m_data[2]*w.m_data[1]
+        ,   v.m_data[2]*w.m_data[0]-v.m_data[0]*w.m_data[2]
+        ,   v.m_data[0]*w.m_data[1]-v.m_data[1]*w.m_data[0]
+        );
+    }
+
+    //@}
+
+#endif
+
+    /**
+     * \name Derived operators
+     */
+    //@{
+
+    /// Returns the element-wise sum of vectors \a v and \a w.
+    friend G_INLINE AlignedVec3f operator+(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return AlignedVec3f(v)+=w;
+    }
+
+    /// Returns the element-wise difference of vectors \a v and \a w.
+    friend G_INLINE AlignedVec3f operator-(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return AlignedVec3f(v)-=w;
+    }
+
+    /// Returns the element-wise product of vectors \a v and \a w.
+    friend G_INLINE AlignedVec3f operator*(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return AlignedVec3f(v)*=w;
+    }
+
+    /// Returns the element-wise quotient of vectors \a v and \a w.
+    friend G_INLINE AlignedVec3f operator/(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return AlignedVec3f(v)/=w;
+    }
+
+    /// Multiplies each element of vector \a v by a scalar \a s from the right.
+    friend G_INLINE AlignedVec3f operator*(AlignedVec3f const& v,float const s) {
+        return AlignedVec3f(v)*=s;
+    }
+
+    /// Multiplies each element of vector \a v by a scalar \a s from the left.
+    friend G_INLINE AlignedVec3f operator*(float const s,AlignedVec3f const& v) {
+        return AlignedVec3f(v)*=s;
+    }
+
+    /// Divides each element of vector \a v by a scalar \a s.
+    friend G_INLINE AlignedVec3f operator/(AlignedVec3f const& v,float const s) {
+        return AlignedVec3f(v)/=s;
+    }
+
+    /// Returns whether not all elements in \a v equal their counterparts in
+    /// \a w with regard to a tolerance depending on the precision of type
+    /// \c float.
+    friend G_INLINE bool operator!=(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return !(v==w);
+    }
+
+    /// Returns whether all elements in \a v are greater than their
+    /// counterparts in \a w.
+    friend G_INLINE bool operator>(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return w<v;
+    }
+
+    /// Returns whether all elements in \a v are greater than or equal to their
+    /// counterparts in \a w.
+    friend G_INLINE bool operator>=(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return w<=v;
+    }
+
+    /// Determines the minimum element of \c this vector.
+    float minElement() const {
+        return min(m_data[0],m_data[1],m_data[2]);
+    }
+
+    /// Determines the maximum element of \c this vector.
+    float maxElement() const {
+        return max(m_data[0],m_data[1],m_data[2]);
+    }
+
+    /// Linearly interpolates between vectors \a v and \a w based on \a s.
+    friend G_INLINE AlignedVec3f lerp(AlignedVec3f const& v,AlignedVec3f const& w,float const s) {
+        return v+(w-v)*s;
+    }
+
+    /// Returns the squared Cartesian length of this vector.
+    G_INLINE float length2() const {
+        return dot(*this);
+    }
+
+    /// Returns the Cartesian length of this vector.
+    double length() const {
+        return sqrt(static_cast<double>(length2()));
+    }
+
+    /// Normalizes this vector so its length equals 1 (if it is not very small).
+    /// Returns the length before normalization.
+    double normalize() {
+        double l=length2();
+
+        if (l>Numf::ZERO_TOLERANCE()*Numf::ZERO_TOLERANCE()) {
+            l=sqrt(l);
+            (*this)/=static_cast<float>(l);
+        }
+
+        return l;
+    }
+
+    /// Returns whether all elements equal their counterpart in \a v with regard
+    /// to the tolerance \a t.
+    bool equals(AlignedVec3f const& v,float const t=1e-6f) const {
+        return (v-*this).length2()<=t*t;
+    }
+
+    /// Returns a normalized copy of vector \a v.
+    friend AlignedVec3f operator~(AlignedVec3f const& v) {
+        AlignedVec3f tmp=v;
+        tmp.normalize();
+        return tmp;
+    }
+
+    /// Returns the dot product between vectors \a v and \a w.
+    friend G_INLINE float operator%(AlignedVec3f const& v,AlignedVec3f const& w) {
+        return v.dot(w);
+    }
+
+    //@}
+
+  private:
+
+    union {
+#if defined(GALE_USE_SSE) && defined(G_ARCH_X86_64)
+        __m128 m_simd;   ///< SSE register holding all elements.
+#endif
+        float m_data[4]; ///< Access to the individual elements.
+    };
+};
+
+} // namespace math
+
+} // namespace gale
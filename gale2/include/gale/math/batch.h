@@ -0,0 +1,163 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#pragma once
+
+/**
+ * \file
+ * Batch operations on arrays of vectors and quaternions
+ */
+
+#include "hmatrix4.h"
+
+namespace gale {
+
+namespace math {
+
+/**
+ * Describes vectors stored as a "structure of arrays" (SoA), i.e. by separate
+ * arrays of x-, y- and z-coordinates. In contrast to arrays of Vec3f, SIMD
+ * code can process several of these vectors per instruction without shuffling.
+ */
+struct Vec3fArrays
+{
+    float* x; ///< Pointer to the array of x-coordinates.
+    float* y; ///< Pointer to the array of y-coordinates.
+    float* z; ///< Pointer to the array of z-coordinates.
+};
+
+/**
+ * Describes quaternions stored as a "structure of arrays" (SoA), i.e. by
+ * separate arrays of the real parts and the x-, y- and z-components of the
+ * imaginary parts, see Vec3fArrays.
+ */
+struct QuatfArrays
+{
+    float* w; ///< Pointer to the array of real parts.
+    float* x; ///< Pointer to the array of imaginary x-components.
+    float* y; ///< Pointer to the array of imaginary y-components.
+    float* z; ///< Pointer to the array of imaginary z-components.
+};
+
+/**
+ * \name Batch functions on vectors
+ * These functions process \a n vectors at once, either stored as arrays of
+ * Vec3f or as a Vec3fArrays. They are vectorized if \c GALE_USE_SSE is defined.
+ * Output arrays may alias input arrays. If \a threads is not 1, large arrays
+ * are split across up to \a threads threads (0 uses all processors); as threads
+ * are created per call, this only pays off for hundreds of thousands of vectors.
+ */
+//@{
+
+/// Transforms the points in \a in by matrix \a m and stores them in \a out.
+void transformPoints(HMat4f const& m,Vec3f const* in,Vec3f* out,int const n,int const threads=1);
+
+/// Transforms the points in \a in by matrix \a m and stores them in \a out.
+void transformPoints(HMat4f const& m,Vec3fArrays const& in,Vec3fArrays const& out,int const n,int const threads=1);
+
+/// Transforms the normals in \a in by the inverse transpose of the upper-left
+/// 3x3 part of matrix \a m, normalizes them with the given \a accuracy like
+/// Vector::normalize() and stores them in \a out.
+void transformNormals(HMat4f const& m,Vec3f const* in,Vec3f* out,int const n,Accuracy const accuracy=ACCURACY_EXACT,int const threads=1);
+
+/// Transforms the normals in \a in by the inverse transpose of the upper-left
+/// 3x3 part of matrix \a m, normalizes them with the given \a accuracy like
+/// Vector::normalize() and stores them in \a out.
+void transformNormals(HMat4f const& m,Vec3fArrays const& in,Vec3fArrays const& out,int const n,Accuracy const accuracy=ACCURACY_EXACT,int const threads=1);
+
+/// Stores copies of the vectors in \a in normalized with the given \a accuracy
+/// in \a out. Like Vector::normalize(), vectors of (almost) zero length are
+/// copied unchanged.
+void normalizeAll(Vec3f const* in,Vec3f* out,int const n,Accuracy const accuracy=ACCURACY_EXACT,int const threads=1);
+
+/// Stores copies of the vectors in \a in normalized with the given \a accuracy
+/// in \a out. Like Vector::normalize(), vectors of (almost) zero length are
+/// copied unchanged.
+void normalizeAll(Vec3fArrays const& in,Vec3fArrays const& out,int const n,Accuracy const accuracy=ACCURACY_EXACT,int const threads=1);
+
+/// Stores the dot products of the vectors in \a a and \a b in \a out.
+void dotAll(Vec3f const* a,Vec3f const* b,float* out,int const n,int const threads=1);
+
+/// Stores the dot products of the vectors in \a a and \a b in \a out.
+void dotAll(Vec3fArrays const& a,Vec3fArrays const& b,float* out,int const n,int const threads=1);
+
+/// Stores the cross products of the vectors in \a a and \a b in \a out.
+void crossAll(Vec3f const* a,Vec3f const* b,Vec3f* out,int const n,int const threads=1);
+
+/// Stores the cross products of the vectors in \a a and \a b in \a out.
+void crossAll(Vec3fArrays const& a,Vec3fArrays const& b,Vec3fArrays const& out,int const n,int const threads=1);
+
+/// Calculates the element-wise minimum \a min and maximum \a max of the vectors
+/// in \a in, e.g. to get a bounding box. Returns false if \a n is not positive,
+/// leaving \a min and \a max unchanged.
+bool minMaxAll(Vec3f const* in,int const n,Vec3f& min,Vec3f& max,int const threads=1);
+
+/// Calculates the element-wise minimum \a min and maximum \a max of the vectors
+/// in \a in, e.g. to get a bounding box. Returns false if \a n is not positive,
+/// leaving \a min and \a max unchanged.
+bool minMaxAll(Vec3fArrays const& in,int const n,Vec3f& min,Vec3f& max,int const threads=1);
+
+//@}
+
+/**
+ * \name Batch functions on quaternions
+ * These functions process \a n quaternions stored as a QuatfArrays at once,
+ * with the same vectorization, aliasing and threading rules as the batch
+ * functions on vectors.
+ */
+//@{
+
+/// Stores the normalized linear interpolations between the quaternions in \a q
+/// and \a r based on the scalars in \a s in \a out. The normalization uses the
+/// given \a accuracy like Vector::normalize().
+void nlerpAll(QuatfArrays const& q,QuatfArrays const& r,float const* s,QuatfArrays const& out,int const n,Accuracy const accuracy=ACCURACY_EXACT,int const threads=1);
+
+/// Stores the spherical-linear interpolations between the normalized
+/// quaternions in \a q and \a r based on the scalars in \a s, which need to
+/// be in [0,1], in \a out. In contrast to slerp(), the shorter arc is taken,
+/// i.e. the quaternions in \a r are negated if their angle cosine to those in
+/// \a q is negative. For \c ACCURACY_EXACT, slerp() is called, otherwise the
+/// interpolation weights are approximated by polynomials in the angle cosine,
+/// avoiding any trigonometric functions and divisions. For \c ACCURACY_HIGH
+/// the absolute error of the weights is below 1e-6, for \c ACCURACY_FAST it
+/// is below 1.2e-4.
+void slerpAll(QuatfArrays const& q,QuatfArrays const& r,float const* s,QuatfArrays const& out,int const n,Accuracy const accuracy=ACCURACY_HIGH,int const threads=1);
+
+/// Stores the products of the quaternions in \a q and \a r in \a out.
+void multiplyAll(QuatfArrays const& q,QuatfArrays const& r,QuatfArrays const& out,int const n,int const threads=1);
+
+/// Stores the vectors in \a v rotated by the normalized quaternions in \a q in
+/// \a out.
+void rotateAll(QuatfArrays const& q,Vec3fArrays const& v,Vec3fArrays const& out,int const n,int const threads=1);
+
+/// Stores the homogeneous matrices that match the rotations represented by
+/// the normalized quaternions in \a q in \a out, like Quaternion::getMatrix().
+void getMatrices(QuatfArrays const& q,HMat4f* out,int const n,int const threads=1);
+
+//@}
+
+} // namespace math
+
+} // namespace gale
@@ -50,12 +50,12 @@ template<typename T>
 struct ColorChannel
 {
     /// Returns the minimum value allowed for a color channel.
-    static T MIN_VALUE() {
+    static G_CONSTEXPR T MIN_VALUE() {
         return Numerics<T>::MIN();
     }
 
     /// Returns the maximum value allowed for a color channel.
-    static T MAX_VALUE() {
+    static G_CONSTEXPR T MAX_VALUE() {
         return Numerics<T>::MAX();
     }
 
@@ -67,25 +67,25 @@ struct ColorChannel
 
 /// \cond DOXYGEN_IGNORE
 template<>
-inline float ColorChannel<float>::MIN_VALUE()
+G_CONSTEXPR float ColorChannel<float>::MIN_VALUE()
 {
     return 0;
 }
 
 template<>
-inline float ColorChannel<float>::MAX_VALUE()
+G_CONSTEXPR float ColorChannel<float>::MAX_VALUE()
 {
     return 1;
 }
 
 template<>
-inline double ColorChannel<double>::MIN_VALUE()
+G_CONSTEXPR double ColorChannel<double>::MIN_VALUE()
 {
     return 0;
 }
 
 template<>
-inline double ColorChannel<double>::MAX_VALUE()
+G_CONSTEXPR double ColorChannel<double>::MAX_VALUE()
 {
     return 1;
 }
@@ -124,56 +124,49 @@ class Color:public TupleBase<N,T,Color<N,T> >,public ColorChannel<T>
      * \name Predefined constants
      * In order to avoid the so called "static initialization order fiasco",
      * static methods instead of static variables are used here, see
-     * http://www.parashift.com/c++-faq-lite/ctors.html#faq-10.14.
+     * http://www.parashift.com/c++-faq-lite/ctors.html#faq-10.14. The
+     * constants are returned by value so they can be folded at compile time.
      */
     //@{
 
     /// Returns a color which represents black.
-    static Color const& BLACK() {
-        static Color const c(0x0|0x8);
-        return c;
+    static G_CONSTEXPR Color BLACK() {
+        return Color(0x0|0x8);
     }
 
     /// Returns a color which represents blue.
-    static Color const& BLUE() {
-        static Color const c(0x4|0x8);
-        return c;
+    static G_CONSTEXPR Color BLUE() {
+        return Color(0x4|0x8);
     }
 
     /// Returns a color which represents green.
-    static Color const& GREEN() {
-        static Color const c(0x2|0x8);
-        return c;
+    static G_CONSTEXPR Color GREEN() {
+        return Color(0x2|0x8);
     }
 
     /// Returns a color which represents cyan.
-    static Color const& CYAN() {
-        static Color const c(0x6|0x8);
-        return c;
+    static G_CONSTEXPR Color CYAN() {
+        return Color(0x6|0x8);
     }
 
     /// Returns a color which represents red.
-    static Color const& RED() {
-        static Color const c(0x1|0x8);
-        return c;
+    static G_CONSTEXPR Color RED() {
+        return Color(0x1|0x8);
     }
 
     /// Returns a color which represents magenta.
-    static Color const& MAGENTA() {
-        static Color const c(0x5|0x8);
-        return c;
+    static G_CONSTEXPR Color MAGENTA() {
+        return Color(0x5|0x8);
     }
 
     /// Returns a color which represents yellow.
-    static Color const& YELLOW() {
-        static Color const c(0x3|0x8);
-        return c;
+    static G_CONSTEXPR Color YELLOW() {
+        return Color(0x3|0x8);
     }
 
     /// Returns a color which represents white.
-    static Color const& WHITE() {
-        static Color const c(0x7|0x8);
-        return c;
+    static G_CONSTEXPR Color WHITE() {
+        return Color(0x7|0x8);
     }
 
     //@}
@@ -199,13 +192,11 @@ class Color:public TupleBase<N,T,Color<N,T> >,public ColorChannel<T>
     /// depending on the bits set in \a mask. Bit 0 maps to the first channel,
     /// bit 1 to second one and so on. This constructor is required to
     /// initialize the static class constants.
-    explicit Color(unsigned int const mask)
+    G_CONSTEXPR explicit Color(unsigned int const mask)
+    :   Base(mask,ColorChannel<T>::MAX_VALUE(),ColorChannel<T>::MIN_VALUE(),meta::MakeIndexSequence<N>())
     {
         // Do not allow colors with less than 3 elements.
-        G_ASSERT(N>=3)
-
-        meta::LoopFwd<N,meta::OpAssign>
-            ::iterateIndexMask(Base::data(),mask,MAX_VALUE(),MIN_VALUE());
+        static_assert(N>=3,"Colors need to have at least 3 channels");
     }
 
   public:
@@ -216,12 +207,12 @@ class Color:public TupleBase<N,T,Color<N,T> >,public ColorChannel<T>
     }
 
     /// Allows to initialize 3-channel colors directly.
-    Color(T const r,T const g,T const b)
+    G_CONSTEXPR Color(T const r,T const g,T const b)
     :   Base(r,g,b)
     {}
 
     /// Allows to initialize 4-channel colors directly.
-    Color(T const r,T const g,T const b,T const a)
+    G_CONSTEXPR Color(T const r,T const g,T const b,T const a)
     :   Base(r,g,b,a)
     {}
 
@@ -70,26 +70,23 @@ struct Constants
     typedef T Type;
 
     /// Returns the ratio of a circle's circumference to its diameter.
-    static T PI() {
+    static G_CONSTEXPR T PI() {
         return static_cast<T>(M_PI);
     }
 
     /// Returns the factor to convert degrees to radians.
-    static T const& DEG_TO_RAD() {
-        static T const f=PI()/T(180);
-        return f;
+    static G_CONSTEXPR T DEG_TO_RAD() {
+        return PI()/T(180);
     }
 
     /// Returns the factor to convert radians to degrees.
-    static T const& RAD_TO_DEG() {
-        static T const f=T(180)/PI();
-        return f;
+    static G_CONSTEXPR T RAD_TO_DEG() {
+        return T(180)/PI();
     }
 
-    /// Returns the Golden Ratio as commonly used in arts.
-    static T const& GOLDEN_RATIO() {
-        static T const r=(1+sqrt(T(5)))/T(2);
-        return r;
+    /// Returns the Golden Ratio as commonly used in arts, i.e. (1+sqrt(5))/2.
+    static G_CONSTEXPR T GOLDEN_RATIO() {
+        return static_cast<T>(1.6180339887498948482);
     }
 };
 
@@ -146,73 +143,73 @@ typedef Numerics<unsigned char> Numub;
 template<>
 struct Numerics<double>
 {
-    static double MIN()                    { return DBL_MIN;      }
-    static double MAX()                    { return DBL_MAX;      }
-    static double EPSILON()                { return DBL_EPSILON;  }
-    static double ZERO_TOLERANCE()         { return 1e-8;        }
+    static G_CONSTEXPR double MIN()                    { return DBL_MIN;      }
+    static G_CONSTEXPR double MAX()                    { return DBL_MAX;      }
+    static G_CONSTEXPR double EPSILON()                { return DBL_EPSILON;  }
+    static G_CONSTEXPR double ZERO_TOLERANCE()         { return 1e-8;        }
 };
 
 template<>
 struct Numerics<float>
 {
-    static float MIN()                     { return FLT_MIN;      }
-    static float MAX()                     { return FLT_MAX;      }
-    static float EPSILON()                 { return FLT_EPSILON;  }
-    static float ZERO_TOLERANCE()          { return 1e-6f;       }
+    static G_CONSTEXPR float MIN()                     { return FLT_MIN;      }
+    static G_CONSTEXPR float MAX()                     { return FLT_MAX;      }
+    static G_CONSTEXPR float EPSILON()                 { return FLT_EPSILON;  }
+    static G_CONSTEXPR float ZERO_TOLERANCE()          { return 1e-6f;       }
 };
 
 template<>
 struct Numerics<int>
 {
-    static int MIN()                       { return INT_MIN;      }
-    static int MAX()                       { return INT_MAX;      }
-    static int EPSILON()                   { return 0;            }
-    static int ZERO_TOLERANCE()            { return 0;            }
+    static G_CONSTEXPR int MIN()                       { return INT_MIN;      }
+    static G_CONSTEXPR int MAX()                       { return INT_MAX;      }
+    static G_CONSTEXPR int EPSILON()                   { return 0;            }
+    static G_CONSTEXPR int ZERO_TOLERANCE()            { return 0;            }
 };
 
 template<>
 struct Numerics<unsigned int>
 {
-    static unsigned int MIN()              { return 0;            }
-    static unsigned int MAX()              { return UINT_MAX;     }
-    static unsigned int EPSILON()          { return 0;            }
-    static unsigned int ZERO_TOLERANCE()   { return 0;            }
+    static G_CONSTEXPR unsigned int MIN()              { return 0;            }
+    static G_CONSTEXPR unsigned int MAX()              { return UINT_MAX;     }
+    static G_CONSTEXPR unsigned int EPSILON()          { return 0;            }
+    static G_CONSTEXPR unsigned int ZERO_TOLERANCE()   { return 0;            }
 };
 
 template<>
 struct Numerics<short>
 {
-    static short MIN()                     { return SHRT_MIN;     }
-    static short MAX()                     { return SHRT_MAX;     }
-    static short EPSILON()                 { return 0;            }
-    static short ZERO_TOLERANCE()          { return 0;            }
+    static G_CONSTEXPR short MIN()                     { return SHRT_MIN;     }
+    static G_CONSTEXPR short MAX()                     { return SHRT_MAX;     }
+    static G_CONSTEXPR short EPSILON()                 { return 0;            }
+    static G_CONSTEXPR short ZERO_TOLERANCE()          { return 0;            }
 };
 
 template<>
 struct Numerics<unsigned short>
 {
-    static unsigned short MIN()            { return 0;            }
-    static unsigned short MAX()            { return USHRT_MAX;    }
-    static unsigned short EPSILON()        { return 0;            }
-    static unsigned short ZERO_TOLERANCE() { return 0;            }
+    static G_CONSTEXPR unsigned short MIN()            { return 0;            }
+    static G_CONSTEXPR unsigned short MAX()            { return USHRT_MAX;    }
+    static G_CONSTEXPR unsigned short EPSILON()        { return 0;            }
+    static G_CONSTEXPR unsigned short ZERO_TOLERANCE() { return 0;            }
 };
 
 template<>
 struct Numerics<signed char>
 {
-    static signed char MIN()               { return SCHAR_MIN;    }
-    static signed char MAX()               { return SCHAR_MAX;    }
-    static signed char EPSILON()           { return 0;            }
-    static signed char ZERO_TOLERANCE()    { return 0;            }
+    static G_CONSTEXPR signed char MIN()               { return SCHAR_MIN;    }
+    static G_CONSTEXPR signed char MAX()               { return SCHAR_MAX;    }
+    static G_CONSTEXPR signed char EPSILON()           { return 0;            }
+    static G_CONSTEXPR signed char ZERO_TOLERANCE()    { return 0;            }
 };
 
 template<>
 struct Numerics<unsigned char>
 {
-    static unsigned char MIN()             { return 0;            }
-    static unsigned char MAX()             { return UCHAR_MAX;    }
-    static unsigned char EPSILON()         { return 0;            }
-    static unsigned char ZERO_TOLERANCE()  { return 0;            }
+    static G_CONSTEXPR unsigned char MIN()             { return 0;            }
+    static G_CONSTEXPR unsigned char MAX()             { return UCHAR_MAX;    }
+    static G_CONSTEXPR unsigned char EPSILON()         { return 0;            }
+    static G_CONSTEXPR unsigned char ZERO_TOLERANCE()  { return 0;            }
 };
 /// \endcond
 
@@ -0,0 +1,334 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#pragma once
+
+/**
+ * \file
+ * Opt-in expression templates for tuple arithmetics
+ */
+
+#include "tuple.h"
+
+#include <type_traits>
+
+namespace gale {
+
+namespace math {
+
+/**
+ * Wrapper for an expression node of type \a E that evaluates to a tuple of
+ * class \a C with \a N elements of type \a T. In contrast to the operators
+ * provided by TupleBase, which return a temporary tuple for each operation,
+ * the operators on expressions only record the operation. The whole
+ * expression is then evaluated element by element in a single pass when it is
+ * converted to \a C, so e.g. a weighted sum of vectors neither copies any
+ * intermediate vectors nor prevents the compiler from fusing multiplications
+ * and additions.
+ *
+ * Expressions are created by wrapping a tuple operand into lazy():
+ * \code
+ * Vec3f x=lazy(a)*0.5f+lazy(b)*0.5f-c*0.25f;
+ * \endcode
+ *
+ * As expressions only store references to their operands, they need to be
+ * converted within the full-expression they were created in. In particular,
+ * do not store them in variables declared as \c auto.
+ */
+template<unsigned int N,typename T,class C,class E>
+class TupleExpression
+{
+  public:
+
+    /// Definition for external access to the data type.
+    typedef T Type;
+
+    /// Wraps the expression node \a e.
+    explicit TupleExpression(E const& e)
+    :   m_node(e) {}
+
+    /// Evaluates the expression for the element at index \a i.
+    G_INLINE T operator[](unsigned int const i) const {
+        return m_node[i];
+    }
+
+    /// Evaluates the expression for all elements and returns the result.
+    G_INLINE operator C() const {
+        C tmp;
+        meta::LoopFwd<N,meta::OpAssign>::iterateIndexed(tmp.data(),m_node);
+        return tmp;
+    }
+
+    E m_node; ///< The wrapped expression node.
+};
+
+/**
+ * \name Expression nodes
+ */
+//@{
+
+/// Expression node referring to the elements of a tuple.
+template<typename T>
+struct ExpressionTuple
+{
+    /// Stores a pointer to the tuple elements \a d.
+    explicit ExpressionTuple(T const* const d)
+    :   data(d) {}
+
+    /// Returns the tuple element at index \a i.
+    G_INLINE T operator[](unsigned int const i) const {
+        return data[i];
+    }
+
+    T const* data; ///< Pointer to the tuple elements.
+};
+
+/// Expression node returning the same scalar for all elements.
+template<typename T>
+struct ExpressionScalar
+{
+    /// Stores the scalar \a s.
+    explicit ExpressionScalar(T const s)
+    :   scalar(s) {}
+
+    /// Returns the scalar, independent of the index.
+    G_INLINE T operator[](unsigned int const i) const {
+        G_UNREF_PARAM(i)
+        return scalar;
+    }
+
+    T scalar; ///< The scalar value.
+};
+
+/// Expression node applying the meta-template operator \a OP to the elements
+/// of \a L and \a R.
+template<class OP,typename T,class L,class R>
+struct ExpressionBinary
+{
+    /// Stores the operands \a l and \a r.
+    ExpressionBinary(L const& l,R const& r)
+    :   left(l)
+    ,   right(r) {}
+
+    /// Returns the result of the operation for the element at index \a i.
+    G_INLINE T operator[](unsigned int const i) const {
+        T a=left[i];
+        OP::evaluate(a,right[i]);
+        return a;
+    }
+
+    L left;  ///< The left hand side operand.
+    R right; ///< The right hand side operand.
+};
+
+/// Expression node negating the elements of \a E.
+template<typename T,class E>
+struct ExpressionNegate
+{
+    /// Stores the operand \a e.
+    explicit ExpressionNegate(E const& e)
+    :   operand(e) {}
+
+    /// Returns the negated element at index \a i.
+    G_INLINE T operator[](unsigned int const i) const {
+        return -operand[i];
+    }
+
+    E operand; ///< The operand to negate.
+};
+
+//@}
+
+/**
+ * Helper class to determine whether \a T is derived from TupleBase.
+ */
+template<class T>
+struct IsTuple
+{
+  private:
+
+    template<unsigned int N,typename U,class C>
+    static char test(TupleBase<N,U,C> const*);
+
+    static long test(...);
+
+  public:
+
+    /// Is \c true if \a T is a tuple.
+    static bool const value=sizeof(test(static_cast<T const*>(NULL)))==1;
+};
+
+/**
+ * \name Expression creation
+ */
+//@{
+
+/// Wraps the tuple \a t into an expression so that the following operators
+/// create expressions instead of temporary tuples.
+template<unsigned int N,typename T,class C>
+G_INLINE TupleExpression<N,T,C,ExpressionTuple<T> > lazy(TupleBase<N,T,C> const& t)
+{
+    return TupleExpression<N,T,C,ExpressionTuple<T> >(ExpressionTuple<T>(t.data()));
+}
+
+/// Returns \a x unchanged if it is not a tuple, e.g. a scalar or an
+/// expression. This allows generic code like the Interpolator to use lazy()
+/// for any type.
+template<typename T>
+G_INLINE typename std::enable_if<!IsTuple<T>::value,T const&>::type lazy(T const& x)
+{
+    return x;
+}
+
+//@}
+
+/**
+ * \name Expression / expression operators
+ */
+//@{
+
+/// Returns an expression for the negation of \a e.
+template<unsigned int N,typename T,class C,class E>
+G_INLINE TupleExpression<N,T,C,ExpressionNegate<T,E> >
+operator-(TupleExpression<N,T,C,E> const& e)
+{
+    return TupleExpression<N,T,C,ExpressionNegate<T,E> >(ExpressionNegate<T,E>(e.m_node));
+}
+
+/// Returns an expression for the element-wise sum of \a l and \a r.
+template<unsigned int N,typename T,class C,class L,class R>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithAdd,T,L,R> >
+operator+(TupleExpression<N,T,C,L> const& l,TupleExpression<N,T,C,R> const& r)
+{
+    typedef ExpressionBinary<meta::OpArithAdd,T,L,R> Node;
+    return TupleExpression<N,T,C,Node>(Node(l.m_node,r.m_node));
+}
+
+/// Returns an expression for the element-wise sum of \a l and tuple \a r.
+template<unsigned int N,typename T,class C,class L>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithAdd,T,L,ExpressionTuple<T> > >
+operator+(TupleExpression<N,T,C,L> const& l,C const& r)
+{
+    return l+lazy(r);
+}
+
+/// Returns an expression for the element-wise sum of tuple \a l and \a r.
+template<unsigned int N,typename T,class C,class R>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithAdd,T,ExpressionTuple<T>,R> >
+operator+(C const& l,TupleExpression<N,T,C,R> const& r)
+{
+    return lazy(l)+r;
+}
+
+/// Returns an expression for the element-wise difference of \a l and \a r.
+template<unsigned int N,typename T,class C,class L,class R>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithSub,T,L,R> >
+operator-(TupleExpression<N,T,C,L> const& l,TupleExpression<N,T,C,R> const& r)
+{
+    typedef ExpressionBinary<meta::OpArithSub,T,L,R> Node;
+    return TupleExpression<N,T,C,Node>(Node(l.m_node,r.m_node));
+}
+
+/// Returns an expression for the element-wise difference of \a l and tuple \a r.
+template<unsigned int N,typename T,class C,class L>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithSub,T,L,ExpressionTuple<T> > >
+operator-(TupleExpression<N,T,C,L> const& l,C const& r)
+{
+    return l-lazy(r);
+}
+
+/// Returns an expression for the element-wise difference of tuple \a l and \a r.
+template<unsigned int N,typename T,class C,class R>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithSub,T,ExpressionTuple<T>,R> >
+operator-(C const& l,TupleExpression<N,T,C,R> const& r)
+{
+    return lazy(l)-r;
+}
+
+/// Returns an expression for the element-wise product of \a l and \a r.
+template<unsigned int N,typename T,class C,class L,class R>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithMul,T,L,R> >
+operator*(TupleExpression<N,T,C,L> const& l,TupleExpression<N,T,C,R> const& r)
+{
+    typedef ExpressionBinary<meta::OpArithMul,T,L,R> Node;
+    return TupleExpression<N,T,C,Node>(Node(l.m_node,r.m_node));
+}
+
+/// Returns an expression for the element-wise product of \a l and tuple \a r.
+template<unsigned int N,typename T,class C,class L>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithMul,T,L,ExpressionTuple<T> > >
+operator*(TupleExpression<N,T,C,L> const& l,C const& r)
+{
+    return l*lazy(r);
+}
+
+/// Returns an expression for the element-wise product of tuple \a l and \a r.
+template<unsigned int N,typename T,class C,class R>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithMul,T,ExpressionTuple<T>,R> >
+operator*(C const& l,TupleExpression<N,T,C,R> const& r)
+{
+    return lazy(l)*r;
+}
+
+//@}
+
+/**
+ * \name Expression / scalar operators
+ */
+//@{
+
+/// Returns an expression for multiplying each element of \a e by a scalar
+/// \a s from the right.
+template<unsigned int N,typename T,class C,class E>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithMul,T,E,ExpressionScalar<T> > >
+operator*(TupleExpression<N,T,C,E> const& e,typename TupleExpression<N,T,C,E>::Type const s)
+{
+    typedef ExpressionBinary<meta::OpArithMul,T,E,ExpressionScalar<T> > Node;
+    return TupleExpression<N,T,C,Node>(Node(e.m_node,ExpressionScalar<T>(s)));
+}
+
+/// Returns an expression for multiplying each element of \a e by a scalar
+/// \a s from the left.
+template<unsigned int N,typename T,class C,class E>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithMul,T,E,ExpressionScalar<T> > >
+operator*(typename TupleExpression<N,T,C,E>::Type const s,TupleExpression<N,T,C,E> const& e)
+{
+    return e*s;
+}
+
+/// Returns an expression for dividing each element of \a e by a scalar \a s.
+template<unsigned int N,typename T,class C,class E>
+G_INLINE TupleExpression<N,T,C,ExpressionBinary<meta::OpArithDiv,T,E,ExpressionScalar<T> > >
+operator/(TupleExpression<N,T,C,E> const& e,typename TupleExpression<N,T,C,E>::Type const s)
+{
+    typedef ExpressionBinary<meta::OpArithDiv,T,E,ExpressionScalar<T> > Node;
+    return TupleExpression<N,T,C,Node>(Node(e.m_node,ExpressionScalar<T>(s)));
+}
+
+//@}
+
+} // namespace math
+
+} // namespace gale
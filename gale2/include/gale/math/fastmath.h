@@ -0,0 +1,307 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#pragma once
+
+/**
+ * \file
+ * Vectorized approximations of transcendental functions
+ */
+
+#include "essentials.h"
+
+#ifdef GALE_USE_SSE
+    #include <xmmintrin.h>
+#endif
+
+#ifdef GALE_USE_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace gale {
+
+namespace math {
+
+/// Accuracy levels for functions that trade precision for speed.
+enum Accuracy {
+    ACCURACY_EXACT ///< Uses the C runtime functions without vectorization.
+,   ACCURACY_HIGH  ///< Vectorized approximations within a few ULPs of float precision.
+,   ACCURACY_FAST  ///< Vectorized approximations with errors in the order of 1e-4.
+};
+
+#ifdef GALE_USE_SSE2
+
+/**
+ * \name Packed approximations using SSE2
+ * These functions approximate their C runtime counterparts for 4 floats at
+ * once. \c ACCURACY_EXACT is treated like \c ACCURACY_HIGH.
+ */
+//@{
+
+/// Calculates the sine \a s and cosine \a c of \a x. For \c ACCURACY_HIGH the
+/// absolute error is below 1e-7 for |x| < 8192, for \c ACCURACY_FAST it is
+/// below 4e-4.
+G_INLINE void sinCosPS(__m128 x,__m128& s,__m128& c,Accuracy const accuracy=ACCURACY_HIGH)
+{
+    // Reduce the range to [-PI/4,PI/4] by subtracting the nearest multiple q of
+    // PI/2 in three steps to retain precision (Cody-Waite reduction).
+    __m128i q=_mm_cvtps_epi32(_mm_mul_ps(x,_mm_set1_ps(0.63661977f)));
+    __m128 j=_mm_cvtepi32_ps(q);
+
+    x=_mm_sub_ps(x,_mm_mul_ps(j,_mm_set1_ps(1.5703125f)));
+    x=_mm_sub_ps(x,_mm_mul_ps(j,_mm_set1_ps(4.837512969970703125e-4f)));
+    x=_mm_sub_ps(x,_mm_mul_ps(j,_mm_set1_ps(7.54978995489188216e-8f)));
+
+    __m128 z=_mm_mul_ps(x,x);
+    __m128 ps,pc;
+
+    if (accuracy==ACCURACY_FAST) {
+        // Truncated Taylor series.
+        ps=_mm_add_ps(_mm_set1_ps(-1.6666667e-1f),_mm_mul_ps(z,_mm_set1_ps(8.3333333e-3f)));
+        pc=_mm_add_ps(_mm_set1_ps(-0.5f),_mm_mul_ps(z,_mm_set1_ps(4.1666667e-2f)));
+    }
+    else {
+        // Minimax polynomials as used by the Cephes library.
+        ps=_mm_add_ps(_mm_set1_ps(8.3321608736e-3f),_mm_mul_ps(z,_mm_set1_ps(-1.9515295891e-4f)));
+        ps=_mm_add_ps(_mm_set1_ps(-1.6666654611e-1f),_mm_mul_ps(z,ps));
+
+        pc=_mm_add_ps(_mm_set1_ps(-1.388731625493765e-3f),_mm_mul_ps(z,_mm_set1_ps(2.443315711809948e-5f)));
+        pc=_mm_add_ps(_mm_set1_ps(4.166664568298827e-2f),_mm_mul_ps(z,pc));
+        pc=_mm_add_ps(_mm_set1_ps(-0.5f),_mm_mul_ps(z,pc));
+    }
+
+    ps=_mm_add_ps(x,_mm_mul_ps(_mm_mul_ps(x,z),ps));
+    pc=_mm_add_ps(_mm_set1_ps(1.0f),_mm_mul_ps(z,pc));
+
+    // Swap sine and cosine for odd quadrants.
+    __m128 swap=_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q,_mm_set1_epi32(1)),_mm_set1_epi32(1)));
+    s=_mm_or_ps(_mm_and_ps(swap,pc),_mm_andnot_ps(swap,ps));
+    c=_mm_or_ps(_mm_and_ps(swap,ps),_mm_andnot_ps(swap,pc));
+
+    // Negate the sine in quadrants 2 and 3, and the cosine in quadrants 1 and 2.
+    __m128i two=_mm_set1_epi32(2);
+    s=_mm_xor_ps(s,_mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q,two),30)));
+    c=_mm_xor_ps(c,_mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q,_mm_set1_epi32(1)),two),30)));
+}
+
+/// Returns the base-2 logarithm of \a x, which has to be positive and normal.
+/// For \c ACCURACY_HIGH the absolute error is below 1e-6, for
+/// \c ACCURACY_FAST it is below 1e-4.
+G_INLINE __m128 log2PS(__m128 x,Accuracy const accuracy=ACCURACY_HIGH)
+{
+    __m128i bits=_mm_castps_si128(x);
+
+    // Split into the exponent and the mantissa in [1,2).
+    __m128i e=_mm_sub_epi32(_mm_srli_epi32(bits,23),_mm_set1_epi32(127));
+    __m128 m=_mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits,_mm_set1_epi32(0x007fffff)),_mm_set1_epi32(0x3f800000)));
+
+    // Move the mantissa to [sqrt(2)/2,sqrt(2)) to be centered around 1.
+    __m128 big=_mm_cmpgt_ps(m,_mm_set1_ps(1.41421356f));
+    m=_mm_or_ps(_mm_and_ps(big,_mm_mul_ps(m,_mm_set1_ps(0.5f))),_mm_andnot_ps(big,m));
+    e=_mm_sub_epi32(e,_mm_castps_si128(big));
+
+    // Use the series log(m) = 2*atanh(t) with t = (m-1)/(m+1), |t| < 0.172.
+    __m128 one=_mm_set1_ps(1.0f);
+    __m128 t=_mm_div_ps(_mm_sub_ps(m,one),_mm_add_ps(m,one));
+    __m128 t2=_mm_mul_ps(t,t);
+
+    __m128 p;
+    if (accuracy==ACCURACY_FAST) {
+        p=_mm_set1_ps(1.0f/3.0f);
+    }
+    else {
+        p=_mm_add_ps(_mm_set1_ps(1.0f/5.0f),_mm_mul_ps(t2,_mm_set1_ps(1.0f/7.0f)));
+        p=_mm_add_ps(_mm_set1_ps(1.0f/3.0f),_mm_mul_ps(t2,p));
+    }
+    p=_mm_add_ps(one,_mm_mul_ps(t2,p));
+
+    // Scale by 2/ln(2) to get the base-2 logarithm.
+    p=_mm_mul_ps(_mm_mul_ps(t,p),_mm_set1_ps(2.88539008f));
+
+    return _mm_add_ps(_mm_cvtepi32_ps(e),p);
+}
+
+/// Returns 2 raised to the power of \a x, where \a x is clamped to the range
+/// of normal floats. For \c ACCURACY_HIGH the relative error is below 2e-7,
+/// for \c ACCURACY_FAST it is below 6e-5.
+G_INLINE __m128 exp2PS(__m128 x,Accuracy const accuracy=ACCURACY_HIGH)
+{
+    x=_mm_min_ps(_mm_max_ps(x,_mm_set1_ps(-126.0f)),_mm_set1_ps(127.99f));
+
+    // Split into the nearest integer and a fraction in [-0.5,0.5].
+    __m128i i=_mm_cvtps_epi32(x);
+    __m128 u=_mm_mul_ps(_mm_sub_ps(x,_mm_cvtepi32_ps(i)),_mm_set1_ps(0.69314718f));
+
+    // Evaluate the Taylor series of exp(u) with |u| < 0.347 using Horner's rule.
+    __m128 p;
+    if (accuracy==ACCURACY_FAST) {
+        p=_mm_set1_ps(1.0f/24.0f);
+    }
+    else {
+        p=_mm_add_ps(_mm_set1_ps(1.0f/120.0f),_mm_mul_ps(u,_mm_set1_ps(1.0f/720.0f)));
+        p=_mm_add_ps(_mm_set1_ps(1.0f/24.0f),_mm_mul_ps(u,p));
+    }
+    p=_mm_add_ps(_mm_set1_ps(1.0f/6.0f),_mm_mul_ps(u,p));
+    p=_mm_add_ps(_mm_set1_ps(0.5f),_mm_mul_ps(u,p));
+    p=_mm_add_ps(_mm_set1_ps(1.0f),_mm_mul_ps(u,p));
+    p=_mm_add_ps(_mm_set1_ps(1.0f),_mm_mul_ps(u,p));
+
+    // Scale by 2^i by constructing floats directly. As i may round up to 128,
+    // which does not fit the exponent, split it into two halves.
+    __m128i h=_mm_srai_epi32(i,1);
+    __m128i bias=_mm_set1_epi32(127);
+    __m128 s0=_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(h,bias),23));
+    __m128 s1=_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_sub_epi32(i,h),bias),23));
+    return _mm_mul_ps(_mm_mul_ps(p,s0),s1);
+}
+
+/// Returns \a x raised to the power of \a y for non-negative \a x. The error
+/// corresponds to that of log2PS() and exp2PS().
+G_INLINE __m128 powPS(__m128 x,__m128 y,Accuracy const accuracy=ACCURACY_HIGH)
+{
+    __m128 zero=_mm_setzero_ps();
+
+    // Avoid taking the logarithm of 0 or denormals.
+    __m128 r=exp2PS(_mm_mul_ps(y,log2PS(_mm_max_ps(x,_mm_set1_ps(FLT_MIN)),accuracy)),accuracy);
+
+    // Handle a base of 0, which yields 0, 1 or infinity depending on y's sign.
+    __m128 null=_mm_cmpeq_ps(x,zero);
+    __m128 special=_mm_or_ps(
+        _mm_and_ps(_mm_cmpeq_ps(y,zero),_mm_set1_ps(1.0f))
+    ,   _mm_and_ps(_mm_cmplt_ps(y,zero),_mm_set1_ps(HUGE_VALF))
+    );
+
+    return _mm_or_ps(_mm_and_ps(null,special),_mm_andnot_ps(null,r));
+}
+
+//@}
+
+#endif // GALE_USE_SSE2
+
+#ifdef GALE_USE_SSE
+
+/**
+ * \name Packed reciprocals using SSE
+ * These functions calculate reciprocals for 4 floats at once.
+ */
+//@{
+
+/// Returns the reciprocal square root of the positive \a x. For
+/// \c ACCURACY_FAST the hardware estimate with a relative error below 3.7e-4
+/// is returned, for \c ACCURACY_HIGH it is refined by one Newton-Raphson step
+/// to a relative error below 1e-6, and for \c ACCURACY_EXACT it is calculated
+/// by a square root and a division.
+G_INLINE __m128 rsqrtPS(__m128 x,Accuracy const accuracy=ACCURACY_HIGH)
+{
+    if (accuracy==ACCURACY_EXACT) {
+        return _mm_div_ps(_mm_set1_ps(1.0f),_mm_sqrt_ps(x));
+    }
+
+    __m128 r=_mm_rsqrt_ps(x);
+
+    if (accuracy==ACCURACY_HIGH) {
+        // r' = r * (3 - x * r^2) / 2
+        __m128 xrr=_mm_mul_ps(_mm_mul_ps(x,r),r);
+        r=_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f),r),_mm_sub_ps(_mm_set1_ps(3.0f),xrr));
+    }
+
+    return r;
+}
+
+/// Returns the reciprocal of the non-zero \a x. For \c ACCURACY_FAST the
+/// hardware estimate with a relative error below 3.7e-4 is returned, for
+/// \c ACCURACY_HIGH it is refined by one Newton-Raphson step to a relative
+/// error below 1e-6, and for \c ACCURACY_EXACT it is calculated by a division.
+G_INLINE __m128 rcpPS(__m128 x,Accuracy const accuracy=ACCURACY_HIGH)
+{
+    if (accuracy==ACCURACY_EXACT) {
+        return _mm_div_ps(_mm_set1_ps(1.0f),x);
+    }
+
+    __m128 r=_mm_rcp_ps(x);
+
+    if (accuracy==ACCURACY_HIGH) {
+        // r' = r * (2 - x * r)
+        r=_mm_mul_ps(r,_mm_sub_ps(_mm_set1_ps(2.0f),_mm_mul_ps(x,r)));
+    }
+
+    return r;
+}
+
+//@}
+
+#endif // GALE_USE_SSE
+
+/**
+ * \name Scalar approximations
+ * These functions use the packed approximations for a single value if
+ * \c GALE_USE_SSE is defined, and the C runtime functions otherwise.
+ */
+//@{
+
+/// Returns the reciprocal square root of the positive \a x with the error
+/// bounds documented for rsqrtPS().
+G_INLINE float rsqrt(float const x,Accuracy const accuracy=ACCURACY_HIGH)
+{
+#ifdef GALE_USE_SSE
+    if (accuracy!=ACCURACY_EXACT) {
+        return _mm_cvtss_f32(rsqrtPS(_mm_set_ss(x),accuracy));
+    }
+#else
+    G_UNREF_PARAM(accuracy)
+#endif
+    return 1.0f/static_cast<float>(sqrt(static_cast<double>(x)));
+}
+
+/// Returns the reciprocal square root of the positive \a x. As there are no
+/// approximations for doubles, the \a accuracy is ignored.
+G_INLINE double rsqrt(double const x,Accuracy const accuracy=ACCURACY_HIGH)
+{
+    G_UNREF_PARAM(accuracy)
+    return 1.0/sqrt(x);
+}
+
+//@}
+
+/**
+ * \name Batch functions
+ * These functions process arrays of \a n floats at once. They are vectorized
+ * if \c GALE_USE_SSE2 is defined and \a accuracy is not \c ACCURACY_EXACT.
+ * Output arrays may alias input arrays.
+ */
+//@{
+
+/// Calculates the sines \a s and cosines \a c of the angles in \a x.
+void sinCosBatch(float const* x,float* s,float* c,int const n,Accuracy const accuracy=ACCURACY_HIGH);
+
+/// Raises the non-negative values in \a x to the power of \a y and stores the
+/// results in \a r.
+void powBatch(float const* x,float const y,float* r,int const n,Accuracy const accuracy=ACCURACY_HIGH);
+
+//@}
+
+} // namespace math
+
+} // namespace gale
@@ -30,7 +30,7 @@
  * Linear algebra homogeneous matrix routines
  */
 
-#include "vector.h"
+#include "matrix4.h"
 
 namespace gale {
 
@@ -165,20 +165,19 @@ class HMatrix4
      * \name Predefined constants
      * In order to avoid the so called "static initialization order fiasco",
      * static methods instead of static variables are used here, see
-     * http://www.parashift.com/c++-faq-lite/ctors.html#faq-10.14.
+     * http://www.parashift.com/c++-faq-lite/ctors.html#faq-10.14. The
+     * constants are returned by value so they can be folded at compile time.
      */
     //@{
 
     /// Returns a matrix which has all components set to 0.
-    static HMatrix4 const& ZERO() {
-        static HMatrix4 const m(Vec::ZERO(),Vec::ZERO(),Vec::ZERO(),Vec::ZERO());
-        return m;
+    static G_CONSTEXPR HMatrix4 ZERO() {
+        return HMatrix4(Vec::ZERO(),Vec::ZERO(),Vec::ZERO(),Vec::ZERO());
     }
 
     /// Returns the identity matrix (regarding multiplication).
-    static HMatrix4 const& IDENTITY() {
-        static HMatrix4 const m(Vec::X(),Vec::Y(),Vec::Z(),Vec::ZERO());
-        return m;
+    static G_CONSTEXPR HMatrix4 IDENTITY() {
+        return HMatrix4(Vec::X(),Vec::Y(),Vec::Z(),Vec::ZERO());
     }
 
     //@}
@@ -202,7 +201,7 @@ class HMatrix4
     :   m_c0w(0),m_c1w(0),m_c2w(0),m_c3w(1) {}
 
     /// Initialize the column vectors with vectors \a c0, \a c1, \a c2 and \a c3.
-    HMatrix4(Vec const& c0,Vec const& c1,Vec const& c2,Vec const& c3)
+    G_CONSTEXPR HMatrix4(Vec const& c0,Vec const& c1,Vec const& c2,Vec const& c3)
     :   c0(c0),m_c0w(0)
     ,   c1(c1),m_c1w(0)
     ,   c2(c2),m_c2w(0)
@@ -384,18 +383,9 @@ class HMatrix4
 
     /// Returns matrix \a m multiplied by matrix \a n from the right.
     friend HMatrix4 operator*(HMatrix4 const& m,HMatrix4 const& n) {
-        Vec c0,c1,c2,c3;
-
-        // 36 scalar muls/divs, 27 scalar adds/subs (includes translation).
-        for (int row=2;row>=0;--row) {
-            int col1=row+4,col2=row+8,col3=row+12;
-            c0[row] = m[row]*n[ 0] + m[col1]*n[ 1] + m[col2]*n[ 2];
-            c1[row] = m[row]*n[ 4] + m[col1]*n[ 5] + m[col2]*n[ 6];
-            c2[row] = m[row]*n[ 8] + m[col1]*n[ 9] + m[col2]*n[10];
-            c3[row] = m[row]*n[12] + m[col1]*n[13] + m[col2]*n[14] + m[col3];
-        }
-
-        return HMatrix4(c0,c1,c2,c3);
+        HMatrix4 tmp;
+        Matrix4Kernels<T>::mulAffine(tmp.data(),m.data(),n.data());
+        return tmp;
     }
 
     /// Returns matrix \a m multiplied by the inverse of matrix \a n from the right.
@@ -551,17 +541,25 @@ class HMatrix4
         }
 
         if (valid) {
-            // Invert any scaling.
-            c0/=c0.length2();
-            c1/=c1.length2();
-            c2/=c2.length2();
+            // Invert any scaling, rotation and translation.
+            HMatrix4 tmp;
+            Matrix4Kernels<T>::invertAffine(tmp.data(),data());
+            *this=tmp;
+        }
+    }
 
-            // Invert any translation.
-            c3=Vec(-c3%c0,-c3%c1,-c3%c2);
+    /// Calculates the \a count matrices in \a r as the matrices in \a m
+    /// multiplied by the matrices in \a n from the right, e.g. to combine the
+    /// bone transformations with the inverse bind poses for skinning.
+    static void multiply(HMatrix4* const r,HMatrix4 const* const m,HMatrix4 const* const n,int const count) {
+        Matrix4Kernels<T>::mulAffineBatch(r->data(),m->data(),n->data(),count);
+    }
 
-            // Invert any rotation.
-            transpose();
-        }
+    /// Calculates the \a count matrices in \a r as matrix \a m multiplied by
+    /// the matrices in \a n from the right, e.g. to combine the view with the
+    /// model transformations of instances.
+    static void multiply(HMatrix4* const r,HMatrix4 const& m,HMatrix4 const* const n,int const count) {
+        Matrix4Kernels<T>::mulAffineBroadcast(r->data(),m.data(),n->data(),count);
     }
 
     //@}
@@ -32,6 +32,8 @@
 
 #include "../global/dynamicarray.h"
 
+#include "expression.h"
+
 // For specialized friend lerp()-methods.
 #include "quaternion.h"
 
@@ -199,12 +201,15 @@ class Interpolator
     /// \a v2, \a v3, the weights in \a w and the factor \a f, at position \a s.
     template<class T>
     static T evalPolynomial(T const& v0,T const& v1,T const& v2,T const& v3,signed char const (&w)[16],float const f,float const s) {
-        T a=f*(v0*w[ 0] + v1*w[ 1] + v2*w[ 2] + v3*w[ 3]);
-        T b=f*(v0*w[ 4] + v1*w[ 5] + v2*w[ 6] + v3*w[ 7]);
-        T c=f*(v0*w[ 8] + v1*w[ 9] + v2*w[10] + v3*w[11]);
-        T d=f*(v0*w[12] + v1*w[13] + v2*w[14] + v3*w[15]);
-
-        return ((a*s + b)*s + c)*s + d;
+        // Evaluate the basis functions for all values first, which only
+        // requires scalar arithmetics, and then sum up the weighted values in
+        // a single expression.
+        float b0=f*(((w[ 0]*s + w[ 4])*s + w[ 8])*s + w[12]);
+        float b1=f*(((w[ 1]*s + w[ 5])*s + w[ 9])*s + w[13]);
+        float b2=f*(((w[ 2]*s + w[ 6])*s + w[10])*s + w[14]);
+        float b3=f*(((w[ 3]*s + w[ 7])*s + w[11])*s + w[15]);
+
+        return lazy(v0)*b0 + lazy(v1)*b1 + lazy(v2)*b2 + lazy(v3)*b3;
     }
 };
 
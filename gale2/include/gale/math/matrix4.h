@@ -36,6 +36,198 @@ namespace gale {
 
 namespace math {
 
+/**
+ * Scalar kernels for the products of 4x4 matrices in column-major order with
+ * other matrices and vectors. These also serve as the reference for the SIMD
+ * kernels. The result \a r must not alias any of the arguments.
+ */
+template<typename T>
+struct Matrix4ScalarKernels
+{
+    /// Calculates \a r as matrix \a m multiplied by matrix \a n from the right.
+    static void mulMatMat(T* const r,T const* const m,T const* const n) {
+        // 64 scalar muls/divs, 48 scalar adds/subs.
+        for (int row=3;row>=0;--row) {
+            int col1=row+4,col2=row+8,col3=row+12;
+            r[row ] = m[row]*n[ 0] + m[col1]*n[ 1] + m[col2]*n[ 2] + m[col3]*n[ 3];
+            r[col1] = m[row]*n[ 4] + m[col1]*n[ 5] + m[col2]*n[ 6] + m[col3]*n[ 7];
+            r[col2] = m[row]*n[ 8] + m[col1]*n[ 9] + m[col2]*n[10] + m[col3]*n[11];
+            r[col3] = m[row]*n[12] + m[col1]*n[13] + m[col2]*n[14] + m[col3]*n[15];
+        }
+    }
+
+    /// Calculates \a r as matrix \a m multiplied from the left to column
+    /// vector \a v.
+    static void mulMatVec(T* const r,T const* const m,T const* const v) {
+        // 16 scalar muls/divs, 12 scalar adds/subs.
+        r[0] = m[0]*v[0] + m[4]*v[1] + m[ 8]*v[2] + m[12]*v[3];
+        r[1] = m[1]*v[0] + m[5]*v[1] + m[ 9]*v[2] + m[13]*v[3];
+        r[2] = m[2]*v[0] + m[6]*v[1] + m[10]*v[2] + m[14]*v[3];
+        r[3] = m[3]*v[0] + m[7]*v[1] + m[11]*v[2] + m[15]*v[3];
+    }
+
+    /// Calculates \a r as matrix \a m multiplied from the right to row vector
+    /// \a v.
+    static void mulVecMat(T* const r,T const* const m,T const* const v) {
+        // 16 scalar muls/divs, 12 scalar adds/subs.
+        r[0] = v[0]*m[ 0] + v[1]*m[ 1] + v[2]*m[ 2] + v[3]*m[ 3];
+        r[1] = v[0]*m[ 4] + v[1]*m[ 5] + v[2]*m[ 6] + v[3]*m[ 7];
+        r[2] = v[0]*m[ 8] + v[1]*m[ 9] + v[2]*m[10] + v[3]*m[11];
+        r[3] = v[0]*m[12] + v[1]*m[13] + v[2]*m[14] + v[3]*m[15];
+    }
+
+    /// Calculates \a r as affine matrix \a m multiplied by affine matrix \a n
+    /// from the right, i.e. the last rows of \a m and \a n are assumed to be
+    /// (0,0,0,1).
+    static void mulAffine(T* const r,T const* const m,T const* const n) {
+        // 36 scalar muls/divs, 27 scalar adds/subs (includes translation).
+        for (int row=2;row>=0;--row) {
+            int col1=row+4,col2=row+8,col3=row+12;
+            r[row ] = m[row]*n[ 0] + m[col1]*n[ 1] + m[col2]*n[ 2];
+            r[col1] = m[row]*n[ 4] + m[col1]*n[ 5] + m[col2]*n[ 6];
+            r[col2] = m[row]*n[ 8] + m[col1]*n[ 9] + m[col2]*n[10];
+            r[col3] = m[row]*n[12] + m[col1]*n[13] + m[col2]*n[14] + m[col3];
+        }
+        r[3]=r[7]=r[11]=0;
+        r[15]=1;
+    }
+
+    /// Calculates the \a count matrices in \a r as the matrices in \a m
+    /// multiplied by the matrices in \a n from the right.
+    static void mulMatMatBatch(T* const r,T const* const m,T const* const n,int const count) {
+        for (int i=0;i<count*16;i+=16) {
+            mulMatMat(r+i,m+i,n+i);
+        }
+    }
+
+    /// Calculates the \a count matrices in \a r as the single matrix \a m
+    /// multiplied by the matrices in \a n from the right.
+    static void mulMatMatBroadcast(T* const r,T const* const m,T const* const n,int const count) {
+        for (int i=0;i<count*16;i+=16) {
+            mulMatMat(r+i,m,n+i);
+        }
+    }
+
+    /// Calculates the \a count affine matrices in \a r as the affine matrices
+    /// in \a m multiplied by the affine matrices in \a n from the right.
+    static void mulAffineBatch(T* const r,T const* const m,T const* const n,int const count) {
+        for (int i=0;i<count*16;i+=16) {
+            mulAffine(r+i,m+i,n+i);
+        }
+    }
+
+    /// Calculates the \a count affine matrices in \a r as the single affine
+    /// matrix \a m multiplied by the affine matrices in \a n from the right.
+    static void mulAffineBroadcast(T* const r,T const* const m,T const* const n,int const count) {
+        for (int i=0;i<count*16;i+=16) {
+            mulAffine(r+i,m,n+i);
+        }
+    }
+
+    /// Calculates \a r as the transpose of matrix \a m.
+    static void transpose(T* const r,T const* const m) {
+        for (int i=0;i<4;++i) {
+            r[i   ]=m[i*4  ];
+            r[i+ 4]=m[i*4+1];
+            r[i+ 8]=m[i*4+2];
+            r[i+12]=m[i*4+3];
+        }
+    }
+
+    /// Returns the determinant of matrix \a m.
+    static T determinant(T const* const m) {
+        T a[6],b[6];
+        interim(m,a,b);
+        return a[0]*b[5] - a[1]*b[4] + a[2]*b[3] + a[3]*b[2] - a[4]*b[1] + a[5]*b[0];
+    }
+
+    /// Calculates \a r as the adjoint of matrix \a m and returns the
+    /// determinant of \a m.
+    static T adjoint(T* const r,T const* const m) {
+        T a[6],b[6];
+        interim(m,a,b);
+
+        int o0=0;
+        int o1=1;
+        T const* f=b;
+
+        for (int i=0;i<2;++i) {
+            T* v=r+o0*4;
+            v[0] = + m[ 4+o1]*f[5] - m[ 8+o1]*f[4] + m[12+o1]*f[3];
+            v[1] = - m[   o1]*f[5] + m[ 8+o1]*f[2] - m[12+o1]*f[1];
+            v[2] = + m[   o1]*f[4] - m[ 4+o1]*f[2] + m[12+o1]*f[0];
+            v[3] = - m[   o1]*f[3] + m[ 4+o1]*f[1] - m[ 8+o1]*f[0];
+
+            v=r+o1*4;
+            v[0] = - m[ 4+o0]*f[5] + m[ 8+o0]*f[4] - m[12+o0]*f[3];
+            v[1] = + m[   o0]*f[5] - m[ 8+o0]*f[2] + m[12+o0]*f[1];
+            v[2] = - m[   o0]*f[4] + m[ 4+o0]*f[2] - m[12+o0]*f[0];
+            v[3] = + m[   o0]*f[3] - m[ 4+o0]*f[1] + m[ 8+o0]*f[0];
+
+            o0+=2;
+            o1+=2;
+            f=a;
+        }
+
+        return a[0]*b[5] - a[1]*b[4] + a[2]*b[3] + a[3]*b[2] - a[4]*b[1] + a[5]*b[0];
+    }
+
+    /// Calculates \a r as the inverse of the affine matrix \a m, whose upper
+    /// left 3x3 part is assumed to be orthogonal. Any scaling is inverted by
+    /// dividing the columns by their squared lengths, the rotation by
+    /// transposing the 3x3 part, and the translation by transforming it with
+    /// the inverted 3x3 part.
+    static void invertAffine(T* const r,T const* const m) {
+        for (int i=0;i<3;++i) {
+            T const* c=m+i*4;
+            T s=1/(c[0]*c[0] + c[1]*c[1] + c[2]*c[2]);
+            r[i  ]=c[0]*s;
+            r[i+4]=c[1]*s;
+            r[i+8]=c[2]*s;
+            r[i+12]=-(m[12]*c[0] + m[13]*c[1] + m[14]*c[2])*s;
+        }
+        r[3]=r[7]=r[11]=0;
+        r[15]=1;
+    }
+
+  private:
+
+    /// Calculates the 2x2 minors of the upper two rows of matrix \a m into
+    /// \a a and those of the lower two rows into \a b, for the column pairs
+    /// (0,1), (0,2), (0,3), (1,2), (1,3) and (2,3).
+    static void interim(T const* const m,T (&a)[6],T (&b)[6]) {
+        static unsigned int const indices[]={
+            0,  0,  0,  4,  4,  8
+        ,   5,  9, 13,  9, 13, 13
+        };
+
+        for (int i=0;i<6;++i) {
+            unsigned int o0=indices[i];
+            unsigned int o1=indices[i+6];
+
+            a[i]=m[o0]*m[o1] - m[o1-1]*m[o0+1];
+
+            o0+=2;
+            o1+=2;
+
+            b[i]=m[o0]*m[o1] - m[o1-1]*m[o0+1];
+        }
+    }
+};
+
+/**
+ * The kernels used by Matrix4. The SIMD specializations for \c float and
+ * \c double are selected at compile time by \c GALE_USE_SSE, \c GALE_USE_AVX
+ * and \c GALE_USE_FMA, all other types use the scalar kernels. See
+ * Matrix4KernelSet for kernels that are selected at runtime instead.
+ */
+template<typename T>
+struct Matrix4Kernels:public Matrix4ScalarKernels<T>
+{
+};
+
+#include "matrix4_simd.inl"
+
 // Make sure data members are tightly packed.
 #pragma pack(push,1)
 
@@ -147,20 +339,19 @@ class Matrix4
      * \name Predefined constants
      * In order to avoid the so called "static initialization order fiasco",
      * static methods instead of static variables are used here, see
-     * http://www.parashift.com/c++-faq-lite/ctors.html#faq-10.14.
+     * http://www.parashift.com/c++-faq-lite/ctors.html#faq-10.14. The
+     * constants are returned by value so they can be folded at compile time.
      */
     //@{
 
     /// Returns a matrix which has all components set to 0.
-    static Matrix4 const& ZERO() {
-        static Matrix4 const m(Vec::ZERO(),Vec::ZERO(),Vec::ZERO(),Vec::ZERO());
-        return m;
+    static G_CONSTEXPR Matrix4 ZERO() {
+        return Matrix4(Vec::ZERO(),Vec::ZERO(),Vec::ZERO(),Vec::ZERO());
     }
 
     /// Returns the identity matrix (regarding multiplication).
-    static Matrix4 const& IDENTITY() {
-        static Matrix4 const m(Vec::X(),Vec::Y(),Vec::Z(),Vec::W());
-        return m;
+    static G_CONSTEXPR Matrix4 IDENTITY() {
+        return Matrix4(Vec::X(),Vec::Y(),Vec::Z(),Vec::W());
     }
 
     //@}
@@ -190,7 +381,7 @@ class Matrix4
     Matrix4() {}
 
     /// Initialize the column vectors with vectors \a c0 to \a c3.
-    Matrix4(Vec const& c0,Vec const& c1,Vec const& c2,Vec const& c3)
+    G_CONSTEXPR Matrix4(Vec const& c0,Vec const& c1,Vec const& c2,Vec const& c3)
     :   c0(c0),c1(c1),c2(c2),c3(c3) {}
 
     /// Creates a matrix from multiplying column vector \a c with row vector \a r.
@@ -292,18 +483,9 @@ class Matrix4
 
     /// Returns matrix \a m multiplied by matrix \a n from the right.
     friend Matrix4 operator*(Matrix4 const& m,Matrix4 const& n) {
-        Vec c0,c1,c2,c3;
-
-        // 64 scalar muls/divs, 48 scalar adds/subs.
-        for (int row=3;row>=0;--row) {
-            int col1=row+4,col2=row+8,col3=row+12;
-            c0[row] = m[row]*n[ 0] + m[col1]*n[ 1] + m[col2]*n[ 2] + m[col3]*n[ 3];
-            c1[row] = m[row]*n[ 4] + m[col1]*n[ 5] + m[col2]*n[ 6] + m[col3]*n[ 7];
-            c2[row] = m[row]*n[ 8] + m[col1]*n[ 9] + m[col2]*n[10] + m[col3]*n[11];
-            c3[row] = m[row]*n[12] + m[col1]*n[13] + m[col2]*n[14] + m[col3]*n[15];
-        }
-
-        return Matrix4(c0,c1,c2,c3);
+        Matrix4 tmp;
+        Matrix4Kernels<T>::mulMatMat(tmp.data(),m.data(),n.data());
+        return tmp;
     }
 
     //@}
@@ -316,25 +498,17 @@ class Matrix4
     /// Multiplies this matrix from the left to column vector \a v (resulting in
     /// a column vector).
     Vec mulMatVec(Vec const& v) const {
-        // 16 scalar muls/divs, 12 scalar adds/subs.
-        return Vec(
-            c0[0]*v[0] + c1[0]*v[1] + c2[0]*v[2] + c3[0]*v[3]
-        ,   c0[1]*v[0] + c1[1]*v[1] + c2[1]*v[2] + c3[1]*v[3]
-        ,   c0[2]*v[0] + c1[2]*v[1] + c2[2]*v[2] + c3[2]*v[3]
-        ,   c0[3]*v[0] + c1[3]*v[1] + c2[3]*v[2] + c3[3]*v[3]
-        );
+        Vec tmp;
+        Matrix4Kernels<T>::mulMatVec(tmp.data(),data(),v.data());
+        return tmp;
     }
 
     /// Multiplies this matrix from the right to row vector \a v (resulting in a
     /// row vector).
     Vec mulVecMat(Vec const& v) const {
-        // 16 scalar muls/divs, 12 scalar adds/subs.
-        return Vec(
-            v[0]*c0[0] + v[1]*c0[1] + v[2]*c0[2] + v[3]*c0[3]
-        ,   v[0]*c1[0] + v[1]*c1[1] + v[2]*c1[2] + v[3]*c1[3]
-        ,   v[0]*c2[0] + v[1]*c2[1] + v[2]*c2[2] + v[3]*c2[3]
-        ,   v[0]*c3[0] + v[1]*c3[1] + v[2]*c3[2] + v[3]*c3[3]
-        );
+        Vec tmp;
+        Matrix4Kernels<T>::mulVecMat(tmp.data(),data(),v.data());
+        return tmp;
     }
 
     /// Multiplies this matrix from the left to column vector \a v (resulting in
@@ -440,25 +614,28 @@ class Matrix4
 
     /// Returns the determinant of this matrix.
     T determinant() const {
-        T a[6],b[6];
-        interim(a,b);
-        return determinant(a,b);
+        return Matrix4Kernels<T>::determinant(data());
     }
 
     /// Returns the adjoint of this matrix.
     Matrix4 adjoint() const {
-        T a[6],b[6];
-        interim(a,b);
-        return adjoint(a,b);
+        Matrix4 tmp;
+        Matrix4Kernels<T>::adjoint(tmp.data(),data());
+        return tmp;
+    }
+
+    /// Transposes this matrix.
+    void transpose() {
+        Matrix4 tmp;
+        Matrix4Kernels<T>::transpose(tmp.data(),data());
+        *this=tmp;
     }
 
     /// Inverts this matrix. Optionally returns a \a result indicating whether
     /// the matrix' determinant is non-zero and thus the inverse exists.
     void invert(bool* const result=NULL) {
-        T a[6],b[6];
-        interim(a,b);
-
-        T det=determinant(a,b);
+        Matrix4 tmp;
+        T det=Matrix4Kernels<T>::adjoint(tmp.data(),data());
         bool valid=(abs(det)>Numerics<T>::ZERO_TOLERANCE());
 
         if (result) {
@@ -466,10 +643,24 @@ class Matrix4
         }
 
         if (valid) {
-            *this=(1/det)*adjoint(a,b);
+            *this=tmp*(1/det);
         }
     }
 
+    /// Calculates the \a count matrices in \a r as the matrices in \a m
+    /// multiplied by the matrices in \a n from the right, e.g. to combine the
+    /// bone transformations with the inverse bind poses for skinning.
+    static void multiply(Matrix4* const r,Matrix4 const* const m,Matrix4 const* const n,int const count) {
+        Matrix4Kernels<T>::mulMatMatBatch(r->data(),m->data(),n->data(),count);
+    }
+
+    /// Calculates the \a count matrices in \a r as matrix \a m multiplied by
+    /// the matrices in \a n from the right, e.g. to combine the view projection
+    /// with the model transformations of instances.
+    static void multiply(Matrix4* const r,Matrix4 const& m,Matrix4 const* const n,int const count) {
+        Matrix4Kernels<T>::mulMatMatBroadcast(r->data(),m.data(),n->data(),count);
+    }
+
     //@}
 
     /**
@@ -519,63 +710,6 @@ class Matrix4
 
 #endif // GALE_TINY_CODE
 
-  private:
-
-    /// Calculates interim results for determinant() and adjoint().
-    void interim(T (&a)[6],T (&b)[6]) const {
-        static unsigned int const indices[]={
-            0,  0,  0,  4,  4,  8
-        ,   5,  9, 13,  9, 13, 13
-        };
-
-        for (int i=0;i<6;++i) {
-            unsigned int o0=indices[i];
-            unsigned int o1=indices[i+6];
-
-            a[i]=(*this)[o0]*(*this)[o1] - (*this)[o1-1]*(*this)[o0+1];
-
-            o0+=2;
-            o1+=2;
-
-            b[i]=(*this)[o0]*(*this)[o1] - (*this)[o1-1]*(*this)[o0+1];
-        }
-    }
-
-    /// Returns the determinant based on the interim values in \a a and \a b.
-    T determinant(T const a[6],T const b[6]) const {
-        return a[0]*b[5] - a[1]*b[4] + a[2]*b[3] + a[3]*b[2] - a[4]*b[1] + a[5]*b[0];
-    }
-
-    /// Returns the adjoint based on the interim values in \a a and \a b.
-    Matrix4 adjoint(T const a[6],T const b[6]) const {
-        Vec v[4];
-
-        unsigned int o0=0;
-        unsigned int o1=1;
-        T const* f=b;
-
-        for (int i=0;i<2;++i) {
-            v[o0]=Vec(
-                + c1[o1]*f[5] - c2[o1]*f[4] + c3[o1]*f[3]
-            ,   - c0[o1]*f[5] + c2[o1]*f[2] - c3[o1]*f[1]
-            ,   + c0[o1]*f[4] - c1[o1]*f[2] + c3[o1]*f[0]
-            ,   - c0[o1]*f[3] + c1[o1]*f[1] - c2[o1]*f[0]
-            );
-            v[o1]=Vec(
-                - c1[o0]*f[5] + c2[o0]*f[4] - c3[o0]*f[3]
-            ,   + c0[o0]*f[5] - c2[o0]*f[2] + c3[o0]*f[1]
-            ,   - c0[o0]*f[4] + c1[o0]*f[2] - c3[o0]*f[0]
-            ,   + c0[o0]*f[3] - c1[o0]*f[1] + c2[o0]*f[0]
-            );
-
-            o0+=2;
-            o1+=2;
-            f=a;
-        }
-
-        return Matrix4(v[0],v[1],v[2],v[3]);
-    }
-
   public:
 
     Vec c0; ///< The first column vector.
@@ -596,6 +730,48 @@ typedef Matrix4<float> Mat4f;
 
 //@}
 
+/**
+ * A set of matrix kernels that is selected at runtime based on the instruction
+ * set extensions reported by system::CPUInfo. In contrast to Matrix4Kernels,
+ * this allows to use AVX and FMA in builds that need to run on older CPUs.
+ */
+struct Matrix4KernelSet
+{
+    /// Instruction set levels for which kernels are available.
+    enum Level {
+        LEVEL_SCALAR ///< Plain C++ code.
+    ,   LEVEL_SSE    ///< SSE for floats, doubles use the scalar code.
+    ,   LEVEL_AVX    ///< AVX combined with FMA for floats and doubles.
+    };
+
+    /// Returns the highest level supported by the CPU.
+    static Level maxLevel();
+
+    /// Returns the kernels for the given \a level, which is clamped to the
+    /// highest level supported by the CPU.
+    static Matrix4KernelSet const& get(Level level=LEVEL_AVX);
+
+    Level level; ///< The level the kernels were compiled for.
+
+    /// Kernel for Matrix4ScalarKernels::mulMatMat() on floats.
+    void (*mulMatMatf)(float* const r,float const* const m,float const* const n);
+
+    /// Kernel for Matrix4ScalarKernels::mulMatVec() on floats.
+    void (*mulMatVecf)(float* const r,float const* const m,float const* const v);
+
+    /// Kernel for Matrix4ScalarKernels::mulVecMat() on floats.
+    void (*mulVecMatf)(float* const r,float const* const m,float const* const v);
+
+    /// Kernel for Matrix4ScalarKernels::mulMatMat() on doubles.
+    void (*mulMatMatd)(double* const r,double const* const m,double const* const n);
+
+    /// Kernel for Matrix4ScalarKernels::mulMatVec() on doubles.
+    void (*mulMatVecd)(double* const r,double const* const m,double const* const v);
+
+    /// Kernel for Matrix4ScalarKernels::mulVecMat() on doubles.
+    void (*mulVecMatd)(double* const r,double const* const m,double const* const v);
+};
+
 } // namespace math
 
 } // namespace gale
@@ -0,0 +1,471 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#if defined(GALE_USE_FMA) || defined(GALE_USE_AVX)
+    #include <immintrin.h>
+#elif defined(GALE_USE_SSE)
+    #include <xmmintrin.h>
+#endif
+
+#ifdef GALE_USE_SSE
+
+/**
+ * Matrix kernels for floats using SSE instructions, and FMA instructions if
+ * \c GALE_USE_FMA is defined. As the matrix data is tightly packed, unaligned
+ * loads and stores are used.
+ */
+template<>
+struct Matrix4Kernels<float>:public Matrix4ScalarKernels<float>
+{
+    /// Returns \a a * \a b + \a c.
+    static G_INLINE __m128 madd(__m128 const a,__m128 const b,__m128 const c) {
+#ifdef GALE_USE_FMA
+        return _mm_fmadd_ps(a,b,c);
+#else
+        return _mm_add_ps(_mm_mul_ps(a,b),c);
+#endif
+    }
+
+    /// Returns the linear combination of the columns of matrix \a m with the
+    /// elements of vector \a v as the weights.
+    static G_INLINE __m128 combine(float const* const m,float const* const v) {
+        __m128 r=_mm_mul_ps(_mm_loadu_ps(m),_mm_set1_ps(v[0]));
+        r=madd(_mm_loadu_ps(m+ 4),_mm_set1_ps(v[1]),r);
+        r=madd(_mm_loadu_ps(m+ 8),_mm_set1_ps(v[2]),r);
+        return madd(_mm_loadu_ps(m+12),_mm_set1_ps(v[3]),r);
+    }
+
+    /// Calculates \a r as matrix \a m multiplied by matrix \a n from the right.
+    static void mulMatMat(float* const r,float const* const m,float const* const n) {
+        _mm_storeu_ps(r   ,combine(m,n   ));
+        _mm_storeu_ps(r+ 4,combine(m,n+ 4));
+        _mm_storeu_ps(r+ 8,combine(m,n+ 8));
+        _mm_storeu_ps(r+12,combine(m,n+12));
+    }
+
+    /// Calculates \a r as matrix \a m multiplied from the left to column
+    /// vector \a v.
+    static void mulMatVec(float* const r,float const* const m,float const* const v) {
+        _mm_storeu_ps(r,combine(m,v));
+    }
+
+    /// Calculates \a r as matrix \a m multiplied from the right to row vector
+    /// \a v.
+    static void mulVecMat(float* const r,float const* const m,float const* const v) {
+        __m128 x=_mm_loadu_ps(v);
+        __m128 p0=_mm_mul_ps(_mm_loadu_ps(m   ),x);
+        __m128 p1=_mm_mul_ps(_mm_loadu_ps(m+ 4),x);
+        __m128 p2=_mm_mul_ps(_mm_loadu_ps(m+ 8),x);
+        __m128 p3=_mm_mul_ps(_mm_loadu_ps(m+12),x);
+
+        // Sum up the products horizontally.
+        _MM_TRANSPOSE4_PS(p0,p1,p2,p3);
+        _mm_storeu_ps(r,_mm_add_ps(_mm_add_ps(p0,p1),_mm_add_ps(p2,p3)));
+    }
+
+    /// Calculates \a r as affine matrix \a m multiplied by affine matrix \a n
+    /// from the right. As the last row of the result is calculated exactly,
+    /// this is just the general product.
+    static void mulAffine(float* const r,float const* const m,float const* const n) {
+        mulMatMat(r,m,n);
+    }
+
+    /// Calculates the \a count matrices in \a r as the matrices in \a m
+    /// multiplied by the matrices in \a n from the right.
+    static void mulMatMatBatch(float* const r,float const* const m,float const* const n,int const count) {
+        for (int i=0;i<count*16;i+=16) {
+            mulMatMat(r+i,m+i,n+i);
+        }
+    }
+
+    /// Calculates the \a count matrices in \a r as the single matrix \a m
+    /// multiplied by the matrices in \a n from the right. The columns of \a m
+    /// are kept in registers for all products.
+    static void mulMatMatBroadcast(float* const r,float const* const m,float const* const n,int const count) {
+        __m128 m0=_mm_loadu_ps(m   );
+        __m128 m1=_mm_loadu_ps(m+ 4);
+        __m128 m2=_mm_loadu_ps(m+ 8);
+        __m128 m3=_mm_loadu_ps(m+12);
+
+        for (int i=0;i<count*16;i+=4) {
+            float const* v=n+i;
+            __m128 c=_mm_mul_ps(m0,_mm_set1_ps(v[0]));
+            c=madd(m1,_mm_set1_ps(v[1]),c);
+            c=madd(m2,_mm_set1_ps(v[2]),c);
+            _mm_storeu_ps(r+i,madd(m3,_mm_set1_ps(v[3]),c));
+        }
+    }
+
+    /// Calculates the \a count affine matrices in \a r as the affine matrices
+    /// in \a m multiplied by the affine matrices in \a n from the right.
+    static void mulAffineBatch(float* const r,float const* const m,float const* const n,int const count) {
+        mulMatMatBatch(r,m,n,count);
+    }
+
+    /// Calculates the \a count affine matrices in \a r as the single affine
+    /// matrix \a m multiplied by the affine matrices in \a n from the right.
+    static void mulAffineBroadcast(float* const r,float const* const m,float const* const n,int const count) {
+        mulMatMatBroadcast(r,m,n,count);
+    }
+
+    /// Calculates \a r as the transpose of matrix \a m.
+    static void transpose(float* const r,float const* const m) {
+        __m128 c0=_mm_loadu_ps(m   );
+        __m128 c1=_mm_loadu_ps(m+ 4);
+        __m128 c2=_mm_loadu_ps(m+ 8);
+        __m128 c3=_mm_loadu_ps(m+12);
+
+        _MM_TRANSPOSE4_PS(c0,c1,c2,c3);
+
+        _mm_storeu_ps(r   ,c0);
+        _mm_storeu_ps(r+ 4,c1);
+        _mm_storeu_ps(r+ 8,c2);
+        _mm_storeu_ps(r+12,c3);
+    }
+
+    /// Returns the 2x2 minors of rows \a a and \a b for the column pairs given
+    /// by the shuffle masks \a P and \a Q.
+    template<int P,int Q>
+    static G_INLINE __m128 minors(__m128 const a,__m128 const b) {
+        return _mm_sub_ps(
+            _mm_mul_ps(_mm_shuffle_ps(a,a,P),_mm_shuffle_ps(b,b,Q))
+        ,   _mm_mul_ps(_mm_shuffle_ps(a,a,Q),_mm_shuffle_ps(b,b,P))
+        );
+    }
+
+    /// Returns the cofactors for the elements of row \a v, given the minors
+    /// \a f0, \a f1 and \a f2 of the pair of rows that does not contain it.
+    static G_INLINE __m128 cofactors(__m128 const v,__m128 const f0,__m128 const f1,__m128 const f2) {
+        __m128 c=_mm_mul_ps(_mm_shuffle_ps(v,v,_MM_SHUFFLE(0,0,0,1)),f0);
+        c=madd(_mm_shuffle_ps(v,v,_MM_SHUFFLE(1,1,2,2)),f1,c);
+        return madd(_mm_shuffle_ps(v,v,_MM_SHUFFLE(2,3,3,3)),f2,c);
+    }
+
+    /// Calculates \a r as the adjoint of matrix \a m and returns the
+    /// determinant of \a m. This vectorizes the scalar kernel by working on
+    /// the rows of \a m.
+    static float adjoint(float* const r,float const* const m) {
+        __m128 r0=_mm_loadu_ps(m   );
+        __m128 r1=_mm_loadu_ps(m+ 4);
+        __m128 r2=_mm_loadu_ps(m+ 8);
+        __m128 r3=_mm_loadu_ps(m+12);
+
+        _MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+
+        // The minors of the lower two rows for the ordered column pairs
+        // (2,3), (3,2), (1,3), (2,1), then (3,1), (0,3), (3,0), (0,2), and
+        // then (1,2), (2,0), (0,1), (1,0), where swapping a pair negates it.
+        __m128 b0=minors<_MM_SHUFFLE(2,1,3,2),_MM_SHUFFLE(1,3,2,3)>(r2,r3);
+        __m128 b1=minors<_MM_SHUFFLE(0,3,0,3),_MM_SHUFFLE(2,0,3,1)>(r2,r3);
+        __m128 b2=minors<_MM_SHUFFLE(1,0,2,1),_MM_SHUFFLE(0,1,0,2)>(r2,r3);
+
+        // The same for the upper two rows.
+        __m128 a0=minors<_MM_SHUFFLE(2,1,3,2),_MM_SHUFFLE(1,3,2,3)>(r0,r1);
+        __m128 a1=minors<_MM_SHUFFLE(0,3,0,3),_MM_SHUFFLE(2,0,3,1)>(r0,r1);
+        __m128 a2=minors<_MM_SHUFFLE(1,0,2,1),_MM_SHUFFLE(0,1,0,2)>(r0,r1);
+
+        __m128 zero=_mm_setzero_ps();
+        __m128 c0=cofactors(r1,b0,b1,b2);
+        _mm_storeu_ps(r   ,c0);
+        _mm_storeu_ps(r+ 4,_mm_sub_ps(zero,cofactors(r0,b0,b1,b2)));
+        _mm_storeu_ps(r+ 8,cofactors(r3,a0,a1,a2));
+        _mm_storeu_ps(r+12,_mm_sub_ps(zero,cofactors(r2,a0,a1,a2)));
+
+        // Expand the determinant along the first row.
+        __m128 d=_mm_mul_ps(r0,c0);
+        d=_mm_add_ps(d,_mm_movehl_ps(d,d));
+        d=_mm_add_ss(d,_mm_shuffle_ps(d,d,_MM_SHUFFLE(1,1,1,1)));
+        return _mm_cvtss_f32(d);
+    }
+
+    /// Calculates \a r as the inverse of the affine matrix \a m, whose upper
+    /// left 3x3 part is assumed to be orthogonal.
+    static void invertAffine(float* const r,float const* const m) {
+        __m128 r0=_mm_loadu_ps(m   );
+        __m128 r1=_mm_loadu_ps(m+ 4);
+        __m128 r2=_mm_loadu_ps(m+ 8);
+        __m128 r3=_mm_loadu_ps(m+12);
+
+        _MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+
+        // Get the reciprocal squared lengths of the columns. The last element
+        // is made zero without dividing by the possibly zero translation.
+        __m128 l=_mm_add_ps(_mm_mul_ps(r0,r0),_mm_set_ps(1,0,0,0));
+        l=madd(r1,r1,l);
+        l=madd(r2,r2,l);
+        __m128 s=_mm_div_ps(_mm_set_ps(0,1,1,1),l);
+
+        // The scaled rows are the columns of the inverse.
+        r0=_mm_mul_ps(r0,s);
+        r1=_mm_mul_ps(r1,s);
+        r2=_mm_mul_ps(r2,s);
+
+        __m128 t=_mm_mul_ps(r0,_mm_set1_ps(m[12]));
+        t=madd(r1,_mm_set1_ps(m[13]),t);
+        t=madd(r2,_mm_set1_ps(m[14]),t);
+
+        _mm_storeu_ps(r   ,r0);
+        _mm_storeu_ps(r+ 4,r1);
+        _mm_storeu_ps(r+ 8,r2);
+        _mm_storeu_ps(r+12,_mm_sub_ps(_mm_set_ps(1,0,0,0),t));
+    }
+};
+
+#endif // GALE_USE_SSE
+
+#ifdef GALE_USE_AVX
+
+/**
+ * Matrix kernels for doubles using AVX instructions, and FMA instructions if
+ * \c GALE_USE_FMA is defined. As the matrix data is tightly packed, unaligned
+ * loads and stores are used.
+ */
+template<>
+struct Matrix4Kernels<double>:public Matrix4ScalarKernels<double>
+{
+    /// Returns \a a * \a b + \a c.
+    static G_INLINE __m256d madd(__m256d const a,__m256d const b,__m256d const c) {
+#ifdef GALE_USE_FMA
+        return _mm256_fmadd_pd(a,b,c);
+#else
+        return _mm256_add_pd(_mm256_mul_pd(a,b),c);
+#endif
+    }
+
+    /// Returns the linear combination of the columns of matrix \a m with the
+    /// elements of vector \a v as the weights.
+    static G_INLINE __m256d combine(double const* const m,double const* const v) {
+        __m256d r=_mm256_mul_pd(_mm256_loadu_pd(m),_mm256_set1_pd(v[0]));
+        r=madd(_mm256_loadu_pd(m+ 4),_mm256_set1_pd(v[1]),r);
+        r=madd(_mm256_loadu_pd(m+ 8),_mm256_set1_pd(v[2]),r);
+        return madd(_mm256_loadu_pd(m+12),_mm256_set1_pd(v[3]),r);
+    }
+
+    /// Calculates \a r as matrix \a m multiplied by matrix \a n from the right.
+    static void mulMatMat(double* const r,double const* const m,double const* const n) {
+        _mm256_storeu_pd(r   ,combine(m,n   ));
+        _mm256_storeu_pd(r+ 4,combine(m,n+ 4));
+        _mm256_storeu_pd(r+ 8,combine(m,n+ 8));
+        _mm256_storeu_pd(r+12,combine(m,n+12));
+    }
+
+    /// Calculates \a r as matrix \a m multiplied from the left to column
+    /// vector \a v.
+    static void mulMatVec(double* const r,double const* const m,double const* const v) {
+        _mm256_storeu_pd(r,combine(m,v));
+    }
+
+    /// Calculates \a r as matrix \a m multiplied from the right to row vector
+    /// \a v.
+    static void mulVecMat(double* const r,double const* const m,double const* const v) {
+        __m256d x=_mm256_loadu_pd(v);
+        __m256d p0=_mm256_mul_pd(_mm256_loadu_pd(m   ),x);
+        __m256d p1=_mm256_mul_pd(_mm256_loadu_pd(m+ 4),x);
+        __m256d p2=_mm256_mul_pd(_mm256_loadu_pd(m+ 8),x);
+        __m256d p3=_mm256_mul_pd(_mm256_loadu_pd(m+12),x);
+
+        // Sum up pairs of products within the 128-bit lanes, then add the lanes.
+        __m256d h01=_mm256_hadd_pd(p0,p1);
+        __m256d h23=_mm256_hadd_pd(p2,p3);
+        __m256d lo=_mm256_permute2f128_pd(h01,h23,0x20);
+        __m256d hi=_mm256_permute2f128_pd(h01,h23,0x31);
+        _mm256_storeu_pd(r,_mm256_add_pd(lo,hi));
+    }
+
+    /// Calculates \a r as affine matrix \a m multiplied by affine matrix \a n
+    /// from the right. As the last row of the result is calculated exactly,
+    /// this is just the general product.
+    static void mulAffine(double* const r,double const* const m,double const* const n) {
+        mulMatMat(r,m,n);
+    }
+
+    /// Calculates the \a count matrices in \a r as the matrices in \a m
+    /// multiplied by the matrices in \a n from the right.
+    static void mulMatMatBatch(double* const r,double const* const m,double const* const n,int const count) {
+        for (int i=0;i<count*16;i+=16) {
+            mulMatMat(r+i,m+i,n+i);
+        }
+    }
+
+    /// Calculates the \a count matrices in \a r as the single matrix \a m
+    /// multiplied by the matrices in \a n from the right. The columns of \a m
+    /// are kept in registers for all products.
+    static void mulMatMatBroadcast(double* const r,double const* const m,double const* const n,int const count) {
+        __m256d m0=_mm256_loadu_pd(m   );
+        __m256d m1=_mm256_loadu_pd(m+ 4);
+        __m256d m2=_mm256_loadu_pd(m+ 8);
+        __m256d m3=_mm256_loadu_pd(m+12);
+
+        for (int i=0;i<count*16;i+=4) {
+            double const* v=n+i;
+            __m256d c=_mm256_mul_pd(m0,_mm256_broadcast_sd(v));
+            c=madd(m1,_mm256_broadcast_sd(v+1),c);
+            c=madd(m2,_mm256_broadcast_sd(v+2),c);
+            _mm256_storeu_pd(r+i,madd(m3,_mm256_broadcast_sd(v+3),c));
+        }
+    }
+
+    /// Calculates the \a count affine matrices in \a r as the affine matrices
+    /// in \a m multiplied by the affine matrices in \a n from the right.
+    static void mulAffineBatch(double* const r,double const* const m,double const* const n,int const count) {
+        mulMatMatBatch(r,m,n,count);
+    }
+
+    /// Calculates the \a count affine matrices in \a r as the single affine
+    /// matrix \a m multiplied by the affine matrices in \a n from the right.
+    static void mulAffineBroadcast(double* const r,double const* const m,double const* const n,int const count) {
+        mulMatMatBroadcast(r,m,n,count);
+    }
+
+    /// Transposes the matrix given by the columns \a c0 to \a c3 in-place.
+    static G_INLINE void transpose(__m256d& c0,__m256d& c1,__m256d& c2,__m256d& c3) {
+        __m256d t0=_mm256_unpacklo_pd(c0,c1);
+        __m256d t1=_mm256_unpackhi_pd(c0,c1);
+        __m256d t2=_mm256_unpacklo_pd(c2,c3);
+        __m256d t3=_mm256_unpackhi_pd(c2,c3);
+
+        c0=_mm256_permute2f128_pd(t0,t2,0x20);
+        c1=_mm256_permute2f128_pd(t1,t3,0x20);
+        c2=_mm256_permute2f128_pd(t0,t2,0x31);
+        c3=_mm256_permute2f128_pd(t1,t3,0x31);
+    }
+
+    /// Calculates \a r as the transpose of matrix \a m.
+    static void transpose(double* const r,double const* const m) {
+        __m256d c0=_mm256_loadu_pd(m   );
+        __m256d c1=_mm256_loadu_pd(m+ 4);
+        __m256d c2=_mm256_loadu_pd(m+ 8);
+        __m256d c3=_mm256_loadu_pd(m+12);
+
+        transpose(c0,c1,c2,c3);
+
+        _mm256_storeu_pd(r   ,c0);
+        _mm256_storeu_pd(r+ 4,c1);
+        _mm256_storeu_pd(r+ 8,c2);
+        _mm256_storeu_pd(r+12,c3);
+    }
+
+    /// Returns the elements of a vector selected by the shuffle mask \a S,
+    /// given its lower and upper 128-bit lanes duplicated in \a lo and \a hi.
+    /// This works around AVX lacking a shuffle across the 128-bit lanes.
+    template<int S>
+    static G_INLINE __m256d shuffle(__m256d const lo,__m256d const hi) {
+        int const select=(S&1) | ((S>>1)&2) | ((S>>2)&4) | ((S>>3)&8);
+        int const blend=((S>>1)&1) | ((S>>2)&2) | ((S>>3)&4) | ((S>>4)&8);
+        return _mm256_blend_pd(_mm256_permute_pd(lo,select),_mm256_permute_pd(hi,select),blend);
+    }
+
+    /// Returns the 2x2 minors of rows \a a and \a b for the column pairs given
+    /// by the shuffle masks \a P and \a Q, see shuffle() for the arguments.
+    template<int P,int Q>
+    static G_INLINE __m256d minors(__m256d const alo,__m256d const ahi,__m256d const blo,__m256d const bhi) {
+        return _mm256_sub_pd(
+            _mm256_mul_pd(shuffle<P>(alo,ahi),shuffle<Q>(blo,bhi))
+        ,   _mm256_mul_pd(shuffle<Q>(alo,ahi),shuffle<P>(blo,bhi))
+        );
+    }
+
+    /// Returns the cofactors for the elements of the row given by \a lo and
+    /// \a hi, see shuffle(), given the minors \a f0, \a f1 and \a f2 of the
+    /// pair of rows that does not contain it.
+    static G_INLINE __m256d cofactors(__m256d const lo,__m256d const hi,__m256d const f0,__m256d const f1,__m256d const f2) {
+        __m256d c=_mm256_mul_pd(shuffle<_MM_SHUFFLE(0,0,0,1)>(lo,hi),f0);
+        c=madd(shuffle<_MM_SHUFFLE(1,1,2,2)>(lo,hi),f1,c);
+        return madd(shuffle<_MM_SHUFFLE(2,3,3,3)>(lo,hi),f2,c);
+    }
+
+    /// Calculates \a r as the adjoint of matrix \a m and returns the
+    /// determinant of \a m. This vectorizes the scalar kernel by working on
+    /// the rows of \a m.
+    static double adjoint(double* const r,double const* const m) {
+        __m256d r0=_mm256_loadu_pd(m   );
+        __m256d r1=_mm256_loadu_pd(m+ 4);
+        __m256d r2=_mm256_loadu_pd(m+ 8);
+        __m256d r3=_mm256_loadu_pd(m+12);
+
+        transpose(r0,r1,r2,r3);
+
+        __m256d r0lo=_mm256_permute2f128_pd(r0,r0,0x00),r0hi=_mm256_permute2f128_pd(r0,r0,0x11);
+        __m256d r1lo=_mm256_permute2f128_pd(r1,r1,0x00),r1hi=_mm256_permute2f128_pd(r1,r1,0x11);
+        __m256d r2lo=_mm256_permute2f128_pd(r2,r2,0x00),r2hi=_mm256_permute2f128_pd(r2,r2,0x11);
+        __m256d r3lo=_mm256_permute2f128_pd(r3,r3,0x00),r3hi=_mm256_permute2f128_pd(r3,r3,0x11);
+
+        // See Matrix4Kernels<float>::adjoint() for the column pairs.
+        __m256d b0=minors<_MM_SHUFFLE(2,1,3,2),_MM_SHUFFLE(1,3,2,3)>(r2lo,r2hi,r3lo,r3hi);
+        __m256d b1=minors<_MM_SHUFFLE(0,3,0,3),_MM_SHUFFLE(2,0,3,1)>(r2lo,r2hi,r3lo,r3hi);
+        __m256d b2=minors<_MM_SHUFFLE(1,0,2,1),_MM_SHUFFLE(0,1,0,2)>(r2lo,r2hi,r3lo,r3hi);
+
+        __m256d a0=minors<_MM_SHUFFLE(2,1,3,2),_MM_SHUFFLE(1,3,2,3)>(r0lo,r0hi,r1lo,r1hi);
+        __m256d a1=minors<_MM_SHUFFLE(0,3,0,3),_MM_SHUFFLE(2,0,3,1)>(r0lo,r0hi,r1lo,r1hi);
+        __m256d a2=minors<_MM_SHUFFLE(1,0,2,1),_MM_SHUFFLE(0,1,0,2)>(r0lo,r0hi,r1lo,r1hi);
+
+        __m256d zero=_mm256_setzero_pd();
+        __m256d c0=cofactors(r1lo,r1hi,b0,b1,b2);
+        _mm256_storeu_pd(r   ,c0);
+        _mm256_storeu_pd(r+ 4,_mm256_sub_pd(zero,cofactors(r0lo,r0hi,b0,b1,b2)));
+        _mm256_storeu_pd(r+ 8,cofactors(r3lo,r3hi,a0,a1,a2));
+        _mm256_storeu_pd(r+12,_mm256_sub_pd(zero,cofactors(r2lo,r2hi,a0,a1,a2)));
+
+        // Expand the determinant along the first row.
+        __m256d d=_mm256_mul_pd(r0,c0);
+        __m128d s=_mm_add_pd(_mm256_castpd256_pd128(d),_mm256_extractf128_pd(d,1));
+        s=_mm_add_sd(s,_mm_unpackhi_pd(s,s));
+        return _mm_cvtsd_f64(s);
+    }
+
+    /// Calculates \a r as the inverse of the affine matrix \a m, whose upper
+    /// left 3x3 part is assumed to be orthogonal.
+    static void invertAffine(double* const r,double const* const m) {
+        __m256d r0=_mm256_loadu_pd(m   );
+        __m256d r1=_mm256_loadu_pd(m+ 4);
+        __m256d r2=_mm256_loadu_pd(m+ 8);
+        __m256d r3=_mm256_loadu_pd(m+12);
+
+        transpose(r0,r1,r2,r3);
+
+        // Get the reciprocal squared lengths of the columns. The last element
+        // is made zero without dividing by the possibly zero translation.
+        __m256d l=_mm256_add_pd(_mm256_mul_pd(r0,r0),_mm256_set_pd(1,0,0,0));
+        l=madd(r1,r1,l);
+        l=madd(r2,r2,l);
+        __m256d s=_mm256_div_pd(_mm256_set_pd(0,1,1,1),l);
+
+        // The scaled rows are the columns of the inverse.
+        r0=_mm256_mul_pd(r0,s);
+        r1=_mm256_mul_pd(r1,s);
+        r2=_mm256_mul_pd(r2,s);
+
+        __m256d t=_mm256_mul_pd(r0,_mm256_broadcast_sd(m+12));
+        t=madd(r1,_mm256_broadcast_sd(m+13),t);
+        t=madd(r2,_mm256_broadcast_sd(m+14),t);
+
+        _mm256_storeu_pd(r   ,r0);
+        _mm256_storeu_pd(r+ 4,r1);
+        _mm256_storeu_pd(r+ 8,r2);
+        _mm256_storeu_pd(r+12,_mm256_sub_pd(_mm256_set_pd(1,0,0,0),t));
+    }
+};
+
+#endif // GALE_USE_AVX
@@ -0,0 +1,1137 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#pragma once
+
+/**
+ * \file
+ * Packets of several vectors stored as a "structure of arrays" in registers
+ */
+
+#include "vector.h"
+
+#ifdef GALE_USE_SSE
+    #include <xmmintrin.h>
+#endif
+
+#ifdef GALE_USE_AVX
+    #include <immintrin.h>
+#endif
+
+namespace gale {
+
+namespace math {
+
+/**
+ * A mask as the result of comparing packets lane by lane, with one bit per lane
+ * that is set if the comparison was true for that lane.
+ */
+class Mask4
+{
+  public:
+
+    /// The number of lanes of this mask.
+    static int const Lanes=4;
+
+    /// Create a mask whose lanes are not initialized.
+    Mask4() {}
+
+#ifdef GALE_USE_SSE
+
+    /// Creates a mask from an SSE register \a m whose lanes have either all or
+    /// no bits set.
+    Mask4(__m128 const m)
+    :   m_simd(m) {}
+
+    /// Returns the mask with lane \a i represented by bit \a i.
+    G_INLINE int bits() const {
+        return _mm_movemask_ps(m_simd);
+    }
+
+    /// Returns the lane-wise logical conjunction of masks \a m and \a n.
+    friend G_INLINE Mask4 operator&(Mask4 const& m,Mask4 const& n) {
+        return _mm_and_ps(m.m_simd,n.m_simd);
+    }
+
+    /// Returns the lane-wise logical disjunction of masks \a m and \a n.
+    friend G_INLINE Mask4 operator|(Mask4 const& m,Mask4 const& n) {
+        return _mm_or_ps(m.m_simd,n.m_simd);
+    }
+
+    /// Returns the lane-wise logical exclusive disjunction of masks \a m and \a n.
+    friend G_INLINE Mask4 operator^(Mask4 const& m,Mask4 const& n) {
+        return _mm_xor_ps(m.m_simd,n.m_simd);
+    }
+
+    /// Returns the lane-wise logical negation of mask \a m.
+    friend G_INLINE Mask4 operator~(Mask4 const& m) {
+        __m128 zero=_mm_setzero_ps();
+        return _mm_andnot_ps(m.m_simd,_mm_cmpeq_ps(zero,zero));
+    }
+
+    __m128 m_simd; ///< SSE register with all bits of true lanes set.
+
+#else
+
+    /// Creates a mask from the given \a bits, with lane \a i represented by
+    /// bit \a i.
+    explicit Mask4(int const bits)
+    :   m_bits(bits&0xf) {}
+
+    /// Returns the mask with lane \a i represented by bit \a i.
+    G_INLINE int bits() const {
+        return m_bits;
+    }
+
+    /// Returns the lane-wise logical conjunction of masks \a m and \a n.
+    friend G_INLINE Mask4 operator&(Mask4 const& m,Mask4 const& n) {
+        return Mask4(m.m_bits&n.m_bits);
+    }
+
+    /// Returns the lane-wise logical disjunction of masks \a m and \a n.
+    friend G_INLINE Mask4 operator|(Mask4 const& m,Mask4 const& n) {
+        return Mask4(m.m_bits|n.m_bits);
+    }
+
+    /// Returns the lane-wise logical exclusive disjunction of masks \a m and \a n.
+    friend G_INLINE Mask4 operator^(Mask4 const& m,Mask4 const& n) {
+        return Mask4(m.m_bits^n.m_bits);
+    }
+
+    /// Returns the lane-wise logical negation of mask \a m.
+    friend G_INLINE Mask4 operator~(Mask4 const& m) {
+        return Mask4(~m.m_bits);
+    }
+
+    int m_bits; ///< Lane \a i is represented by bit \a i.
+
+#endif
+
+    /// Returns whether the mask is true for any lane.
+    G_INLINE bool any() const {
+        return bits()!=0;
+    }
+
+    /// Returns whether the mask is true for all lanes.
+    G_INLINE bool all() const {
+        return bits()==(1<<Lanes)-1;
+    }
+
+    /// Returns whether the mask is true for no lane.
+    G_INLINE bool none() const {
+        return bits()==0;
+    }
+};
+
+/**
+ * A packet of 4 floats that are processed in parallel. It uses a single SSE
+ * register if \c GALE_USE_SSE is defined.
+ */
+class Packet4f
+{
+  public:
+
+    /// The number of lanes of this packet.
+    static int const Lanes=4;
+
+    /// The type of masks resulting from comparisons.
+    typedef Mask4 Mask;
+
+    /**
+     * \name Constructors
+     */
+    //@{
+
+    /// Create a packet whose lanes are not initialized.
+    Packet4f() {}
+
+#ifdef GALE_USE_SSE
+
+    /// Creates a packet from an SSE register \a m.
+    Packet4f(__m128 const m)
+    :   m_simd(m) {}
+
+    /// Creates a packet with all lanes set to \a s.
+    Packet4f(float const s)
+    :   m_simd(_mm_set1_ps(s)) {}
+
+    /// Creates a packet from the individual lanes \a e0 to \a e3.
+    Packet4f(float const e0,float const e1,float const e2,float const e3)
+    :   m_simd(_mm_setr_ps(e0,e1,e2,e3)) {}
+
+    /// Returns a packet loaded from 4 floats at \a p, which needs not be aligned.
+    static G_INLINE Packet4f load(float const* p) {
+        return _mm_loadu_ps(p);
+    }
+
+    /// Stores the 4 floats to \a p, which needs not be aligned.
+    G_INLINE void store(float* p) const {
+        _mm_storeu_ps(p,m_simd);
+    }
+
+#else
+
+    /// Creates a packet with all lanes set to \a s.
+    Packet4f(float const s) {
+        m_data[0]=m_data[1]=m_data[2]=m_data[3]=s;
+    }
+
+    /// Creates a packet from the individual lanes \a e0 to \a e3.
+    Packet4f(float const e0,float const e1,float const e2,float const e3) {
+        m_data[0]=e0; m_data[1]=e1; m_data[2]=e2; m_data[3]=e3;
+    }
+
+    /// Returns a packet loaded from 4 floats at \a p, which needs not be aligned.
+    static G_INLINE Packet4f load(float const* p) {
+        return Packet4f(p[0],p[1],p[2],p[3]);
+    }
+
+    /// Stores the 4 floats to \a p, which needs not be aligned.
+    G_INLINE void store(float* p) const {
+        memcpy(p,m_data,sizeof(m_data));
+    }
+
+#endif
+
+    //@}
+
+    /**
+     * \name Element access methods
+     */
+    //@{
+
+    /// Returns a reference to lane \a i.
+    G_INLINE float& operator[](int const i) {
+        return m_data[i];
+    }
+
+    /// Returns a constant reference to lane \a i.
+    G_INLINE float const& operator[](int const i) const {
+        return m_data[i];
+    }
+
+    //@}
+
+    /**
+     * \name Arithmetic operators
+     */
+    //@{
+
+#ifdef GALE_USE_SSE
+
+    /// Returns the lane-wise sum of \a p and \a q.
+    friend G_INLINE Packet4f operator+(Packet4f const& p,Packet4f const& q) {
+        return _mm_add_ps(p.m_simd,q.m_simd);
+    }
+
+    /// Returns the lane-wise difference of \a p and \a q.
+    friend G_INLINE Packet4f operator-(Packet4f const& p,Packet4f const& q) {
+        return _mm_sub_ps(p.m_simd,q.m_simd);
+    }
+
+    /// Returns the lane-wise product of \a p and \a q.
+    friend G_INLINE Packet4f operator*(Packet4f const& p,Packet4f const& q) {
+        return _mm_mul_ps(p.m_simd,q.m_simd);
+    }
+
+    /// Returns the lane-wise quotient of \a p and \a q.
+    friend G_INLINE Packet4f operator/(Packet4f const& p,Packet4f const& q) {
+        return _mm_div_ps(p.m_simd,q.m_simd);
+    }
+
+    /// Returns a negated copy of \a p.
+    friend G_INLINE Packet4f operator-(Packet4f const& p) {
+        return _mm_xor_ps(p.m_simd,_mm_set1_ps(-0.0f));
+    }
+
+    /// Returns the lane-wise minimum of this packet and \a p.
+    G_INLINE Packet4f minElements(Packet4f const& p) const {
+        return _mm_min_ps(m_simd,p.m_simd);
+    }
+
+    /// Returns the lane-wise maximum of this packet and \a p.
+    G_INLINE Packet4f maxElements(Packet4f const& p) const {
+        return _mm_max_ps(m_simd,p.m_simd);
+    }
+
+    /// Returns the lane-wise square root of \a p.
+    friend G_INLINE Packet4f sqrt(Packet4f const& p) {
+        return _mm_sqrt_ps(p.m_simd);
+    }
+
+#else
+
+    /// Returns the lane-wise sum of \a p and \a q.
+    friend G_INLINE Packet4f operator+(Packet4f const& p,Packet4f const& q) {
+        return Packet4f(p[0]+q[0],p[1]+q[1],p[2]+q[2],p[3]+q[3]);
+    }
+
+    /// Returns the lane-wise difference of \a p and \a q.
+    friend G_INLINE Packet4f operator-(Packet4f const& p,Packet4f const& q) {
+        return Packet4f(p[0]-q[0],p[1]-q[1],p[2]-q[2],p[3]-q[3]);
+    }
+
+    /// Returns the lane-wise product of \a p and \a q.
+    friend G_INLINE Packet4f operator*(Packet4f const& p,Packet4f const& q) {
+        return Packet4f(p[0]*q[0],p[1]*q[1],p[2]*q[2],p[3]*q[3]);
+    }
+
+    /// Returns the lane-wise quotient of \a p and \a q.
+    friend G_INLINE Packet4f operator/(Packet4f const& p,Packet4f const& q) {
+        return Packet4f(p[0]/q[0],p[1]/q[1],p[2]/q[2],p[3]/q[3]);
+    }
+
+    /// Returns a negated copy of \a p.
+    friend G_INLINE Packet4f operator-(Packet4f const& p) {
+        return Packet4f(-p[0],-p[1],-p[2],-p[3]);
+    }
+
+    /// Returns the lane-wise minimum of this packet and \a p.
+    G_INLINE Packet4f minElements(Packet4f const& p) const {
+        Packet4f r;
+        for (int i=0;i<Lanes;++i) {
+            r[i]=p[i]<m_data[i]?p[i]:m_data[i];
+        }
+        return r;
+    }
+
+    /// Returns the lane-wise maximum of this packet and \a p.
+    G_INLINE Packet4f maxElements(Packet4f const& p) const {
+        Packet4f r;
+        for (int i=0;i<Lanes;++i) {
+            r[i]=p[i]>m_data[i]?p[i]:m_data[i];
+        }
+        return r;
+    }
+
+    /// Returns the lane-wise square root of \a p.
+    friend G_INLINE Packet4f sqrt(Packet4f const& p) {
+        return Packet4f(sqrtf(p[0]),sqrtf(p[1]),sqrtf(p[2]),sqrtf(p[3]));
+    }
+
+#endif
+
+    /// Adds \a p to this packet lane-wise.
+    G_INLINE Packet4f& operator+=(Packet4f const& p) {
+        return *this=*this+p;
+    }
+
+    /// Subtracts \a p from this packet lane-wise.
+    G_INLINE Packet4f& operator-=(Packet4f const& p) {
+        return *this=*this-p;
+    }
+
+    /// Multiplies this packet by \a p lane-wise.
+    G_INLINE Packet4f& operator*=(Packet4f const& p) {
+        return *this=*this*p;
+    }
+
+    /// Divides this packet by \a p lane-wise.
+    G_INLINE Packet4f& operator/=(Packet4f const& p) {
+        return *this=*this/p;
+    }
+
+    //@}
+
+    /**
+     * \name Comparison operators
+     */
+    //@{
+
+#ifdef GALE_USE_SSE
+
+    /// Returns the mask of lanes in which \a p is less than \a q.
+    friend G_INLINE Mask4 operator<(Packet4f const& p,Packet4f const& q) {
+        return _mm_cmplt_ps(p.m_simd,q.m_simd);
+    }
+
+    /// Returns the mask of lanes in which \a p is less than or equal to \a q.
+    friend G_INLINE Mask4 operator<=(Packet4f const& p,Packet4f const& q) {
+        return _mm_cmple_ps(p.m_simd,q.m_simd);
+    }
+
+    /// Returns the mask of lanes in which \a p equals \a q exactly.
+    friend G_INLINE Mask4 operator==(Packet4f const& p,Packet4f const& q) {
+        return _mm_cmpeq_ps(p.m_simd,q.m_simd);
+    }
+
+    /// Returns the lanes of \a p where \a m is true, and those of \a q otherwise.
+    friend G_INLINE Packet4f select(Mask4 const& m,Packet4f const& p,Packet4f const& q) {
+        return _mm_or_ps(_mm_and_ps(m.m_simd,p.m_simd),_mm_andnot_ps(m.m_simd,q.m_simd));
+    }
+
+#else
+
+    /// Returns the mask of lanes in which \a p is less than \a q.
+    friend G_INLINE Mask4 operator<(Packet4f const& p,Packet4f const& q) {
+        return Mask4((p[0]<q[0])|(p[1]<q[1])<<1|(p[2]<q[2])<<2|(p[3]<q[3])<<3);
+    }
+
+    /// Returns the mask of lanes in which \a p is less than or equal to \a q.
+    friend G_INLINE Mask4 operator<=(Packet4f const& p,Packet4f const& q) {
+        return Mask4((p[0]<=q[0])|(p[1]<=q[1])<<1|(p[2]<=q[2])<<2|(p[3]<=q[3])<<3);
+    }
+
+    /// Returns the mask of lanes in which \a p equals \a q exactly.
+    friend G_INLINE Mask4 operator==(Packet4f const& p,Packet4f const& q) {
+        return Mask4((p[0]==q[0])|(p[1]==q[1])<<1|(p[2]==q[2])<<2|(p[3]==q[3])<<3);
+    }
+
+    /// Returns the lanes of \a p where \a m is true, and those of \a q otherwise.
+    friend G_INLINE Packet4f select(Mask4 const& m,Packet4f const& p,Packet4f const& q) {
+        Packet4f r;
+        for (int i=0;i<Lanes;++i) {
+            r[i]=(m.bits()&(1<<i))?p[i]:q[i];
+        }
+        return r;
+    }
+
+#endif
+
+    /// Returns the mask of lanes in which \a p is greater than \a q.
+    friend G_INLINE Mask4 operator>(Packet4f const& p,Packet4f const& q) {
+        return q<p;
+    }
+
+    /// Returns the mask of lanes in which \a p is greater than or equal to \a q.
+    friend G_INLINE Mask4 operator>=(Packet4f const& p,Packet4f const& q) {
+        return q<=p;
+    }
+
+    /// Returns the mask of lanes in which \a p does not equal \a q exactly.
+    friend G_INLINE Mask4 operator!=(Packet4f const& p,Packet4f const& q) {
+        return ~(p==q);
+    }
+
+    //@}
+
+  private:
+
+    union {
+#ifdef GALE_USE_SSE
+        __m128 m_simd;   ///< SSE register holding all lanes.
+#endif
+        float m_data[4]; ///< Access to the individual lanes.
+    };
+};
+
+/**
+ * A mask as the result of comparing 8-lane packets, see Mask4.
+ */
+class Mask8
+{
+  public:
+
+    /// The number of lanes of this mask.
+    static int const Lanes=8;
+
+    /// Create a mask whose lanes are not initialized.
+    Mask8() {}
+
+#ifdef GALE_USE_AVX
+
+    /// Creates a mask from an AVX register \a m whose lanes have either all or
+    /// no bits set.
+    Mask8(__m256 const m)
+    :   m_simd(m) {}
+
+    /// Returns the mask with lane \a i represented by bit \a i.
+    G_INLINE int bits() const {
+        return _mm256_movemask_ps(m_simd);
+    }
+
+    /// Returns the lane-wise logical conjunction of masks \a m and \a n.
+    friend G_INLINE Mask8 operator&(Mask8 const& m,Mask8 const& n) {
+        return _mm256_and_ps(m.m_simd,n.m_simd);
+    }
+
+    /// Returns the lane-wise logical disjunction of masks \a m and \a n.
+    friend G_INLINE Mask8 operator|(Mask8 const& m,Mask8 const& n) {
+        return _mm256_or_ps(m.m_simd,n.m_simd);
+    }
+
+    /// Returns the lane-wise logical exclusive disjunction of masks \a m and \a n.
+    friend G_INLINE Mask8 operator^(Mask8 const& m,Mask8 const& n) {
+        return _mm256_xor_ps(m.m_simd,n.m_simd);
+    }
+
+    /// Returns the lane-wise logical negation of mask \a m.
+    friend G_INLINE Mask8 operator~(Mask8 const& m) {
+        __m256 zero=_mm256_setzero_ps();
+        return _mm256_andnot_ps(m.m_simd,_mm256_cmp_ps(zero,zero,_CMP_EQ_OQ));
+    }
+
+    __m256 m_simd; ///< AVX register with all bits of true lanes set.
+
+#else
+
+    /// Creates a mask from the masks \a lo and \a hi for the lower and upper
+    /// 4 lanes.
+    Mask8(Mask4 const& lo,Mask4 const& hi)
+    :   m_lo(lo)
+    ,   m_hi(hi) {}
+
+    /// Returns the mask with lane \a i represented by bit \a i.
+    G_INLINE int bits() const {
+        return m_lo.bits()|(m_hi.bits()<<4);
+    }
+
+    /// Returns the lane-wise logical conjunction of masks \a m and \a n.
+    friend G_INLINE Mask8 operator&(Mask8 const& m,Mask8 const& n) {
+        return Mask8(m.m_lo&n.m_lo,m.m_hi&n.m_hi);
+    }
+
+    /// Returns the lane-wise logical disjunction of masks \a m and \a n.
+    friend G_INLINE Mask8 operator|(Mask8 const& m,Mask8 const& n) {
+        return Mask8(m.m_lo|n.m_lo,m.m_hi|n.m_hi);
+    }
+
+    /// Returns the lane-wise logical exclusive disjunction of masks \a m and \a n.
+    friend G_INLINE Mask8 operator^(Mask8 const& m,Mask8 const& n) {
+        return Mask8(m.m_lo^n.m_lo,m.m_hi^n.m_hi);
+    }
+
+    /// Returns the lane-wise logical negation of mask \a m.
+    friend G_INLINE Mask8 operator~(Mask8 const& m) {
+        return Mask8(~m.m_lo,~m.m_hi);
+    }
+
+    Mask4 m_lo; ///< Mask of the lower 4 lanes.
+    Mask4 m_hi; ///< Mask of the upper 4 lanes.
+
+#endif
+
+    /// Returns whether the mask is true for any lane.
+    G_INLINE bool any() const {
+        return bits()!=0;
+    }
+
+    /// Returns whether the mask is true for all lanes.
+    G_INLINE bool all() const {
+        return bits()==(1<<Lanes)-1;
+    }
+
+    /// Returns whether the mask is true for no lane.
+    G_INLINE bool none() const {
+        return bits()==0;
+    }
+};
+
+/**
+ * A packet of 8 floats that are processed in parallel. It uses a single AVX
+ * register if \c GALE_USE_AVX is defined, and two Packet4f otherwise. With
+ * \c GALE_USE_AVX, instances need to be 32-byte aligned, which the compiler
+ * only guarantees for automatic variables.
+ */
+class Packet8f
+{
+  public:
+
+    /// The number of lanes of this packet.
+    static int const Lanes=8;
+
+    /// The type of masks resulting from comparisons.
+    typedef Mask8 Mask;
+
+    /**
+     * \name Constructors
+     */
+    //@{
+
+    /// Create a packet whose lanes are not initialized.
+    Packet8f() {}
+
+#ifdef GALE_USE_AVX
+
+    /// Creates a packet from an AVX register \a m.
+    Packet8f(__m256 const m)
+    :   m_simd(m) {}
+
+    /// Creates a packet with all lanes set to \a s.
+    Packet8f(float const s)
+    :   m_simd(_mm256_set1_ps(s)) {}
+
+    /// Returns a packet loaded from 8 floats at \a p, which needs not be aligned.
+    static G_INLINE Packet8f load(float const* p) {
+        return _mm256_loadu_ps(p);
+    }
+
+    /// Stores the 8 floats to \a p, which needs not be aligned.
+    G_INLINE void store(float* p) const {
+        _mm256_storeu_ps(p,m_simd);
+    }
+
+#else
+
+    /// Creates a packet from the packets \a lo and \a hi for the lower and
+    /// upper 4 lanes.
+    Packet8f(Packet4f const& lo,Packet4f const& hi)
+    :   m_lo(lo)
+    ,   m_hi(hi) {}
+
+    /// Creates a packet with all lanes set to \a s.
+    Packet8f(float const s)
+    :   m_lo(s)
+    ,   m_hi(s) {}
+
+    /// Returns a packet loaded from 8 floats at \a p, which needs not be aligned.
+    static G_INLINE Packet8f load(float const* p) {
+        return Packet8f(Packet4f::load(p),Packet4f::load(p+4));
+    }
+
+    /// Stores the 8 floats to \a p, which needs not be aligned.
+    G_INLINE void store(float* p) const {
+        m_lo.store(p);
+        m_hi.store(p+4);
+    }
+
+#endif
+
+    //@}
+
+    /**
+     * \name Element access methods
+     */
+    //@{
+
+#ifdef GALE_USE_AVX
+
+    /// Returns a reference to lane \a i.
+    G_INLINE float& operator[](int const i) {
+        return m_data[i];
+    }
+
+    /// Returns a constant reference to lane \a i.
+    G_INLINE float const& operator[](int const i) const {
+        return m_data[i];
+    }
+
+#else
+
+    /// Returns a reference to lane \a i.
+    G_INLINE float& operator[](int const i) {
+        return i<4?m_lo[i]:m_hi[i-4];
+    }
+
+    /// Returns a constant reference to lane \a i.
+    G_INLINE float const& operator[](int const i) const {
+        return i<4?m_lo[i]:m_hi[i-4];
+    }
+
+#endif
+
+    //@}
+
+    /**
+     * \name Arithmetic operators
+     */
+    //@{
+
+#ifdef GALE_USE_AVX
+
+    /// Returns the lane-wise sum of \a p and \a q.
+    friend G_INLINE Packet8f operator+(Packet8f const& p,Packet8f const& q) {
+        return _mm256_add_ps(p.m_simd,q.m_simd);
+    }
+
+    /// Returns the lane-wise difference of \a p and \a q.
+    friend G_INLINE Packet8f operator-(Packet8f const& p,Packet8f const& q) {
+        return _mm256_sub_ps(p.m_simd,q.m_simd);
+    }
+
+    /// Returns the lane-wise product of \a p and \a q.
+    friend G_INLINE Packet8f operator*(Packet8f const& p,Packet8f const& q) {
+        return _mm256_mul_ps(p.m_simd,q.m_simd);
+    }
+
+    /// Returns the lane-wise quotient of \a p and \a q.
+    friend G_INLINE Packet8f operator/(Packet8f const& p,Packet8f const& q) {
+        return _mm256_div_ps(p.m_simd,q.m_simd);
+    }
+
+    /// Returns a negated copy of \a p.
+    friend G_INLINE Packet8f operator-(Packet8f const& p) {
+        return _mm256_xor_ps(p.m_simd,_mm256_set1_ps(-0.0f));
+    }
+
+    /// Returns the lane-wise minimum of this packet and \a p.
+    G_INLINE Packet8f minElements(Packet8f const& p) const {
+        return _mm256_min_ps(m_simd,p.m_simd);
+    }
+
+    /// Returns the lane-wise maximum of this packet and \a p.
+    G_INLINE Packet8f maxElements(Packet8f const& p) const {
+        return _mm256_max_ps(m_simd,p.m_simd);
+    }
+
+    /// Returns the lane-wise square root of \a p.
+    friend G_INLINE Packet8f sqrt(Packet8f const& p) {
+        return _mm256_sqrt_ps(p.m_simd);
+    }
+
+#else
+
+    /// Returns the lane-wise sum of \a p and \a q.
+    friend G_INLINE Packet8f operator+(Packet8f const& p,Packet8f const& q) {
+        return Packet8f(p.m_lo+q.m_lo,p.m_hi+q.m_hi);
+    }
+
+    /// Returns the lane-wise difference of \a p and \a q.
+    friend G_INLINE Packet8f operator-(Packet8f const& p,Packet8f const& q) {
+        return Packet8f(p.m_lo-q.m_lo,p.m_hi-q.m_hi);
+    }
+
+    /// Returns the lane-wise product of \a p and \a q.
+    friend G_INLINE Packet8f operator*(Packet8f const& p,Packet8f const& q) {
+        return Packet8f(p.m_lo*q.m_lo,p.m_hi*q.m_hi);
+    }
+
+    /// Returns the lane-wise quotient of \a p and \a q.
+    friend G_INLINE Packet8f operator/(Packet8f const& p,Packet8f const& q) {
+        return Packet8f(p.m_lo/q.m_lo,p.m_hi/q.m_hi);
+    }
+
+    /// Returns a negated copy of \a p.
+    friend G_INLINE Packet8f operator-(Packet8f const& p) {
+        return Packet8f(-p.m_lo,-p.m_hi);
+    }
+
+    /// Returns the lane-wise minimum of this packet and \a p.
+    G_INLINE Packet8f minElements(Packet8f const& p) const {
+        return Packet8f(m_lo.minElements(p.m_lo),m_hi.minElements(p.m_hi));
+    }
+
+    /// Returns the lane-wise maximum of this packet and \a p.
+    G_INLINE Packet8f maxElements(Packet8f const& p) const {
+        return Packet8f(m_lo.maxElements(p.m_lo),m_hi.maxElements(p.m_hi));
+    }
+
+    /// Returns the lane-wise square root of \a p.
+    friend G_INLINE Packet8f sqrt(Packet8f const& p) {
+        return Packet8f(sqrt(p.m_lo),sqrt(p.m_hi));
+    }
+
+#endif
+
+    /// Adds \a p to this packet lane-wise.
+    G_INLINE Packet8f& operator+=(Packet8f const& p) {
+        return *this=*this+p;
+    }
+
+    /// Subtracts \a p from this packet lane-wise.
+    G_INLINE Packet8f& operator-=(Packet8f const& p) {
+        return *this=*this-p;
+    }
+
+    /// Multiplies this packet by \a p lane-wise.
+    G_INLINE Packet8f& operator*=(Packet8f const& p) {
+        return *this=*this*p;
+    }
+
+    /// Divides this packet by \a p lane-wise.
+    G_INLINE Packet8f& operator/=(Packet8f const& p) {
+        return *this=*this/p;
+    }
+
+    //@}
+
+    /**
+     * \name Comparison operators
+     */
+    //@{
+
+#ifdef GALE_USE_AVX
+
+    /// Returns the mask of lanes in which \a p is less than \a q.
+    friend G_INLINE Mask8 operator<(Packet8f const& p,Packet8f const& q) {
+        return _mm256_cmp_ps(p.m_simd,q.m_simd,_CMP_LT_OQ);
+    }
+
+    /// Returns the mask of lanes in which \a p is less than or equal to \a q.
+    friend G_INLINE Mask8 operator<=(Packet8f const& p,Packet8f const& q) {
+        return _mm256_cmp_ps(p.m_simd,q.m_simd,_CMP_LE_OQ);
+    }
+
+    /// Returns the mask of lanes in which \a p equals \a q exactly.
+    friend G_INLINE Mask8 operator==(Packet8f const& p,Packet8f const& q) {
+        return _mm256_cmp_ps(p.m_simd,q.m_simd,_CMP_EQ_OQ);
+    }
+
+    /// Returns the lanes of \a p where \a m is true, and those of \a q otherwise.
+    friend G_INLINE Packet8f select(Mask8 const& m,Packet8f const& p,Packet8f const& q) {
+        return _mm256_or_ps(_mm256_and_ps(m.m_simd,p.m_simd),_mm256_andnot_ps(m.m_simd,q.m_simd));
+    }
+
+#else
+
+    /// Returns the mask of lanes in which \a p is less than \a q.
+    friend G_INLINE Mask8 operator<(Packet8f const& p,Packet8f const& q) {
+        return Mask8(p.m_lo<q.m_lo,p.m_hi<q.m_hi);
+    }
+
+    /// Returns the mask of lanes in which \a p is less than or equal to \a q.
+    friend G_INLINE Mask8 operator<=(Packet8f const& p,Packet8f const& q) {
+        return Mask8(p.m_lo<=q.m_lo,p.m_hi<=q.m_hi);
+    }
+
+    /// Returns the mask of lanes in which \a p equals \a q exactly.
+    friend G_INLINE Mask8 operator==(Packet8f const& p,Packet8f const& q) {
+        return Mask8(p.m_lo==q.m_lo,p.m_hi==q.m_hi);
+    }
+
+    /// Returns the lanes of \a p where \a m is true, and those of \a q otherwise.
+    friend G_INLINE Packet8f select(Mask8 const& m,Packet8f const& p,Packet8f const& q) {
+        return Packet8f(select(m.m_lo,p.m_lo,q.m_lo),select(m.m_hi,p.m_hi,q.m_hi));
+    }
+
+#endif
+
+    /// Returns the mask of lanes in which \a p is greater than \a q.
+    friend G_INLINE Mask8 operator>(Packet8f const& p,Packet8f const& q) {
+        return q<p;
+    }
+
+    /// Returns the mask of lanes in which \a p is greater than or equal to \a q.
+    friend G_INLINE Mask8 operator>=(Packet8f const& p,Packet8f const& q) {
+        return q<=p;
+    }
+
+    /// Returns the mask of lanes in which \a p does not equal \a q exactly.
+    friend G_INLINE Mask8 operator!=(Packet8f const& p,Packet8f const& q) {
+        return ~(p==q);
+    }
+
+    //@}
+
+  private:
+
+#ifdef GALE_USE_AVX
+    union {
+        __m256 m_simd;   ///< AVX register holding all lanes.
+        float m_data[8]; ///< Access to the individual lanes.
+    };
+#else
+    Packet4f m_lo; ///< The lower 4 lanes.
+    Packet4f m_hi; ///< The upper 4 lanes.
+#endif
+};
+
+/**
+ * A packet of several 3-vectors of floats, stored as a "structure of arrays"
+ * with one packet \a P per coordinate. This way, each operation processes all
+ * vectors in the packet at once without wasting a lane on a 4th component.
+ * The operators mirror those of Vector, but work lane-wise: scalar results
+ * like the dot product become packets, and comparisons yield masks that can be
+ * used to blend packets via select(). All methods are forced inline as they
+ * would be slower than their scalar counterparts as function calls.
+ *
+ * Example usage to test 8 points against a plane at once:
+ * \code
+ * Vec3fx8 p=Vec3fx8::load(points);
+ * Mask8 above=p%Vec3fx8(normal)>Packet8f(distance);
+ * \endcode
+ */
+template<class P>
+class Vec3fPacket
+{
+  public:
+
+    /// The number of vectors in this packet.
+    static int const Lanes=P::Lanes;
+
+    /// The type of packets for the coordinates.
+    typedef P Packet;
+
+    /// The type of masks resulting from comparisons.
+    typedef typename P::Mask Mask;
+
+    /**
+     * \name Constructors
+     */
+    //@{
+
+    /// Create a packet whose vectors are not initialized.
+    Vec3fPacket() {}
+
+    /// Creates a packet from the packets of \a x-, \a y- and \a z-coordinates.
+    Vec3fPacket(P const& x,P const& y,P const& z)
+    :   x(x)
+    ,   y(y)
+    ,   z(z) {}
+
+    /// Creates a packet with all vectors set to \a v.
+    explicit Vec3fPacket(Vec3f const& v)
+    :   x(v.getX())
+    ,   y(v.getY())
+    ,   z(v.getZ()) {}
+
+    /// Returns a packet loaded from \c Lanes consecutive vectors at \a v.
+    static G_INLINE Vec3fPacket load(Vec3f const* v) {
+        float c[3][Lanes];
+        for (int i=0;i<Lanes;++i) {
+            c[0][i]=v[i].getX();
+            c[1][i]=v[i].getY();
+            c[2][i]=v[i].getZ();
+        }
+        return Vec3fPacket(P::load(c[0]),P::load(c[1]),P::load(c[2]));
+    }
+
+    /// Returns a packet loaded from \c Lanes consecutive coordinates at each
+    /// of \a x, \a y and \a z.
+    static G_INLINE Vec3fPacket load(float const* x,float const* y,float const* z) {
+        return Vec3fPacket(P::load(x),P::load(y),P::load(z));
+    }
+
+    /// Stores the vectors to \c Lanes consecutive vectors at \a v.
+    G_INLINE void store(Vec3f* v) const {
+        float c[3][Lanes];
+        x.store(c[0]);
+        y.store(c[1]);
+        z.store(c[2]);
+        for (int i=0;i<Lanes;++i) {
+            v[i].set(c[0][i],c[1][i],c[2][i]);
+        }
+    }
+
+    /// Stores the vectors to \c Lanes consecutive coordinates at each of
+    /// \a x, \a y and \a z.
+    G_INLINE void store(float* x,float* y,float* z) const {
+        this->x.store(x);
+        this->y.store(y);
+        this->z.store(z);
+    }
+
+    //@}
+
+    /**
+     * \name Element access methods
+     */
+    //@{
+
+    /// Returns the vector in lane \a i.
+    G_INLINE Vec3f get(int const i) const {
+        return Vec3f(x[i],y[i],z[i]);
+    }
+
+    /// Sets the vector in lane \a i to \a v.
+    G_INLINE void set(int const i,Vec3f const& v) {
+        x[i]=v.getX();
+        y[i]=v.getY();
+        z[i]=v.getZ();
+    }
+
+    //@}
+
+    /**
+     * \name Arithmetic operators
+     */
+    //@{
+
+    /// Returns the lane-wise sum of \a v and \a w.
+    friend G_INLINE Vec3fPacket operator+(Vec3fPacket const& v,Vec3fPacket const& w) {
+        return Vec3fPacket(v.x+w.x,v.y+w.y,v.z+w.z);
+    }
+
+    /// Returns the lane-wise difference of \a v and \a w.
+    friend G_INLINE Vec3fPacket operator-(Vec3fPacket const& v,Vec3fPacket const& w) {
+        return Vec3fPacket(v.x-w.x,v.y-w.y,v.z-w.z);
+    }
+
+    /// Returns \a v scaled lane-wise by \a s.
+    friend G_INLINE Vec3fPacket operator*(Vec3fPacket const& v,P const& s) {
+        return Vec3fPacket(v.x*s,v.y*s,v.z*s);
+    }
+
+    /// Returns \a v scaled lane-wise by \a s.
+    friend G_INLINE Vec3fPacket operator*(P const& s,Vec3fPacket const& v) {
+        return v*s;
+    }
+
+    /// Returns \a v divided lane-wise by \a s.
+    friend G_INLINE Vec3fPacket operator/(Vec3fPacket const& v,P const& s) {
+        return Vec3fPacket(v.x/s,v.y/s,v.z/s);
+    }
+
+    /// Returns a negated copy of \a v.
+    friend G_INLINE Vec3fPacket operator-(Vec3fPacket const& v) {
+        return Vec3fPacket(-v.x,-v.y,-v.z);
+    }
+
+    /// Adds \a v to this packet lane-wise.
+    G_INLINE Vec3fPacket& operator+=(Vec3fPacket const& v) {
+        return *this=*this+v;
+    }
+
+    /// Subtracts \a v from this packet lane-wise.
+    G_INLINE Vec3fPacket& operator-=(Vec3fPacket const& v) {
+        return *this=*this-v;
+    }
+
+    /// Scales this packet lane-wise by \a s.
+    G_INLINE Vec3fPacket& operator*=(P const& s) {
+        return *this=*this*s;
+    }
+
+    /// Divides this packet lane-wise by \a s.
+    G_INLINE Vec3fPacket& operator/=(P const& s) {
+        return *this=*this/s;
+    }
+
+    /// Returns the lane-wise minimum of all coordinates of this packet and \a v.
+    G_INLINE Vec3fPacket minElements(Vec3fPacket const& v) const {
+        return Vec3fPacket(x.minElements(v.x),y.minElements(v.y),z.minElements(v.z));
+    }
+
+    /// Returns the lane-wise maximum of all coordinates of this packet and \a v.
+    G_INLINE Vec3fPacket maxElements(Vec3fPacket const& v) const {
+        return Vec3fPacket(x.maxElements(v.x),y.maxElements(v.y),z.maxElements(v.z));
+    }
+
+    /// Returns the lane-wise linear interpolation between \a v and \a w by \a s.
+    friend G_INLINE Vec3fPacket lerp(Vec3fPacket const& v,Vec3fPacket const& w,P const& s) {
+        return v+(w-v)*s;
+    }
+
+    //@}
+
+    /**
+     * \name Magnitude related methods
+     */
+    //@{
+
+    /// Returns the squared Cartesian lengths of the vectors.
+    G_INLINE P length2() const {
+        return x*x+y*y+z*z;
+    }
+
+    /// Returns the Cartesian lengths of the vectors.
+    G_INLINE P length() const {
+        return sqrt(length2());
+    }
+
+    /// Normalizes the vectors so their lengths equal 1 (if they are not very
+    /// small). Returns the lengths before normalization.
+    G_INLINE P normalize() {
+        P l2=length2();
+        P l=sqrt(l2);
+
+        // Divide short vectors by 1 to keep them unchanged like Vector does.
+        Mask m=l2>P(Numerics<float>::ZERO_TOLERANCE()*Numerics<float>::ZERO_TOLERANCE());
+        *this/=select(m,l,P(1.0f));
+
+        return l;
+    }
+
+    /// Returns the mask of lanes in which the vectors equal their counterparts
+    /// in \a v with regard to the tolerance \a t.
+    G_INLINE Mask equals(Vec3fPacket const& v,float const t=1e-6f) const {
+        return (v-*this).length2()<=P(t*t);
+    }
+
+    //@}
+
+    /**
+     * \name Convenience operators for named methods
+     */
+    //@{
+
+    /// Returns a normalized copy of \a v.
+    friend G_INLINE Vec3fPacket operator~(Vec3fPacket const& v) {
+        Vec3fPacket tmp=v;
+        tmp.normalize();
+        return tmp;
+    }
+
+    /// Returns the lane-wise dot products between \a v and \a w.
+    friend G_INLINE P operator%(Vec3fPacket const& v,Vec3fPacket const& w) {
+        return v.x*w.x+v.y*w.y+v.z*w.z;
+    }
+
+    /// Returns the lane-wise cross products between \a v and \a w.
+    friend G_INLINE Vec3fPacket operator^(Vec3fPacket const& v,Vec3fPacket const& w) {
+        return Vec3fPacket(
+            v.y*w.z-v.z*w.y
+        ,   v.z*w.x-v.x*w.z
+        ,   v.x*w.y-v.y*w.x
+        );
+    }
+
+    //@}
+
+    /**
+     * \name Comparison operators
+     * Like for Tuple, a vector compares less than another if all coordinates do.
+     */
+    //@{
+
+    /// Returns the mask of lanes in which all coordinates of \a v are less
+    /// than those of \a w.
+    friend G_INLINE Mask operator<(Vec3fPacket const& v,Vec3fPacket const& w) {
+        return (v.x<w.x)&(v.y<w.y)&(v.z<w.z);
+    }
+
+    /// Returns the mask of lanes in which all coordinates of \a v are less
+    /// than or equal to those of \a w.
+    friend G_INLINE Mask operator<=(Vec3fPacket const& v,Vec3fPacket const& w) {
+        return (v.x<=w.x)&(v.y<=w.y)&(v.z<=w.z);
+    }
+
+    /// Returns the mask of lanes in which all coordinates of \a v are greater
+    /// than those of \a w.
+    friend G_INLINE Mask operator>(Vec3fPacket const& v,Vec3fPacket const& w) {
+        return w<v;
+    }
+
+    /// Returns the mask of lanes in which all coordinates of \a v are greater
+    /// than or equal to those of \a w.
+    friend G_INLINE Mask operator>=(Vec3fPacket const& v,Vec3fPacket const& w) {
+        return w<=v;
+    }
+
+    /// Returns the vectors of \a v where \a m is true, and those of \a w otherwise.
+    friend G_INLINE Vec3fPacket select(Mask const& m,Vec3fPacket const& v,Vec3fPacket const& w) {
+        return Vec3fPacket(select(m,v.x,w.x),select(m,v.y,w.y),select(m,v.z,w.z));
+    }
+
+    //@}
+
+    P x; ///< Packet of x-coordinates.
+    P y; ///< Packet of y-coordinates.
+    P z; ///< Packet of z-coordinates.
+};
+
+/**
+ * \name Type definitions for packets of vectors
+ */
+//@{
+
+typedef Vec3fPacket<Packet4f> Vec3fx4; ///< Packet of 4 vectors using SSE.
+typedef Vec3fPacket<Packet8f> Vec3fx8; ///< Packet of 8 vectors using AVX.
+
+//@}
+
+} // namespace math
+
+} // namespace gale
@@ -0,0 +1,132 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#pragma once
+
+/**
+ * \file
+ * Routines to pack vectors into compact integer formats
+ */
+
+#include "vector.h"
+
+namespace gale {
+
+namespace math {
+
+/**
+ * \name Signed normalized formats
+ * The packed formats match those that OpenGL expects for the vertex attribute
+ * types \c GL_SHORT and \c GL_INT_2_10_10_10_REV with normalization. Components
+ * are expected to be in range [-1,1] and are clamped otherwise.
+ */
+//@{
+
+/// Packs the components of \a v to 16-bit integers \a p. The maximum absolute
+/// error per component is about 1.5e-5.
+inline void packSNorm16(Vec3f const& v,g_int16 p[3])
+{
+    for (int i=0;i<3;++i) {
+        p[i]=static_cast<g_int16>(roundToEven(clamp(v[i],-1.0f,1.0f)*32767.0f));
+    }
+}
+
+/// Returns the vector packed to 16-bit integers \a p.
+inline Vec3f unpackSNorm16(g_int16 const p[3])
+{
+    return Vec3f(
+        max(p[0]/32767.0f,-1.0f)
+    ,   max(p[1]/32767.0f,-1.0f)
+    ,   max(p[2]/32767.0f,-1.0f)
+    );
+}
+
+/// Packs the components of \a v to 10 bits each of a 32-bit integer, leaving the
+/// upper 2 bits zero. The maximum absolute error per component is about 1e-3.
+inline g_uint32 packSNorm1010102(Vec3f const& v)
+{
+    g_uint32 p=0;
+    for (int i=0;i<3;++i) {
+        int c=static_cast<int>(roundToEven(clamp(v[i],-1.0f,1.0f)*511.0f));
+        p|=(static_cast<g_uint32>(c)&0x3ff)<<(i*10);
+    }
+    return p;
+}
+
+/// Returns the vector packed to 10 bits per component in \a p.
+inline Vec3f unpackSNorm1010102(g_uint32 const p)
+{
+    Vec3f v;
+    for (int i=0;i<3;++i) {
+        // Shift the component's sign bit to the top for sign extension.
+        int c=static_cast<g_int32>(p<<(22-i*10))>>22;
+        v[i]=max(c/511.0f,-1.0f);
+    }
+    return v;
+}
+
+/// Packs the unit vector \a n to two 16-bit integers \a p using an octahedral
+/// mapping, which distributes the precision evenly across all directions. The
+/// maximum angular error is about 7e-5 radians. As there is no matching OpenGL
+/// vertex attribute type, decoding needs to be done by a shader on the GPU.
+inline void packOctSNorm16(Vec3f const& n,g_int16 p[2])
+{
+    // Project the vector onto the octahedron and fold the lower hemisphere.
+    float s=1.0f/(abs(n.getX())+abs(n.getY())+abs(n.getZ()));
+    float x=n.getX()*s,y=n.getY()*s;
+
+    if (n.getZ()<0) {
+        float fx=(1.0f-abs(y))*(x>=0?1.0f:-1.0f);
+        float fy=(1.0f-abs(x))*(y>=0?1.0f:-1.0f);
+        x=fx;
+        y=fy;
+    }
+
+    p[0]=static_cast<g_int16>(roundToEven(clamp(x,-1.0f,1.0f)*32767.0f));
+    p[1]=static_cast<g_int16>(roundToEven(clamp(y,-1.0f,1.0f)*32767.0f));
+}
+
+/// Returns the unit vector packed to two 16-bit integers \a p using an
+/// octahedral mapping.
+inline Vec3f unpackOctSNorm16(g_int16 const p[2])
+{
+    float x=max(p[0]/32767.0f,-1.0f),y=max(p[1]/32767.0f,-1.0f);
+    float z=1.0f-abs(x)-abs(y);
+
+    if (z<0) {
+        float fx=(1.0f-abs(y))*(x>=0?1.0f:-1.0f);
+        float fy=(1.0f-abs(x))*(y>=0?1.0f:-1.0f);
+        x=fx;
+        y=fy;
+    }
+
+    return ~Vec3f(x,y,z);
+}
+
+//@}
+
+} // namespace math
+
+} // namespace gale
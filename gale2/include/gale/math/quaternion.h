@@ -72,22 +72,21 @@ class Quaternion
      * \name Predefined constants
      * In order to avoid the so called "static initialization order fiasco",
      * static methods instead of static variables are used here, see
-     * http://www.parashift.com/c++-faq-lite/ctors.html#faq-10.14.
+     * http://www.parashift.com/c++-faq-lite/ctors.html#faq-10.14. The
+     * constants are returned by value so they can be folded at compile time.
      */
     //@{
 
     /// Returns a quaternion which has all components set to 0 (which is the
     /// identity quaternion regarding addition).
-    static Quaternion const& ZERO() {
-        static Quaternion const q(0,Vec::ZERO());
-        return q;
+    static G_CONSTEXPR Quaternion ZERO() {
+        return Quaternion(0,Vec::ZERO());
     }
 
     /// Returns a quaternion with the real part set to 1 and the imaginary part
     /// set to 0 (which is the identity quaternion regarding multiplication).
-    static Quaternion const& IDENTITY() {
-        static Quaternion const q(1,Vec::ZERO());
-        return q;
+    static G_CONSTEXPR Quaternion IDENTITY() {
+        return Quaternion(1,Vec::ZERO());
     }
 
     //@}
@@ -115,7 +114,7 @@ class Quaternion
 
     /// Initialized the quaternion to the given \a real number part and the
     /// imaginary number parts given as \a imag.
-    Quaternion(T const real,Vec const& imag)
+    G_CONSTEXPR Quaternion(T const real,Vec const& imag)
     :   real(real)
     ,   imag(imag)
     {}
@@ -460,7 +459,7 @@ class Quaternion
     /// \a r based on a scalar \a s within the quadrilateral defined
     /// together with the "tangent" quaternions \a a and \a b (the curve touches
     /// the midpoint of the "line" from \a a to \a b when \a s = 0.5).
-    /// Optionally, an \a interpolator may be specified. For performance
+    /// The given \a interpolator is used instead of slerp(). For performance
     /// reasons, \a s is not clamped to [0,1].
     friend Quaternion squad(
         Quaternion const& q
@@ -468,12 +467,29 @@ class Quaternion
     ,   float const s
     ,   Quaternion const& a
     ,   Quaternion const& b
-    ,   Interpolator const interpolator=Quaternion::slerp
+    ,   Interpolator const interpolator
     )
     {
         return interpolator(interpolator(q,r,s),interpolator(a,b,s),2*s*(1-s));
     }
 
+    /// Performs a cubic Bezier interpolation between the quaternions \a q and
+    /// \a r based on a scalar \a s within the quadrilateral defined
+    /// together with the "tangent" quaternions \a a and \a b using slerp().
+    /// For performance reasons, \a s is not clamped to [0,1].
+    friend Quaternion squad(
+        Quaternion const& q
+    ,   Quaternion const& r
+    ,   float const s
+    ,   Quaternion const& a
+    ,   Quaternion const& b
+    )
+    {
+        // As slerp() is only found by argument-dependent lookup, it cannot be
+        // named as the default argument for the interpolator.
+        return slerp(slerp(q,r,s),slerp(a,b,s),2*s*(1-s));
+    }
+
     //@}
 
     /**
@@ -32,6 +32,7 @@
 
 #include "../meta/loops.h"
 #include "../meta/operators.h"
+#include "../meta/tools.h"
 
 #include "random.h"
 
@@ -73,29 +74,39 @@ class TupleBase
     }
 
     /// Allows to initialize 2-tuples directly.
-    TupleBase(T const e0,T const e1) {
-        G_ASSERT(N==2)
-        m_data[0]=e0;
-        m_data[1]=e1;
+    G_CONSTEXPR TupleBase(T const e0,T const e1)
+    :   m_data{e0,e1}
+    {
+        static_assert(N==2,"Only 2-tuples can be initialized from 2 elements");
     }
 
     /// Allows to initialize 3-tuples directly.
-    TupleBase(T const e0,T const e1,T const e2) {
-        G_ASSERT(N==3)
-        m_data[0]=e0;
-        m_data[1]=e1;
-        m_data[2]=e2;
+    G_CONSTEXPR TupleBase(T const e0,T const e1,T const e2)
+    :   m_data{e0,e1,e2}
+    {
+        static_assert(N==3,"Only 3-tuples can be initialized from 3 elements");
     }
 
     /// Allows to initialize 4-tuples directly.
-    TupleBase(T const e0,T const e1,T const e2,T const e3) {
-        G_ASSERT(N==4)
-        m_data[0]=e0;
-        m_data[1]=e1;
-        m_data[2]=e2;
-        m_data[3]=e3;
+    G_CONSTEXPR TupleBase(T const e0,T const e1,T const e2,T const e3)
+    :   m_data{e0,e1,e2,e3}
+    {
+        static_assert(N==4,"Only 4-tuples can be initialized from 4 elements");
     }
 
+  protected:
+
+    /// Sets each element to either \a set or \a clear depending on the bits
+    /// set in \a mask. Bit 0 maps to the first element, bit 1 to second one
+    /// and so on. The indices \a I have to run from 0 to \a N-1. This
+    /// constructor is required to initialize constants at compile time.
+    template<unsigned int... I>
+    G_CONSTEXPR TupleBase(unsigned int const mask,T const set,T const clear,meta::IndexSequence<I...>)
+    :   m_data{(mask&(1<<I))?set:clear...}
+    {}
+
+  public:
+
     //@}
 
     /**
@@ -401,6 +412,7 @@ class TupleBase
 };
 
 #include "tuple_sse.inl"
+#include "tuple_avx.inl"
 
 #pragma pack(pop)
 
@@ -434,15 +446,15 @@ class Tuple:public TupleBase<N,T,Tuple<N,T> >
     Tuple() {}
 
     /// Allows to initialize 2-tuples directly.
-    Tuple(T const e0,T const e1)
+    G_CONSTEXPR Tuple(T const e0,T const e1)
     :   Base(e0,e1) {}
 
     /// Allows to initialize 3-tuples directly.
-    Tuple(T const e0,T const e1,T const e2)
+    G_CONSTEXPR Tuple(T const e0,T const e1,T const e2)
     :   Base(e0,e1,e2) {}
 
     /// Allows to initialize 4-tuples directly.
-    Tuple(T const e0,T const e1,T const e2,T const e3)
+    G_CONSTEXPR Tuple(T const e0,T const e1,T const e2,T const e3)
     :   Base(e0,e1,e2,e3) {}
 
     //@}
@@ -0,0 +1,410 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef GALE_USE_AVX
+
+#include <immintrin.h>
+
+/**
+ * Because there is more than one template parameter, this has to be a complete
+ * template specialization. It uses AVX instructions for x86 architectures, which
+ * process all four doubles in a single 256-bit register.
+ */
+template<class C>
+class TupleBase<4,double,C>
+{
+  public:
+
+    /**
+     * \name Constructors
+     */
+    //@{
+
+    /// Create a tuple whose elements are either not initialized at all or
+    /// initialized to 0 if \c GALE_INIT_DATA is defined.
+    TupleBase() {
+#ifdef GALE_INIT_DATA
+        m_simd=_mm256_setzero_pd();
+#endif
+    }
+
+    /// Allows to initialize 4-tuples directly.
+    TupleBase(double const e0,double const e1,double const e2,double const e3) {
+        m_simd=_mm256_setr_pd(e0,e1,e2,e3);
+    }
+
+  protected:
+
+    /// Sets each element to either \a set or \a clear depending on the bits
+    /// set in \a mask. Unlike for the generic TupleBase, this cannot be
+    /// evaluated at compile time.
+    template<unsigned int... I>
+    TupleBase(unsigned int const mask,double const set,double const clear,meta::IndexSequence<I...>) {
+        m_simd=_mm256_setr_pd(mask&1?set:clear,mask&2?set:clear,mask&4?set:clear,mask&8?set:clear);
+    }
+
+  public:
+
+    //@}
+
+    /**
+     * \name Element access methods
+     */
+    //@{
+
+    /// Returns a pointer to the internal data array.
+    double* data() {
+        return m_data;
+    }
+
+    /// Returns a constant pointer to the internal data array.
+    double const* data() const {
+        return m_data;
+    }
+
+    /// Casts \c this tuple to a pointer of type \c double. As an intended side
+    /// effect, this also provides indexed data access.
+    operator double*() {
+        return data();
+    }
+
+    /// Casts \c this tuple to a constant pointer of type \c double. As an
+    /// intended side effect, this also provides indexed data access.
+    operator double const*() const {
+        return data();
+    }
+
+    /// Assigns new values to the first two tuple elements.
+    void set(double const e0,double const e1) {
+        m_data[0]=e0;
+        m_data[1]=e1;
+    }
+
+    /// Assigns new values to the first three tuple elements.
+    void set(double const e0,double const e1,double const e2) {
+        m_data[0]=e0;
+        m_data[1]=e1;
+        m_data[2]=e2;
+    }
+
+    /// Assigns new values to the first four tuple elements.
+    void set(double const e0,double const e1,double const e2,double const e3) {
+        m_simd=_mm256_setr_pd(e0,e1,e2,e3);
+    }
+
+    /// Loads the tuple elements from an array of four doubles at address \a a,
+    /// which must be 32-byte aligned.
+    void load(double const* const a) {
+        m_simd=_mm256_load_pd(a);
+    }
+
+    /// Stores the tuple elements to an array of four doubles at address \a a,
+    /// which must be 32-byte aligned.
+    void store(double* const a) const {
+        _mm256_store_pd(a,m_simd);
+    }
+
+    //@}
+
+    /**
+     * \name Arithmetic tuple / tuple operators
+     */
+    //@{
+
+    /// Element-wise increments \c this tuple by tuple \a t.
+    C const& operator+=(C const& t) {
+        m_simd=_mm256_add_pd(m_simd,t.m_simd);
+        return *static_cast<C*>(this);
+    }
+
+    /// Element-wise decrements \c this tuple by tuple \a t.
+    C const& operator-=(C const& t) {
+        m_simd=_mm256_sub_pd(m_simd,t.m_simd);
+        return *static_cast<C*>(this);
+    }
+
+    /// Element-wise multiplies \c this tuple by tuple \a t.
+    C const& operator*=(C const& t) {
+        m_simd=_mm256_mul_pd(m_simd,t.m_simd);
+        return *static_cast<C*>(this);
+    }
+
+    /// Element-wise divides \c this tuple by tuple \a t.
+    C const& operator/=(C const& t) {
+        G_ASSERT(t.absMinElement()>Numerics<double>::ZERO_TOLERANCE())
+        m_simd=_mm256_div_pd(m_simd,t.m_simd);
+        return *static_cast<C*>(this);
+    }
+
+    /// Returns tuple \a t unchanged; provided for convenience.
+    friend C const& operator+(C const& t) {
+        return t;
+    }
+
+    /// Returns the element-wise negation of tuple \a t.
+    friend C operator-(C const& t) {
+        C tmp;
+        // Flip the sign bits so that 0 becomes -0 like in the generic case.
+        tmp.m_simd=_mm256_xor_pd(t.m_simd,_mm256_set1_pd(-0.0));
+        return tmp;
+    }
+
+    /// Returns the element-wise sum of tuples \a t and \a u.
+    friend C operator+(C const& t,C const& u) {
+        return C(t)+=u;
+    }
+
+    /// Returns the element-wise difference of tuples \a t and \a u.
+    friend C operator-(C const& t,C const& u) {
+        return C(t)-=u;
+    }
+
+    /// Returns the element-wise product of tuples \a t and \a u.
+    friend C operator*(C const& t,C const& u) {
+        return C(t)*=u;
+    }
+
+    /// Returns the element-wise quotient of tuples \a t and \a u.
+    friend C operator/(C const& t,C const& u) {
+        // The value of u is checked downstream in OpArithReci.
+        return C(t)/=u;
+    }
+
+    //@}
+
+    /**
+     * \name Arithmetic tuple / scalar operators
+     */
+    //@{
+
+    /// Multiplies each element of \c this tuple by a scalar \a s.
+    C const& operator*=(double const s) {
+        m_simd=_mm256_mul_pd(m_simd,_mm256_set1_pd(s));
+        return *static_cast<C*>(this);
+    }
+
+    /// Divides each element of \c this tuple by a scalar \a s.
+    C const& operator/=(double const s) {
+        G_ASSERT(abs(s)>Numerics<double>::ZERO_TOLERANCE())
+        m_simd=_mm256_div_pd(m_simd,_mm256_set1_pd(s));
+        return *static_cast<C*>(this);
+    }
+
+    /// Multiplies each element of tuple \a t by a scalar \a s from the right.
+    friend C operator*(C const& t,double const s) {
+        return C(t)*=s;
+    }
+
+    /// Multiplies each element of tuple \a t by a scalar \a s from the left.
+    friend C operator*(double const s,C const& t) {
+        return t*s;
+    }
+
+    /// Divides each element of tuple \a t by a scalar \a s.
+    friend C operator/(C const& t,double const s) {
+        // The value of s is checked downstream in operator/=(double s).
+        return C(t)/=s;
+    }
+
+    /// Divides a scalar \a s by each element of tuple \a t.
+    friend C operator/(double const s,C const& t) {
+        G_ASSERT(t.absMinElement()>Numerics<double>::ZERO_TOLERANCE())
+
+        C tmp;
+        tmp.m_simd=_mm256_div_pd(_mm256_set1_pd(s),t.m_simd);
+        return tmp;
+    }
+
+    //@}
+
+    /**
+     * \name Extremes determination methods
+     */
+    //@{
+
+    /// Determines the minimum element of \c this tuple.
+    double minElement() const {
+        return horizontalMin(m_simd);
+    }
+
+    /// Determines the maximum element of \c this tuple.
+    double maxElement() const {
+        return horizontalMax(m_simd);
+    }
+
+    /// Determines the absolute minimum element of \c this tuple.
+    double absMinElement() const {
+        return horizontalMin(absValues(m_simd));
+    }
+
+    /// Determines the absolute maximum element of \c this tuple.
+    double absMaxElement() const {
+        return horizontalMax(absValues(m_simd));
+    }
+
+    /// Calculates the element-wise minimum of \c this tuple and tuple \a t.
+    C minElements(C const& t) const {
+        C tmp;
+        tmp.m_simd=_mm256_min_pd(m_simd,t.m_simd);
+        return tmp;
+    }
+
+    /// Calculates the element-wise maximum of \c this tuple and tuple \a t.
+    C maxElements(C const& t) const {
+        C tmp;
+        tmp.m_simd=_mm256_max_pd(m_simd,t.m_simd);
+        return tmp;
+    }
+
+    //@}
+
+    /**
+     * \name Element-wise comparison operators
+     */
+    //@{
+
+    /// Returns whether all elements in \a t are less than their counterpart in
+    /// \a u.
+    friend bool operator<(C const& t,C const& u) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(t.m_simd,u.m_simd,_CMP_LT_OQ))==0xf;
+    }
+
+    /// Returns whether all elements in \a t are less than or equal to their
+    /// counterpart in \a u.
+    friend bool operator<=(C const& t,C const& u) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(t.m_simd,u.m_simd,_CMP_LE_OQ))==0xf;
+    }
+
+    /// Returns whether all elements in \a t are greater than their counterpart
+    /// in \a u.
+    friend bool operator>(C const& t,C const& u) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(t.m_simd,u.m_simd,_CMP_GT_OQ))==0xf;
+    }
+
+    /// Returns whether all elements in \a t are greater than or equal to their
+    /// counterpart in \a u.
+    friend bool operator>=(C const& t,C const& u) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(t.m_simd,u.m_simd,_CMP_GE_OQ))==0xf;
+    }
+
+    /// Returns whether all elements in \a t equal their counterpart in \a u
+    /// with regard to a tolerance depending on the precision of type \c double.
+    friend bool operator==(C const& t,C const& u) {
+        __m256d diff=absValues(_mm256_sub_pd(u.m_simd,t.m_simd));
+        __m256d tol=_mm256_set1_pd(Numerics<double>::ZERO_TOLERANCE());
+        return _mm256_movemask_pd(_mm256_cmp_pd(diff,tol,_CMP_LE_OQ))==0xf;
+    }
+
+    /// Returns whether the elements in \a t are not equal to their counterparts
+    /// in \a u with regard to a tolerance depending on the precision of type
+    /// \c double.
+    friend bool operator!=(C const& t,C const& u) {
+        return !(t==u);
+    }
+
+    //@}
+
+    /**
+     * \name Miscellaneous methods
+     */
+    //@{
+
+    /// Linearly interpolates between the tuples \a t and \a u based on a scalar
+    /// \a s. For performance reasons, \a s is not clamped to [0,1].
+    friend C lerp(C const& t,C const& u,double const s) {
+        C tmp;
+        tmp.m_simd=_mm256_add_pd(
+            t.m_simd
+        ,   _mm256_mul_pd(
+                _mm256_sub_pd(u.m_simd,t.m_simd)
+            ,   _mm256_set1_pd(s)
+            )
+        );
+        return tmp;
+    }
+
+    //@}
+
+#ifndef GALE_TINY_CODE
+
+    /**
+     * \name Streaming input / output methods
+     */
+    //@{
+
+    /// Reads tuple values from an input stream.
+    friend std::istream& operator>>(std::istream& s,C& t) {
+        return s
+            >> t.m_data[0]
+            >> t.m_data[1]
+            >> t.m_data[2]
+            >> t.m_data[3]
+        ;
+    }
+
+    /// Writes tuple values to an output stream.
+    friend std::ostream& operator<<(std::ostream& s,C const& t) {
+        return s
+            << '(' << t.m_data[0]
+            << ',' << t.m_data[1]
+            << ',' << t.m_data[2]
+            << ',' << t.m_data[3]
+            << ')'
+        ;
+    }
+
+    //@}
+
+#endif // GALE_TINY_CODE
+
+  protected:
+
+    /// Returns the absolute values of the elements in \a v by clearing the
+    /// sign bits.
+    static __m256d absValues(__m256d const v) {
+        return _mm256_andnot_pd(_mm256_set1_pd(-0.0),v);
+    }
+
+    /// Returns the minimum of the elements in \a v.
+    static double horizontalMin(__m256d v) {
+        v=_mm256_min_pd(v,_mm256_permute_pd(v,0x5));
+        v=_mm256_min_pd(v,_mm256_permute2f128_pd(v,v,0x01));
+        return _mm_cvtsd_f64(_mm256_castpd256_pd128(v));
+    }
+
+    /// Returns the maximum of the elements in \a v.
+    static double horizontalMax(__m256d v) {
+        v=_mm256_max_pd(v,_mm256_permute_pd(v,0x5));
+        v=_mm256_max_pd(v,_mm256_permute2f128_pd(v,v,0x01));
+        return _mm_cvtsd_f64(_mm256_castpd256_pd128(v));
+    }
+
+    union {
+        __m256d m_simd;  ///< SIMD data type for a 256-bit register.
+        double m_data[4]; ///< Element view of the SIMD register.
+    };
+};
+
+#endif // GALE_USE_AVX
@@ -29,7 +29,9 @@
 
 /**
  * Because there is more than one template parameter, this has to be a complete
- * template specialization. It uses SSE instructions for x86 architectures.
+ * template specialization. It uses SSE instructions for x86 architectures. The
+ * elements are accessed through a union instead of compiler specific members of
+ * \c __m128, so this works with MSVC as well as with GCC and Clang.
  */
 template<class C>
 class TupleBase<4,float,C>
@@ -54,6 +56,18 @@ class TupleBase<4,float,C>
         m_simd=_mm_setr_ps(e0,e1,e2,e3);
     }
 
+  protected:
+
+    /// Sets each element to either \a set or \a clear depending on the bits
+    /// set in \a mask. Unlike for the generic TupleBase, this cannot be
+    /// evaluated at compile time.
+    template<unsigned int... I>
+    TupleBase(unsigned int const mask,float const set,float const clear,meta::IndexSequence<I...>) {
+        m_simd=_mm_setr_ps(mask&1?set:clear,mask&2?set:clear,mask&4?set:clear,mask&8?set:clear);
+    }
+
+  public:
+
     //@}
 
     /**
@@ -63,12 +77,12 @@ class TupleBase<4,float,C>
 
     /// Returns a pointer to the internal data array.
     float* data() {
-        return m_simd.m128_f32;
+        return m_data;
     }
 
     /// Returns a constant pointer to the internal data array.
     float const* data() const {
-        return m_simd.m128_f32;
+        return m_data;
     }
 
     /// Casts \c this tuple to a pointer of type \c float. As an intended side
@@ -83,11 +97,36 @@ class TupleBase<4,float,C>
         return data();
     }
 
+    /// Assigns new values to the first two tuple elements.
+    void set(float const e0,float const e1) {
+        m_data[0]=e0;
+        m_data[1]=e1;
+    }
+
+    /// Assigns new values to the first three tuple elements.
+    void set(float const e0,float const e1,float const e2) {
+        m_data[0]=e0;
+        m_data[1]=e1;
+        m_data[2]=e2;
+    }
+
     /// Assigns new values to the first four tuple elements.
     void set(float const e0,float const e1,float const e2,float const e3) {
         m_simd=_mm_setr_ps(e0,e1,e2,e3);
     }
 
+    /// Loads the tuple elements from an array of four floats at address \a a,
+    /// which must be 16-byte aligned.
+    void load(float const* const a) {
+        m_simd=_mm_load_ps(a);
+    }
+
+    /// Stores the tuple elements to an array of four floats at address \a a,
+    /// which must be 16-byte aligned.
+    void store(float* const a) const {
+        _mm_store_ps(a,m_simd);
+    }
+
     //@}
 
     /**
@@ -115,8 +154,9 @@ class TupleBase<4,float,C>
 
     /// Element-wise divides \c this tuple by tuple \a t.
     C const& operator/=(C const& t) {
-        // The value of t is checked downstream in operator/=(float s).
-        return (*this)*=1/t;
+        G_ASSERT(t.absMinElement()>Numerics<float>::ZERO_TOLERANCE())
+        m_simd=_mm_div_ps(m_simd,t.m_simd);
+        return *static_cast<C*>(this);
     }
 
     /// Returns tuple \a t unchanged; provided for convenience.
@@ -127,7 +167,8 @@ class TupleBase<4,float,C>
     /// Returns the element-wise negation of tuple \a t.
     friend C operator-(C const& t) {
         C tmp;
-        tmp.m_simd=_mm_sub_ps(_mm_set_ps1(0),t.m_simd);
+        // Flip the sign bits so that 0 becomes -0 like in the generic case.
+        tmp.m_simd=_mm_xor_ps(t.m_simd,_mm_set_ps1(-0.0f));
         return tmp;
     }
 
@@ -168,7 +209,8 @@ class TupleBase<4,float,C>
     /// Divides each element of \c this tuple by a scalar \a s.
     C const& operator/=(float const s) {
         G_ASSERT(abs(s)>Numerics<float>::ZERO_TOLERANCE())
-        return (*this)*=1/s;
+        m_simd=_mm_div_ps(m_simd,_mm_set_ps1(s));
+        return *static_cast<C*>(this);
     }
 
     /// Multiplies each element of tuple \a t by a scalar \a s from the right.
@@ -189,8 +231,11 @@ class TupleBase<4,float,C>
 
     /// Divides a scalar \a s by each element of tuple \a t.
     friend C operator/(float const s,C const& t) {
+        G_ASSERT(t.absMinElement()>Numerics<float>::ZERO_TOLERANCE())
+
+        // Do not use _mm_rcp_ps() here as its 12-bit precision is too low.
         C tmp;
-        tmp.m_simd=_mm_mul_ps(_mm_set_ps1(s),_mm_rcp_ps(t.m_simd));
+        tmp.m_simd=_mm_div_ps(_mm_set_ps1(s),t.m_simd);
         return tmp;
     }
 
@@ -203,22 +248,22 @@ class TupleBase<4,float,C>
 
     /// Determines the minimum element of \c this tuple.
     float minElement() const {
-        return meta::LoopFwd<4,meta::OpCalcMin>::iterate(data());
+        return horizontalMin(m_simd);
     }
 
     /// Determines the maximum element of \c this tuple.
     float maxElement() const {
-        return meta::LoopFwd<4,meta::OpCalcMax>::iterate(data());
+        return horizontalMax(m_simd);
     }
 
     /// Determines the absolute minimum element of \c this tuple.
     float absMinElement() const {
-        return meta::LoopFwd<4,meta::OpCalcMin>::iterateAbsValues(data());
+        return horizontalMin(absValues(m_simd));
     }
 
     /// Determines the absolute maximum element of \c this tuple.
     float absMaxElement() const {
-        return meta::LoopFwd<4,meta::OpCalcMax>::iterateAbsValues(data());
+        return horizontalMax(absValues(m_simd));
     }
 
     /// Calculates the element-wise minimum of \c this tuple and tuple \a t.
@@ -266,13 +311,17 @@ class TupleBase<4,float,C>
         return _mm_movemask_ps(_mm_cmpge_ps(t.m_simd,u.m_simd))==0xf;
     }
 
-    /// Returns whether all elements in \a t equal their counterpart in \a u.
+    /// Returns whether all elements in \a t equal their counterpart in \a u
+    /// with regard to a tolerance depending on the precision of type \c float.
     friend bool operator==(C const& t,C const& u) {
-        return _mm_movemask_ps(_mm_cmpeq_ps(t.m_simd,u.m_simd))==0xf;
+        __m128 diff=absValues(_mm_sub_ps(u.m_simd,t.m_simd));
+        __m128 tol=_mm_set_ps1(Numerics<float>::ZERO_TOLERANCE());
+        return _mm_movemask_ps(_mm_cmple_ps(diff,tol))==0xf;
     }
 
     /// Returns whether the elements in \a t are not equal to their counterparts
-    /// in \a u.
+    /// in \a u with regard to a tolerance depending on the precision of type
+    /// \c float.
     friend bool operator!=(C const& t,C const& u) {
         return !(t==u);
     }
@@ -310,20 +359,20 @@ class TupleBase<4,float,C>
     /// Reads tuple values from an input stream.
     friend std::istream& operator>>(std::istream& s,C& t) {
         return s
-            >> t.m_simd.m128_f32[0]
-            >> t.m_simd.m128_f32[1]
-            >> t.m_simd.m128_f32[2]
-            >> t.m_simd.m128_f32[3]
+            >> t.m_data[0]
+            >> t.m_data[1]
+            >> t.m_data[2]
+            >> t.m_data[3]
         ;
     }
 
     /// Writes tuple values to an output stream.
     friend std::ostream& operator<<(std::ostream& s,C const& t) {
         return s
-            << '(' << t.m_simd.m128_f32[0]
-            << ',' << t.m_simd.m128_f32[1]
-            << ',' << t.m_simd.m128_f32[2]
-            << ',' << t.m_simd.m128_f32[3]
+            << '(' << t.m_data[0]
+            << ',' << t.m_data[1]
+            << ',' << t.m_data[2]
+            << ',' << t.m_data[3]
             << ')'
         ;
     }
@@ -334,7 +383,31 @@ class TupleBase<4,float,C>
 
   protected:
 
-    __m128 m_simd;   ///< SIMD data type for a 128-bit register.
+    /// Returns the absolute values of the elements in \a v by clearing the
+    /// sign bits.
+    static __m128 absValues(__m128 const v) {
+        return _mm_andnot_ps(_mm_set_ps1(-0.0f),v);
+    }
+
+    /// Returns the minimum of the elements in \a v.
+    static float horizontalMin(__m128 v) {
+        v=_mm_min_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(2,3,0,1)));
+        v=_mm_min_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(1,0,3,2)));
+        return _mm_cvtss_f32(v);
+    }
+
+    /// Returns the maximum of the elements in \a v.
+    static float horizontalMax(__m128 v) {
+        v=_mm_max_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(2,3,0,1)));
+        v=_mm_max_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(1,0,3,2)));
+        return _mm_cvtss_f32(v);
+    }
+
+    // Portable element access; __m128::m128_f32 is only available on MSVC.
+    union {
+        __m128 m_simd;   ///< SIMD data type for a 128-bit register.
+        float m_data[4]; ///< Element view of the SIMD register.
+    };
 };
 
 #endif // GALE_USE_SSE
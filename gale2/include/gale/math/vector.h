@@ -30,6 +30,7 @@
  * Linear algebra vector routines
  */
 
+#include "fastmath.h"
 #include "tuple.h"
 
 namespace gale {
@@ -69,38 +70,34 @@ class Vector:public TupleBase<N,T,Vector<N,T> >
      * \name Predefined constants
      * In order to avoid the so called "static initialization order fiasco",
      * static methods instead of static variables are used here, see
-     * http://www.parashift.com/c++-faq-lite/ctors.html#faq-10.14.
+     * http://www.parashift.com/c++-faq-lite/ctors.html#faq-10.14. The
+     * constants are returned by value so they can be folded at compile time.
      */
     //@{
 
     /// Returns a vector which has all components set to 0.
-    static Vector const& ZERO() {
-        static Vector const v(0x0);
-        return v;
+    static G_CONSTEXPR Vector ZERO() {
+        return Vector(0x0);
     }
 
     /// Returns a vector which has the x-component set to 1, all others to 0.
-    static Vector const& X() {
-        static Vector const v(0x1);
-        return v;
+    static G_CONSTEXPR Vector X() {
+        return Vector(0x1);
     }
 
     /// Returns a vector which has the y-component set to 1, all others to 0.
-    static Vector const& Y() {
-        static Vector const v(0x2);
-        return v;
+    static G_CONSTEXPR Vector Y() {
+        return Vector(0x2);
     }
 
     /// Returns a vector which has the z-component set to 1, all others to 0.
-    static Vector const& Z() {
-        static Vector const v(0x4);
-        return v;
+    static G_CONSTEXPR Vector Z() {
+        return Vector(0x4);
     }
 
     /// Returns a vector which has the w-component set to 1, all others to 0.
-    static Vector const& W() {
-        static Vector const v(0x8);
-        return v;
+    static G_CONSTEXPR Vector W() {
+        return Vector(0x8);
     }
 
     //@}
@@ -131,9 +128,8 @@ class Vector:public TupleBase<N,T,Vector<N,T> >
     /// set in \a mask. Bit 0 maps to the first component, bit 1 to second one
     /// and so on. This constructor is required to initialize the static class
     /// constants.
-    explicit Vector(unsigned int const mask) {
-        meta::LoopFwd<N,meta::OpAssign>::iterateIndexMask(Base::data(),mask);
-    }
+    G_CONSTEXPR explicit Vector(unsigned int const mask)
+    :   Base(mask,T(1),T(0),meta::MakeIndexSequence<N>()) {}
 
   public:
 
@@ -142,15 +138,15 @@ class Vector:public TupleBase<N,T,Vector<N,T> >
     Vector() {}
 
     /// Allows to initialize 2-vectors directly.
-    Vector(T const x,T const y)
+    G_CONSTEXPR Vector(T const x,T const y)
     :   Base(x,y) {}
 
     /// Allows to initialize 3-vectors directly.
-    Vector(T const x,T const y,T const z)
+    G_CONSTEXPR Vector(T const x,T const y,T const z)
     :   Base(x,y,z) {}
 
     /// Allows to initialize 4-vectors directly.
-    Vector(T const x,T const y,T const z,T const w)
+    G_CONSTEXPR Vector(T const x,T const y,T const z,T const w)
     :   Base(x,y,z,w) {}
 
     /// Converts a vector of different type but with the same amount of
@@ -263,6 +259,28 @@ class Vector:public TupleBase<N,T,Vector<N,T> >
         return l;
     }
 
+    /// Normalizes this vector like normalize(), but with the given \a accuracy
+    /// for float vectors. \c ACCURACY_HIGH multiplies by a reciprocal square
+    /// root estimate that is refined by one Newton-Raphson step, resulting in a
+    /// length within 1e-6 of 1, and \c ACCURACY_FAST uses the raw estimate,
+    /// resulting in a length within 4e-4 of 1, see rsqrtPS(). Returns the
+    /// (approximate) length before normalization.
+    double normalize(Accuracy const accuracy) {
+        if (accuracy==ACCURACY_EXACT) {
+            return normalize();
+        }
+
+        T l2=length2();
+
+        if (l2>Numerics<T>::ZERO_TOLERANCE()*Numerics<T>::ZERO_TOLERANCE()) {
+            T r=rsqrt(l2,accuracy);
+            (*this)*=r;
+            return l2*r;
+        }
+
+        return l2;
+    }
+
     /// Returns whether all elements equal their counterpart in \a v with regard
     /// to the tolerance \a t.
     bool equals(Vector const& v,T const t=T(1e-6)) {
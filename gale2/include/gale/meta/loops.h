@@ -106,6 +106,14 @@ struct LoopFwd
             && OP::evaluate(a[index],b[index]);
     }
 
+    /// Iterates over a destination array and an object \a b that provides
+    /// an index operator, like an expression template.
+    template<typename A,class B>
+    static G_INLINE void iterateIndexed(A* const a,B const& b) {
+        LoopFwd<index,OP>::iterateIndexed(a,b);
+        OP::evaluate(a[index],b[index]);
+    }
+
     /// Iterates over a destination array \a a setting its elements according to
     /// the bit mask \a b to either the value of \a set or \a clear.
     template<typename A,typename B>
@@ -171,6 +179,13 @@ struct LoopFwd<1,OP>
         return OP::evaluate(a[0],b[0]);
     }
 
+    /// Iterates over a destination array and an object \a b that provides
+    /// an index operator, like an expression template.
+    template<typename A,class B>
+    static G_INLINE void iterateIndexed(A* const a,B const& b) {
+        OP::evaluate(a[0],b[0]);
+    }
+
     /// Iterates over a destination array \a a setting its elements according to
     /// the bit mask \a b to either the value of \a set or \a clear.
     template<typename A,typename B>
@@ -59,6 +59,32 @@ struct ArrayInitializer
     T* iterator; ///< Stores the current position within the array.
 };
 
+/**
+ * A compile-time sequence of the indices \a I, e.g. to expand an array
+ * initializer element by element in a constant expression.
+ */
+template<unsigned int... I>
+struct IndexSequence
+{
+};
+
+/**
+ * Helper class that derives from IndexSequence<0,...,N-1>, so an instance
+ * can be passed where an IndexSequence is expected.
+ */
+template<unsigned int N,unsigned int... I>
+struct MakeIndexSequence:public MakeIndexSequence<N-1,N-1,I...>
+{
+};
+
+/**
+ * Partial template specialization to stop the meta-recursion.
+ */
+template<unsigned int... I>
+struct MakeIndexSequence<0,I...>:public IndexSequence<I...>
+{
+};
+
 } // namespace meta
 
 } // namespace gale
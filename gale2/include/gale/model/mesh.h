@@ -31,6 +31,7 @@
  */
 
 #include "../global/dynamicarray.h"
+#include "../math/fastmath.h"
 #include "../math/formula.h"
 #include "../math/hmatrix4.h"
 
@@ -60,20 +61,22 @@ struct Mesh
     {
       public:
 
-        /// Methods to create shapes, e.g. for use as extrusion contours.
+        /// Methods to create shapes, e.g. for use as extrusion contours. All
+        /// samples are calculated in batches, which are vectorized if a lower
+        /// \a accuracy than the default \c math::ACCURACY_EXACT is requested.
         struct Shape
         {
             /// Returns an array of vectors on an ellipse with width \a w and
             /// height \a h, divided into \a segs segments.
-            static void Ellipse(VectorArray& shape,int const segs,float const w,float const h);
+            static void Ellipse(VectorArray& shape,int const segs,float const w,float const h,math::Accuracy const accuracy=math::ACCURACY_EXACT);
 
             /// Returns an array of vectors on a heart shape as published at
             /// http://iquilezles.org/blog/?p=1181.
-            static void Heart(VectorArray& shape,int const segs);
+            static void Heart(VectorArray& shape,int const segs,math::Accuracy const accuracy=math::ACCURACY_EXACT);
 
             /// Returns an array of vectors as calculated by the Superformula,
             /// see http://local.wasp.uwa.edu.au/~pbourke/geometry/supershape/.
-            static void Supershape(VectorArray& shape,int const segs,float const m,float const n1,float const n2,float const n3,float const a=1.0f,float const b=1.0f);
+            static void Supershape(VectorArray& shape,int const segs,float const m,float const n1,float const n2,float const n3,float const a=1.0f,float const b=1.0f,math::Accuracy const accuracy=math::ACCURACY_EXACT);
         };
 
         /**
@@ -185,7 +188,15 @@ struct Mesh
         /// Generates a mesh by extruding the line loop defined by \a contour
         /// along the given \a path. If \a close is \c true, the end of the path
         /// is connected to its beginning, else cut faces are created.
-        static Mesh* Extruder(VectorArray const& path,VectorArray const& contour,bool const closed=true,MatrixArray const* const trans=NULL);
+        static Mesh* Extruder(VectorArray const& path,VectorArray const& contour,bool const closed=true,MatrixArray const* const trans=NULL) {
+            return Extruder(path,contour,contour.getSize(),closed,trans);
+        }
+
+        /// Generates a mesh by extruding the line loop defined by the
+        /// \a contour_size vectors at \a contour along the given \a path. The
+        /// contour is only read, so a precomputed contour may be shared among
+        /// any number of extrusions without copying it into a VectorArray.
+        static Mesh* Extruder(VectorArray const& path,math::Vec3f const* const contour,int const contour_size,bool const closed=true,MatrixArray const* const trans=NULL);
 
         /// Generates a mesh's surface by calculating \a eval at every point on
         /// the grid of size \a s_segs by \a t_segs which is defined by walking
@@ -297,6 +308,69 @@ struct Mesh
         static void assignNeighbors(Mesh const& orig,Mesh& mesh,int const x0i);
     };
 
+    /// Class to reduce the number of faces of meshes, e.g. to generate levels
+    /// of detail for rendering distant objects.
+    class Simplifier
+    {
+      public:
+
+        /// Collapses edges of \a mesh in the order of the least quadric error
+        /// as described by M. Garland and P. Heckbert in
+        /// http://graphics.cs.uiuc.edu/~garland/papers/quadrics.pdf until its
+        /// faces amount to at most \a triangles triangles, where a face with
+        /// n vertices counts as n-2 triangles. The ordered neighborhoods are
+        /// kept consistent. Collapses that would change the topology or flip
+        /// faces are skipped, and vertices of faces with other than 3 to 5
+        /// vertices, e.g. at boundaries, are kept. Returns the number of
+        /// triangles the faces amount to.
+        static int EdgeCollapse(Mesh& mesh,int const triangles);
+    };
+
+    /// Class to create meshes from face lists as e.g. stored in files. Faces
+    /// are expected to list their vertex indices in counter-clockwise order.
+    class Importer
+    {
+      public:
+
+        /// Returns a mesh consisting of the given \a vertices and faces, where
+        /// the vertex indices of face \c i are stored in \a indices starting
+        /// at \a offsets[i] up to (excluding) \a offsets[i+1]. The neighborhood
+        /// of each vertex is ordered using a hash of the faces' directed edges
+        /// in time linear to the number of face vertices. If \a threads is 0,
+        /// all available processors are used.
+        static Mesh* Faces(VectorArray const& vertices,IndexArray const& offsets,IndexArray const& indices,int const threads=0);
+
+#ifndef GALE_TINY_CODE
+
+        /**
+         * \name File importers
+         * Methods to stream meshes from files with bounded buffer memory. The
+         * files are read in blocks which are parsed by up to \a threads threads
+         * in parallel. Return \c NULL if the file cannot be read or parsed.
+         */
+        //@{
+
+        /// Returns a mesh read from the Wavefront OBJ file at \a path, see
+        /// http://www.martinreddy.net/gfx/3d/OBJ.spec. Only vertex positions
+        /// and faces are imported.
+        static Mesh* OBJ(char const* path,int const threads=0);
+
+        /// Returns a mesh read from the binary PLY file at \a path, see
+        /// http://paulbourke.net/dataformats/ply/. Only vertex positions and
+        /// faces are imported.
+        static Mesh* PLY(char const* path,int const threads=0);
+
+        //@}
+
+#endif // GALE_TINY_CODE
+
+      private:
+
+        /// Orders the neighborhoods of all vertices in \a mesh according to
+        /// the faces described by \a offsets and \a indices, see Faces().
+        static void assignNeighbors(Mesh& mesh,IndexArray const& offsets,IndexArray const& indices,int const threads);
+    };
+
     /// Creates a mesh with \a num_vertices uninitialized vertices.
     Mesh(int const num_vertices=0)
     :   vertices(num_vertices),neighbors(num_vertices) {}
@@ -333,6 +407,20 @@ struct Mesh
     /// vertices that make up the edge's face, and their indices in \a polygon.
     int orbit(int ai,int bi,IndexArray& polygon) const;
 
+    /// Walks each oriented edge once to collect all faces of at least three
+    /// vertices. The face indices are stored consecutively in \a indices, where
+    /// face \c f spans the range from \a offsets[f] to \a offsets[f+1]. Each
+    /// face starts at its vertex of the lowest index, so the faces are sorted
+    /// by their first vertex. The vertices are split into ranges that are
+    /// walked by up to \a threads threads, with each face extracted by the
+    /// range containing its first vertex. Returns the number of faces.
+    int extractFaces(IndexArray& offsets,IndexArray& indices,int const threads=0) const;
+
+    /// Assigns each vertex the index of its connected component in
+    /// \a components, where components are numbered in order of their vertex
+    /// of the lowest index. Returns the number of components.
+    int connectedComponents(IndexArray& components) const;
+
     //@}
 
     /**
@@ -350,6 +438,12 @@ struct Mesh
     /// Removes \a xi from the neighborhood of \a vi.
     void erase(int const xi,int const vi);
 
+    /// Merges all vertices that are closer than \a epsilon to each other and
+    /// joins their neighborhoods. A spatial hash is used to find coincident
+    /// vertices in linear expected time, optionally using the given number of
+    /// \a threads. Returns the number of removed vertices.
+    int weld(float const epsilon,int const threads=0);
+
     //@}
 
     /**
@@ -0,0 +1,131 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#pragma once
+
+/**
+ * \file
+ * Triangle cluster routines for fine-grained culling
+ */
+
+#include "../math/matrix4.h"
+
+#include "boundingbox.h"
+#include "mesh.h"
+
+namespace gale {
+
+namespace model {
+
+/**
+ * A set of meshlets, i.e. small clusters of adjacent triangles, each with its
+ * own bounding volumes and normal cone, so they can be culled individually.
+ * All data is stored in flat arrays indexed by the meshlet number.
+ */
+class Meshlets
+{
+  public:
+
+    /// Partitions the triangles described by \a count \a indices into
+    /// meshlets of at most \a max_vertices of the \a num_vertices \a vertices
+    /// and at most \a max_triangles triangles each. Meshlets are grown across
+    /// shared vertices, preferring triangles that add the fewest vertices.
+    void build(math::Vec3f const* vertices,int const num_vertices,unsigned int const* indices,int const count,int const max_vertices=64,int const max_triangles=124);
+
+    /// Recalculates the bounding volumes and normal cones from the current
+    /// positions of the \a vertices, e.g. after they have been animated.
+    void bound(math::Vec3f const* vertices);
+
+    /// Removes all meshlets.
+    void clear();
+
+    /// Returns the number of meshlets.
+    int getSize() const {
+        return m_radii.getSize();
+    }
+
+    /// Returns the triangle indices of all meshlets in order.
+    Mesh::IndexArray const& indices() const {
+        return m_indices;
+    }
+
+    /// Returns the offset of the first index of the given \a meshlet.
+    int getBegin(int const meshlet) const {
+        return m_offsets[meshlet];
+    }
+
+    /// Returns the offset after the last index of the given \a meshlet.
+    int getEnd(int const meshlet) const {
+        return m_offsets[meshlet+1];
+    }
+
+    /// Returns the bounding box of the given \a meshlet.
+    AABB const& getBox(int const meshlet) const {
+        return m_boxes[meshlet];
+    }
+
+    /// Returns the bounding sphere center of the given \a meshlet.
+    math::Vec3f const& getCenter(int const meshlet) const {
+        return m_centers[meshlet];
+    }
+
+    /// Returns the bounding sphere radius of the given \a meshlet.
+    float getRadius(int const meshlet) const {
+        return m_radii[meshlet];
+    }
+
+    /// Returns the axis of the cone that contains the face normals of the
+    /// given \a meshlet.
+    math::Vec3f const& getConeAxis(int const meshlet) const {
+        return m_axes[meshlet];
+    }
+
+    /// Returns the sine of the half-angle of the cone that contains the face
+    /// normals of the given \a meshlet, or 1 if the normals span a half-space.
+    float getConeCutoff(int const meshlet) const {
+        return m_cutoffs[meshlet];
+    }
+
+    /// Collects the numbers of the meshlets in \a visible whose bounding
+    /// spheres intersect the view frustum defined by \a view and
+    /// \a projection, and that have at least one front-facing triangle as seen
+    /// from the eye. Returns the number of visible meshlets.
+    int cull(math::HMat4f const& view,math::Mat4d const& projection,Mesh::IndexArray& visible) const;
+
+  private:
+
+    Mesh::IndexArray m_indices;        ///< Triangle indices of all meshlets in order.
+    Mesh::IndexArray m_offsets;        ///< Offsets of the meshlets' first indices, followed by the total.
+
+    global::DynamicArray<AABB> m_boxes; ///< Bounding boxes.
+    Mesh::VectorArray m_centers;        ///< Bounding sphere centers.
+    global::DynamicArray<float> m_radii; ///< Bounding sphere radii.
+    Mesh::VectorArray m_axes;           ///< Normal cone axes.
+    global::DynamicArray<float> m_cutoffs; ///< Sines of the normal cone half-angles.
+};
+
+} // namespace model
+
+} // namespace gale
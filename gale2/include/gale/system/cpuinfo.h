@@ -532,7 +532,13 @@ class CPUInfo:public global::Singleton<CPUInfo>
         return (m_00000001_ecx&(1<<10))!=0;
     }
 
-    // Bits 11 and 12 are reserved (on Intel and AMD).
+    // Bit 11 is reserved (on Intel and AMD).
+
+    /// Returns whether the processor supports the fused multiply-add
+    /// instructions using the VEX encoding.
+    bool hasFMA() const {
+        return (m_00000001_ecx&(1<<12))!=0;
+    }
 
     /// Returns whether the CMPXCHG16B instruction is supported.
     bool hasCX16() const {
@@ -601,7 +607,31 @@ class CPUInfo:public global::Singleton<CPUInfo>
         return (m_00000001_ecx&(1<<27))!=0;
     }
 
-    // Bits 28 to 31 are reserved (on Intel and AMD).
+    /// Returns whether the processor supports the Advanced Vector Extensions.
+    /// Note that the OS needs to support AVX, too, see isAVXEnabled().
+    bool hasAVX() const {
+        return (m_00000001_ecx&(1<<28))!=0;
+    }
+
+    // Bits 29 to 31 are not queried.
+
+    /// Returns whether the OS saves the SSE and AVX register states on context
+    /// switches, which is required to actually use AVX instructions.
+    bool isAVXEnabled() const;
+
+    //@}
+
+    /**
+     * \name Features reported by the structured extended flags
+     */
+    //@{
+
+    /* Features returned in the EBX register */
+
+    /// Returns whether the processor supports the Advanced Vector Extensions 2.
+    bool hasAVX2() const {
+        return (m_00000007_ebx&(1<<5))!=0;
+    }
 
     //@}
 
@@ -780,6 +810,8 @@ class CPUInfo:public global::Singleton<CPUInfo>
 
     unsigned int m_80000001_edx; ///< CPUID extended feature flags, part 1.
     unsigned int m_80000001_ecx; ///< CPUID extended feature flags, part 2.
+
+    unsigned int m_00000007_ebx; ///< CPUID structured extended feature flags.
 };
 
 /// For convenience, offer a predefined instance of the CPUInfo class.
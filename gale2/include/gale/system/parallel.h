@@ -0,0 +1,82 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#pragma once
+
+/**
+ * \file
+ * Fork-join helpers to distribute work across processors
+ */
+
+#include "../global/types.h"
+
+namespace gale {
+
+namespace system {
+
+/**
+ * Minimal fork-join helper that splits a range of items into contiguous chunks
+ * and processes each chunk on its own native thread. As threads are created
+ * per call instead of being pooled, this only pays off for coarse-grained work
+ * like processing whole meshes or files. Chunk boundaries only depend on the
+ * number of items and chunks, so callers can allocate per-chunk buffers up
+ * front and merge them in chunk order to get deterministic results.
+ */
+class Parallel
+{
+  public:
+
+    /// The maximum number of chunks that are processed concurrently.
+    static int const MAX_CHUNKS=64;
+
+    /// Function pointer type definition for kernels that process the items
+    /// from \a begin to (excluding) \a end as the given \a chunk. The \a context
+    /// is passed through unmodified.
+    typedef void (*Kernel)(void* context,int chunk,int begin,int end);
+
+    /// Returns the number of logical processors available to this process.
+    static int getThreadCount();
+
+    /// Returns the number of chunks to split \a count items into when using
+    /// up to \a threads threads, where each chunk consists of at least \a grain
+    /// items. If \a threads is 0, getThreadCount() threads are used.
+    static int getChunkCount(int const count,int threads=0,int const grain=1);
+
+    /// Returns the index of the first item in \a chunk if \a count items are
+    /// split into \a chunks chunks.
+    static int getChunkBegin(int const count,int const chunks,int const chunk) {
+        return static_cast<int>(static_cast<g_int64>(count)*chunk/chunks);
+    }
+
+    /// Splits \a count items into getChunkCount() chunks and calls \a kernel
+    /// for each of them, where all but the first chunk are processed on
+    /// separate threads. Returns the number of chunks after all of them have
+    /// been processed.
+    static int run(Kernel kernel,void* context,int const count,int const threads=0,int const grain=1);
+};
+
+} // namespace system
+
+} // namespace gale
@@ -0,0 +1,307 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#pragma once
+
+/**
+ * \file
+ * Grouping of mesh instances for batched rendering
+ */
+
+#include "../global/dynamicarray.h"
+#include "../math/color.h"
+#include "../math/hmatrix4.h"
+
+namespace gale {
+
+namespace wrapgl {
+
+/**
+ * Collects instances of meshes of type \a M, each with its own transformation
+ * and optional color, and groups them by mesh so that all instances of a mesh
+ * can be rendered at once, see Renderer::draw(). The calls to render the
+ * instances are issued to a back-end by render(), so the type \a M only needs
+ * to provide a numDrawCalls() method to count the rendering cost without a
+ * rendering context.
+ */
+template<class M>
+class InstanceBatch
+{
+  public:
+
+    /// The ways to render a batch, from the least to the most efficient one.
+    enum Mode {
+        MODE_SEPARATE  ///< Render each instance separately, e.g. by calling Renderer::draw() per instance.
+    ,   MODE_BATCHED   ///< Set up each mesh once and loop over its instances.
+    ,   MODE_INSTANCED ///< Set up each mesh once and draw all its instances in a single call.
+    };
+
+    /// Statistics about the work required to render a batch.
+    struct Statistics
+    {
+        int state_changes; ///< Number of buffer, array, matrix and color changes.
+        int draw_calls;    ///< Number of issued draw calls.
+    };
+
+    /// Creates an empty batch.
+    InstanceBatch()
+    :   m_sorted(true)
+    {}
+
+    /// Adds an instance of \a mesh with the given \a transform.
+    void add(M const& mesh,math::HMat4f const& transform) {
+        m_meshes.insert(&mesh);
+        m_transforms.insert(transform);
+
+        if (m_colors.getSize()>0) {
+            m_colors.insert(math::Col4f::WHITE());
+        }
+
+        m_sorted=false;
+    }
+
+    /// Adds an instance of \a mesh with the given \a transform and \a color.
+    void add(M const& mesh,math::HMat4f const& transform,math::Col4f const& color) {
+        // Instances without a color so far are white.
+        while (m_colors.getSize()<m_transforms.getSize()) {
+            m_colors.insert(math::Col4f::WHITE());
+        }
+
+        add(mesh,transform);
+        m_colors.last()=color;
+    }
+
+    /// Removes all instances from the batch.
+    void clear() {
+        m_meshes.clear();
+        m_transforms.clear();
+        m_colors.clear();
+        m_groups.clear();
+        m_offsets.clear();
+        m_sorted=true;
+    }
+
+    /// Returns the total number of instances in the batch.
+    int numInstances() const {
+        return m_transforms.getSize();
+    }
+
+    /// Groups the instances by mesh, where the meshes are ordered by their
+    /// first instance and the instances of each mesh keep their order. Needs
+    /// to be called after adding instances and before accessing the groups.
+    void sort() {
+        if (m_sorted) {
+            return;
+        }
+
+        // Assign each instance to the group of its mesh. There usually are
+        // only a few distinct meshes, so a linear search is fast enough.
+        int n=m_meshes.getSize();
+        global::DynamicArray<int> group(n);
+
+        m_groups.clear();
+        for (int i=0;i<n;++i) {
+            group[i]=m_groups.find(m_meshes[i]);
+            if (group[i]<0) {
+                group[i]=m_groups.insert(m_meshes[i]);
+            }
+        }
+
+        // Sort the instances by group using a counting sort.
+        int g=m_groups.getSize();
+        m_offsets.setSize(g+1);
+        memset(m_offsets,0,(g+1)*sizeof(int));
+        for (int i=0;i<n;++i) {
+            ++m_offsets[group[i]+1];
+        }
+        for (int k=0;k<g;++k) {
+            m_offsets[k+1]+=m_offsets[k];
+        }
+
+        global::DynamicArray<int> fill(m_offsets);
+        global::DynamicArray<math::HMat4f> transforms(n);
+        global::DynamicArray<math::Col4f> colors(m_colors.getSize());
+
+        for (int i=0;i<n;++i) {
+            int k=fill[group[i]]++;
+            m_meshes[k]=m_groups[group[i]];
+            transforms[k]=m_transforms[i];
+            if (colors.getSize()>0) {
+                colors[k]=m_colors[i];
+            }
+        }
+
+        m_transforms.swap(transforms);
+        m_colors.swap(colors);
+
+        m_sorted=true;
+    }
+
+    /**
+     * \name Group access methods
+     */
+    //@{
+
+    /// Returns the number of groups, i.e. distinct meshes.
+    int numGroups() const {
+        return m_groups.getSize();
+    }
+
+    /// Returns the mesh of the given \a group.
+    M const& getMesh(int const group) const {
+        return *m_groups[group];
+    }
+
+    /// Returns the number of instances in the given \a group.
+    int getCount(int const group) const {
+        return m_offsets[group+1]-m_offsets[group];
+    }
+
+    /// Returns the contiguous transformations of the given \a group.
+    math::HMat4f const* getTransforms(int const group) const {
+        return &m_transforms[m_offsets[group]];
+    }
+
+    /// Returns the contiguous colors of the given \a group, or \c NULL if no
+    /// instance has a color.
+    math::Col4f const* getColors(int const group) const {
+        return m_colors.getSize()>0 ? &m_colors[m_offsets[group]] : NULL;
+    }
+
+    //@}
+
+    /// Issues the calls to render \a count instances of \a mesh in the given
+    /// \a mode to \a backend, each with its own transformation from the
+    /// contiguous \a transforms array, and optionally its own color from the
+    /// \a colors array. The type \a B needs to provide bind() and release()
+    /// methods to set up and restore a mesh's arrays, transform() and color()
+    /// methods to set an instance's state, an upload() method for all
+    /// instances' data, and a submit() method to issue a mesh's draw calls for
+    /// a number of instances, or for the current one if the number is 0.
+    template<class B>
+    static void render(B& backend,M const& mesh,math::HMat4f const* transforms,int const count,math::Col4f const* colors,Mode const mode) {
+        if (mode==MODE_INSTANCED) {
+            backend.bind(mesh);
+            backend.upload(mesh,transforms,count,colors);
+            backend.submit(mesh,count);
+            backend.release(mesh);
+            return;
+        }
+
+        if (mode==MODE_BATCHED) {
+            backend.bind(mesh);
+        }
+
+        for (int i=0;i<count;++i) {
+            if (mode==MODE_SEPARATE) {
+                backend.bind(mesh);
+            }
+
+            backend.transform(mesh,transforms[i]);
+            if (colors) {
+                backend.color(colors[i]);
+            }
+            backend.submit(mesh,0);
+
+            if (mode==MODE_SEPARATE) {
+                backend.release(mesh);
+            }
+        }
+
+        if (mode==MODE_BATCHED) {
+            backend.release(mesh);
+        }
+    }
+
+    /// Issues the calls to render all instances in the given \a mode to
+    /// \a backend, one group at a time. The batch needs to be sorted.
+    template<class B>
+    void render(B& backend,Mode const mode) const {
+        for (int k=0;k<numGroups();++k) {
+            render(backend,getMesh(k),getTransforms(k),getCount(k),getColors(k),mode);
+        }
+    }
+
+    /// Returns the number of state changes and draw calls to render the batch
+    /// in the given \a mode, as counted from the calls issued by render().
+    /// Setting up and restoring a mesh's arrays count as one state change
+    /// each, as does each transformation, color and the upload of per-instance
+    /// data.
+    Statistics getStatistics(Mode const mode) const {
+        Counter counter;
+        render(counter,mode);
+        return counter.statistics;
+    }
+
+  private:
+
+    /// A back-end for render() that counts the calls instead of rendering.
+    struct Counter
+    {
+        Counter() {
+            statistics.state_changes=0;
+            statistics.draw_calls=0;
+        }
+
+        void bind(M const&) {
+            ++statistics.state_changes;
+        }
+
+        void release(M const&) {
+            ++statistics.state_changes;
+        }
+
+        void transform(M const&,math::HMat4f const&) {
+            ++statistics.state_changes;
+        }
+
+        void color(math::Col4f const&) {
+            ++statistics.state_changes;
+        }
+
+        void upload(M const&,math::HMat4f const*,int const,math::Col4f const*) {
+            ++statistics.state_changes;
+        }
+
+        void submit(M const& mesh,int const) {
+            statistics.draw_calls+=mesh.numDrawCalls();
+        }
+
+        Statistics statistics; ///< The counted calls.
+    };
+
+    global::DynamicArray<M const*> m_meshes;         ///< Mesh of each instance.
+    global::DynamicArray<math::HMat4f> m_transforms; ///< Transformation of each instance.
+    global::DynamicArray<math::Col4f> m_colors;      ///< Color of each instance, if any.
+
+    global::DynamicArray<M const*> m_groups; ///< Distinct meshes in order of their first instance.
+    global::DynamicArray<int> m_offsets;     ///< Offsets of the groups' instances.
+
+    bool m_sorted; ///< Whether the instances are grouped by mesh.
+};
+
+} // namespace wrapgl
+
+} // namespace gale
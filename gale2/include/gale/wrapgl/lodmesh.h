@@ -0,0 +1,127 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#pragma once
+
+/**
+ * \file
+ * Level of detail management for prepared meshes
+ */
+
+#include "preparedmesh.h"
+
+#include "../math/hmatrix4.h"
+#include "../math/matrix4.h"
+
+namespace gale {
+
+namespace wrapgl {
+
+#ifdef G_OS_WINDOWS
+class Camera;
+#endif
+
+/**
+ * A class to manage a chain of prepared meshes at decreasing levels of detail,
+ * and to select the level to render by the mesh's size on the screen.
+ */
+class LODMesh
+{
+  public:
+
+    /// Creates an empty chain of levels of detail.
+    LODMesh() {}
+
+    /// Frees all levels of detail.
+    ~LODMesh() {
+        clear();
+    }
+
+    /// Compiles \a count levels of detail from \a mesh, where each level is
+    /// simplified to at most the given number of \a budgets triangles using
+    /// model::Mesh::Simplifier::EdgeCollapse(). The budgets have to be in
+    /// decreasing order, so each level can be simplified from the previous
+    /// one. Levels that cannot be simplified any further are omitted. The
+    /// levels are compiled by up to \a threads threads, where 0 means to use
+    /// all available processors.
+    void compile(model::Mesh const& mesh,int const* budgets,int const count,int const threads=0);
+
+    /// Returns the number of levels of detail.
+    int numLevels() const {
+        return m_levels.getSize();
+    }
+
+    /// Returns the prepared mesh of the given \a level, where 0 is the finest.
+    PreparedMesh& getLevel(int const level) {
+        return *m_levels[level];
+    }
+
+    /// Returns the prepared mesh of the given \a level, where 0 is the finest.
+    PreparedMesh const& getLevel(int const level) const {
+        return *m_levels[level];
+    }
+
+    /// Returns the number of triangles the faces of the given \a level amount
+    /// to.
+    int numTriangles(int const level) const {
+        return m_triangles[level];
+    }
+
+    /// Returns the coarsest level whose triangles cover at most \a pixels
+    /// pixels each on average if the mesh covers an \a area of pixels. If even
+    /// the finest level's triangles cover more, level 0 is returned.
+    int selectLevel(float const area,float const pixels=16.0f) const;
+
+#ifdef G_OS_WINDOWS
+    /// Returns the coarsest level whose triangles cover at most \a pixels
+    /// pixels each on average if rendered by \a camera, where the covered
+    /// area is estimated from the projected bounding box.
+    PreparedMesh& select(Camera& camera,float const pixels=16.0f);
+#endif
+
+    /// Returns the area in pixels on a screen of the given \a width and
+    /// \a height that the \a box covers when transformed by \a view and
+    /// \a projection. The area is clamped to the screen. If the box lies
+    /// partly behind the eye, the whole screen is considered to be covered.
+    static float projectedArea(model::AABB const& box,math::HMat4f const& view,math::Mat4d const& projection,int const width,int const height);
+
+  private:
+
+    /// Frees all levels of detail.
+    void clear();
+
+    /// Disable copying as the levels are owned.
+    LODMesh(LODMesh const&);
+
+    /// Disable assignments as the levels are owned.
+    LODMesh& operator=(LODMesh const&);
+
+    global::DynamicArray<PreparedMesh*> m_levels; ///< Prepared meshes from fine to coarse.
+    global::DynamicArray<int> m_triangles;        ///< Number of triangles per level.
+};
+
+} // namespace wrapgl
+
+} // namespace gale
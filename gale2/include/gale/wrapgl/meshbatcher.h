@@ -0,0 +1,153 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#pragma once
+
+/**
+ * \file
+ * Merging of many small meshes into a single prepared mesh
+ */
+
+#include "preparedmesh.h"
+
+#include "../math/hmatrix4.h"
+
+namespace gale {
+
+namespace wrapgl {
+
+/**
+ * Concatenates the vertices, normals and primitives of many meshes, each with
+ * an optional static transformation, so they can be rendered as a single
+ * prepared mesh with one vertex and one index buffer, see PreparedMesh::merge().
+ * The ranges of each mesh's data in the merged arrays are kept to be able to
+ * identify the submeshes afterwards.
+ */
+class MeshBatcher
+{
+  public:
+
+    /// A range of items from \c begin to (excluding) \c end.
+    struct Range
+    {
+        int begin; ///< Index of the first item.
+        int end;   ///< Index after the last item.
+    };
+
+    /// The ranges of a submesh's data in the merged arrays.
+    struct Submesh
+    {
+        Range vertices;  ///< Range of vertices and normals.
+        Range points;    ///< Range of indices in the point indices.
+        Range lines;     ///< Range of indices in the line indices.
+        Range triangles; ///< Range of indices in the triangle indices.
+        Range quads;     ///< Range of indices in the quadrilateral indices.
+        Range polygons;  ///< Range of polygons in the polygon table.
+    };
+
+    /// Creates an empty batch.
+    MeshBatcher() {
+        m_primitives.setSize(PRIMITIVE_TYPES);
+        box.min=box.max=math::Vec3f::ZERO();
+    }
+
+    /// Appends the compiled mesh \a prep, optionally transformed by
+    /// \a transform, and returns the index of the submesh.
+    int add(PreparedMesh const& prep,math::HMat4f const* transform=NULL);
+
+    /// Appends the mesh that consists of \a vertices with \a normals, the
+    /// \a primitives table of point, line, triangle and quadrilateral indices
+    /// in this order, and the \a polygons table, optionally transformed by
+    /// \a transform. Normals are transformed by the inverse transpose, and the
+    /// faces' winding is reversed for mirroring transformations so front faces
+    /// stay front faces. Returns the index of the submesh.
+    int add(
+        model::Mesh::VectorArray const& vertices
+    ,   model::Mesh::VectorArray const& normals
+    ,   model::Mesh::IndexTable const& primitives
+    ,   model::Mesh::IndexTable const& polygons
+    ,   math::HMat4f const* transform=NULL
+    );
+
+    /// Removes all submeshes.
+    void clear();
+
+    /// Returns the number of submeshes.
+    int numSubmeshes() const {
+        return m_submeshes.getSize();
+    }
+
+    /// Returns the ranges of the given \a submesh.
+    Submesh const& getSubmesh(int const submesh) const {
+        return m_submeshes[submesh];
+    }
+
+    /**
+     * \name Access to the merged arrays
+     */
+    //@{
+
+    /// Returns the merged vertices.
+    model::Mesh::VectorArray const& getVertices() const {
+        return m_vertices;
+    }
+
+    /// Returns the merged normals.
+    model::Mesh::VectorArray const& getNormals() const {
+        return m_normals;
+    }
+
+    /// Returns the merged point, line, triangle and quadrilateral indices in
+    /// this order.
+    model::Mesh::IndexTable const& getPrimitives() const {
+        return m_primitives;
+    }
+
+    /// Returns the merged polygons.
+    model::Mesh::IndexTable const& getPolygons() const {
+        return m_polygons;
+    }
+
+    //@}
+
+    /// The number of primitive types with fixed numbers of vertices.
+    static int const PRIMITIVE_TYPES=4;
+
+    model::AABB box; ///< The merged meshes' axis-aligned bounding box.
+
+  private:
+
+    model::Mesh::VectorArray m_vertices; ///< Merged vertex positions.
+    model::Mesh::VectorArray m_normals;  ///< Merged vertex normals.
+
+    model::Mesh::IndexTable m_primitives; ///< Merged primitive indices.
+    model::Mesh::IndexTable m_polygons;   ///< Merged polygon indices.
+
+    global::DynamicArray<Submesh> m_submeshes; ///< Ranges of the submeshes.
+};
+
+} // namespace wrapgl
+
+} // namespace gale
@@ -31,6 +31,7 @@
  */
 
 #include "../model/mesh.h"
+#include "../model/meshlets.h"
 
 #ifdef GALE_USE_VBO
     #include "vertexarrayobject.h"
@@ -41,18 +42,280 @@ namespace gale {
 
 namespace wrapgl {
 
+#ifdef G_OS_WINDOWS
+class Camera;
+#endif
+
+class MeshBatcher;
+
 /**
  * A class to prepare a mesh for optimal rendering on the GPU.
  */
 class PreparedMesh
 {
+    friend class MeshBatcher;
     friend struct Renderer;
 
   public:
 
+    /// Ways to weight the face normals when averaging them to vertex normals.
+    enum NormalWeighting {
+        WEIGHT_AREA  ///< Weights the face normals by the faces' areas.
+    ,   WEIGHT_ANGLE ///< Weights the face normals by the angles at the vertices.
+    };
+
+    /// Creates an empty prepared mesh that renders faces by their primitive
+    /// types.
+    PreparedMesh()
+    :   m_weighting(WEIGHT_AREA)
+    ,   m_accuracy(math::ACCURACY_EXACT)
+    ,   m_strip_mode(false)
+    ,   m_meshlet_vertices(0)
+    ,   m_meshlet_triangles(0)
+    ,   m_compact(false)
+    ,   m_vertex_type(GL_FLOAT)
+    ,   m_normal_type(GL_FLOAT)
+    ,   m_index_type(GL_UNSIGNED_INT)
+    ,   m_normal_offset(0)
+    ,   m_center(math::Vec3f::ZERO())
+    ,   m_scale(1.0f)
+    ,   m_vertices_begin(0)
+    ,   m_vertices_end(0)
+    ,   m_normals_begin(0)
+    ,   m_normals_end(0)
+    {
+        // Make room for an index array for each primitive type.
+        m_primitives.setSize(PI_COUNT);
+    }
+
+#ifndef GALE_TINY_CODE
+
+    /// Class to write compiled meshes to files, e.g. for offline tools or for
+    /// caching. The files are written in large blocks. For text formats, the
+    /// data is formatted by up to \a threads threads in parallel, where 0
+    /// means to use all available processors. All methods return whether the
+    /// file could be written successfully.
+    class Exporter
+    {
+      public:
+
+        /// Writes the vertices, normals and primitives of \a mesh to the
+        /// Wavefront OBJ file at \a path.
+        static bool OBJ(PreparedMesh const& mesh,char const* path,int const threads=0);
+
+        /// Writes the vertices, normals and faces of \a mesh to the binary PLY
+        /// file at \a path. Lines are written as edges, points are omitted.
+        static bool PLY(PreparedMesh const& mesh,char const* path);
+
+        /// Writes the bounding box, vertices, normals and index arrays of
+        /// \a mesh to the file at \a path in a raw binary format that closely
+        /// matches the in-memory layout. The file starts with a header of 32-bit
+        /// unsigned integers: The magic number \c RAW_MAGIC, the number of
+        /// vertices, the number of indices per primitive type, the number of
+        /// polygons followed by their number of indices. The bounding box,
+        /// vertices, normals, primitive and polygon indices follow in order.
+        static bool Raw(PreparedMesh const& mesh,char const* path);
+
+        /// The magic number identifying raw binary files, reading "GLRW".
+        static unsigned int const RAW_MAGIC=0x57524c47;
+    };
+
+#endif // GALE_TINY_CODE
+
     /// Generates the primitive index arrays from the mesh data structure
-    /// and calculates vertex normals from averaged face normals.
-    void compile(model::Mesh const& mesh);
+    /// and calculates vertex normals from averaged face normals. The work is
+    /// split across up to \a threads threads, where 0 means to use all
+    /// available processors. The result does not depend on the number of
+    /// threads. Faces of more than 5 vertices are skipped, as the mesh's
+    /// neighborhoods do not tell them apart from the boundaries of holes in
+    /// open meshes.
+    void compile(model::Mesh const& mesh,int const threads=0);
+
+    /// Updates the vertices from \a mesh whose topology must not have changed
+    /// since the last compile(), e.g. for animated meshes. Only the normals and
+    /// the bounding box are recalculated using the cached primitives, and only
+    /// the changed ranges are uploaded. The work is split across up to
+    /// \a threads threads, where 0 means to use all available processors. If
+    /// the number of vertices differs, the \a mesh is compiled instead.
+    void updateVertices(model::Mesh const& mesh,int const threads=0);
+
+    /// Takes the merged vertices, normals and primitives of all meshes in the
+    /// \a batcher to render them with a single set of buffer objects and the
+    /// draw calls of a single mesh. The merged vertices do not refer to a mesh,
+    /// so updateVertices() must not be called afterwards.
+    void merge(MeshBatcher const& batcher);
+
+    /// Sets how face normals are weighted when averaging them to vertex
+    /// normals. The setting takes effect with the next compile() or
+    /// updateVertices().
+    void setNormalWeighting(NormalWeighting const weighting) {
+        m_weighting=weighting;
+    }
+
+    /// Returns how face normals are weighted when averaging them to vertex
+    /// normals.
+    NormalWeighting getNormalWeighting() const {
+        return m_weighting;
+    }
+
+    /// Sets the \a accuracy to normalize the vertex normals with, see
+    /// Vector::normalize(). The setting takes effect with the next compile()
+    /// or updateVertices().
+    void setNormalAccuracy(math::Accuracy const accuracy) {
+        m_accuracy=accuracy;
+    }
+
+    /// Returns the accuracy to normalize the vertex normals with.
+    math::Accuracy getNormalAccuracy() const {
+        return m_accuracy;
+    }
+
+    /// Calculates the unnormalized \a normals of the \a count faces consisting
+    /// of \a size \a vertices each that are described by \a indices. The
+    /// normals are calculated using Newell's method, so they do not depend on
+    /// the order of traversal, and their lengths equal twice the faces' areas.
+    /// If \a angles is not \c NULL, it receives the interior angles of the
+    /// faces' corners in radians, in the order of the \a indices. For
+    /// triangles and quadrilaterals, the normals are calculated in blocks by
+    /// crossAll().
+    static void faceNormals(math::Vec3f const* vertices,unsigned int const* indices,int const count,int const size,math::Vec3f* normals,float* angles=NULL);
+
+    /// Reorders the triangles and quadrilaterals for a post-transform vertex
+    /// cache of the given \a cache_size using reorderFaces(), and renumbers
+    /// the vertices in the order of their first use to improve the locality of
+    /// vertex fetches. Vertex updates still refer to the mesh's vertex order.
+    void optimize(int const cache_size=32);
+
+    /// Returns the average cache miss ratio, i.e. the number of transformed
+    /// vertices per triangle, when rendering the triangles and quadrilaterals
+    /// with a simulated vertex cache of the given \a cache_size. Quadrilaterals
+    /// count as two triangles. The cache is flushed between primitive types.
+    /// It uses a FIFO replacement policy like most hardware, or LRU if \a lru
+    /// is \c true.
+    float getACMR(int const cache_size=32,bool const lru=false) const;
+
+    /// Returns the number of vertex cache misses when rendering the \a count
+    /// \a indices with a simulated cache of \a cache_size entries, starting
+    /// with an empty cache. The cache uses a FIFO replacement policy, or LRU
+    /// if \a lru is \c true.
+    static int countCacheMisses(unsigned int const* indices,int const count,int const cache_size=32,bool const lru=false);
+
+    /// Reorders the faces consisting of \a size vertices each that are
+    /// described by \a count \a indices to reduce the misses of a vertex cache
+    /// of the given \a cache_size. This uses the linear-time "Tipsify"
+    /// algorithm by Sander, Nehab and Barczak, which fans around vertices while
+    /// simulating a FIFO cache. The order of vertices within each face is
+    /// preserved.
+    static void reorderFaces(unsigned int* indices,int const count,int const size,int const cache_size=32);
+
+    /// Sets whether to render all faces with a single draw call. If \a enable
+    /// is \c true, quadrilaterals and polygons are triangulated, and all
+    /// triangles are turned into strips that are stitched together by
+    /// degenerate triangles. The setting is kept when recompiling.
+    void setStripMode(bool const enable);
+
+    /// Returns whether all faces are rendered as a single triangle strip.
+    bool getStripMode() const {
+        return m_strip_mode;
+    }
+
+    /// Returns the number of indices that are sent when rendering the mesh.
+    int numIndices() const;
+
+    /// Returns the number of draw calls that are issued when rendering the mesh.
+    int numDrawCalls() const;
+
+    /// Turns the triangles described by \a count \a indices into a single
+    /// triangle \a strip by greedily walking across shared edges, and stitching
+    /// the resulting strips with degenerate triangles. The triangles' winding
+    /// is preserved.
+    static void stripify(unsigned int const* indices,int const count,model::Mesh::IndexArray& strip);
+
+    /// Splits all faces into meshlets of at most \a max_vertices vertices and
+    /// \a max_triangles triangles each for culling them individually, where
+    /// quadrilaterals and polygons are triangulated. The meshlets are rebuilt
+    /// when recompiling. If \a max_vertices is 0, the meshlets are removed.
+    void buildMeshlets(int const max_vertices=64,int const max_triangles=124);
+
+    /// Returns the meshlets, if any.
+    model::Meshlets const& getMeshlets() const {
+        return m_meshlets;
+    }
+
+#ifdef G_OS_WINDOWS
+    /// Collects the numbers of the meshlets in \a visible that are inside the
+    /// frustum of \a camera and not back-facing, see model::Meshlets::cull().
+    /// Returns the number of visible meshlets.
+    int cullMeshlets(Camera const& camera,model::Mesh::IndexArray& visible) const;
+#endif
+
+    /// Sets whether to upload vertices in compact formats to save bandwidth
+    /// and memory. If \a enable is \c true, positions are quantized to 16-bit
+    /// integers relative to the bounding box, and normals are packed to 10 bits
+    /// per component if supported, or to 16 bits otherwise. Indices always use
+    /// 16 bits if there are few enough vertices. This only has an effect when
+    /// using buffer objects.
+    void setCompactVertices(bool const enable);
+
+    /// Returns whether vertices are uploaded in compact formats.
+    bool getCompactVertices() const {
+        return m_compact;
+    }
+
+    /// Gets the \a center and uniform \a scale that restore the positions
+    /// from the quantized compact vertices. As the quantization follows the
+    /// bounding box, it may change with updateVertices().
+    void getQuantization(math::Vec3f& center,float& scale) const {
+        center=m_center;
+        scale=m_scale;
+    }
+
+    /// Gets the range from \a begin to (excluding) \a end of the vertices that
+    /// changed with the last compile() or updateVertices(), which is the range
+    /// that gets uploaded to buffer objects. If the quantization changed, this
+    /// includes all vertices.
+    void getChangedVertices(int& begin,int& end) const {
+        begin=m_vertices_begin;
+        end=m_vertices_end;
+    }
+
+    /// Gets the range from \a begin to (excluding) \a end of the normals that
+    /// changed with the last compile() or updateVertices(), which is the range
+    /// that gets uploaded to buffer objects.
+    void getChangedNormals(int& begin,int& end) const {
+        begin=m_normals_begin;
+        end=m_normals_end;
+    }
+
+    /// Returns the OpenGL data type of the uploaded vertices.
+    GLenum vertexType() const {
+        return m_vertex_type;
+    }
+
+    /// Returns the OpenGL data type of the uploaded normals.
+    GLenum normalType() const {
+        return m_normal_type;
+    }
+
+    /// Returns the OpenGL data type of the uploaded indices.
+    GLenum indexType() const {
+        return m_index_type;
+    }
+
+    /// Returns the number of bytes a vertex including its normal takes in the
+    /// uploaded format.
+    int getVertexSize() const;
+
+    /// Returns the byte offset of the normals that follow the positions of the
+    /// given number of \a vertices of the given \a type in a buffer object.
+    /// As OpenGL requires offsets to be multiples of the size of the data
+    /// type, the offset is rounded up to a multiple of 4 bytes.
+    static size_t getNormalOffset(int const vertices,GLenum const type);
+
+    /// Returns the number of bytes an index takes in the uploaded format.
+    int getIndexSize() const {
+        return m_index_type==GL_UNSIGNED_SHORT?2:4;
+    }
 
     /// Returns whether the mesh contains something to render.
     bool hasData() const {
@@ -79,7 +342,8 @@ class PreparedMesh
         return m_normals;
     }
 
-    /// Returns a pointer to the vertices as suitable for glVertexPointer().
+    /// Returns a pointer to the vertices as suitable for glVertexPointer() with
+    /// vertexType().
     model::Mesh::VectorArray::Type const* vertexPointer() const {
 #ifdef GALE_USE_VBO
         return reinterpret_cast<model::Mesh::VectorArray::Type const*>(0);
@@ -88,10 +352,11 @@ class PreparedMesh
 #endif
     }
 
-    /// Returns a pointer to the normals as suitable for glNormalPointer().
+    /// Returns a pointer to the normals as suitable for glNormalPointer() with
+    /// normalType().
     model::Mesh::VectorArray::Type const* normalPointer() const {
 #ifdef GALE_USE_VBO
-        return reinterpret_cast<model::Mesh::VectorArray::Type const*>(m_vbo_vertnorm.getSize()/2);
+        return reinterpret_cast<model::Mesh::VectorArray::Type const*>(m_normal_offset);
 #else
         return normalAccess();
 #endif
@@ -117,7 +382,7 @@ class PreparedMesh
         return m_primitives[PI_QUADS].getSize()/4;
     }
 
-    /// Returns the number of polygons in this mesh.
+    /// Returns the number of polygons, i.e. pentagons, in this mesh.
     int numPolys() const {
         return m_polygons.getSize();
     }
@@ -138,12 +403,78 @@ class PreparedMesh
     /// OpenGL enums for the primitive types.
     static GLenum const GL_PRIM_TYPE[PI_COUNT];
 
+    /// Data shared by the threads during compilation.
+    struct CompileContext;
+
+    /// Uploads all vertices, normals and indices to the buffer objects, if any.
+    void upload();
+
+    /// Appends all faces to \a triangles, where quadrilaterals and polygons
+    /// are triangulated as fans.
+    void triangulate(model::Mesh::IndexArray& triangles) const;
+
+    /// Triangulates all faces and turns them into a single triangle strip.
+    void buildStrip();
+
+    /// Triangulates all faces and partitions them into meshlets.
+    void partitionMeshlets();
+
+    /// Removes the face corners sorted by vertex after the faces have changed.
+    void clearCorners() {
+        m_corner_offsets.clear();
+        m_corners.clear();
+        m_corner_faces.clear();
+    }
+
+#ifdef GALE_USE_VBO
+    /// Uploads the vertices from \a begin to (excluding) \a end in the current
+    /// format.
+    void uploadVertices(int const begin,int const end);
+
+    /// Uploads the normals from \a begin to (excluding) \a end in the current
+    /// format.
+    void uploadNormals(int const begin,int const end);
+#endif
+
+    /// Calculates the \a center and \a scale to quantize the vertices with.
+    void calculateQuantization(math::Vec3f& center,float& scale) const;
+
     model::Mesh::VectorArray m_vertices; ///< Array of vertex positions.
     model::Mesh::VectorArray m_normals;  ///< Array of vertex normals.
 
     model::Mesh::IndexTable m_primitives; ///< Table of vertex indices describing primitives.
     model::Mesh::IndexTable m_polygons;   ///< Table of vertex indices describing polygons.
 
+    model::Mesh::IndexArray m_sources; ///< Mesh vertex indices of reordered vertices, if any.
+
+    /// The corners of all faces, numbered in face order, sorted by their
+    /// vertices to accumulate the vertex normals. The corners of vertex \c i
+    /// span the range from \c m_corner_offsets[i] to \c m_corner_offsets[i+1].
+    model::Mesh::IndexArray m_corner_offsets;
+    model::Mesh::IndexArray m_corners;      ///< Corners of the faces sorted by vertex.
+    model::Mesh::IndexArray m_corner_faces; ///< Number of the face each corner belongs to.
+
+    NormalWeighting m_weighting; ///< How to weight face normals for vertex normals.
+    math::Accuracy m_accuracy;   ///< How accurately to normalize vertex normals.
+
+    model::Mesh::IndexArray m_strip; ///< Triangle strip of all faces in strip mode.
+    bool m_strip_mode;               ///< Whether to render the triangle strip instead of the faces.
+
+    model::Meshlets m_meshlets; ///< Clusters of triangles for culling, if any.
+    int m_meshlet_vertices;     ///< Maximum number of vertices per meshlet.
+    int m_meshlet_triangles;    ///< Maximum number of triangles per meshlet.
+
+    bool m_compact;               ///< Whether to upload vertices in compact formats.
+    GLenum m_vertex_type;         ///< Data type of the uploaded vertices.
+    GLenum m_normal_type;         ///< Data type of the uploaded normals.
+    GLenum m_index_type;          ///< Data type of the uploaded indices.
+    size_t m_normal_offset;       ///< Offset of the normals in the buffer object.
+    math::Vec3f m_center;         ///< Center to add to quantized vertices.
+    float m_scale;                ///< Scale to apply to quantized vertices.
+
+    int m_vertices_begin,m_vertices_end; ///< Range of the last changed vertices.
+    int m_normals_begin,m_normals_end;   ///< Range of the last changed normals.
+
 #ifdef GALE_USE_VBO
     ArrayBufferObject m_vbo_vertnorm; ///< Vertices and normals buffer.
     IndexBufferObject m_vbo_primpoly; ///< Primitive and polygon indices buffer.
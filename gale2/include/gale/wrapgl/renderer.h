@@ -31,6 +31,7 @@
  */
 
 #include "camera.h"
+#include "instancebatch.h"
 #include "preparedmesh.h"
 
 namespace gale {
@@ -46,11 +47,56 @@ struct Renderer
     /// Renders the given prepared mesh \a prep.
     static void draw(PreparedMesh const& prep);
 
+    /// Renders only the given \a meshlets of the prepared mesh \a prep, e.g.
+    /// as returned by PreparedMesh::cullMeshlets().
+    static void draw(PreparedMesh const& prep,model::Mesh::IndexArray const& meshlets);
+
+    /// Renders \a count instances of the prepared mesh \a prep, each with its
+    /// own transformation from the contiguous \a transforms array, and
+    /// optionally its own color from the \a colors array. If instanced arrays
+    /// are supported and a program is in use, the per-instance data is streamed
+    /// to a buffer object and all instances are drawn with a single call per
+    /// primitive. The program then needs to read the transformation's columns
+    /// from the generic attributes starting at \c INSTANCE_TRANSFORM_ATTRIB and
+    /// the color from \c INSTANCE_COLOR_ATTRIB. Otherwise, the mesh is set up
+    /// only once and the instances are drawn in a loop using the modelview
+    /// matrix and the current color. The calls are issued by
+    /// InstanceBatch::render().
+    static void draw(PreparedMesh const& prep,math::HMat4f const* transforms,int const count,math::Col4f const* colors=NULL);
+
+    /// Renders all instances in the \a batch, one group at a time. The batch
+    /// needs to be sorted.
+    static void draw(InstanceBatch<PreparedMesh> const& batch);
+
     /// Renders the given axis-aligned bounding \a box.
     static void draw(model::AABB const& box);
 
     /// Renders the view frustum of the given \a camera.
     static void draw(Camera const& camera);
+
+    /// The first of four generic vertex attributes that receive the columns of
+    /// the per-instance transformation when drawing instanced.
+    static GLuint const INSTANCE_TRANSFORM_ATTRIB=10;
+
+    /// The generic vertex attribute that receives the per-instance color when
+    /// drawing instanced.
+    static GLuint const INSTANCE_COLOR_ATTRIB=14;
+
+  private:
+
+    /// The OpenGL back-end for InstanceBatch::render().
+    struct Backend;
+
+    /// Sets up the vertex arrays to render \a prep, and if \a dequantize is
+    /// set, the transformation to restore quantized positions.
+    static void bind(PreparedMesh const& prep,bool const dequantize=true);
+
+    /// Restores the state changed by bind().
+    static void release(PreparedMesh const& prep,bool const dequantize=true);
+
+    /// Issues the draw calls for all primitives of the bound \a prep. If
+    /// \a instances is positive, instanced draw calls are used.
+    static void submit(PreparedMesh const& prep,int const instances=0);
 };
 
 } // namespace wrapgl
@@ -0,0 +1,932 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/math/batch.h"
+
+#include "gale/math/quaternion.h"
+
+#include "gale/system/parallel.h"
+
+#ifdef GALE_USE_SSE
+    #include <xmmintrin.h>
+#endif
+
+using namespace gale::system;
+
+namespace gale {
+
+namespace math {
+
+namespace {
+
+// Minimum number of vectors per thread so the thread creation pays off.
+int const GRAIN=65536;
+
+// Arguments shared by all batch kernels. For each of the inputs and outputs,
+// either the pointer to the Vec3f array or to the Vec3fArrays is set.
+struct BatchContext
+{
+    BatchContext()
+    :   a(NULL),b(NULL),out(NULL)
+    ,   sa(NULL),sb(NULL),sout(NULL)
+    ,   dots(NULL)
+    ,   normalize(false)
+    ,   accuracy(ACCURACY_EXACT)
+    {}
+
+    Vec3f const* a;
+    Vec3f const* b;
+    Vec3f* out;
+
+    Vec3fArrays const* sa;
+    Vec3fArrays const* sb;
+    Vec3fArrays const* sout;
+
+    float* dots;
+
+    HMat4f matrix;
+    bool normalize;
+    Accuracy accuracy;
+
+    Vec3f min[Parallel::MAX_CHUNKS],max[Parallel::MAX_CHUNKS];
+};
+
+G_INLINE Vec3f get(Vec3f const* aos,Vec3fArrays const* soa,int const i)
+{
+    return aos ? aos[i] : Vec3f(soa->x[i],soa->y[i],soa->z[i]);
+}
+
+G_INLINE void put(Vec3f* aos,Vec3fArrays const* soa,int const i,Vec3f const& v)
+{
+    if (aos) {
+        aos[i]=v;
+    }
+    else {
+        soa->x[i]=v.getX();
+        soa->y[i]=v.getY();
+        soa->z[i]=v.getZ();
+    }
+}
+
+// Returns the matrix to transform normals with, whose columns are those of the
+// cofactor matrix. These equal the inverse transpose up to the determinant,
+// which is sufficient as normals get normalized anyway, apart from its sign.
+HMat4f normalMatrix(HMat4f const& m)
+{
+    Vec3f n0=m.c1^m.c2,n1=m.c2^m.c0,n2=m.c0^m.c1;
+
+    if (m.c0%n0<0) {
+        n0=-n0;
+        n1=-n1;
+        n2=-n2;
+    }
+
+    return HMat4f(n0,n1,n2,Vec3f::ZERO());
+}
+
+#ifdef GALE_USE_SSE
+
+// Loads the 4 vectors starting at index i into SoA registers, deinterleaving
+// them if they are stored as Vec3f.
+G_INLINE void load4(Vec3f const* aos,Vec3fArrays const* soa,int const i,__m128& x,__m128& y,__m128& z)
+{
+    if (aos) {
+        float const* p=aos[i].data();
+
+        // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+        __m128 a=_mm_loadu_ps(p);
+        __m128 b=_mm_loadu_ps(p+4);
+        __m128 c=_mm_loadu_ps(p+8);
+
+        __m128 t=_mm_shuffle_ps(b,c,_MM_SHUFFLE(1,0,3,2));
+        x=_mm_shuffle_ps(a,t,_MM_SHUFFLE(3,0,3,0));
+
+        y=_mm_shuffle_ps(
+            _mm_shuffle_ps(a,b,_MM_SHUFFLE(0,0,1,1))
+        ,   _mm_shuffle_ps(b,c,_MM_SHUFFLE(2,2,3,3))
+        ,   _MM_SHUFFLE(2,0,2,0)
+        );
+
+        z=_mm_shuffle_ps(
+            _mm_shuffle_ps(a,b,_MM_SHUFFLE(1,1,2,2))
+        ,   _mm_shuffle_ps(c,c,_MM_SHUFFLE(3,3,0,0))
+        ,   _MM_SHUFFLE(2,0,2,0)
+        );
+    }
+    else {
+        x=_mm_loadu_ps(soa->x+i);
+        y=_mm_loadu_ps(soa->y+i);
+        z=_mm_loadu_ps(soa->z+i);
+    }
+}
+
+// Stores the 4 vectors in SoA registers starting at index i, interleaving them
+// if they are stored as Vec3f.
+G_INLINE void store4(Vec3f* aos,Vec3fArrays const* soa,int const i,__m128 const x,__m128 const y,__m128 const z)
+{
+    if (aos) {
+        float* p=aos[i].data();
+
+        _mm_storeu_ps(p,_mm_shuffle_ps(
+            _mm_shuffle_ps(x,y,_MM_SHUFFLE(0,0,0,0))
+        ,   _mm_shuffle_ps(z,x,_MM_SHUFFLE(1,1,0,0))
+        ,   _MM_SHUFFLE(2,0,2,0)
+        ));
+
+        _mm_storeu_ps(p+4,_mm_shuffle_ps(
+            _mm_shuffle_ps(y,z,_MM_SHUFFLE(1,1,1,1))
+        ,   _mm_shuffle_ps(x,y,_MM_SHUFFLE(2,2,2,2))
+        ,   _MM_SHUFFLE(2,0,2,0)
+        ));
+
+        _mm_storeu_ps(p+8,_mm_shuffle_ps(
+            _mm_shuffle_ps(z,x,_MM_SHUFFLE(3,3,2,2))
+        ,   _mm_shuffle_ps(y,z,_MM_SHUFFLE(3,3,3,3))
+        ,   _MM_SHUFFLE(2,0,2,0)
+        ));
+    }
+    else {
+        _mm_storeu_ps(soa->x+i,x);
+        _mm_storeu_ps(soa->y+i,y);
+        _mm_storeu_ps(soa->z+i,z);
+    }
+}
+
+// Returns a * b + c * d + e * f.
+G_INLINE __m128 dot4(__m128 const a,__m128 const b,__m128 const c,__m128 const d,__m128 const e,__m128 const f)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a,b),_mm_mul_ps(c,d)),_mm_mul_ps(e,f));
+}
+
+G_INLINE void normalize4(__m128& x,__m128& y,__m128& z,Accuracy const accuracy)
+{
+    float const tol=Numerics<float>::ZERO_TOLERANCE();
+
+    __m128 l2=dot4(x,x,y,y,z,z);
+    __m128 valid=_mm_cmpgt_ps(l2,_mm_set1_ps(tol*tol));
+
+    // Scale the vectors that are too short by 1 to keep them unchanged.
+    if (accuracy==ACCURACY_EXACT) {
+        __m128 l=_mm_sqrt_ps(l2);
+        l=_mm_or_ps(_mm_and_ps(valid,l),_mm_andnot_ps(valid,_mm_set1_ps(1.0f)));
+
+        x=_mm_div_ps(x,l);
+        y=_mm_div_ps(y,l);
+        z=_mm_div_ps(z,l);
+    }
+    else {
+        __m128 r=rsqrtPS(l2,accuracy);
+        r=_mm_or_ps(_mm_and_ps(valid,r),_mm_andnot_ps(valid,_mm_set1_ps(1.0f)));
+
+        x=_mm_mul_ps(x,r);
+        y=_mm_mul_ps(y,r);
+        z=_mm_mul_ps(z,r);
+    }
+}
+
+G_INLINE float minElement4(__m128 v)
+{
+    v=_mm_min_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(2,3,0,1)));
+    v=_mm_min_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(1,0,3,2)));
+    return _mm_cvtss_f32(v);
+}
+
+G_INLINE float maxElement4(__m128 v)
+{
+    v=_mm_max_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(2,3,0,1)));
+    v=_mm_max_ps(v,_mm_shuffle_ps(v,v,_MM_SHUFFLE(1,0,3,2)));
+    return _mm_cvtss_f32(v);
+}
+
+#endif // GALE_USE_SSE
+
+void transformKernel(void* context,int chunk,int begin,int end)
+{
+    G_UNREF_PARAM(chunk)
+
+    BatchContext const& c=*static_cast<BatchContext const*>(context);
+    HMat4f const& m=c.matrix;
+
+    int i=begin;
+
+#ifdef GALE_USE_SSE
+    // Broadcast each matrix element to a register.
+    __m128 e[12];
+    for (int k=0;k<12;++k) {
+        e[k]=_mm_set1_ps(m.data()[(k/3)*4+k%3]);
+    }
+
+    for (;i+4<=end;i+=4) {
+        __m128 x,y,z;
+        load4(c.a,c.sa,i,x,y,z);
+
+        __m128 tx=_mm_add_ps(dot4(e[0],x,e[3],y,e[6],z),e[ 9]);
+        __m128 ty=_mm_add_ps(dot4(e[1],x,e[4],y,e[7],z),e[10]);
+        __m128 tz=_mm_add_ps(dot4(e[2],x,e[5],y,e[8],z),e[11]);
+
+        if (c.normalize) {
+            normalize4(tx,ty,tz,c.accuracy);
+        }
+
+        store4(c.out,c.sout,i,tx,ty,tz);
+    }
+#endif
+
+    for (;i<end;++i) {
+        Vec3f v=m*get(c.a,c.sa,i);
+        if (c.normalize) {
+            v.normalize(c.accuracy);
+        }
+        put(c.out,c.sout,i,v);
+    }
+}
+
+void normalizeKernel(void* context,int chunk,int begin,int end)
+{
+    G_UNREF_PARAM(chunk)
+
+    BatchContext const& c=*static_cast<BatchContext const*>(context);
+
+    int i=begin;
+
+#ifdef GALE_USE_SSE
+    for (;i+4<=end;i+=4) {
+        __m128 x,y,z;
+        load4(c.a,c.sa,i,x,y,z);
+        normalize4(x,y,z,c.accuracy);
+        store4(c.out,c.sout,i,x,y,z);
+    }
+#endif
+
+    for (;i<end;++i) {
+        Vec3f v=get(c.a,c.sa,i);
+        v.normalize(c.accuracy);
+        put(c.out,c.sout,i,v);
+    }
+}
+
+void dotKernel(void* context,int chunk,int begin,int end)
+{
+    G_UNREF_PARAM(chunk)
+
+    BatchContext const& c=*static_cast<BatchContext const*>(context);
+
+    int i=begin;
+
+#ifdef GALE_USE_SSE
+    for (;i+4<=end;i+=4) {
+        __m128 ax,ay,az,bx,by,bz;
+        load4(c.a,c.sa,i,ax,ay,az);
+        load4(c.b,c.sb,i,bx,by,bz);
+        _mm_storeu_ps(c.dots+i,dot4(ax,bx,ay,by,az,bz));
+    }
+#endif
+
+    for (;i<end;++i) {
+        c.dots[i]=get(c.a,c.sa,i)%get(c.b,c.sb,i);
+    }
+}
+
+void crossKernel(void* context,int chunk,int begin,int end)
+{
+    G_UNREF_PARAM(chunk)
+
+    BatchContext const& c=*static_cast<BatchContext const*>(context);
+
+    int i=begin;
+
+#ifdef GALE_USE_SSE
+    for (;i+4<=end;i+=4) {
+        __m128 ax,ay,az,bx,by,bz;
+        load4(c.a,c.sa,i,ax,ay,az);
+        load4(c.b,c.sb,i,bx,by,bz);
+
+        __m128 x=_mm_sub_ps(_mm_mul_ps(ay,bz),_mm_mul_ps(az,by));
+        __m128 y=_mm_sub_ps(_mm_mul_ps(az,bx),_mm_mul_ps(ax,bz));
+        __m128 z=_mm_sub_ps(_mm_mul_ps(ax,by),_mm_mul_ps(ay,bx));
+
+        store4(c.out,c.sout,i,x,y,z);
+    }
+#endif
+
+    for (;i<end;++i) {
+        put(c.out,c.sout,i,get(c.a,c.sa,i)^get(c.b,c.sb,i));
+    }
+}
+
+void minMaxKernel(void* context,int chunk,int begin,int end)
+{
+    BatchContext& c=*static_cast<BatchContext*>(context);
+
+    Vec3f min=get(c.a,c.sa,begin),max=min;
+
+    int i=begin+1;
+
+#ifdef GALE_USE_SSE
+    if (i+4<=end) {
+        __m128 min_x=_mm_set1_ps(min.getX()),max_x=min_x;
+        __m128 min_y=_mm_set1_ps(min.getY()),max_y=min_y;
+        __m128 min_z=_mm_set1_ps(min.getZ()),max_z=min_z;
+
+        for (;i+4<=end;i+=4) {
+            __m128 x,y,z;
+            load4(c.a,c.sa,i,x,y,z);
+
+            min_x=_mm_min_ps(min_x,x);
+            min_y=_mm_min_ps(min_y,y);
+            min_z=_mm_min_ps(min_z,z);
+
+            max_x=_mm_max_ps(max_x,x);
+            max_y=_mm_max_ps(max_y,y);
+            max_z=_mm_max_ps(max_z,z);
+        }
+
+        min.set(minElement4(min_x),minElement4(min_y),minElement4(min_z));
+        max.set(maxElement4(max_x),maxElement4(max_y),maxElement4(max_z));
+    }
+#endif
+
+    for (;i<end;++i) {
+        Vec3f v=get(c.a,c.sa,i);
+        min=min.minElements(v);
+        max=max.maxElements(v);
+    }
+
+    c.min[chunk]=min;
+    c.max[chunk]=max;
+}
+
+bool minMax(BatchContext& c,int const n,Vec3f& min,Vec3f& max,int const threads)
+{
+    if (n<=0) {
+        return false;
+    }
+
+    int chunks=Parallel::run(minMaxKernel,&c,n,threads,GRAIN);
+
+    min=c.min[0];
+    max=c.max[0];
+
+    for (int i=1;i<chunks;++i) {
+        min=min.minElements(c.min[i]);
+        max=max.maxElements(c.max[i]);
+    }
+
+    return true;
+}
+
+/*
+ * Quaternion kernels
+ */
+
+// Arguments shared by all quaternion batch kernels.
+struct QuatBatchContext
+{
+    QuatBatchContext()
+    :   q(NULL),r(NULL),out(NULL)
+    ,   v(NULL),vout(NULL)
+    ,   s(NULL)
+    ,   matrices(NULL)
+    ,   accuracy(ACCURACY_EXACT)
+    {}
+
+    QuatfArrays const* q;
+    QuatfArrays const* r;
+    QuatfArrays const* out;
+
+    Vec3fArrays const* v;
+    Vec3fArrays const* vout;
+
+    float const* s;
+    HMat4f* matrices;
+    Accuracy accuracy;
+};
+
+G_INLINE Quatf get(QuatfArrays const* soa,int const i)
+{
+    return Quatf(soa->w[i],Vec3f(soa->x[i],soa->y[i],soa->z[i]));
+}
+
+G_INLINE void put(QuatfArrays const* soa,int const i,Quatf const& q)
+{
+    soa->w[i]=q.real;
+    soa->x[i]=q.imag.getX();
+    soa->y[i]=q.imag.getY();
+    soa->z[i]=q.imag.getZ();
+}
+
+// Like Quaternion::normalize(), but with the given accuracy.
+G_INLINE void normalize(Quatf& q,Accuracy const accuracy)
+{
+    float const tol=Numerics<float>::ZERO_TOLERANCE();
+
+    float l2=q.length2();
+    if (l2>tol*tol) {
+        q*=rsqrt(l2,accuracy);
+    }
+}
+
+// The slerp weight sin(s*a)/sin(a) for the angle a between two quaternions is
+// a series in (x-1), where x = cos(a), whose coefficients follow the recurrence
+// c0 = s, ci = c(i-1) * (s^2 - i^2) / (i * (2i + 1)) = c(i-1) * (s^2 * u - v).
+// These are u and v for i = 1 to 12.
+float const SLERP_U[]={
+    1.0f/3,1.0f/10,1.0f/21,1.0f/36,1.0f/55,1.0f/78
+,   1.0f/105,1.0f/136,1.0f/171,1.0f/210,1.0f/253,1.0f/300
+};
+
+float const SLERP_V[]={
+    1.0f/3,2.0f/5,3.0f/7,4.0f/9,5.0f/11,6.0f/13
+,   7.0f/15,8.0f/17,9.0f/19,10.0f/21,11.0f/23,12.0f/25
+};
+
+// Returns the number of series terms for the given accuracy, and the factor
+// for the last term that compensates for most of the truncation error for
+// x in [0,1] and s in [0,1].
+G_INLINE int slerpTerms(Accuracy const accuracy,float& last)
+{
+    if (accuracy==ACCURACY_FAST) {
+        last=1.818f;
+        return 6;
+    }
+
+    last=1.894f;
+    return 12;
+}
+
+// Returns the approximated slerp weight for s and y = x-1.
+float slerpWeight(float const s,float const y,Accuracy const accuracy)
+{
+    float last;
+    int i=slerpTerms(accuracy,last)-1;
+
+    float s2=s*s;
+    float w=1+(s2*SLERP_U[i]-SLERP_V[i])*last*y;
+
+    while (--i>=0) {
+        w=1+(s2*SLERP_U[i]-SLERP_V[i])*y*w;
+    }
+
+    return s*w;
+}
+
+#ifdef GALE_USE_SSE
+
+// Loads the 4 quaternions starting at index i into SoA registers.
+G_INLINE void load4(QuatfArrays const* soa,int const i,__m128& w,__m128& x,__m128& y,__m128& z)
+{
+    w=_mm_loadu_ps(soa->w+i);
+    x=_mm_loadu_ps(soa->x+i);
+    y=_mm_loadu_ps(soa->y+i);
+    z=_mm_loadu_ps(soa->z+i);
+}
+
+// Stores the 4 quaternions in SoA registers starting at index i.
+G_INLINE void store4(QuatfArrays const* soa,int const i,__m128 const w,__m128 const x,__m128 const y,__m128 const z)
+{
+    _mm_storeu_ps(soa->w+i,w);
+    _mm_storeu_ps(soa->x+i,x);
+    _mm_storeu_ps(soa->y+i,y);
+    _mm_storeu_ps(soa->z+i,z);
+}
+
+// Returns the approximated slerp weights for s and y = x-1.
+G_INLINE __m128 slerpWeight4(__m128 const s,__m128 const y,Accuracy const accuracy)
+{
+    float last;
+    int i=slerpTerms(accuracy,last)-1;
+
+    __m128 s2=_mm_mul_ps(s,s);
+    __m128 one=_mm_set1_ps(1.0f);
+
+    __m128 c=_mm_sub_ps(_mm_mul_ps(s2,_mm_set1_ps(SLERP_U[i]*last)),_mm_set1_ps(SLERP_V[i]*last));
+    __m128 w=_mm_add_ps(one,_mm_mul_ps(c,y));
+
+    while (--i>=0) {
+        c=_mm_sub_ps(_mm_mul_ps(s2,_mm_set1_ps(SLERP_U[i])),_mm_set1_ps(SLERP_V[i]));
+        w=_mm_add_ps(one,_mm_mul_ps(_mm_mul_ps(c,y),w));
+    }
+
+    return _mm_mul_ps(s,w);
+}
+
+#endif // GALE_USE_SSE
+
+void nlerpKernel(void* context,int chunk,int begin,int end)
+{
+    G_UNREF_PARAM(chunk)
+
+    QuatBatchContext const& c=*static_cast<QuatBatchContext const*>(context);
+
+    int i=begin;
+
+#ifdef GALE_USE_SSE
+    float const tol=Numerics<float>::ZERO_TOLERANCE();
+
+    for (;i+4<=end;i+=4) {
+        __m128 qw,qx,qy,qz,rw,rx,ry,rz;
+        load4(c.q,i,qw,qx,qy,qz);
+        load4(c.r,i,rw,rx,ry,rz);
+
+        __m128 s=_mm_loadu_ps(c.s+i);
+        __m128 w=_mm_add_ps(qw,_mm_mul_ps(_mm_sub_ps(rw,qw),s));
+        __m128 x=_mm_add_ps(qx,_mm_mul_ps(_mm_sub_ps(rx,qx),s));
+        __m128 y=_mm_add_ps(qy,_mm_mul_ps(_mm_sub_ps(ry,qy),s));
+        __m128 z=_mm_add_ps(qz,_mm_mul_ps(_mm_sub_ps(rz,qz),s));
+
+        // Scale the quaternions that are too short by 1 to keep them unchanged.
+        __m128 l2=_mm_add_ps(_mm_mul_ps(w,w),dot4(x,x,y,y,z,z));
+        __m128 valid=_mm_cmpgt_ps(l2,_mm_set1_ps(tol*tol));
+        __m128 l=rsqrtPS(l2,c.accuracy);
+        l=_mm_or_ps(_mm_and_ps(valid,l),_mm_andnot_ps(valid,_mm_set1_ps(1.0f)));
+
+        store4(c.out,i,_mm_mul_ps(w,l),_mm_mul_ps(x,l),_mm_mul_ps(y,l),_mm_mul_ps(z,l));
+    }
+#endif
+
+    for (;i<end;++i) {
+        Quatf q=get(c.q,i),r=get(c.r,i);
+        float s=c.s[i];
+
+        q=Quatf(q.real+(r.real-q.real)*s,lerp(q.imag,r.imag,s));
+        normalize(q,c.accuracy);
+
+        put(c.out,i,q);
+    }
+}
+
+void slerpKernel(void* context,int chunk,int begin,int end)
+{
+    G_UNREF_PARAM(chunk)
+
+    QuatBatchContext const& c=*static_cast<QuatBatchContext const*>(context);
+
+    int i=begin;
+
+    if (c.accuracy==ACCURACY_EXACT) {
+        for (;i<end;++i) {
+            Quatf q=get(c.q,i),r=get(c.r,i);
+            if (q.dot(r)<0) {
+                r=-r;
+            }
+            put(c.out,i,slerp(q,r,c.s[i]));
+        }
+        return;
+    }
+
+#ifdef GALE_USE_SSE
+    __m128 one=_mm_set1_ps(1.0f);
+    __m128 sign=_mm_set1_ps(-0.0f);
+
+    for (;i+4<=end;i+=4) {
+        __m128 qw,qx,qy,qz,rw,rx,ry,rz;
+        load4(c.q,i,qw,qx,qy,qz);
+        load4(c.r,i,rw,rx,ry,rz);
+
+        // Flip the sign of r where the angle cosine is negative.
+        __m128 x=_mm_add_ps(_mm_mul_ps(qw,rw),dot4(qx,rx,qy,ry,qz,rz));
+        __m128 flip=_mm_and_ps(x,sign);
+        x=_mm_xor_ps(x,flip);
+
+        __m128 s=_mm_loadu_ps(c.s+i);
+        __m128 y=_mm_sub_ps(x,one);
+        __m128 a=slerpWeight4(_mm_sub_ps(one,s),y,c.accuracy);
+        __m128 b=_mm_xor_ps(slerpWeight4(s,y,c.accuracy),flip);
+
+        store4(c.out,i
+        ,   _mm_add_ps(_mm_mul_ps(qw,a),_mm_mul_ps(rw,b))
+        ,   _mm_add_ps(_mm_mul_ps(qx,a),_mm_mul_ps(rx,b))
+        ,   _mm_add_ps(_mm_mul_ps(qy,a),_mm_mul_ps(ry,b))
+        ,   _mm_add_ps(_mm_mul_ps(qz,a),_mm_mul_ps(rz,b))
+        );
+    }
+#endif
+
+    for (;i<end;++i) {
+        Quatf q=get(c.q,i),r=get(c.r,i);
+        float s=c.s[i];
+
+        float x=q.dot(r);
+        if (x<0) {
+            x=-x;
+            r=-r;
+        }
+
+        float y=x-1;
+        put(c.out,i,q*slerpWeight(1-s,y,c.accuracy)+r*slerpWeight(s,y,c.accuracy));
+    }
+}
+
+void multiplyKernel(void* context,int chunk,int begin,int end)
+{
+    G_UNREF_PARAM(chunk)
+
+    QuatBatchContext const& c=*static_cast<QuatBatchContext const*>(context);
+
+    int i=begin;
+
+#ifdef GALE_USE_SSE
+    for (;i+4<=end;i+=4) {
+        __m128 qw,qx,qy,qz,rw,rx,ry,rz;
+        load4(c.q,i,qw,qx,qy,qz);
+        load4(c.r,i,rw,rx,ry,rz);
+
+        __m128 w=_mm_sub_ps(_mm_mul_ps(qw,rw),dot4(qx,rx,qy,ry,qz,rz));
+        __m128 x=_mm_sub_ps(dot4(qw,rx,rw,qx,qy,rz),_mm_mul_ps(qz,ry));
+        __m128 y=_mm_sub_ps(dot4(qw,ry,rw,qy,qz,rx),_mm_mul_ps(qx,rz));
+        __m128 z=_mm_sub_ps(dot4(qw,rz,rw,qz,qx,ry),_mm_mul_ps(qy,rx));
+
+        store4(c.out,i,w,x,y,z);
+    }
+#endif
+
+    for (;i<end;++i) {
+        put(c.out,i,get(c.q,i)*get(c.r,i));
+    }
+}
+
+void rotateKernel(void* context,int chunk,int begin,int end)
+{
+    G_UNREF_PARAM(chunk)
+
+    QuatBatchContext const& c=*static_cast<QuatBatchContext const*>(context);
+
+    int i=begin;
+
+#ifdef GALE_USE_SSE
+    for (;i+4<=end;i+=4) {
+        __m128 qw,qx,qy,qz,vx,vy,vz;
+        load4(c.q,i,qw,qx,qy,qz);
+        load4(NULL,c.v,i,vx,vy,vz);
+
+        // i = w * v + (q x v)
+        __m128 ix=_mm_add_ps(_mm_mul_ps(qw,vx),_mm_sub_ps(_mm_mul_ps(qy,vz),_mm_mul_ps(qz,vy)));
+        __m128 iy=_mm_add_ps(_mm_mul_ps(qw,vy),_mm_sub_ps(_mm_mul_ps(qz,vx),_mm_mul_ps(qx,vz)));
+        __m128 iz=_mm_add_ps(_mm_mul_ps(qw,vz),_mm_sub_ps(_mm_mul_ps(qx,vy),_mm_mul_ps(qy,vx)));
+
+        // r = (q . v) * q + w * i - (i x q)
+        __m128 d=dot4(qx,vx,qy,vy,qz,vz);
+        __m128 x=_mm_add_ps(_mm_mul_ps(d,qx),_mm_sub_ps(_mm_mul_ps(qw,ix),_mm_sub_ps(_mm_mul_ps(iy,qz),_mm_mul_ps(iz,qy))));
+        __m128 y=_mm_add_ps(_mm_mul_ps(d,qy),_mm_sub_ps(_mm_mul_ps(qw,iy),_mm_sub_ps(_mm_mul_ps(iz,qx),_mm_mul_ps(ix,qz))));
+        __m128 z=_mm_add_ps(_mm_mul_ps(d,qz),_mm_sub_ps(_mm_mul_ps(qw,iz),_mm_sub_ps(_mm_mul_ps(ix,qy),_mm_mul_ps(iy,qx))));
+
+        store4(NULL,c.vout,i,x,y,z);
+    }
+#endif
+
+    for (;i<end;++i) {
+        put(NULL,c.vout,i,get(c.q,i)*get(NULL,c.v,i));
+    }
+}
+
+void matrixKernel(void* context,int chunk,int begin,int end)
+{
+    G_UNREF_PARAM(chunk)
+
+    QuatBatchContext const& c=*static_cast<QuatBatchContext const*>(context);
+
+    int i=begin;
+
+#ifdef GALE_USE_SSE
+    __m128 zero=_mm_setzero_ps();
+    __m128 one=_mm_set1_ps(1.0f);
+    __m128 c3=_mm_set_ps(1,0,0,0);
+
+    for (;i+4<=end;i+=4) {
+        __m128 qw,qx,qy,qz;
+        load4(c.q,i,qw,qx,qy,qz);
+
+        __m128 x=_mm_add_ps(qx,qx);
+        __m128 y=_mm_add_ps(qy,qy);
+        __m128 z=_mm_add_ps(qz,qz);
+
+        __m128 wx=_mm_mul_ps(x,qw),wy=_mm_mul_ps(y,qw),wz=_mm_mul_ps(z,qw);
+        __m128 xx=_mm_mul_ps(x,qx),xy=_mm_mul_ps(y,qx),xz=_mm_mul_ps(z,qx);
+        __m128 yy=_mm_mul_ps(y,qy),yz=_mm_mul_ps(z,qy),zz=_mm_mul_ps(z,qz);
+
+        // Get the columns of 4 matrices at a time and transpose them so each
+        // register holds the column of one matrix.
+        __m128 m0=_mm_sub_ps(one,_mm_add_ps(yy,zz));
+        __m128 m1=_mm_add_ps(xy,wz);
+        __m128 m2=_mm_sub_ps(xz,wy);
+        __m128 m3=zero;
+        _MM_TRANSPOSE4_PS(m0,m1,m2,m3);
+        _mm_storeu_ps(c.matrices[i  ].data(),m0);
+        _mm_storeu_ps(c.matrices[i+1].data(),m1);
+        _mm_storeu_ps(c.matrices[i+2].data(),m2);
+        _mm_storeu_ps(c.matrices[i+3].data(),m3);
+
+        m0=_mm_sub_ps(xy,wz);
+        m1=_mm_sub_ps(one,_mm_add_ps(xx,zz));
+        m2=_mm_add_ps(yz,wx);
+        m3=zero;
+        _MM_TRANSPOSE4_PS(m0,m1,m2,m3);
+        _mm_storeu_ps(c.matrices[i  ].data()+4,m0);
+        _mm_storeu_ps(c.matrices[i+1].data()+4,m1);
+        _mm_storeu_ps(c.matrices[i+2].data()+4,m2);
+        _mm_storeu_ps(c.matrices[i+3].data()+4,m3);
+
+        m0=_mm_add_ps(xz,wy);
+        m1=_mm_sub_ps(yz,wx);
+        m2=_mm_sub_ps(one,_mm_add_ps(xx,yy));
+        m3=zero;
+        _MM_TRANSPOSE4_PS(m0,m1,m2,m3);
+        _mm_storeu_ps(c.matrices[i  ].data()+8,m0);
+        _mm_storeu_ps(c.matrices[i+1].data()+8,m1);
+        _mm_storeu_ps(c.matrices[i+2].data()+8,m2);
+        _mm_storeu_ps(c.matrices[i+3].data()+8,m3);
+
+        for (int k=0;k<4;++k) {
+            _mm_storeu_ps(c.matrices[i+k].data()+12,c3);
+        }
+    }
+#endif
+
+    for (;i<end;++i) {
+        get(c.q,i).getMatrix(c.matrices[i]);
+    }
+}
+
+} // namespace
+
+void transformPoints(HMat4f const& m,Vec3f const* in,Vec3f* out,int const n,int const threads)
+{
+    BatchContext c;
+    c.matrix=m;
+    c.a=in;
+    c.out=out;
+    Parallel::run(transformKernel,&c,n,threads,GRAIN);
+}
+
+void transformPoints(HMat4f const& m,Vec3fArrays const& in,Vec3fArrays const& out,int const n,int const threads)
+{
+    BatchContext c;
+    c.matrix=m;
+    c.sa=&in;
+    c.sout=&out;
+    Parallel::run(transformKernel,&c,n,threads,GRAIN);
+}
+
+void transformNormals(HMat4f const& m,Vec3f const* in,Vec3f* out,int const n,Accuracy const accuracy,int const threads)
+{
+    BatchContext c;
+    c.accuracy=accuracy;
+    c.matrix=normalMatrix(m);
+    c.normalize=true;
+    c.a=in;
+    c.out=out;
+    Parallel::run(transformKernel,&c,n,threads,GRAIN);
+}
+
+void transformNormals(HMat4f const& m,Vec3fArrays const& in,Vec3fArrays const& out,int const n,Accuracy const accuracy,int const threads)
+{
+    BatchContext c;
+    c.accuracy=accuracy;
+    c.matrix=normalMatrix(m);
+    c.normalize=true;
+    c.sa=&in;
+    c.sout=&out;
+    Parallel::run(transformKernel,&c,n,threads,GRAIN);
+}
+
+void normalizeAll(Vec3f const* in,Vec3f* out,int const n,Accuracy const accuracy,int const threads)
+{
+    BatchContext c;
+    c.accuracy=accuracy;
+    c.a=in;
+    c.out=out;
+    Parallel::run(normalizeKernel,&c,n,threads,GRAIN);
+}
+
+void normalizeAll(Vec3fArrays const& in,Vec3fArrays const& out,int const n,Accuracy const accuracy,int const threads)
+{
+    BatchContext c;
+    c.accuracy=accuracy;
+    c.sa=&in;
+    c.sout=&out;
+    Parallel::run(normalizeKernel,&c,n,threads,GRAIN);
+}
+
+void dotAll(Vec3f const* a,Vec3f const* b,float* out,int const n,int const threads)
+{
+    BatchContext c;
+    c.a=a;
+    c.b=b;
+    c.dots=out;
+    Parallel::run(dotKernel,&c,n,threads,GRAIN);
+}
+
+void dotAll(Vec3fArrays const& a,Vec3fArrays const& b,float* out,int const n,int const threads)
+{
+    BatchContext c;
+    c.sa=&a;
+    c.sb=&b;
+    c.dots=out;
+    Parallel::run(dotKernel,&c,n,threads,GRAIN);
+}
+
+void crossAll(Vec3f const* a,Vec3f const* b,Vec3f* out,int const n,int const threads)
+{
+    BatchContext c;
+    c.a=a;
+    c.b=b;
+    c.out=out;
+    Parallel::run(crossKernel,&c,n,threads,GRAIN);
+}
+
+void crossAll(Vec3fArrays const& a,Vec3fArrays const& b,Vec3fArrays const& out,int const n,int const threads)
+{
+    BatchContext c;
+    c.sa=&a;
+    c.sb=&b;
+    c.sout=&out;
+    Parallel::run(crossKernel,&c,n,threads,GRAIN);
+}
+
+bool minMaxAll(Vec3f const* in,int const n,Vec3f& min,Vec3f& max,int const threads)
+{
+    BatchContext c;
+    c.a=in;
+    return minMax(c,n,min,max,threads);
+}
+
+bool minMaxAll(Vec3fArrays const& in,int const n,Vec3f& min,Vec3f& max,int const threads)
+{
+    BatchContext c;
+    c.sa=&in;
+    return minMax(c,n,min,max,threads);
+}
+
+void nlerpAll(QuatfArrays const& q,QuatfArrays const& r,float const* s,QuatfArrays const& out,int const n,Accuracy const accuracy,int const threads)
+{
+    QuatBatchContext c;
+    c.q=&q;
+    c.r=&r;
+    c.s=s;
+    c.out=&out;
+    c.accuracy=accuracy;
+    Parallel::run(nlerpKernel,&c,n,threads,GRAIN);
+}
+
+void slerpAll(QuatfArrays const& q,QuatfArrays const& r,float const* s,QuatfArrays const& out,int const n,Accuracy const accuracy,int const threads)
+{
+    QuatBatchContext c;
+    c.q=&q;
+    c.r=&r;
+    c.s=s;
+    c.out=&out;
+    c.accuracy=accuracy;
+    Parallel::run(slerpKernel,&c,n,threads,GRAIN);
+}
+
+void multiplyAll(QuatfArrays const& q,QuatfArrays const& r,QuatfArrays const& out,int const n,int const threads)
+{
+    QuatBatchContext c;
+    c.q=&q;
+    c.r=&r;
+    c.out=&out;
+    Parallel::run(multiplyKernel,&c,n,threads,GRAIN);
+}
+
+void rotateAll(QuatfArrays const& q,Vec3fArrays const& v,Vec3fArrays const& out,int const n,int const threads)
+{
+    QuatBatchContext c;
+    c.q=&q;
+    c.v=&v;
+    c.vout=&out;
+    Parallel::run(rotateKernel,&c,n,threads,GRAIN);
+}
+
+void getMatrices(QuatfArrays const& q,HMat4f* out,int const n,int const threads)
+{
+    QuatBatchContext c;
+    c.q=&q;
+    c.matrices=out;
+    Parallel::run(matrixKernel,&c,n,threads,GRAIN);
+}
+
+} // namespace math
+
+} // namespace gale
@@ -52,6 +52,7 @@ CPUInfo::CPUInfo()
 ,   m_00000001_ecx(0)
 ,   m_80000001_edx(0)
 ,   m_80000001_ecx(0)
+,   m_00000007_ebx(0)
 {
     // Null-terminate the vendor string.
     m_vendor[0]=m_vendor[3*4]='\0';
@@ -123,6 +124,33 @@ CPUInfo::CPUInfo()
             : "%ecx", "%edx", "cc"   /* Clobber */
         );
 
+#endif // G_COMP_MSVC
+    }
+
+    if (maxCPUIDStdFunc()>=0x07) {
+        // Input  : EAX = 0x00000007, ECX = 0
+        //
+        // Output : EBX = Structured extended feature flags
+
+#ifdef G_COMP_MSVC
+
+        __cpuidex(info,0x00000007,0);
+        m_00000007_ebx=static_cast<unsigned int>(info[1]);
+
+#elif defined(G_COMP_GNUC) // G_COMP_MSVC
+
+        __asm__(
+            "movl $0x00000007,%%eax\n\t"
+            "xorl %%ecx,%%ecx\n\t"
+            EMIT_1(push,bx)
+            "cpuid\n\t"
+            "movl %%ebx,%%eax\n\t"
+            EMIT_1(pop,bx)
+            : "=a" (m_00000007_ebx)  /* Output  */
+            :                        /* Input   */
+            : "%ecx", "%edx", "cc"   /* Clobber */
+        );
+
 #endif // G_COMP_MSVC
     }
 
@@ -180,6 +208,35 @@ CPUInfo::CPUInfo()
     }
 }
 
+bool CPUInfo::isAVXEnabled() const
+{
+    if (!hasOSXSAVE() || !hasAVX()) {
+        return false;
+    }
+
+    // Read the XFEATURE_ENABLED_MASK register and check whether the XMM and
+    // YMM states are enabled.
+    unsigned int xcr0;
+
+#ifdef G_COMP_MSVC
+
+    xcr0=static_cast<unsigned int>(_xgetbv(0));
+
+#elif defined(G_COMP_GNUC) // G_COMP_MSVC
+
+    // Emit the XGETBV opcode directly as old assemblers do not know it.
+    __asm__(
+        ".byte 0x0f,0x01,0xd0\n\t"
+        : "=a" (xcr0)  /* Output  */
+        : "c" (0)      /* Input   */
+        : "%edx"       /* Clobber */
+    );
+
+#endif // G_COMP_MSVC
+
+    return (xcr0&0x06)==0x06;
+}
+
 #ifdef G_COMP_MSVC
 
 #ifdef G_ARCH_X86_64
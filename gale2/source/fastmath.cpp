@@ -0,0 +1,107 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/math/fastmath.h"
+
+namespace gale {
+
+namespace math {
+
+void sinCosBatch(float const* x,float* s,float* c,int const n,Accuracy const accuracy)
+{
+    int i=0;
+
+#ifdef GALE_USE_SSE2
+    if (accuracy!=ACCURACY_EXACT) {
+        __m128 ps,pc;
+
+        for (;i+4<=n;i+=4) {
+            sinCosPS(_mm_loadu_ps(x+i),ps,pc,accuracy);
+            _mm_storeu_ps(s+i,ps);
+            _mm_storeu_ps(c+i,pc);
+        }
+
+        if (i<n) {
+            // Pad the remaining elements to process them in the same way.
+            float tx[4]={0,0,0,0},ts[4],tc[4];
+            memcpy(tx,x+i,(n-i)*sizeof(float));
+
+            sinCosPS(_mm_loadu_ps(tx),ps,pc,accuracy);
+            _mm_storeu_ps(ts,ps);
+            _mm_storeu_ps(tc,pc);
+
+            memcpy(s+i,ts,(n-i)*sizeof(float));
+            memcpy(c+i,tc,(n-i)*sizeof(float));
+        }
+
+        return;
+    }
+#else
+    G_UNREF_PARAM(accuracy)
+#endif
+
+    for (;i<n;++i) {
+        float a=x[i];
+        s[i]=sin(a);
+        c[i]=cos(a);
+    }
+}
+
+void powBatch(float const* x,float const y,float* r,int const n,Accuracy const accuracy)
+{
+    int i=0;
+
+#ifdef GALE_USE_SSE2
+    if (accuracy!=ACCURACY_EXACT) {
+        __m128 py=_mm_set1_ps(y);
+
+        for (;i+4<=n;i+=4) {
+            _mm_storeu_ps(r+i,powPS(_mm_loadu_ps(x+i),py,accuracy));
+        }
+
+        if (i<n) {
+            // Pad the remaining elements to process them in the same way.
+            float tx[4]={1,1,1,1},tr[4];
+            memcpy(tx,x+i,(n-i)*sizeof(float));
+
+            _mm_storeu_ps(tr,powPS(_mm_loadu_ps(tx),py,accuracy));
+
+            memcpy(r+i,tr,(n-i)*sizeof(float));
+        }
+
+        return;
+    }
+#else
+    G_UNREF_PARAM(accuracy)
+#endif
+
+    for (;i<n;++i) {
+        r[i]=pow(x[i],y);
+    }
+}
+
+} // namespace math
+
+} // namespace gale
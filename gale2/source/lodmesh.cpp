@@ -0,0 +1,151 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/wrapgl/lodmesh.h"
+
+#ifdef G_OS_WINDOWS
+    #include "gale/wrapgl/camera.h"
+#endif
+
+using namespace gale::math;
+using namespace gale::model;
+
+namespace gale {
+
+namespace wrapgl {
+
+void LODMesh::compile(Mesh const& mesh,int const* budgets,int const count,int const threads)
+{
+    clear();
+
+    Mesh simplified(mesh);
+
+    for (int i=0;i<count;++i) {
+        int triangles=Mesh::Simplifier::EdgeCollapse(simplified,budgets[i]);
+
+        // Skip levels that could not be simplified any further.
+        if (i>0 && triangles>=m_triangles.last()) {
+            continue;
+        }
+
+        PreparedMesh* level=new PreparedMesh;
+        level->compile(simplified,threads);
+
+        m_levels.insert(level);
+        m_triangles.insert(triangles);
+    }
+}
+
+int LODMesh::selectLevel(float const area,float const pixels) const
+{
+    float triangles=area/pixels;
+
+    for (int i=m_levels.getSize()-1;i>0;--i) {
+        if (m_triangles[i]>=triangles) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+#ifdef G_OS_WINDOWS
+
+PreparedMesh& LODMesh::select(Camera& camera,float const pixels)
+{
+    Camera::ScreenSpace const& screen=camera.getScreenSpace();
+
+    // All levels share approximately the same bounding box.
+    float area=projectedArea(m_levels[0]->box,!camera.getModelview(),camera.getProjection(),screen.width,screen.height);
+
+    return *m_levels[selectLevel(area,pixels)];
+}
+
+#endif // G_OS_WINDOWS
+
+float LODMesh::projectedArea(AABB const& box,HMat4f const& view,Mat4d const& projection,int const width,int const height)
+{
+    AABB::Vertices v;
+    box.vertices(v);
+    int const corners=G_ARRAY_LENGTH(v);
+
+    // Start with an empty rectangle, which is the correct result if all
+    // corners are off the same side of the screen.
+    double min_x=1,min_y=1,max_x=-1,max_y=-1;
+    int behind=0;
+
+    for (int i=0;i<corners;++i) {
+        Vec3d e(view*v[i]);
+
+        double w=projection[3]*e.getX()+projection[7]*e.getY()+projection[11]*e.getZ()+projection[15];
+        if (w<=0) {
+            ++behind;
+            continue;
+        }
+
+        double x=(projection[0]*e.getX()+projection[4]*e.getY()+projection[ 8]*e.getZ()+projection[12])/w;
+        double y=(projection[1]*e.getX()+projection[5]*e.getY()+projection[ 9]*e.getZ()+projection[13])/w;
+
+        min_x=min(min_x,x);
+        min_y=min(min_y,y);
+        max_x=max(max_x,x);
+        max_y=max(max_y,y);
+    }
+
+    if (behind==corners) {
+        return 0;
+    }
+
+    if (behind>0) {
+        // The box reaches behind the eye.
+        return static_cast<float>(width)*height;
+    }
+
+    // Clamp the normalized device coordinates to the screen.
+    min_x=clamp(min_x,-1.0,1.0);
+    min_y=clamp(min_y,-1.0,1.0);
+    max_x=clamp(max_x,-1.0,1.0);
+    max_y=clamp(max_y,-1.0,1.0);
+
+    if (max_x<=min_x || max_y<=min_y) {
+        return 0;
+    }
+
+    return static_cast<float>((max_x-min_x)*0.5*width*(max_y-min_y)*0.5*height);
+}
+
+void LODMesh::clear()
+{
+    for (int i=0;i<m_levels.getSize();++i) {
+        delete m_levels[i];
+    }
+
+    m_levels.clear();
+    m_triangles.clear();
+}
+
+} // namespace wrapgl
+
+} // namespace gale
@@ -0,0 +1,208 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/math/matrix4.h"
+
+#include "gale/system/cpuinfo.h"
+
+#include <immintrin.h>
+
+using namespace gale::system;
+
+namespace gale {
+
+namespace math {
+
+namespace {
+
+/*
+ * SSE kernels for floats
+ */
+
+G_INLINE __m128 combineSSE(float const* const m,float const* const v)
+{
+    __m128 r=_mm_mul_ps(_mm_loadu_ps(m),_mm_set1_ps(v[0]));
+    r=_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m+ 4),_mm_set1_ps(v[1])),r);
+    r=_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m+ 8),_mm_set1_ps(v[2])),r);
+    return _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m+12),_mm_set1_ps(v[3])),r);
+}
+
+void mulMatMatfSSE(float* const r,float const* const m,float const* const n)
+{
+    _mm_storeu_ps(r   ,combineSSE(m,n   ));
+    _mm_storeu_ps(r+ 4,combineSSE(m,n+ 4));
+    _mm_storeu_ps(r+ 8,combineSSE(m,n+ 8));
+    _mm_storeu_ps(r+12,combineSSE(m,n+12));
+}
+
+void mulMatVecfSSE(float* const r,float const* const m,float const* const v)
+{
+    _mm_storeu_ps(r,combineSSE(m,v));
+}
+
+void mulVecMatfSSE(float* const r,float const* const m,float const* const v)
+{
+    __m128 x=_mm_loadu_ps(v);
+    __m128 p0=_mm_mul_ps(_mm_loadu_ps(m   ),x);
+    __m128 p1=_mm_mul_ps(_mm_loadu_ps(m+ 4),x);
+    __m128 p2=_mm_mul_ps(_mm_loadu_ps(m+ 8),x);
+    __m128 p3=_mm_mul_ps(_mm_loadu_ps(m+12),x);
+
+    _MM_TRANSPOSE4_PS(p0,p1,p2,p3);
+    _mm_storeu_ps(r,_mm_add_ps(_mm_add_ps(p0,p1),_mm_add_ps(p2,p3)));
+}
+
+/*
+ * AVX / FMA kernels for floats and doubles. These are compiled for the AVX and
+ * FMA instruction sets even if the rest of the build is not, so they must not
+ * be inlined into code compiled for other instruction sets.
+ */
+
+G_TARGET("avx,fma") inline __m128 combineFMA(float const* const m,float const* const v)
+{
+    __m128 r=_mm_mul_ps(_mm_loadu_ps(m),_mm_set1_ps(v[0]));
+    r=_mm_fmadd_ps(_mm_loadu_ps(m+ 4),_mm_set1_ps(v[1]),r);
+    r=_mm_fmadd_ps(_mm_loadu_ps(m+ 8),_mm_set1_ps(v[2]),r);
+    return _mm_fmadd_ps(_mm_loadu_ps(m+12),_mm_set1_ps(v[3]),r);
+}
+
+G_TARGET("avx,fma") void mulMatMatfAVX(float* const r,float const* const m,float const* const n)
+{
+    _mm_storeu_ps(r   ,combineFMA(m,n   ));
+    _mm_storeu_ps(r+ 4,combineFMA(m,n+ 4));
+    _mm_storeu_ps(r+ 8,combineFMA(m,n+ 8));
+    _mm_storeu_ps(r+12,combineFMA(m,n+12));
+}
+
+G_TARGET("avx,fma") void mulMatVecfAVX(float* const r,float const* const m,float const* const v)
+{
+    _mm_storeu_ps(r,combineFMA(m,v));
+}
+
+G_TARGET("avx,fma") void mulVecMatfAVX(float* const r,float const* const m,float const* const v)
+{
+    __m128 x=_mm_loadu_ps(v);
+    __m128 p0=_mm_mul_ps(_mm_loadu_ps(m   ),x);
+    __m128 p1=_mm_mul_ps(_mm_loadu_ps(m+ 4),x);
+    __m128 p2=_mm_mul_ps(_mm_loadu_ps(m+ 8),x);
+    __m128 p3=_mm_mul_ps(_mm_loadu_ps(m+12),x);
+
+    // Sum up pairs of products, then the pairs of sums.
+    __m128 h01=_mm_hadd_ps(p0,p1);
+    __m128 h23=_mm_hadd_ps(p2,p3);
+    _mm_storeu_ps(r,_mm_hadd_ps(h01,h23));
+}
+
+G_TARGET("avx,fma") inline __m256d combineFMA(double const* const m,double const* const v)
+{
+    __m256d r=_mm256_mul_pd(_mm256_loadu_pd(m),_mm256_set1_pd(v[0]));
+    r=_mm256_fmadd_pd(_mm256_loadu_pd(m+ 4),_mm256_set1_pd(v[1]),r);
+    r=_mm256_fmadd_pd(_mm256_loadu_pd(m+ 8),_mm256_set1_pd(v[2]),r);
+    return _mm256_fmadd_pd(_mm256_loadu_pd(m+12),_mm256_set1_pd(v[3]),r);
+}
+
+G_TARGET("avx,fma") void mulMatMatdAVX(double* const r,double const* const m,double const* const n)
+{
+    _mm256_storeu_pd(r   ,combineFMA(m,n   ));
+    _mm256_storeu_pd(r+ 4,combineFMA(m,n+ 4));
+    _mm256_storeu_pd(r+ 8,combineFMA(m,n+ 8));
+    _mm256_storeu_pd(r+12,combineFMA(m,n+12));
+}
+
+G_TARGET("avx,fma") void mulMatVecdAVX(double* const r,double const* const m,double const* const v)
+{
+    _mm256_storeu_pd(r,combineFMA(m,v));
+}
+
+G_TARGET("avx,fma") void mulVecMatdAVX(double* const r,double const* const m,double const* const v)
+{
+    __m256d x=_mm256_loadu_pd(v);
+    __m256d p0=_mm256_mul_pd(_mm256_loadu_pd(m   ),x);
+    __m256d p1=_mm256_mul_pd(_mm256_loadu_pd(m+ 4),x);
+    __m256d p2=_mm256_mul_pd(_mm256_loadu_pd(m+ 8),x);
+    __m256d p3=_mm256_mul_pd(_mm256_loadu_pd(m+12),x);
+
+    // Sum up pairs of products within the 128-bit lanes, then add the lanes.
+    __m256d h01=_mm256_hadd_pd(p0,p1);
+    __m256d h23=_mm256_hadd_pd(p2,p3);
+    __m256d lo=_mm256_permute2f128_pd(h01,h23,0x20);
+    __m256d hi=_mm256_permute2f128_pd(h01,h23,0x31);
+    _mm256_storeu_pd(r,_mm256_add_pd(lo,hi));
+}
+
+Matrix4KernelSet const kernel_sets[]={
+    {
+        Matrix4KernelSet::LEVEL_SCALAR
+    ,   &Matrix4ScalarKernels<float>::mulMatMat
+    ,   &Matrix4ScalarKernels<float>::mulMatVec
+    ,   &Matrix4ScalarKernels<float>::mulVecMat
+    ,   &Matrix4ScalarKernels<double>::mulMatMat
+    ,   &Matrix4ScalarKernels<double>::mulMatVec
+    ,   &Matrix4ScalarKernels<double>::mulVecMat
+    }
+,   {
+        Matrix4KernelSet::LEVEL_SSE
+    ,   mulMatMatfSSE
+    ,   mulMatVecfSSE
+    ,   mulVecMatfSSE
+    ,   &Matrix4ScalarKernels<double>::mulMatMat
+    ,   &Matrix4ScalarKernels<double>::mulMatVec
+    ,   &Matrix4ScalarKernels<double>::mulVecMat
+    }
+,   {
+        Matrix4KernelSet::LEVEL_AVX
+    ,   mulMatMatfAVX
+    ,   mulMatVecfAVX
+    ,   mulVecMatfAVX
+    ,   mulMatMatdAVX
+    ,   mulMatVecdAVX
+    ,   mulVecMatdAVX
+    }
+};
+
+} // namespace
+
+Matrix4KernelSet::Level Matrix4KernelSet::maxLevel()
+{
+    static Level const level=
+        (CPU.isAVXEnabled() && CPU.hasFMA()) ? LEVEL_AVX
+    :   CPU.hasSSE() ? LEVEL_SSE
+    :   LEVEL_SCALAR;
+
+    return level;
+}
+
+Matrix4KernelSet const& Matrix4KernelSet::get(Level level)
+{
+    Level max=maxLevel();
+    if (level>max) {
+        level=max;
+    }
+    return kernel_sets[level];
+}
+
+} // namespace math
+
+} // namespace gale
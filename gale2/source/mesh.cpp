@@ -24,8 +24,11 @@
  */
 
 #include "gale/model/mesh.h"
+#include "gale/system/parallel.h"
 
+using namespace gale::global;
 using namespace gale::math;
+using namespace gale::system;
 
 namespace gale {
 
@@ -100,6 +103,252 @@ int Mesh::orbit(int ai,int bi,IndexArray& polygon) const
     return polygon.getSize();
 }
 
+namespace {
+
+// Arguments for extracting the faces starting at ranges of vertices.
+struct FaceContext
+{
+    Mesh const* mesh;
+
+    Mesh::IndexArray first;   // Index of each vertex' first oriented edge.
+    Mesh::IndexArray reverse; // Position of each edge's start in its end's neighborhood.
+    DynamicArray<unsigned char> visited; // Whether each oriented edge was walked.
+
+    Mesh::IndexArray ends[Parallel::MAX_CHUNKS];    // Ends of the faces per chunk.
+    Mesh::IndexArray indices[Parallel::MAX_CHUNKS]; // Face indices per chunk.
+
+    int face_bases[Parallel::MAX_CHUNKS];  // Offsets into the merged offsets.
+    int index_bases[Parallel::MAX_CHUNKS]; // Offsets into the merged indices.
+
+    Mesh::IndexArray* offsets_out;
+    Mesh::IndexArray* indices_out;
+};
+
+void reverseEdgesKernel(void* context,int /*chunk*/,int begin,int end)
+{
+    FaceContext* c=static_cast<FaceContext*>(context);
+    Mesh::IndexTable const& neighbors=c->mesh->neighbors;
+
+    // Look up each position once so walking a face takes constant time per
+    // edge. Missing reverse edges become ~0.
+    for (int vi=begin;vi<end;++vi) {
+        Mesh::IndexArray const& vn=neighbors[vi];
+        unsigned int* r=&c->reverse[c->first[vi]];
+
+        for (int i=0;i<vn.getSize();++i) {
+            r[i]=static_cast<unsigned int>(neighbors[vn[i]].find(vi));
+        }
+    }
+}
+
+void walkFacesKernel(void* context,int chunk,int begin,int end)
+{
+    FaceContext* c=static_cast<FaceContext*>(context);
+    Mesh::IndexTable const& neighbors=c->mesh->neighbors;
+    Mesh::IndexArray const& first=c->first;
+    Mesh::IndexArray const& reverse=c->reverse;
+    unsigned char* visited=c->visited;
+
+    Mesh::IndexArray& ends=c->ends[chunk];
+    Mesh::IndexArray& indices=c->indices[chunk];
+
+    for (int vi=begin;vi<end;++vi) {
+        Mesh::IndexArray const& vn=neighbors[vi];
+        if (vn.getSize()<2) {
+            // Points and line ends do not start any faces.
+            continue;
+        }
+
+        for (int i=0;i<vn.getSize();++i) {
+            unsigned int e=first[vi]+i;
+            if (visited[e]) {
+                continue;
+            }
+
+            // A face is extracted when starting at its vertex of the lowest
+            // index, so other chunks abandon it. Only the flags of edges that
+            // start in this chunk's range are touched, which are not shared.
+            int face_begin=indices.getSize();
+            int ai=vi,bi=vn[i];
+            bool owned=true;
+
+            // Broken neighborhoods may lead into loops that do not return to the
+            // start, which is detected by Brent's algorithm for the edges of
+            // other chunks whose flags cannot be checked.
+            unsigned int mark=e;
+            int power=1,length=0;
+
+            // Like orbit(), add the vertex immediately preceding ai in the
+            // neighborhood of bi, but keep track of the edge indices on the way.
+            for (;;) {
+                if (ai<end) {
+                    visited[e]=1;
+                }
+                indices.insert(ai);
+
+                unsigned int k=reverse[e];
+                if (k==~0U) {
+                    break;
+                }
+
+                Mesh::IndexArray const& bn=neighbors[bi];
+                k=(k>0 ? k : bn.getSize())-1;
+                e=first[bi]+k;
+
+                ai=bi;
+                bi=bn[k];
+
+                if (ai==vi) {
+                    break;
+                }
+
+                if (ai<vi) {
+                    owned=false;
+                    break;
+                }
+
+                if ((ai<end && visited[e]) || e==mark) {
+                    break;
+                }
+
+                if (++length==power) {
+                    mark=e;
+                    power*=2;
+                    length=0;
+                }
+            }
+
+            if (!owned || indices.getSize()-face_begin<3) {
+                // Skip faces of other vertices, lines and broken neighborhoods.
+                indices.setSize(face_begin);
+            }
+            else {
+                ends.insert(indices.getSize());
+            }
+        }
+    }
+}
+
+void mergeFacesKernel(void* context,int /*chunk*/,int begin,int end)
+{
+    FaceContext* c=static_cast<FaceContext*>(context);
+    Mesh::IndexArray& offsets=*c->offsets_out;
+    Mesh::IndexArray& indices=*c->indices_out;
+
+    for (int ci=begin;ci<end;++ci) {
+        Mesh::IndexArray const& ends=c->ends[ci];
+        unsigned int base=c->index_bases[ci];
+
+        if (c->indices[ci].getSize()>0) {
+            memcpy(&indices[base],c->indices[ci],c->indices[ci].getSize()*sizeof(Mesh::IndexArray::Type));
+        }
+
+        unsigned int* o=&offsets[c->face_bases[ci]+1];
+        for (int f=0;f<ends.getSize();++f) {
+            o[f]=base+ends[f];
+        }
+    }
+}
+
+} // namespace
+
+int Mesh::extractFaces(IndexArray& offsets,IndexArray& indices,int const threads) const
+{
+    int n=vertices.getSize();
+
+    FaceContext context;
+    context.mesh=this;
+
+    // Number the oriented edges consecutively in neighborhood order.
+    context.first.setSize(n+1);
+    context.first[0]=0;
+    for (int vi=0;vi<n;++vi) {
+        context.first[vi+1]=context.first[vi]+neighbors[vi].getSize();
+    }
+
+    // Keep a flag per oriented edge to tell whether its face was walked. Flags
+    // are used instead of bits so that chunks do not share any memory.
+    int edges=context.first[n];
+    context.reverse.setSize(edges);
+    context.visited.setSize(edges);
+    memset(context.visited,0,edges);
+
+    Parallel::run(reverseEdgesKernel,&context,n,threads,4096);
+    int chunks=Parallel::run(walkFacesKernel,&context,n,threads,1024);
+
+    // The chunks' faces are sorted by their first vertex, so concatenating them
+    // in chunk order keeps them sorted.
+    int faces=0,size=0;
+    for (int ci=0;ci<chunks;++ci) {
+        context.face_bases[ci]=faces;
+        context.index_bases[ci]=size;
+        faces+=context.ends[ci].getSize();
+        size+=context.indices[ci].getSize();
+    }
+
+    offsets.setSize(faces+1);
+    offsets[0]=0;
+    indices.setSize(size);
+
+    context.offsets_out=&offsets;
+    context.indices_out=&indices;
+    Parallel::run(mergeFacesKernel,&context,chunks,threads);
+
+    return faces;
+}
+
+namespace {
+
+// Returns the representative of the set containing x and compresses the path.
+unsigned int findRoot(Mesh::IndexArray& parents,unsigned int x)
+{
+    while (parents[x]!=x) {
+        // Halve the path by pointing to the grandparent.
+        parents[x]=parents[parents[x]];
+        x=parents[x];
+    }
+    return x;
+}
+
+} // namespace
+
+int Mesh::connectedComponents(IndexArray& components) const
+{
+    int n=vertices.getSize();
+
+    IndexArray parents(n);
+    for (int vi=0;vi<n;++vi) {
+        parents[vi]=vi;
+    }
+
+    // Unite the sets of each edge's vertices, always keeping the lower index
+    // as the representative.
+    for (int vi=0;vi<n;++vi) {
+        IndexArray const& vn=neighbors[vi];
+        for (int i=0;i<vn.getSize();++i) {
+            unsigned int a=findRoot(parents,vi);
+            unsigned int b=findRoot(parents,vn[i]);
+            if (a<b) {
+                parents[b]=a;
+            }
+            else if (b<a) {
+                parents[a]=b;
+            }
+        }
+    }
+
+    // Representatives have the lowest index in their set, so number the
+    // components in a single pass.
+    components.setSize(n);
+    int count=0;
+    for (int vi=0;vi<n;++vi) {
+        unsigned int r=findRoot(parents,vi);
+        components[vi]=(r==static_cast<unsigned int>(vi)) ? count++ : components[r];
+    }
+
+    return count;
+}
+
 int Mesh::insert(int const ai,int const bi,Vec3f const& x)
 {
     // Add a new vertex at index xi.
@@ -25,60 +25,95 @@
 
 #include "gale/model/mesh.h"
 
+#include "gale/math/batch.h"
+
+using namespace gale::global;
 using namespace gale::math;
 
 namespace gale {
 
 namespace model {
 
-void Mesh::Factory::Shape::Ellipse(VectorArray& shape,int const segs,float const w,float const h)
+void Mesh::Factory::Shape::Ellipse(VectorArray& shape,int const segs,float const w,float const h,Accuracy const accuracy)
 {
     shape.setSize(segs);
 
+    // Because of precision issues, multiply here in each iteration instead of
+    // accumulating the delta angles.
+    DynamicArray<float> theta(segs),s(segs),c(segs);
+
     float delta=2*Constf::PI()/segs;
     for (int i=0;i<segs;++i) {
-        // Because of precision issues, multiply here in each iteration instead
-        // of accumulating the delta angles.
-        float theta=i*delta;
+        theta[i]=i*delta;
+    }
 
-        shape[i]=Vec3f(cos(theta)*w,sin(theta)*h,0);
+    sinCosBatch(theta,s,c,segs,accuracy);
+
+    for (int i=0;i<segs;++i) {
+        shape[i]=Vec3f(c[i]*w,s[i]*h,0);
     }
 }
 
-void Mesh::Factory::Shape::Heart(VectorArray& shape,int const segs)
+void Mesh::Factory::Shape::Heart(VectorArray& shape,int const segs,Accuracy const accuracy)
 {
     shape.setSize(segs);
 
+    // Because of precision issues, multiply here in each iteration instead of
+    // accumulating the delta angles.
+    DynamicArray<float> omega(segs),s(segs),c(segs);
+
     float delta=2*Constf::PI()/segs;
     for (int i=0;i<segs;++i) {
-        // Because of precision issues, multiply here in each iteration instead
-        // of accumulating the delta angles.
-        float omega=-Constf::PI()+i*delta;
+        omega[i]=-Constf::PI()+i*delta;
+    }
+
+    sinCosBatch(omega,s,c,segs,accuracy);
 
-        float lambda=abs(omega)/Constf::PI();
+    for (int i=0;i<segs;++i) {
+        float lambda=abs(omega[i])/Constf::PI();
         float lambda2=lambda*lambda,lambda3=lambda2*lambda;
 
         float r=(13*lambda-22*lambda2+10*lambda3)/(6-5*lambda);
 
         // Rotated by 90 CCW from the original formula.
-        shape[i]=Vec3f(sin(omega)*r,-cos(omega)*r,0);
+        shape[i]=Vec3f(s[i]*r,-c[i]*r,0);
     }
 }
 
-void Mesh::Factory::Shape::Supershape(VectorArray& shape,int const segs,float const m,float const n1,float const n2,float const n3,float const a,float const b)
+void Mesh::Factory::Shape::Supershape(VectorArray& shape,int const segs,float const m,float const n1,float const n2,float const n3,float const a,float const b,Accuracy const accuracy)
 {
-    math::SuperFormula f(m,n1,n2,n3,a,b);
-
     shape.setSize(segs);
 
+    // Because of precision issues, multiply here in each iteration instead of
+    // accumulating the delta angles.
+    DynamicArray<float> theta(segs),s(segs),c(segs),ta(segs),tb(segs);
+
     float delta=2*Constf::PI()/segs;
     for (int i=0;i<segs;++i) {
-        // Because of precision issues, multiply here in each iteration instead
-        // of accumulating the delta angles.
-        float theta=i*delta;
+        theta[i]=m*i*delta/4.0f;
+    }
 
-        float r=f(theta);
-        shape[i]=Vec3f(cos(theta)*r,sin(theta)*r,0);
+    // Evaluate the Superformula for all angles at once, see math::SuperFormula.
+    sinCosBatch(theta,s,c,segs,accuracy);
+
+    for (int i=0;i<segs;++i) {
+        ta[i]=abs(c[i]/a);
+        tb[i]=abs(s[i]/b);
+    }
+
+    powBatch(ta,n2,ta,segs,accuracy);
+    powBatch(tb,n3,tb,segs,accuracy);
+
+    for (int i=0;i<segs;++i) {
+        ta[i]+=tb[i];
+        theta[i]=i*delta;
+    }
+
+    powBatch(ta,-1.0f/n1,ta,segs,accuracy);
+    sinCosBatch(theta,s,c,segs,accuracy);
+
+    for (int i=0;i<segs;++i) {
+        shape[i]=Vec3f(c[i]*ta[i],s[i]*ta[i],0);
     }
 }
 
@@ -437,13 +472,13 @@ Mesh* Mesh::Factory::ToroidalMapper(Formula const& long_form,int const long_segs
 // Warning C4701: Potentially uninitialized local variable 'mn' used.
 #pragma warning(disable:4701)
 
-Mesh* Mesh::Factory::Extruder(VectorArray const& path,VectorArray const& contour,bool const closed,MatrixArray const* const trans)
+Mesh* Mesh::Factory::Extruder(VectorArray const& path,Vec3f const* const contour,int const contour_size,bool const closed,MatrixArray const* const trans)
 {
-    if (path.getSize()<2 || contour.getSize()<3) {
+    if (path.getSize()<2 || contour_size<3) {
         return NULL;
     }
 
-    Mesh* m=new Mesh(path.getSize()*contour.getSize()+static_cast<int>(!closed)*2);
+    Mesh* m=new Mesh(path.getSize()*contour_size+static_cast<int>(!closed)*2);
     VectorArray& mv=m->vertices;
 
     // Pointers to the first and last vectors (Alpha and Omega :-) in the path.
@@ -481,10 +516,9 @@ Mesh* Mesh::Factory::Extruder(VectorArray const& path,VectorArray const& contour
             frenet*=(*trans)[pi%trans->getSize()];
         }
 
-        for (int ci=0;ci<contour.getSize();++ci) {
-            // Transform the contour along the path.
-            mv[vi++]=frenet*contour[ci];
-        }
+        // Transform the contour along the path.
+        transformPoints(frenet,contour,&mv[vi],contour_size);
+        vi+=contour_size;
     }
 
     if (!closed) {
@@ -493,7 +527,7 @@ Mesh* Mesh::Factory::Extruder(VectorArray const& path,VectorArray const& contour
 
         // Make all vertices of the start cut face its neighbors.
         IndexArray& nA=m->neighbors[vi];
-        nA.setSize(contour.getSize());
+        nA.setSize(contour_size);
         for (int i=0;i<nA.getSize();++i) {
             nA[i]=i;
         }
@@ -504,7 +538,7 @@ Mesh* Mesh::Factory::Extruder(VectorArray const& path,VectorArray const& contour
 
         // Make all vertices of the end cut face its neighbors.
         IndexArray& nO=m->neighbors[vi];
-        nO.setSize(contour.getSize());
+        nO.setSize(contour_size);
         for (int i=0;i<nO.getSize();++i) {
             nO[i]=mv.getSize()-3-i;
         }
@@ -523,12 +557,12 @@ Mesh* Mesh::Factory::Extruder(VectorArray const& path,VectorArray const& contour
         // start cut face vertex.
         int mn;
 
-        for (int ci=0;ci<contour.getSize();++ci) {
+        for (int ci=0;ci<contour_size;++ci) {
             // Connect the 6 neighbors (5 for the endpoints of an open path).
             IndexArray& vn=m->neighbors[vi];
             vn.setSize(6);
 
-#define WRAP_C(x) wrap(x,contour.getSize())
+#define WRAP_C(x) wrap(x,contour_size)
 
             int n=0,biwc;
 
@@ -541,12 +575,12 @@ Mesh* Mesh::Factory::Extruder(VectorArray const& path,VectorArray const& contour
                 if (closed) {
                     // As the start cut face's neighbors were already determined,
                     // just turn partial neighbors into mutual neighbors here.
-                    for (int cA=0;cA<contour.getSize();++cA) {
+                    for (int cA=0;cA<contour_size;++cA) {
                         if (m->neighbors[cA].find(vi)>=0) {
                             // If there is a wrap-around in the neighbor indices,
                             // swap them.
                             unsigned int& pn=vn[n-1];
-                            if (pn==0 && cA==contour.getSize()-1) {
+                            if (pn==0 && cA==contour_size-1) {
                                 vn[n]=pn;
                                 pn=cA;
                             }
@@ -564,8 +598,8 @@ Mesh* Mesh::Factory::Extruder(VectorArray const& path,VectorArray const& contour
                 }
             }
             else {
-                vn[n++]=biwc+contour.getSize();
-                vn[n++]=vi+contour.getSize();
+                vn[n++]=biwc+contour_size;
+                vn[n++]=vi+contour_size;
             }
 
             // Add the successor on the contour as a neighbor.
@@ -589,7 +623,7 @@ Mesh* Mesh::Factory::Extruder(VectorArray const& path,VectorArray const& contour
                         float md=(mv[mn]-v).length2();
 
                         // Calculate the distances to the opposite cut face's vertices.
-                        for (int cA=1;cA<contour.getSize();++cA) {
+                        for (int cA=1;cA<contour_size;++cA) {
                             int cO=start-cA;
                             float dA=(mv[cO]-v).length2();
                             if (dA<md) {
@@ -601,11 +635,11 @@ Mesh* Mesh::Factory::Extruder(VectorArray const& path,VectorArray const& contour
                     else {
                         ++mn;
                         if (mn==mv.getSize()) {
-                            mn-=contour.getSize();
+                            mn-=contour_size;
                         }
                     }
 
-                    biwc=mn%contour.getSize();
+                    biwc=mn%contour_size;
                     vn[n++]=mn-biwc+WRAP_C(biwc+1);
                     vn[n++]=mn;
                 }
@@ -616,8 +650,8 @@ Mesh* Mesh::Factory::Extruder(VectorArray const& path,VectorArray const& contour
                 }
             }
             else {
-                vn[n++]=biwc-contour.getSize();
-                vn[n++]=vi-contour.getSize();
+                vn[n++]=biwc-contour_size;
+                vn[n++]=vi-contour_size;
             }
 
 #undef WRAP_C
@@ -0,0 +1,1040 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/model/mesh.h"
+#include "gale/system/parallel.h"
+
+#ifndef GALE_TINY_CODE
+    #include <stdio.h>
+#endif
+
+using namespace gale::global;
+using namespace gale::math;
+using namespace gale::system;
+
+namespace gale {
+
+namespace model {
+
+namespace {
+
+/*
+ * Neighborhood construction
+ */
+
+// Provides constant time lookups of the faces' directed edges. Each slot
+// stores an edge from a to b along with the vertices preceding a and following
+// b in the same face, which is all that is required to order neighborhoods. As
+// each directed edge belongs to exactly one face in oriented manifold meshes,
+// the edge uniquely identifies these vertices.
+class EdgeHash
+{
+  public:
+
+    EdgeHash(int const vertices,Mesh::IndexArray const& offsets,Mesh::IndexArray const& indices)
+    {
+        // Keep the load factor between 1/3 and 2/3.
+        int c=indices.getSize();
+        m_slots.setSize(ceilPow2(max(c+c/2,16)));
+        memset(m_slots,0xff,m_slots.getSize()*sizeof(Slot));
+        m_mask=m_slots.getSize()-1;
+
+        // Spread the vertices evenly across the table so that the edges
+        // starting at the same vertex are stored close to each other. This
+        // greatly improves cache hits when walking a vertex' neighborhood.
+        m_scale=max(m_slots.getSize()/max(vertices,1),1);
+
+        for (int f=0;f<offsets.getSize()-1;++f) {
+            unsigned int const* face=indices+offsets[f];
+            int n=offsets[f+1]-offsets[f];
+
+            for (int i=0;i<n;++i) {
+                Slot edge={
+                    face[i]
+                ,   face[(i+1)%n]
+                ,   face[(i+n-1)%n]
+                ,   face[(i+2)%n]
+                };
+
+                // Duplicate edges as present in non-manifold or inconsistently
+                // oriented meshes are skipped.
+                Slot& s=m_slots[locate(edge.a,edge.b)];
+                if (s.a==EMPTY) {
+                    s=edge;
+                }
+            }
+        }
+    }
+
+    // Returns the vertex following x in the neighborhood of v, or -1.
+    int successor(unsigned int const x,unsigned int const v) const {
+        // In the face of the edge from v to x, the vertex preceding v follows x
+        // in the neighborhood of v.
+        Slot const& s=m_slots[locate(v,x)];
+        return s.a==EMPTY ? -1 : static_cast<int>(s.before);
+    }
+
+    // Returns the vertex preceding x in the neighborhood of v, or -1.
+    int predecessor(unsigned int const x,unsigned int const v) const {
+        // In the face of the edge from x to v, the vertex following v precedes
+        // x in the neighborhood of v.
+        Slot const& s=m_slots[locate(x,v)];
+        return s.a==EMPTY ? -1 : static_cast<int>(s.after);
+    }
+
+  private:
+
+    static unsigned int const EMPTY=~0U;
+
+    struct Slot
+    {
+        unsigned int a,b,before,after;
+    };
+
+    // Returns the slot of the edge from a to b, or the empty slot to put it.
+    unsigned int locate(unsigned int const a,unsigned int const b) const {
+        unsigned int s=(a*m_scale+((b*0x9e3779b1U)>>28))&m_mask;
+        while (m_slots[s].a!=EMPTY && (m_slots[s].a!=a || m_slots[s].b!=b)) {
+            s=(s+1)&m_mask;
+        }
+        return s;
+    }
+
+    global::DynamicArray<Slot> m_slots;
+    unsigned int m_mask,m_scale;
+};
+
+// Arguments for building the neighborhoods of a range of vertices.
+struct NeighborContext
+{
+    Mesh* mesh;
+    EdgeHash const* hash;
+
+    Mesh::IndexArray neighbors; // Any neighbor of each vertex.
+    Mesh::IndexArray valences;  // Number of faces of each vertex.
+};
+
+void assignNeighborsKernel(void* context,int /*chunk*/,int begin,int end)
+{
+    NeighborContext const* c=static_cast<NeighborContext const*>(context);
+    EdgeHash const& hash=*c->hash;
+
+    for (int vi=begin;vi<end;++vi) {
+        Mesh::IndexArray& vn=c->mesh->neighbors[vi];
+        vn.clear();
+
+        int valence=c->valences[vi];
+        if (valence==0) {
+            // This vertex does not belong to any face.
+            continue;
+        }
+
+        // Boundary vertices have one more neighbor than faces. Limit the number
+        // of steps to that to guard against non-manifold vertices.
+        ++valence;
+        vn.setCapacity(valence);
+
+        // Walk forward from any neighbor until we are back at the start, which
+        // is the common case for interior vertices.
+        int si=c->neighbors[vi],ni=si;
+        do {
+            vn.insert(ni);
+            ni=hash.successor(ni,vi);
+        } while (ni>=0 && ni!=si && vn.getSize()<valence);
+
+        if (ni>=0) {
+            continue;
+        }
+
+        // A boundary edge was reached, so walk backwards from the start to the
+        // other boundary edge and prepend these neighbors.
+        ni=hash.predecessor(si,vi);
+        while (ni>=0 && vn.getSize()<valence) {
+            vn.insert(ni,0);
+            ni=hash.predecessor(ni,vi);
+        }
+    }
+}
+
+} // namespace
+
+Mesh* Mesh::Importer::Faces(VectorArray const& vertices,IndexArray const& offsets,IndexArray const& indices,int const threads)
+{
+    // Validate the faces before building anything.
+    if (offsets.getSize()<1 || offsets.first()!=0 || offsets.last()!=static_cast<unsigned int>(indices.getSize())) {
+        return NULL;
+    }
+
+    for (int i=0;i<indices.getSize();++i) {
+        if (indices[i]>=static_cast<unsigned int>(vertices.getSize())) {
+            return NULL;
+        }
+    }
+
+    Mesh* mesh=new Mesh(vertices);
+    assignNeighbors(*mesh,offsets,indices,threads);
+    return mesh;
+}
+
+void Mesh::Importer::assignNeighbors(Mesh& mesh,IndexArray const& offsets,IndexArray const& indices,int const threads)
+{
+    EdgeHash hash(mesh.vertices.getSize(),offsets,indices);
+
+    NeighborContext context;
+    context.mesh=&mesh;
+    context.hash=&hash;
+
+    int n=mesh.vertices.getSize();
+    mesh.neighbors.setSize(n);
+
+    context.neighbors.setSize(n);
+    context.valences.setSize(n);
+    memset(context.valences,0,n*sizeof(IndexArray::Type));
+
+    for (int f=0;f<offsets.getSize()-1;++f) {
+        for (unsigned int c=offsets[f];c<offsets[f+1];++c) {
+            unsigned int vi=indices[c];
+            context.neighbors[vi]=indices[c+1<offsets[f+1] ? c+1 : offsets[f]];
+            ++context.valences[vi];
+        }
+    }
+
+    // Vertices are independent of each other at this point, so their
+    // neighborhoods can be built concurrently.
+    Parallel::run(assignNeighborsKernel,&context,n,threads,4096);
+}
+
+#ifndef GALE_TINY_CODE
+
+namespace {
+
+/*
+ * Common file parsing helpers
+ */
+
+// The size of the blocks files are read in. This bounds the memory required
+// for reading apart from the resulting mesh itself.
+int const BLOCK_SIZE=4*1024*1024;
+
+// The minimum number of bytes or records each thread should parse.
+int const GRAIN_SIZE=64*1024;
+
+// Returns 10 raised to the power of e.
+double powerOf10(int e)
+{
+    static double const POWERS[]={
+        1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11
+    ,   1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22
+    };
+
+    if (e<0) {
+        return 1.0/powerOf10(-e);
+    }
+
+    if (e<static_cast<int>(G_ARRAY_LENGTH(POWERS))) {
+        return POWERS[e];
+    }
+
+    return pow(10.0,e);
+}
+
+bool isSpace(char const c)
+{
+    return c==' ' || c=='\t' || c=='\r';
+}
+
+bool isDigit(char const c)
+{
+    return c>='0' && c<='9';
+}
+
+// Parses a decimal floating-point number at p into value and returns the
+// position after it. This is considerably faster than strtod() and does not
+// depend on the locale, at the cost of possibly being off by one ULP.
+char const* parseFloat(char const* p,float& value)
+{
+    bool negative=(*p=='-');
+    if (negative || *p=='+') {
+        ++p;
+    }
+
+    // Accumulate up to 19 significant digits exactly as an integer.
+    g_uint64 mantissa=0;
+    int digits=0,exponent=0;
+
+    for (;isDigit(*p);++p) {
+        if (digits<19) {
+            mantissa=mantissa*10+(*p-'0');
+            digits+=(mantissa!=0);
+        }
+        else {
+            ++exponent;
+        }
+    }
+
+    if (*p=='.') {
+        for (++p;isDigit(*p);++p) {
+            if (digits<19) {
+                mantissa=mantissa*10+(*p-'0');
+                digits+=(mantissa!=0);
+                --exponent;
+            }
+        }
+    }
+
+    if (*p=='e' || *p=='E') {
+        ++p;
+
+        bool exp_negative=(*p=='-');
+        if (exp_negative || *p=='+') {
+            ++p;
+        }
+
+        int e=0;
+        for (;isDigit(*p);++p) {
+            if (e<10000) {
+                e=e*10+(*p-'0');
+            }
+        }
+
+        exponent+=exp_negative ? -e : e;
+    }
+
+    double result=static_cast<double>(mantissa);
+    if (exponent<0) {
+        result/=powerOf10(-exponent);
+    }
+    else if (exponent>0) {
+        result*=powerOf10(exponent);
+    }
+
+    value=static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+// Parses a decimal integer at p into value and returns the position after it.
+char const* parseInt(char const* p,int& value)
+{
+    bool negative=(*p=='-');
+    if (negative || *p=='+') {
+        ++p;
+    }
+
+    int result=0;
+    for (;isDigit(*p);++p) {
+        result=result*10+(*p-'0');
+    }
+
+    value=negative ? -result : result;
+    return p;
+}
+
+// Appends the faces given by their sizes and indices to the global face list,
+// adding base to the indices at the given relative positions.
+void appendFaces(Mesh::IndexArray& offsets,Mesh::IndexArray& indices,Mesh::IndexArray const& sizes,Mesh::IndexArray& local,Mesh::IndexArray const& relative,unsigned int const base)
+{
+    for (int i=0;i<relative.getSize();++i) {
+        local[relative[i]]+=base;
+    }
+
+    int o=offsets.getSize();
+    offsets.setSize(o+sizes.getSize());
+    for (int i=0;i<sizes.getSize();++i,++o) {
+        offsets[o]=offsets[o-1]+sizes[i];
+    }
+
+    indices.insert(local);
+}
+
+/*
+ * Wavefront OBJ parsing
+ */
+
+// The data parsed from a chunk of lines in an OBJ file.
+struct OBJChunk
+{
+    Mesh::VectorArray vertices;
+    Mesh::IndexArray sizes;    // Number of vertices per face.
+    Mesh::IndexArray indices;  // Face vertex indices.
+    Mesh::IndexArray relative; // Positions of indices relative to the chunk.
+};
+
+// Arguments for parsing a block of text from an OBJ file.
+struct OBJContext
+{
+    char const* text;
+    OBJChunk chunks[Parallel::MAX_CHUNKS];
+};
+
+void parseOBJKernel(void* context,int chunk,int begin,int end)
+{
+    OBJContext* c=static_cast<OBJContext*>(context);
+    OBJChunk& data=c->chunks[chunk];
+
+    data.vertices.clear();
+    data.sizes.clear();
+    data.indices.clear();
+    data.relative.clear();
+
+    char const* p=c->text+begin;
+    char const* e=c->text+end;
+
+    // Only parse lines that start in this chunk, the block ends with a newline.
+    if (begin>0 && p[-1]!='\n') {
+        while (*p!='\n') {
+            ++p;
+        }
+        ++p;
+    }
+
+    while (p<e) {
+        while (isSpace(*p)) {
+            ++p;
+        }
+
+        if (p[0]=='v' && isSpace(p[1])) {
+            Vec3f v;
+            p=parseFloat(p+2,v[0]);
+            while (isSpace(*p)) {
+                ++p;
+            }
+            p=parseFloat(p,v[1]);
+            while (isSpace(*p)) {
+                ++p;
+            }
+            p=parseFloat(p,v[2]);
+            data.vertices.insert(v);
+        }
+        else if (p[0]=='f' && isSpace(p[1])) {
+            int first=data.indices.getSize();
+            int first_relative=data.relative.getSize();
+            int count=0;
+            ++p;
+
+            for (;;) {
+                while (isSpace(*p)) {
+                    ++p;
+                }
+                if (!isDigit(*p) && *p!='-' && *p!='+') {
+                    break;
+                }
+
+                int i;
+                p=parseInt(p,i);
+
+                if (i<0) {
+                    // Resolve relative indices as far as possible, and mark
+                    // them for adding the chunk's base index later.
+                    data.relative.insert(data.indices.getSize());
+                    i+=data.vertices.getSize();
+                }
+                else {
+                    // Convert from one-based to zero-based indices. Invalid
+                    // zero indices wrap around and are caught later.
+                    --i;
+                }
+                data.indices.insert(static_cast<unsigned int>(i));
+                ++count;
+
+                // Skip any texture coordinate and normal indices.
+                while (*p && *p!='\n' && !isSpace(*p)) {
+                    ++p;
+                }
+            }
+
+            if (count>=3) {
+                data.sizes.insert(count);
+            }
+            else {
+                // Skip degenerate faces.
+                data.indices.setSize(first);
+                data.relative.setSize(first_relative);
+            }
+        }
+
+        // Skip the rest of the line including comments and unsupported
+        // statements.
+        while (*p!='\n') {
+            ++p;
+        }
+        ++p;
+    }
+}
+
+/*
+ * PLY parsing
+ */
+
+// Data types of PLY properties.
+enum PLYType {
+    PLY_INVALID
+,   PLY_INT8
+,   PLY_UINT8
+,   PLY_INT16
+,   PLY_UINT16
+,   PLY_INT32
+,   PLY_UINT32
+,   PLY_FLOAT32
+,   PLY_FLOAT64
+};
+
+// Returns the data type for the given PLY type name.
+PLYType getPLYType(char const* name)
+{
+    static struct {
+        char const* name;
+        PLYType type;
+    } const TYPES[]={
+        {"char",PLY_INT8},{"int8",PLY_INT8}
+    ,   {"uchar",PLY_UINT8},{"uint8",PLY_UINT8}
+    ,   {"short",PLY_INT16},{"int16",PLY_INT16}
+    ,   {"ushort",PLY_UINT16},{"uint16",PLY_UINT16}
+    ,   {"int",PLY_INT32},{"int32",PLY_INT32}
+    ,   {"uint",PLY_UINT32},{"uint32",PLY_UINT32}
+    ,   {"float",PLY_FLOAT32},{"float32",PLY_FLOAT32}
+    ,   {"double",PLY_FLOAT64},{"float64",PLY_FLOAT64}
+    };
+
+    for (int i=0;i<static_cast<int>(G_ARRAY_LENGTH(TYPES));++i) {
+        if (strcmp(name,TYPES[i].name)==0) {
+            return TYPES[i].type;
+        }
+    }
+
+    return PLY_INVALID;
+}
+
+// Returns the size in bytes of the given PLY data type.
+int getPLYSize(PLYType const type)
+{
+    static int const SIZES[]={0,1,1,2,2,4,4,4,8};
+    return SIZES[type];
+}
+
+// Reads a PLY value of the given type at p, swapping bytes if requested.
+double readPLYValue(unsigned char const* p,PLYType const type,bool const swap)
+{
+    unsigned char b[8];
+    int size=getPLYSize(type);
+
+    if (swap) {
+        for (int i=0;i<size;++i) {
+            b[i]=p[size-1-i];
+        }
+    }
+    else {
+        memcpy(b,p,size);
+    }
+
+    switch (type) {
+        case PLY_INT8: {
+            g_int8 v;
+            memcpy(&v,b,sizeof(v));
+            return v;
+        }
+        case PLY_UINT8: {
+            g_uint8 v;
+            memcpy(&v,b,sizeof(v));
+            return v;
+        }
+        case PLY_INT16: {
+            g_int16 v;
+            memcpy(&v,b,sizeof(v));
+            return v;
+        }
+        case PLY_UINT16: {
+            g_uint16 v;
+            memcpy(&v,b,sizeof(v));
+            return v;
+        }
+        case PLY_INT32: {
+            g_int32 v;
+            memcpy(&v,b,sizeof(v));
+            return v;
+        }
+        case PLY_UINT32: {
+            g_uint32 v;
+            memcpy(&v,b,sizeof(v));
+            return v;
+        }
+        case PLY_FLOAT32: {
+            g_real32 v;
+            memcpy(&v,b,sizeof(v));
+            return v;
+        }
+        case PLY_FLOAT64: {
+            g_real64 v;
+            memcpy(&v,b,sizeof(v));
+            return v;
+        }
+        default: {
+            return 0.0;
+        }
+    }
+}
+
+// A property of a PLY element.
+struct PLYProperty
+{
+    PLYType type;  // The scalar type, or the item type for lists.
+    PLYType count; // The count type for lists, otherwise invalid.
+    char name[32];
+};
+
+// An element declared in a PLY header.
+struct PLYElement
+{
+    char name[32];
+    int count;
+    DynamicArray<PLYProperty> properties;
+
+    // Returns the fixed size of the records, or 0 if they contain lists.
+    int getStride() const {
+        int stride=0;
+        for (int i=0;i<properties.getSize();++i) {
+            if (properties[i].count!=PLY_INVALID) {
+                return 0;
+            }
+            stride+=getPLYSize(properties[i].type);
+        }
+        return stride;
+    }
+
+    // Returns the index of the property with the given name, or -1.
+    int find(char const* name) const {
+        for (int i=0;i<properties.getSize();++i) {
+            if (strcmp(properties[i].name,name)==0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+};
+
+// Buffered sequential reader that reads a file in blocks.
+class BlockReader
+{
+  public:
+
+    BlockReader(FILE* file)
+    :   m_file(file)
+    ,   m_buffer(BLOCK_SIZE)
+    ,   m_begin(0)
+    ,   m_end(0)
+    {}
+
+    // Makes sure at least size bytes are available, growing the buffer for
+    // oversized requests. Returns a pointer to the data or NULL at the end.
+    unsigned char const* request(int const size) {
+        if (m_end-m_begin<size) {
+            // Move any remaining data to the front and fill up the buffer.
+            m_end-=m_begin;
+            memmove(m_buffer,m_buffer+m_begin,m_end);
+            m_begin=0;
+
+            if (size>m_buffer.getSize()) {
+                m_buffer.setSize(size);
+            }
+
+            m_end+=static_cast<int>(fread(m_buffer+m_end,1,m_buffer.getSize()-m_end,m_file));
+            if (m_end<size) {
+                return NULL;
+            }
+        }
+
+        return m_buffer+m_begin;
+    }
+
+    // Marks size bytes as consumed.
+    void consume(int const size) {
+        m_begin+=size;
+    }
+
+    // Reads a line of at most size-1 characters into line, stripping any line
+    // feeds. Returns false at the end of the file.
+    bool readLine(char* line,int const size) {
+        int i=0;
+        for (;;) {
+            unsigned char const* p=request(1);
+            if (!p) {
+                break;
+            }
+            consume(1);
+
+            if (*p=='\n') {
+                line[i]='\0';
+                return true;
+            }
+
+            if (*p!='\r' && i<size-1) {
+                line[i++]=*p;
+            }
+        }
+
+        line[i]='\0';
+        return i>0;
+    }
+
+    // Returns the number of bytes that are available without reading.
+    int available() const {
+        return m_end-m_begin;
+    }
+
+  private:
+
+    FILE* m_file;
+    DynamicArray<unsigned char> m_buffer;
+    int m_begin,m_end;
+};
+
+// Arguments for converting a block of fixed-size PLY vertex records.
+struct PLYVertexContext
+{
+    unsigned char const* data;
+    int stride;
+    int offsets[3];
+    PLYType types[3];
+    bool swap;
+    Vec3f* vertices;
+};
+
+void convertPLYVerticesKernel(void* context,int /*chunk*/,int begin,int end)
+{
+    PLYVertexContext const* c=static_cast<PLYVertexContext const*>(context);
+
+    for (int i=begin;i<end;++i) {
+        unsigned char const* record=c->data+i*c->stride;
+        Vec3f& v=c->vertices[i];
+
+        for (int k=0;k<3;++k) {
+            v[k]=static_cast<float>(readPLYValue(record+c->offsets[k],c->types[k],c->swap));
+        }
+    }
+}
+
+} // namespace
+
+Mesh* Mesh::Importer::OBJ(char const* path,int const threads)
+{
+    FILE* file=fopen(path,"rb");
+    if (!file) {
+        return NULL;
+    }
+
+    Mesh* mesh=new Mesh;
+    IndexArray offsets(1),indices;
+    offsets[0]=0;
+
+    OBJContext* context=new OBJContext;
+
+    // Reserve space for terminating the last line. Parsing stops at newlines,
+    // so no further sentinel is required.
+    DynamicArray<char> buffer(BLOCK_SIZE+1);
+    int size=0;
+
+    for (;;) {
+        int count=static_cast<int>(fread(buffer+size,1,buffer.getSize()-1-size,file));
+        size+=count;
+
+        bool eof=(count==0);
+        if (eof) {
+            if (size==0) {
+                break;
+            }
+
+            // Terminate the last line.
+            if (buffer[size-1]!='\n') {
+                buffer[size++]='\n';
+            }
+        }
+
+        // Only parse complete lines in this block.
+        int length=size;
+        while (length>0 && buffer[length-1]!='\n') {
+            --length;
+        }
+
+        if (length==0) {
+            // Grow the buffer to hold at least one line.
+            buffer.setSize(buffer.getSize()*2);
+            continue;
+        }
+
+        context->text=buffer;
+        int chunks=Parallel::run(parseOBJKernel,context,length,threads,GRAIN_SIZE);
+
+        // Merge the chunks in order, adding the number of vertices parsed so
+        // far to relative indices.
+        for (int i=0;i<chunks;++i) {
+            OBJChunk& data=context->chunks[i];
+            appendFaces(offsets,indices,data.sizes,data.indices,data.relative,mesh->vertices.getSize());
+            mesh->vertices.insert(data.vertices);
+        }
+
+        // Keep the incomplete line for the next block.
+        size-=length;
+        memmove(buffer,buffer+length,size);
+
+        if (eof) {
+            break;
+        }
+    }
+
+    delete context;
+    fclose(file);
+
+    for (int i=0;i<indices.getSize();++i) {
+        if (indices[i]>=static_cast<unsigned int>(mesh->vertices.getSize())) {
+            delete mesh;
+            return NULL;
+        }
+    }
+
+    assignNeighbors(*mesh,offsets,indices,threads);
+    return mesh;
+}
+
+Mesh* Mesh::Importer::PLY(char const* path,int const threads)
+{
+    FILE* file=fopen(path,"rb");
+    if (!file) {
+        return NULL;
+    }
+
+    BlockReader reader(file);
+    DynamicArray<PLYElement> elements;
+
+    static int const ONE=1;
+    bool little_endian=(*reinterpret_cast<char const*>(&ONE)!=0);
+    bool valid=false,swap=false;
+
+    // Parse the header.
+    char line[256];
+    if (reader.readLine(line,sizeof(line)) && strcmp(line,"ply")==0) {
+        while (reader.readLine(line,sizeof(line))) {
+            char keyword[32],a[32],b[32],c[32];
+            int n=sscanf(line,"%31s %31s %31s %31s",keyword,a,b,c);
+
+            if (n<1 || strcmp(keyword,"comment")==0 || strcmp(keyword,"obj_info")==0) {
+                continue;
+            }
+
+            if (strcmp(keyword,"end_header")==0) {
+                break;
+            }
+
+            if (strcmp(keyword,"format")==0 && n>=2) {
+                if (strcmp(a,"binary_little_endian")==0) {
+                    valid=true;
+                    swap=!little_endian;
+                }
+                else if (strcmp(a,"binary_big_endian")==0) {
+                    valid=true;
+                    swap=little_endian;
+                }
+            }
+            else if (strcmp(keyword,"element")==0 && n>=3) {
+                int i=elements.getSize();
+                elements.setSize(i+1);
+                PLYElement& e=elements[i];
+                strcpy(e.name,a);
+                e.count=atoi(b);
+            }
+            else if (strcmp(keyword,"property")==0 && n>=3 && elements.getSize()>0) {
+                PLYProperty p;
+                if (strcmp(a,"list")==0 && n>=4) {
+                    p.count=getPLYType(b);
+                    p.type=getPLYType(c);
+                    sscanf(line,"%*s %*s %*s %*s %31s",p.name);
+                    valid=valid && p.count!=PLY_INVALID;
+                }
+                else {
+                    p.count=PLY_INVALID;
+                    p.type=getPLYType(a);
+                    strcpy(p.name,b);
+                }
+                valid=valid && p.type!=PLY_INVALID;
+                elements.last().properties.insert(p);
+            }
+        }
+    }
+
+    if (!valid) {
+        fclose(file);
+        return NULL;
+    }
+
+    // Faces may precede the vertices, so get their number from the header.
+    int vertices=0;
+    for (int ei=0;ei<elements.getSize();++ei) {
+        if (strcmp(elements[ei].name,"vertex")==0) {
+            vertices=elements[ei].count;
+        }
+    }
+
+    Mesh* mesh=new Mesh;
+    IndexArray offsets(1),indices;
+    offsets[0]=0;
+
+    for (int ei=0;ei<elements.getSize() && valid;++ei) {
+        PLYElement const& e=elements[ei];
+        int stride=e.getStride();
+
+        if (strcmp(e.name,"vertex")==0) {
+            PLYVertexContext context;
+            context.swap=swap;
+            context.stride=stride;
+
+            // Determine the offsets of the position coordinates in a record.
+            static char const* const NAMES[]={"x","y","z"};
+            for (int k=0;k<3;++k) {
+                int pi=e.find(NAMES[k]);
+                if (stride==0 || pi<0) {
+                    valid=false;
+                    break;
+                }
+
+                context.types[k]=e.properties[pi].type;
+                context.offsets[k]=0;
+                for (int i=0;i<pi;++i) {
+                    context.offsets[k]+=getPLYSize(e.properties[i].type);
+                }
+            }
+
+            if (!valid) {
+                break;
+            }
+
+            mesh->vertices.setSize(e.count);
+            mesh->neighbors.setSize(e.count);
+
+            // Convert as many whole records as fit into a block concurrently.
+            int records=max(BLOCK_SIZE/stride,1);
+            for (int vi=0;vi<e.count;vi+=records) {
+                int count=min(records,e.count-vi);
+
+                context.data=reader.request(count*stride);
+                if (!context.data) {
+                    valid=false;
+                    break;
+                }
+
+                context.vertices=mesh->vertices+vi;
+                Parallel::run(convertPLYVerticesKernel,&context,count,threads,GRAIN_SIZE/stride+1);
+
+                reader.consume(count*stride);
+            }
+        }
+        else {
+            bool face=(strcmp(e.name,"face")==0);
+
+            int pi=e.find("vertex_indices");
+            if (pi<0) {
+                pi=e.find("vertex_index");
+            }
+
+            if (face) {
+                offsets.setCapacity(e.count+1);
+                indices.setCapacity(e.count*3);
+            }
+
+            // Faces have variable-size records, so parse them sequentially.
+            for (int r=0;r<e.count && valid;++r) {
+                for (int i=0;i<e.properties.getSize();++i) {
+                    PLYProperty const& p=e.properties[i];
+                    int size=getPLYSize(p.type);
+
+                    if (p.count==PLY_INVALID) {
+                        if (!reader.request(size)) {
+                            valid=false;
+                            break;
+                        }
+                        reader.consume(size);
+                        continue;
+                    }
+
+                    unsigned char const* data=reader.request(getPLYSize(p.count));
+                    if (!data) {
+                        valid=false;
+                        break;
+                    }
+
+                    // Reject negative counts and those whose size overflows.
+                    double n=readPLYValue(data,p.count,swap);
+                    if (n<0 || n>Numerics<int>::MAX()/size) {
+                        valid=false;
+                        break;
+                    }
+
+                    int count=static_cast<int>(n);
+                    reader.consume(getPLYSize(p.count));
+
+                    data=reader.request(count*size);
+                    if (!data) {
+                        valid=false;
+                        break;
+                    }
+
+                    // Skip degenerate faces.
+                    if (face && i==pi && count>=3) {
+                        // Check the range before converting to avoid undefined
+                        // behavior for malformed files.
+                        for (int k=0;k<count && valid;++k) {
+                            double v=readPLYValue(data+k*size,p.type,swap);
+                            if (v<0 || v>=vertices) {
+                                valid=false;
+                            }
+                            else {
+                                indices.insert(static_cast<unsigned int>(v));
+                            }
+                        }
+                        if (!valid) {
+                            break;
+                        }
+                        offsets.insert(indices.getSize());
+                    }
+
+                    reader.consume(count*size);
+                }
+            }
+        }
+    }
+
+    fclose(file);
+
+    if (!valid) {
+        delete mesh;
+        return NULL;
+    }
+
+    assignNeighbors(*mesh,offsets,indices,threads);
+    return mesh;
+}
+
+#endif // GALE_TINY_CODE
+
+} // namespace model
+
+} // namespace gale
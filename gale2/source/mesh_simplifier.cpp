@@ -0,0 +1,486 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/model/mesh.h"
+
+using namespace gale::global;
+using namespace gale::math;
+
+namespace gale {
+
+namespace model {
+
+namespace {
+
+// Symmetric 4x4 matrix of a quadric error metric, only the upper triangle is
+// stored in row-major order.
+struct Quadric
+{
+    Quadric() {
+        memset(q,0,sizeof(q));
+    }
+
+    // Adds the quadric of the plane with unit normal n and distance d, weighted
+    // by w.
+    void addPlane(Vec3d const& n,double const d,double const w) {
+        double a=n.getX(),b=n.getY(),c=n.getZ();
+
+        q[0]+=w*a*a; q[1]+=w*a*b; q[2]+=w*a*c; q[3]+=w*a*d;
+                     q[4]+=w*b*b; q[5]+=w*b*c; q[6]+=w*b*d;
+                                  q[7]+=w*c*c; q[8]+=w*c*d;
+                                               q[9]+=w*d*d;
+    }
+
+    Quadric& operator+=(Quadric const& other) {
+        for (int i=0;i<10;++i) {
+            q[i]+=other.q[i];
+        }
+        return *this;
+    }
+
+    // Returns the squared distance of v to the planes, weighted by their areas.
+    double error(Vec3d const& v) const {
+        double x=v.getX(),y=v.getY(),z=v.getZ();
+        return x*(q[0]*x+2*(q[1]*y+q[2]*z+q[3]))
+             + y*(q[4]*y+2*(q[5]*z+q[6]))
+             + z*(q[7]*z+2*q[8])
+             + q[9];
+    }
+
+    // Calculates the position v of the least error, returns false if it is not
+    // well-defined, e.g. for flat regions.
+    bool minimize(Vec3d& v) const {
+        // Solve the linear system using the cofactors of the symmetric matrix.
+        double c00=q[4]*q[7]-q[5]*q[5];
+        double c01=q[2]*q[5]-q[1]*q[7];
+        double c02=q[1]*q[5]-q[2]*q[4];
+        double c11=q[0]*q[7]-q[2]*q[2];
+        double c12=q[1]*q[2]-q[0]*q[5];
+        double c22=q[0]*q[4]-q[1]*q[1];
+
+        double det=q[0]*c00+q[1]*c01+q[2]*c02;
+
+        // Compare against the cubed mean of the eigenvalues.
+        double trace=(q[0]+q[4]+q[7])/3;
+        if (abs(det)<=1e-6*trace*trace*trace) {
+            return false;
+        }
+
+        double bx=-q[3],by=-q[6],bz=-q[8];
+
+        v.setX((c00*bx+c01*by+c02*bz)/det);
+        v.setY((c01*bx+c11*by+c12*bz)/det);
+        v.setZ((c02*bx+c12*by+c22*bz)/det);
+
+        return true;
+    }
+
+    double q[10];
+};
+
+// Candidate for an edge collapse in the priority queue. It is outdated if any
+// of the vertices has changed since it was queued.
+struct Collapse
+{
+    double cost;
+    int ai,bi;
+    int stamp_a,stamp_b;
+    Vec3f position;
+};
+
+// Inserts the collapse c into the binary min-heap.
+void push(DynamicArray<Collapse>& heap,Collapse const& c)
+{
+    int i=heap.insert(c);
+
+    while (i>0) {
+        int parent=(i-1)/2;
+        if (heap[parent].cost<=c.cost) {
+            break;
+        }
+
+        heap[i]=heap[parent];
+        i=parent;
+    }
+
+    heap[i]=c;
+}
+
+// Removes the collapse of the least cost from the binary min-heap.
+Collapse pop(DynamicArray<Collapse>& heap)
+{
+    Collapse top=heap.first();
+    Collapse c=heap.last();
+    heap.remove();
+
+    int n=heap.getSize();
+    if (n==0) {
+        return top;
+    }
+
+    int i=0;
+    for (;;) {
+        int child=i*2+1;
+        if (child>=n) {
+            break;
+        }
+
+        if (child+1<n && heap[child+1].cost<heap[child].cost) {
+            ++child;
+        }
+
+        if (c.cost<=heap[child].cost) {
+            break;
+        }
+
+        heap[i]=heap[child];
+        i=child;
+    }
+
+    heap[i]=c;
+
+    return top;
+}
+
+// Shared state of the simplification.
+struct Simplification
+{
+    Simplification(Mesh& mesh)
+    :   mesh(mesh)
+    ,   quadrics(mesh.vertices.getSize())
+    ,   stamps(mesh.vertices.getSize())
+    ,   locked(mesh.vertices.getSize())
+    ,   collapsed(mesh.vertices.getSize())
+    {
+        int n=mesh.vertices.getSize();
+
+        memset(stamps,0,n*sizeof(int));
+        memset(locked,0,n*sizeof(bool));
+        memset(collapsed,0,n*sizeof(bool));
+    }
+
+    // Queues the collapse of bi into ai at the position of the least error.
+    void queue(int const ai,int const bi) {
+        Quadric q=quadrics[ai];
+        q+=quadrics[bi];
+
+        Vec3d a(mesh.vertices[ai]),b(mesh.vertices[bi]);
+
+        // Fall back to the end points and the edge center if there is no
+        // unique optimum.
+        Vec3d candidates[4]={a,b,(a+b)*0.5};
+        int count=3;
+        if (q.minimize(candidates[3])) {
+            count=4;
+        }
+
+        Collapse c;
+        c.cost=-1;
+
+        for (int i=0;i<count;++i) {
+            double e=q.error(candidates[i]);
+            if (c.cost<0 || e<c.cost) {
+                c.cost=e;
+                c.position=Vec3f(candidates[i]);
+            }
+        }
+
+        // Clamp rounding errors.
+        c.cost=max(c.cost,0.0);
+
+        c.ai=ai;
+        c.bi=bi;
+        c.stamp_a=stamps[ai];
+        c.stamp_b=stamps[bi];
+
+        push(heap,c);
+    }
+
+    // Returns whether the wedges around vi, which do not include xi, keep
+    // their orientation if vi is moved to position.
+    bool keepsOrientation(int const vi,int const xi,Vec3f const& position) const {
+        Mesh::IndexArray const& vn=mesh.neighbors[vi];
+        Vec3f const& v=mesh.vertices[vi];
+
+        for (int i=0;i<vn.getSize();++i) {
+            int ri=vn[i],si=vn[i+1<vn.getSize()?i+1:0];
+            if (ri==xi || si==xi) {
+                continue;
+            }
+
+            Vec3f const& r=mesh.vertices[ri];
+            Vec3f const& s=mesh.vertices[si];
+
+            Vec3f before=(r-v)^(s-v);
+            Vec3f after=(r-position)^(s-position);
+            if (before%after<=0) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Returns whether bi can be collapsed into ai at position without changing
+    // the topology or flipping faces.
+    bool isValid(Collapse const& c) {
+        int ai=c.ai,bi=c.bi;
+
+        if (locked[ai] || locked[bi]) {
+            return false;
+        }
+
+        // Get the apexes of the triangles adjacent to the edge, if any.
+        int o=mesh.orbit(ai,bi,polygon);
+        int ci=o==3?static_cast<int>(polygon[2]):-1;
+
+        o=mesh.orbit(bi,ai,polygon);
+        int di=o==3?static_cast<int>(polygon[2]):-1;
+
+        if (ci>=0 && ci==di) {
+            return false;
+        }
+
+        // The apexes must keep at least 3 neighbors.
+        if ((ci>=0 && mesh.neighbors[ci].getSize()<=3) || (di>=0 && mesh.neighbors[di].getSize()<=3)) {
+            return false;
+        }
+
+        Mesh::IndexArray const& an=mesh.neighbors[ai];
+        Mesh::IndexArray const& bn=mesh.neighbors[bi];
+
+        int valence=an.getSize()+bn.getSize()-2-int(ci>=0)-int(di>=0);
+        if (valence<3) {
+            return false;
+        }
+
+        // Any other common neighbor would make the mesh non-manifold.
+        for (int i=0;i<an.getSize();++i) {
+            int ri=an[i];
+            if (ri!=bi && ri!=ci && ri!=di && bn.find(ri)>=0) {
+                return false;
+            }
+        }
+
+        return keepsOrientation(ai,bi,c.position) && keepsOrientation(bi,ai,c.position);
+    }
+
+    // Collapses bi into ai and merges their neighborhoods.
+    void collapse(Collapse const& c) {
+        int ai=c.ai,bi=c.bi;
+
+        Mesh::IndexArray& an=mesh.neighbors[ai];
+        Mesh::IndexArray& bn=mesh.neighbors[bi];
+
+        // Get the neighbors of bi following ai up to preceding ai.
+        int n=an.find(bi),m=bn.find(ai),k=bn.getSize();
+
+        polygon.clear();
+        for (int i=1;i<k;++i) {
+            polygon.insert(bn[(m+i)%k]);
+        }
+
+        // The apexes of adjacent triangles already are neighbors of ai.
+        unsigned int prev=an[n>0?n-1:an.getSize()-1];
+        unsigned int next=an[n+1<an.getSize()?n+1:0];
+
+        if (polygon.getSize()>0 && polygon.first()==prev) {
+            polygon.remove(0);
+        }
+        if (polygon.getSize()>0 && polygon.last()==next) {
+            polygon.remove(-1);
+        }
+
+        // Replace bi with its remaining neighbors in order.
+        an.remove(n);
+        an.insert(polygon,n);
+
+        // In the neighborhoods of bi's neighbors, replace bi with ai, or just
+        // remove it if ai already is a neighbor.
+        for (int i=0;i<k;++i) {
+            int ri=bn[i];
+            if (ri==ai) {
+                continue;
+            }
+
+            Mesh::IndexArray& rn=mesh.neighbors[ri];
+            int j=rn.find(bi);
+            if (rn.find(ai)>=0) {
+                rn.remove(j);
+            }
+            else {
+                rn[j]=ai;
+            }
+        }
+
+        bn.clear();
+
+        mesh.vertices[ai]=c.position;
+        quadrics[ai]+=quadrics[bi];
+
+        collapsed[bi]=true;
+        ++stamps[ai];
+    }
+
+    Mesh& mesh;
+
+    DynamicArray<Quadric> quadrics;
+    DynamicArray<int> stamps;
+    DynamicArray<bool> locked;
+    DynamicArray<bool> collapsed;
+
+    DynamicArray<Collapse> heap;
+
+    Mesh::IndexArray polygon;
+};
+
+} // namespace
+
+int Mesh::Simplifier::EdgeCollapse(Mesh& mesh,int const triangles)
+{
+    Simplification s(mesh);
+
+    Mesh::IndexArray& polygon=s.polygon;
+    int n=mesh.vertices.getSize(),count=0;
+
+    // Sum up the quadrics of the faces around each vertex, and count the
+    // faces' triangles.
+    for (int vi=0;vi<n;++vi) {
+        Mesh::IndexArray const& vn=mesh.neighbors[vi];
+
+        if (vn.getSize()<3) {
+            // Keep points, lines and other degenerate neighborhoods.
+            s.locked[vi]=true;
+        }
+
+        for (int i=0;i<vn.getSize();++i) {
+            int o=mesh.orbit(vi,vn[i],polygon);
+            if (o<3 || o>5) {
+                // Like PreparedMesh, only triangular to pentagonal faces are
+                // supported. Keep vertices at other faces, e.g. at boundaries.
+                s.locked[vi]=true;
+                continue;
+            }
+
+            // Visit each face only once, at its vertex of the lowest index.
+            int f=1;
+            while (f<o && polygon[f]>static_cast<unsigned int>(vi)) {
+                ++f;
+            }
+            if (f<o) {
+                continue;
+            }
+
+            count+=o-2;
+
+            // Calculate the normal and area using Newell's method.
+            Vec3d v(mesh.vertices[vi]),normal=Vec3d::ZERO();
+            Vec3d a=Vec3d(mesh.vertices[polygon[1]])-v;
+            for (f=2;f<o;++f) {
+                Vec3d b=Vec3d(mesh.vertices[polygon[f]])-v;
+                normal+=a^b;
+                a=b;
+            }
+
+            double area=normal.normalize()*0.5;
+            if (area<=0) {
+                continue;
+            }
+
+            Quadric q;
+            q.addPlane(normal,-(normal%v),area);
+
+            for (f=0;f<o;++f) {
+                s.quadrics[polygon[f]]+=q;
+            }
+        }
+    }
+
+    // Queue each edge once.
+    for (int vi=0;vi<n;++vi) {
+        Mesh::IndexArray const& vn=mesh.neighbors[vi];
+        for (int i=0;i<vn.getSize();++i) {
+            if (static_cast<unsigned int>(vi)<vn[i]) {
+                s.queue(vi,vn[i]);
+            }
+        }
+    }
+
+    // Collapse the edges of the least error first. Each collapse removes one
+    // vertex from both faces adjacent to the edge, i.e. two triangles.
+    while (count>triangles && s.heap.getSize()>0) {
+        Collapse c=pop(s.heap);
+
+        if (s.collapsed[c.ai] || s.collapsed[c.bi] || c.stamp_a!=s.stamps[c.ai] || c.stamp_b!=s.stamps[c.bi]) {
+            continue;
+        }
+
+        if (!s.isValid(c)) {
+            continue;
+        }
+
+        s.collapse(c);
+        count-=2;
+
+        // The error of all edges at the merged vertex has changed.
+        Mesh::IndexArray const& an=mesh.neighbors[c.ai];
+        for (int i=0;i<an.getSize();++i) {
+            s.queue(c.ai,an[i]);
+        }
+    }
+
+    // Compact the vertices and map the neighborhoods to the new indices.
+    Mesh::IndexArray remap(n);
+    int m=0;
+
+    for (int vi=0;vi<n;++vi) {
+        if (s.collapsed[vi]) {
+            continue;
+        }
+
+        remap[vi]=m;
+        if (m<vi) {
+            mesh.vertices[m]=mesh.vertices[vi];
+            mesh.neighbors[m].swap(mesh.neighbors[vi]);
+        }
+        ++m;
+    }
+
+    mesh.vertices.setSize(m);
+    mesh.neighbors.setSize(m);
+
+    for (int vi=0;vi<m;++vi) {
+        Mesh::IndexArray& vn=mesh.neighbors[vi];
+        for (int i=0;i<vn.getSize();++i) {
+            vn[i]=remap[vn[i]];
+        }
+    }
+
+    return count;
+}
+
+} // namespace model
+
+} // namespace gale
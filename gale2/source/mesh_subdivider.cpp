@@ -25,6 +25,8 @@
 
 #include "gale/model/mesh.h"
 
+#include "gale/math/expression.h"
+
 using namespace gale::math;
 
 namespace gale {
@@ -103,10 +105,12 @@ void Mesh::Subdivider::Butterfly(Mesh& mesh,int steps)
                     continue;
                 }
 
-                Vec3f x = v*0.5f + u*0.5f
-                        + ov[orig.nextTo(ui,vi)]   * 0.125f  + ov[orig.prevTo(ui,vi)]   * 0.125f
-                        - ov[orig.nextTo(ui,vi,2)] * 0.0625f - ov[orig.prevTo(ui,vi,2)] * 0.0625f
-                        - ov[orig.nextTo(vi,ui,2)] * 0.0625f - ov[orig.prevTo(vi,ui,2)] * 0.0625f;
+                // Evaluate the stencil as a single expression per component
+                // instead of creating a temporary vector for each operation.
+                Vec3f x = lazy(v)*0.5f + lazy(u)*0.5f
+                        + lazy(ov[orig.nextTo(ui,vi)])   * 0.125f  + lazy(ov[orig.prevTo(ui,vi)])   * 0.125f
+                        - lazy(ov[orig.nextTo(ui,vi,2)]) * 0.0625f - lazy(ov[orig.prevTo(ui,vi,2)]) * 0.0625f
+                        - lazy(ov[orig.nextTo(vi,ui,2)]) * 0.0625f - lazy(ov[orig.prevTo(vi,ui,2)]) * 0.0625f;
 
                 // Add a new vertex as the arithmetic average of its two neighbors.
                 mesh.insert(ui,vi,x);
@@ -156,9 +160,9 @@ void Mesh::Subdivider::Loop(Mesh& mesh,int steps,bool const move)
                     continue;
                 }
 
-                Vec3f x = v*0.375f + u*0.375f
-                        + ov[orig.nextTo(ui,vi)]*0.125f
-                        + ov[orig.prevTo(ui,vi)]*0.125f;
+                Vec3f x = lazy(v)*0.375f + lazy(u)*0.375f
+                        + lazy(ov[orig.nextTo(ui,vi)])*0.125f
+                        + lazy(ov[orig.prevTo(ui,vi)])*0.125f;
 
                 // Add a new vertex as calculated from its neighbors.
                 mesh.insert(ui,vi,x);
@@ -221,7 +225,7 @@ void Mesh::Subdivider::Sqrt3(Mesh& mesh,int steps,bool const move)
                 }
 
                 // Insert a new vertex at the base mesh's face center.
-                Vec3f c=(v+u+t)/3.0f;
+                Vec3f c=(lazy(v)+u+t)/3.0f;
                 int ci=mesh.vertices.insert(c);
 
                 // Connect the new vertex to the face vertices.
@@ -0,0 +1,340 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/model/mesh.h"
+#include "gale/system/parallel.h"
+
+using namespace gale::global;
+using namespace gale::math;
+using namespace gale::system;
+
+namespace gale {
+
+namespace model {
+
+namespace {
+
+/*
+ * Spatial hashing
+ */
+
+// Arguments for welding a range of vertices.
+struct WeldContext
+{
+    Mesh const* mesh;
+
+    float scale;        // Reciprocal of the cell size.
+    float tolerance;    // Squared welding distance.
+    unsigned int mask;  // Number of buckets minus one.
+
+    Mesh::IndexArray buckets; // Bucket of each vertex.
+    Mesh::IndexArray first;   // Start of each bucket in the entries.
+    Mesh::IndexArray entries; // Vertices sorted by bucket.
+
+    Mesh::IndexArray map;     // Lowest coincident vertex of each vertex.
+    Mesh::IndexArray index;   // New index of each vertex.
+    Mesh::IndexArray members; // Start of each new vertex in the clusters.
+    Mesh::IndexArray clusters;// Old vertices sorted by new vertex.
+
+    Mesh::IndexTable neighbors; // Merged neighborhoods.
+};
+
+// Returns the integer coordinates of the cell containing v.
+inline void cellOf(Vec3f const& v,float const scale,int& x,int& y,int& z)
+{
+    x=static_cast<int>(floor(v.getX()*scale));
+    y=static_cast<int>(floor(v.getY()*scale));
+    z=static_cast<int>(floor(v.getZ()*scale));
+}
+
+// Returns the bucket of the cell at the given integer coordinates.
+inline unsigned int bucketOf(int const x,int const y,int const z,unsigned int const mask)
+{
+    unsigned int h=(x*73856093U)^(y*19349663U)^(z*83492791U);
+
+    // Mix the high bits into the low ones, as regular grids of vertices
+    // otherwise collide heavily after masking.
+    h^=h>>16;
+    h*=0x45d9f3bU;
+    h^=h>>16;
+
+    return h&mask;
+}
+
+void hashVerticesKernel(void* context,int /*chunk*/,int begin,int end)
+{
+    WeldContext* c=static_cast<WeldContext*>(context);
+
+    for (int i=begin;i<end;++i) {
+        int x,y,z;
+        cellOf(c->mesh->vertices[i],c->scale,x,y,z);
+        c->buckets[i]=bucketOf(x,y,z,c->mask);
+    }
+}
+
+void matchVerticesKernel(void* context,int /*chunk*/,int begin,int end)
+{
+    WeldContext* c=static_cast<WeldContext*>(context);
+    Mesh::VectorArray const& vertices=c->mesh->vertices;
+
+    // Coincident vertices share the same cell when welding exactly.
+    int const sides=c->tolerance>0 ? 2 : 1;
+
+    for (int i=begin;i<end;++i) {
+        Vec3f const& v=vertices[i];
+
+        int x,y,z;
+        cellOf(v,c->scale,x,y,z);
+
+        // As the cells are twice as large as the welding distance, coincident
+        // vertices can only be located in this cell or in the adjacent cells
+        // towards the nearest cell corner.
+        int sx=(v.getX()*c->scale-x<0.5f) ? -1 : 1;
+        int sy=(v.getY()*c->scale-y<0.5f) ? -1 : 1;
+        int sz=(v.getZ()*c->scale-z<0.5f) ? -1 : 1;
+
+        // Map the vertex to the lowest coincident index, which makes the
+        // result independent of the number of threads.
+        unsigned int match=i;
+
+        for (int dz=0;dz<sides;++dz) {
+            for (int dy=0;dy<sides;++dy) {
+                for (int dx=0;dx<sides;++dx) {
+                    unsigned int b=bucketOf(x+dx*sx,y+dy*sy,z+dz*sz,c->mask);
+                    for (unsigned int e=c->first[b];e<c->first[b+1];++e) {
+                        unsigned int j=c->entries[e];
+                        if (j<match && (vertices[j]-v).length2()<=c->tolerance) {
+                            match=j;
+                        }
+                    }
+                }
+            }
+        }
+
+        c->map[i]=match;
+    }
+}
+
+/*
+ * Neighborhood merging
+ */
+
+// Appends those items of the ring to the result that it does not contain yet,
+// starting after the given position in the ring.
+void appendRing(Mesh::IndexArray& result,Mesh::IndexArray const& ring,int const start)
+{
+    int n=ring.getSize();
+    for (int k=1;k<=n;++k) {
+        unsigned int x=ring[(start+k)%n];
+        if (result.find(x)<0) {
+            result.insert(x);
+        }
+    }
+}
+
+// Prepends those items of the ring to the result that it does not contain yet,
+// ending before the given position in the ring.
+void prependRing(Mesh::IndexArray& result,Mesh::IndexArray const& ring,int const end)
+{
+    int n=ring.getSize(),at=0;
+    for (int k=1;k<=n;++k) {
+        unsigned int x=ring[(end+k)%n];
+        if (result.find(x)<0) {
+            result.insert(x,at++);
+        }
+    }
+}
+
+void mergeNeighborsKernel(void* context,int /*chunk*/,int begin,int end)
+{
+    WeldContext* c=static_cast<WeldContext*>(context);
+
+    Mesh::IndexTable rings;
+    Mesh::IndexArray ring;
+
+    for (int vi=begin;vi<end;++vi) {
+        Mesh::IndexArray& result=c->neighbors[vi];
+        result.clear();
+
+        // Remap the neighborhoods of all coincident vertices, dropping
+        // references to the welded vertex itself and repeated neighbors.
+        rings.clear();
+        for (unsigned int m=c->members[vi];m<c->members[vi+1];++m) {
+            Mesh::IndexArray const& vn=c->mesh->neighbors[c->clusters[m]];
+
+            ring.clear();
+            for (int k=0;k<vn.getSize();++k) {
+                unsigned int x=c->index[vn[k]];
+                if (x!=static_cast<unsigned int>(vi) && ring.find(x)<0) {
+                    ring.insert(x);
+                }
+            }
+
+            if (ring.getSize()>0) {
+                rings.insert(ring);
+            }
+        }
+
+        if (rings.getSize()==0) {
+            continue;
+        }
+
+        result=rings.last();
+        rings.remove();
+
+        // Each ring of a split vertex is an open fan. Join the fans at their
+        // common boundary neighbors to restore the order around the vertex.
+        while (rings.getSize()>0) {
+            int r=0,k=-1;
+            bool after=true;
+
+            for (r=0;r<rings.getSize();++r) {
+                k=rings[r].find(result.last());
+                if (k>=0) {
+                    break;
+                }
+                k=rings[r].find(result.first());
+                if (k>=0) {
+                    after=false;
+                    break;
+                }
+            }
+
+            if (r==rings.getSize()) {
+                // The fans do not connect, so the vertex is non-manifold.
+                // Simply chain them, which at least keeps all neighbors.
+                r=rings.getSize()-1;
+                k=rings[r].getSize()-1;
+            }
+
+            if (after) {
+                appendRing(result,rings[r],k);
+            }
+            else {
+                prependRing(result,rings[r],k);
+            }
+
+            rings.remove(r);
+        }
+    }
+}
+
+} // namespace
+
+int Mesh::weld(float const epsilon,int const threads)
+{
+    int n=vertices.getSize();
+    if (n==0) {
+        return 0;
+    }
+
+    WeldContext context;
+    context.mesh=this;
+
+    // Cells twice as large as the welding distance keep the number of
+    // vertices per cell small while guaranteeing that coincident vertices are
+    // in adjacent cells. For exact welding use unit cells.
+    float size=epsilon>0 ? 2*epsilon : 1.0f;
+    context.scale=1.0f/size;
+    context.tolerance=epsilon>0 ? epsilon*epsilon : 0.0f;
+
+    unsigned int buckets=ceilPow2(max(2*n,16));
+    context.mask=buckets-1;
+
+    // Hash the vertices to buckets, which is the expensive part for large
+    // meshes and trivially parallel.
+    context.buckets.setSize(n);
+    Parallel::run(hashVerticesKernel,&context,n,threads,16384);
+
+    // Sort the vertices by bucket using a counting sort, keeping them in
+    // ascending order within each bucket.
+    context.first.setSize(buckets+1);
+    memset(context.first,0,(buckets+1)*sizeof(IndexArray::Type));
+    for (int i=0;i<n;++i) {
+        ++context.first[context.buckets[i]+1];
+    }
+    for (unsigned int b=0;b<buckets;++b) {
+        context.first[b+1]+=context.first[b];
+    }
+
+    context.entries.setSize(n);
+    IndexArray fill(context.first);
+    for (int i=0;i<n;++i) {
+        context.entries[fill[context.buckets[i]]++]=i;
+    }
+
+    // Find the coincident vertices.
+    context.map.setSize(n);
+    Parallel::run(matchVerticesKernel,&context,n,threads,4096);
+
+    // Collapse chains of matches so that each vertex maps to the first vertex
+    // of its cluster, then assign new indices in order of these first vertices.
+    context.index.setSize(n);
+    int count=0;
+    for (int i=0;i<n;++i) {
+        unsigned int& m=context.map[i];
+        m=context.map[m];
+        context.index[i]=(m==static_cast<unsigned int>(i)) ? count++ : context.index[m];
+    }
+
+    if (count==n) {
+        return 0;
+    }
+
+    // Group the old vertices by their new index.
+    context.members.setSize(count+1);
+    memset(context.members,0,(count+1)*sizeof(IndexArray::Type));
+    for (int i=0;i<n;++i) {
+        ++context.members[context.index[i]+1];
+    }
+    for (int k=0;k<count;++k) {
+        context.members[k+1]+=context.members[k];
+    }
+
+    context.clusters.setSize(n);
+    fill=context.members;
+    for (int i=0;i<n;++i) {
+        context.clusters[fill[context.index[i]]++]=i;
+    }
+
+    // The new neighborhoods only depend on the old ones, so they can be merged
+    // concurrently.
+    context.neighbors.setSize(count);
+    Parallel::run(mergeNeighborsKernel,&context,count,threads,1024);
+
+    VectorArray welded(count);
+    for (int k=0;k<count;++k) {
+        welded[k]=vertices[context.clusters[context.members[k]]];
+    }
+
+    vertices.swap(welded);
+    neighbors.swap(context.neighbors);
+
+    return n-count;
+}
+
+} // namespace model
+
+} // namespace gale
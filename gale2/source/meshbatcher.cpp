@@ -0,0 +1,153 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/wrapgl/meshbatcher.h"
+
+#include "gale/math/batch.h"
+
+using namespace gale::global;
+using namespace gale::math;
+using namespace gale::model;
+
+namespace gale {
+
+namespace wrapgl {
+
+int MeshBatcher::add(PreparedMesh const& prep,HMat4f const* transform)
+{
+    return add(prep.m_vertices,prep.m_normals,prep.m_primitives,prep.m_polygons,transform);
+}
+
+int MeshBatcher::add(
+    Mesh::VectorArray const& vertices
+,   Mesh::VectorArray const& normals
+,   Mesh::IndexTable const& primitives
+,   Mesh::IndexTable const& polygons
+,   HMat4f const* transform
+)
+{
+    int offset=m_vertices.getSize(),n=vertices.getSize();
+
+    Submesh s;
+    s.vertices.begin=offset;
+    s.vertices.end=offset+n;
+
+    m_vertices.setSize(offset+n);
+    m_normals.setSize(offset+n);
+
+    bool mirrored=false;
+
+    if (transform) {
+        HMat4f const& m=*transform;
+
+        // A negative determinant means the transform mirrors the mesh.
+        mirrored=m.c0%(m.c1^m.c2)<0;
+
+        transformPoints(m,vertices,&m_vertices[offset],n);
+        transformNormals(m,normals,&m_normals[offset],n);
+    }
+    else if (n>0) {
+        memcpy(&m_vertices[offset],vertices,n*sizeof(Mesh::VectorArray::Type));
+        memcpy(&m_normals[offset],normals,n*sizeof(Mesh::VectorArray::Type));
+    }
+
+    // Extend the bounding box.
+    Vec3f min,max;
+    if (minMaxAll(&m_vertices[offset],n,min,max)) {
+        if (offset==0) {
+            box.min=min;
+            box.max=max;
+        }
+        else {
+            box.min=box.min.minElements(min);
+            box.max=box.max.maxElements(max);
+        }
+    }
+
+    // Append the primitives with their indices rebased to the merged vertices.
+    Range* ranges[PRIMITIVE_TYPES]={&s.points,&s.lines,&s.triangles,&s.quads};
+
+    for (int t=0;t<PRIMITIVE_TYPES;++t) {
+        Mesh::IndexArray const& in=primitives[t];
+        Mesh::IndexArray& out=m_primitives[t];
+
+        int begin=out.getSize(),count=in.getSize();
+        ranges[t]->begin=begin;
+        ranges[t]->end=begin+count;
+
+        out.setSize(begin+count);
+        for (int i=0;i<count;++i) {
+            out[begin+i]=in[i]+offset;
+        }
+
+        // Reverse the winding of faces by swapping all but their first vertex.
+        int size=t+1;
+        if (mirrored && size>=3) {
+            for (int f=begin;f<begin+count;f+=size) {
+                for (int a=f+1,b=f+size-1;a<b;++a,--b) {
+                    unsigned int x=out[a];
+                    out[a]=out[b];
+                    out[b]=x;
+                }
+            }
+        }
+    }
+
+    s.polygons.begin=m_polygons.getSize();
+    s.polygons.end=s.polygons.begin+polygons.getSize();
+
+    m_polygons.setSize(s.polygons.end);
+    for (int p=0;p<polygons.getSize();++p) {
+        Mesh::IndexArray const& in=polygons[p];
+        Mesh::IndexArray& out=m_polygons[s.polygons.begin+p];
+
+        int size=in.getSize();
+        out.setSize(size);
+        for (int i=0;i<size;++i) {
+            out[i]=in[(mirrored && i>0) ? size-i : i]+offset;
+        }
+    }
+
+    return m_submeshes.insert(s);
+}
+
+void MeshBatcher::clear()
+{
+    m_vertices.clear();
+    m_normals.clear();
+
+    for (int t=0;t<PRIMITIVE_TYPES;++t) {
+        m_primitives[t].clear();
+    }
+    m_polygons.clear();
+
+    m_submeshes.clear();
+
+    box.min=box.max=Vec3f::ZERO();
+}
+
+} // namespace wrapgl
+
+} // namespace gale
@@ -0,0 +1,342 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/model/meshlets.h"
+#include "gale/model/plane.h"
+
+#include "gale/math/packet.h"
+
+using namespace gale::global;
+using namespace gale::math;
+
+namespace gale {
+
+namespace model {
+
+void Meshlets::build(Vec3f const* vertices,int const num_vertices,unsigned int const* indices,int const count,int const max_vertices,int const max_triangles)
+{
+    clear();
+
+    int triangles=count/3;
+    if (triangles<=0) {
+        return;
+    }
+
+    // Get the triangles around each vertex in a compact table.
+    Mesh::IndexArray first(num_vertices+1),adjacent(triangles*3);
+    memset(first,0,first.getSize()*sizeof(Mesh::IndexArray::Type));
+
+    for (int i=0;i<triangles*3;++i) {
+        ++first[indices[i]+1];
+    }
+    for (int i=0;i<num_vertices;++i) {
+        first[i+1]+=first[i];
+    }
+
+    Mesh::IndexArray cursor(first);
+    for (int i=0;i<triangles*3;++i) {
+        adjacent[cursor[indices[i]]++]=i/3;
+    }
+
+    // Stamp the vertices with the meshlet they were last added to, and the
+    // triangles with the meshlet they were last queued for.
+    DynamicArray<int> vertex_marks(num_vertices),triangle_marks(triangles);
+    memset(vertex_marks,0xff,num_vertices*sizeof(int));
+    memset(triangle_marks,0xff,triangles*sizeof(int));
+
+    DynamicArray<bool> emitted(triangles);
+    memset(emitted,0,triangles*sizeof(bool));
+
+    Mesh::IndexArray candidates;
+    Vec3f sum=Vec3f::ZERO();
+
+    int limit_vertices=max(max_vertices,3),limit_triangles=max(max_triangles,1);
+    int meshlet=0,meshlet_vertices=0,meshlet_triangles=0,seed=0;
+
+    m_indices.setCapacity(triangles*3);
+    m_offsets.insert(0);
+
+    for (int e=0;e<triangles;++e) {
+        // Choose the queued triangle that adds the fewest vertices, and among
+        // those the one closest to the meshlet's center to keep it compact.
+        int best=-1,best_added=4;
+        float best_distance=0;
+
+        Vec3f center=sum/static_cast<float>(max(meshlet_vertices,1));
+
+        for (int i=0;i<candidates.getSize();) {
+            int t=candidates[i];
+            if (emitted[t]) {
+                candidates[i]=candidates.last();
+                candidates.remove();
+                continue;
+            }
+
+            unsigned int const* f=&indices[t*3];
+
+            int added=0;
+            for (int k=0;k<3;++k) {
+                added+=vertex_marks[f[k]]!=meshlet;
+            }
+
+            if (added<=best_added) {
+                float distance=(vertices[f[0]]+vertices[f[1]]+vertices[f[2]]-center*3).length2();
+                if (added<best_added || distance<best_distance) {
+                    best=t;
+                    best_added=added;
+                    best_distance=distance;
+                }
+            }
+
+            ++i;
+        }
+
+        if (best<0) {
+            // Continue with the next triangle in order if the meshlet cannot
+            // grow any further.
+            while (emitted[seed]) {
+                ++seed;
+            }
+
+            best=seed;
+            best_added=0;
+            for (int k=0;k<3;++k) {
+                best_added+=vertex_marks[indices[best*3+k]]!=meshlet;
+            }
+        }
+
+        if (meshlet_vertices+best_added>limit_vertices || meshlet_triangles>=limit_triangles) {
+            // Start a new meshlet with the chosen triangle, which is adjacent
+            // to the previous meshlet.
+            m_offsets.insert(m_indices.getSize());
+
+            ++meshlet;
+            meshlet_vertices=meshlet_triangles=0;
+            sum=Vec3f::ZERO();
+
+            candidates.clear();
+        }
+
+        emitted[best]=true;
+        ++meshlet_triangles;
+
+        for (int k=0;k<3;++k) {
+            unsigned int vi=indices[best*3+k];
+            m_indices.insert(vi);
+
+            if (vertex_marks[vi]==meshlet) {
+                continue;
+            }
+
+            vertex_marks[vi]=meshlet;
+            ++meshlet_vertices;
+            sum+=vertices[vi];
+
+            // Queue the triangles around the new vertex.
+            for (unsigned int a=first[vi];a<first[vi+1];++a) {
+                int t=adjacent[a];
+                if (!emitted[t] && triangle_marks[t]!=meshlet) {
+                    triangle_marks[t]=meshlet;
+                    candidates.insert(t);
+                }
+            }
+        }
+    }
+
+    m_offsets.insert(m_indices.getSize());
+
+    bound(vertices);
+}
+
+void Meshlets::bound(Vec3f const* vertices)
+{
+    int n=m_offsets.getSize()-1;
+
+    m_boxes.setSize(n);
+    m_centers.setSize(n);
+    m_radii.setSize(n);
+    m_axes.setSize(n);
+    m_cutoffs.setSize(n);
+
+    for (int m=0;m<n;++m) {
+        unsigned int const* begin=&m_indices[m_offsets[m]];
+        unsigned int const* end=&m_indices[0]+m_offsets[m+1];
+
+        AABB& box=m_boxes[m];
+        box.min=box.max=vertices[*begin];
+
+        Vec3f axis=Vec3f::ZERO();
+
+        for (unsigned int const* i=begin;i<end;i+=3) {
+            Vec3f const& a=vertices[i[0]];
+            Vec3f const& b=vertices[i[1]];
+            Vec3f const& c=vertices[i[2]];
+
+            box.min=box.min.minElements(a).minElements(b).minElements(c);
+            box.max=box.max.maxElements(a).maxElements(b).maxElements(c);
+
+            Vec3f normal=(b-a)^(c-a);
+            if (normal.normalize()>0) {
+                axis+=normal;
+            }
+        }
+
+        // Enclose the vertices in a sphere around the box center.
+        Vec3f center=box.center();
+        float radius=0;
+
+        for (unsigned int const* i=begin;i<end;++i) {
+            radius=max(radius,static_cast<float>((vertices[*i]-center).length()));
+        }
+
+        m_centers[m]=center;
+        m_radii[m]=radius;
+
+        // Get the maximum angle between the cone axis and the face normals.
+        float cutoff=1;
+
+        if (axis.normalize()>0) {
+            float spread=1;
+
+            for (unsigned int const* i=begin;i<end;i+=3) {
+                Vec3f const& a=vertices[i[0]];
+                Vec3f normal=(vertices[i[1]]-a)^(vertices[i[2]]-a);
+                if (normal.normalize()>0) {
+                    spread=min(spread,normal%axis);
+                }
+            }
+
+            // If the normals span more than a half-space, the meshlet cannot be
+            // back-facing as a whole.
+            if (spread>0) {
+                cutoff=sqrt(1-spread*spread);
+            }
+        }
+
+        m_axes[m]=axis;
+        m_cutoffs[m]=cutoff;
+    }
+}
+
+void Meshlets::clear()
+{
+    m_indices.clear();
+    m_offsets.clear();
+
+    m_boxes.clear();
+    m_centers.clear();
+    m_radii.clear();
+    m_axes.clear();
+    m_cutoffs.clear();
+}
+
+int Meshlets::cull(HMat4f const& view,Mat4d const& projection,Mesh::IndexArray& visible) const
+{
+    visible.clear();
+
+    // Get the rows of the combined view and projection matrix to extract the
+    // frustum planes in object space.
+    double rows[4][4];
+    for (int r=0;r<4;++r) {
+        for (int c=0;c<4;++c) {
+            rows[r][c]=0;
+            for (int k=0;k<4;++k) {
+                rows[r][c]+=projection[k*4+r]*view[c*4+k];
+            }
+        }
+    }
+
+    // All frustum planes face inwards.
+    Plane planes[6];
+    for (int i=0;i<3;++i) {
+        double const* a=rows[i];
+        double const* w=rows[3];
+
+        planes[i*2  ]=Plane(Vec3d(w[0]+a[0],w[1]+a[1],w[2]+a[2]),w[3]+a[3]);
+        planes[i*2+1]=Plane(Vec3d(w[0]-a[0],w[1]-a[1],w[2]-a[2]),w[3]-a[3]);
+    }
+
+    Vec3f eye=(!view).getPositionVector();
+
+    // Test packets of meshlets against all planes and their normal cones at
+    // once, and only handle the remaining meshlets one by one.
+    Vec3fx4 normals[6];
+    Packet4f distances[6];
+    for (int p=0;p<6;++p) {
+        normals[p]=Vec3fx4(Vec3f(planes[p].getNormal()));
+        distances[p]=static_cast<float>(planes[p].getDistance());
+    }
+
+    Vec3fx4 eyes(eye);
+
+    int m=0;
+    for (;m+Vec3fx4::Lanes<=getSize();m+=Vec3fx4::Lanes) {
+        Vec3fx4 centers=Vec3fx4::load(&m_centers[m]);
+        Packet4f radii=Packet4f::load(&m_radii[m]);
+
+        Mask4 inside=centers%normals[0]+distances[0]>=-radii;
+        for (int p=1;p<6;++p) {
+            inside=inside&(centers%normals[p]+distances[p]>=-radii);
+        }
+
+        Vec3fx4 directions=centers-eyes;
+        Mask4 back=directions%Vec3fx4::load(&m_axes[m])>=Packet4f::load(&m_cutoffs[m])*directions.length()+radii;
+
+        int bits=(inside&~back).bits();
+        for (int i=0;i<Vec3fx4::Lanes;++i) {
+            if (bits&(1<<i)) {
+                visible.insert(m+i);
+            }
+        }
+    }
+
+    for (;m<getSize();++m) {
+        Vec3f const& center=m_centers[m];
+        float radius=m_radii[m];
+
+        int p=0;
+        while (p<6 && planes[p].distanceTo(center)>=-radius) {
+            ++p;
+        }
+        if (p<6) {
+            continue;
+        }
+
+        // All triangles are back-facing if all directions from the eye to the
+        // bounding sphere are within 90 degrees of all normals in the cone.
+        Vec3f direction=center-eye;
+        if (direction%m_axes[m]>=m_cutoffs[m]*direction.length()+radius) {
+            continue;
+        }
+
+        visible.insert(m);
+    }
+
+    return visible.getSize();
+}
+
+} // namespace model
+
+} // namespace gale
@@ -0,0 +1,161 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/system/parallel.h"
+
+#ifdef G_OS_LINUX
+    #include <pthread.h>
+#endif
+
+namespace gale {
+
+namespace system {
+
+namespace {
+
+// Arguments passed to a thread for processing a single chunk.
+struct Task
+{
+    Parallel::Kernel kernel;
+    void* context;
+    int chunk,begin,end;
+};
+
+#ifdef G_OS_LINUX
+
+void* runTask(void* param)
+{
+    Task const* task=static_cast<Task const*>(param);
+    task->kernel(task->context,task->chunk,task->begin,task->end);
+    return NULL;
+}
+
+#elif defined G_OS_WINDOWS
+
+DWORD WINAPI runTask(LPVOID param)
+{
+    Task const* task=static_cast<Task const*>(param);
+    task->kernel(task->context,task->chunk,task->begin,task->end);
+    return 0;
+}
+
+#endif
+
+} // namespace
+
+int Parallel::getThreadCount()
+{
+    static int count=0;
+
+    if (count<=0) {
+#ifdef G_OS_LINUX
+        count=static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+#elif defined G_OS_WINDOWS
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        count=static_cast<int>(info.dwNumberOfProcessors);
+#endif
+
+        if (count<1) {
+            count=1;
+        }
+    }
+
+    return count;
+}
+
+int Parallel::getChunkCount(int const count,int threads,int const grain)
+{
+    if (threads<=0) {
+        threads=getThreadCount();
+    }
+
+    if (threads>MAX_CHUNKS) {
+        threads=MAX_CHUNKS;
+    }
+
+    // Do not create chunks with less than the given grain size.
+    int chunks=count/(grain>0 ? grain : 1);
+    if (chunks>threads) {
+        chunks=threads;
+    }
+
+    return chunks>0 ? chunks : 1;
+}
+
+int Parallel::run(Kernel kernel,void* context,int const count,int const threads,int const grain)
+{
+    int chunks=getChunkCount(count,threads,grain);
+
+    Task tasks[MAX_CHUNKS];
+    for (int i=0;i<chunks;++i) {
+        Task& t=tasks[i];
+        t.kernel=kernel;
+        t.context=context;
+        t.chunk=i;
+        t.begin=getChunkBegin(count,chunks,i);
+        t.end=getChunkBegin(count,chunks,i+1);
+    }
+
+#ifdef G_OS_LINUX
+    pthread_t handles[MAX_CHUNKS];
+#elif defined G_OS_WINDOWS
+    HANDLE handles[MAX_CHUNKS];
+#endif
+
+    // Start all but the first chunk on separate threads. If a thread cannot be
+    // created, process its chunk on the calling thread instead.
+    bool started[MAX_CHUNKS];
+    for (int i=1;i<chunks;++i) {
+#ifdef G_OS_LINUX
+        started[i]=pthread_create(&handles[i],NULL,runTask,&tasks[i])==0;
+#elif defined G_OS_WINDOWS
+        handles[i]=CreateThread(NULL,0,runTask,&tasks[i],0,NULL);
+        started[i]=handles[i]!=NULL;
+#endif
+    }
+
+    runTask(&tasks[0]);
+
+    for (int i=1;i<chunks;++i) {
+        if (!started[i]) {
+            runTask(&tasks[i]);
+            continue;
+        }
+
+#ifdef G_OS_LINUX
+        pthread_join(handles[i],NULL);
+#elif defined G_OS_WINDOWS
+        WaitForSingleObject(handles[i],INFINITE);
+        CloseHandle(handles[i]);
+#endif
+    }
+
+    return chunks;
+}
+
+} // namespace system
+
+} // namespace gale
@@ -24,7 +24,16 @@
  */
 
 #include "gale/wrapgl/preparedmesh.h"
+#include "gale/wrapgl/meshbatcher.h"
+#include "gale/math/batch.h"
+#include "gale/math/packing.h"
+#include "gale/system/parallel.h"
 
+#ifdef GALE_USE_VBO
+    #include "GLEX_ARB_vertex_type_2_10_10_10_rev.h"
+#endif
+
+using namespace gale::global;
 using namespace gale::math;
 using namespace gale::model;
 
@@ -32,6 +41,42 @@ namespace gale {
 
 namespace wrapgl {
 
+#ifdef GALE_USE_VBO
+
+namespace {
+
+// Copies the \a indices to the buffer object at \a offset as the given \a type
+// and advances \a offset, where 16-bit indices are converted using \a staging.
+void uploadIndices(IndexBufferObject const& vbo,GLenum const type,Mesh::IndexArray const& indices,GLintptrARB& offset,DynamicArray<g_uint16>& staging)
+{
+    int n=indices.getSize();
+    if (n<=0) {
+        return;
+    }
+
+    size_t size;
+
+    if (type==GL_UNSIGNED_SHORT) {
+        staging.setSize(n);
+        for (int i=0;i<n;++i) {
+            staging[i]=static_cast<g_uint16>(indices[i]);
+        }
+
+        size=n*sizeof(g_uint16);
+        vbo.setData(size,staging,offset);
+    }
+    else {
+        size=n*sizeof(Mesh::IndexArray::Type);
+        vbo.setData(size,indices,offset);
+    }
+
+    offset+=size;
+}
+
+} // namespace
+
+#endif // GALE_USE_VBO
+
 GLenum const PreparedMesh::GL_PRIM_TYPE[PI_COUNT]={
     GL_POINTS
 ,   GL_LINES
@@ -39,200 +84,963 @@ GLenum const PreparedMesh::GL_PRIM_TYPE[PI_COUNT]={
 ,   GL_QUADS
 };
 
-void PreparedMesh::compile(Mesh const& mesh)
+// Data shared by the compile and update kernels. Faces are classified per vertex
+// range into per-chunk buffers, which are then merged in chunk order, so the
+// result does not depend on the number of threads. The face normals are then
+// calculated in a separate pass over the merged face arrays, and summed up per
+// vertex by walking the vertex's corners in face order.
+struct PreparedMesh::CompileContext
 {
-    // Get an own copy of the vertices.
-    m_vertices=mesh.vertices;
+    // Per-chunk buffers for the faces found in a range of vertices.
+    struct Chunk
+    {
+        Mesh::IndexArray primitives[PI_COUNT]; // Primitive indices.
+        Mesh::IndexTable polygons;             // Polygon indices.
 
-    // Set the number of normals to the number of vertices; even point and line
-    // vertices will have normals that equal the vertices' directions.
-    m_normals.setSize(m_vertices.getSize());
+        AABB box;                              // Bounding box of the range's vertices.
 
-    // Initialize the normals to 0 so they can be accumulated.
-    size_t size=m_vertices.getSize()*sizeof(Mesh::VectorArray::Type);
-    memset(m_normals,0,size);
+        int offsets[PI_COUNT];                 // Offsets into the merged primitive arrays.
+        int polygon_offset;                    // Offset into the merged polygon table.
 
-    // Clear all indices as they will be rebuilt now.
-    m_primitives.clear();
-    m_polygons.clear();
+        int vertices_begin,vertices_end;       // Range of changed vertices when updating.
+        int normals_begin,normals_end;         // Range of changed normals when updating.
+    };
 
-    // Make room for an index array for each primitive type.
-    m_primitives.setSize(PI_COUNT);
-    Mesh::IndexArray polygon;
+    CompileContext(PreparedMesh& prepared,Mesh const& mesh)
+    :   prepared(prepared)
+    ,   mesh(mesh)
+    ,   chunk_count(0)
+    {}
 
-    // If there are no vertices, empty the bounding box and return immediately.
-    if (m_vertices.getSize()<=0) {
-        box.min=box.max=Vec3f::ZERO();
-        return;
-    }
+    // Classifies the primitives starting at the vertices from begin to end.
+    static void classify(void* context,int chunk,int begin,int end);
 
-    box.min=box.max=m_vertices[0];
+    // Returns the index of the first face starting at vertex vi or above.
+    int firstFace(int const vi) const;
 
-    for (int vi=0;vi<m_vertices.getSize();++vi) {
+    // Copies the buffers of the chunks from begin to end to their final place.
+    static void merge(void* context,int chunk,int begin,int end);
+
+    // Copies the changed vertices from begin to end when updating.
+    static void copy(void* context,int chunk,int begin,int end);
+
+    // Calculates the face "normals" and corner weights from begin to end,
+    // where the indices run over triangles, quadrilaterals and polygons in
+    // order.
+    static void faces(void* context,int chunk,int begin,int end);
+
+    // Accumulates and normalizes the normals of the blocks of 4 vertices from
+    // begin to end.
+    static void accumulate(void* context,int chunk,int begin,int end);
+
+    // Sorts the face corners by their vertices, see PreparedMesh::m_corners.
+    void sortCorners();
+
+    PreparedMesh& prepared;
+    Mesh const& mesh;
+
+    Chunk chunks[system::Parallel::MAX_CHUNKS];
+    int chunk_count;
+
+    Mesh::IndexArray face_offsets; // Offsets of the mesh's faces.
+    Mesh::IndexArray face_indices; // Indices of the mesh's faces.
+
+    // Calculates the face "normals" and accumulates them to the vertex
+    // normals, returns the number of chunks used for accumulation.
+    int calculateNormals(int const threads);
+
+    Mesh::VectorArray normals;     // Face "normals" of all primitives and polygons in order.
+    DynamicArray<float> weights;   // Corner weights of all faces in order, if any.
+    Mesh::IndexArray polygon_offsets; // Offsets of the polygons' corner weights.
+
+    Mesh::VectorArray sums; // If not empty, receives the accumulated "normals".
+};
+
+void PreparedMesh::CompileContext::classify(void* context,int chunk,int begin,int end)
+{
+    CompileContext* c=static_cast<CompileContext*>(context);
+    Mesh::VectorArray const& vertices=c->prepared.m_vertices;
+    Mesh const& mesh=c->mesh;
+    Chunk& out=c->chunks[chunk];
+
+    Mesh::IndexArray polygon;
+
+    out.box.min=out.box.max=vertices[begin];
+
+    for (int vi=begin;vi<end;++vi) {
         Mesh::IndexArray const& vn=mesh.neighbors[vi];
-        Vec3f const& v=m_vertices[vi];
+        Vec3f const& v=vertices[vi];
 
         // Update the bounding box extents.
-        if (v.getX()<box.min.getX()) {
-            box.min.setX(v.getX());
+        if (v.getX()<out.box.min.getX()) {
+            out.box.min.setX(v.getX());
         }
-        else if (v.getX()>box.max.getX()) {
-            box.max.setX(v.getX());
+        else if (v.getX()>out.box.max.getX()) {
+            out.box.max.setX(v.getX());
         }
 
-        if (v.getY()<box.min.getY()) {
-            box.min.setY(v.getY());
+        if (v.getY()<out.box.min.getY()) {
+            out.box.min.setY(v.getY());
         }
-        else if (v.getY()>box.max.getY()) {
-            box.max.setY(v.getY());
+        else if (v.getY()>out.box.max.getY()) {
+            out.box.max.setY(v.getY());
         }
 
-        if (v.getZ()<box.min.getZ()) {
-            box.min.setZ(v.getZ());
+        if (v.getZ()<out.box.min.getZ()) {
+            out.box.min.setZ(v.getZ());
         }
-        else if (v.getZ()>box.max.getZ()) {
-            box.max.setZ(v.getZ());
+        else if (v.getZ()>out.box.max.getZ()) {
+            out.box.max.setZ(v.getZ());
         }
 
-        // Check for non-face primitives.
+        // Check for non-face primitives, their normals are set when accumulating.
         if (vn.getSize()==0) {
             // This is just a point with an empty neighborhood.
-            m_primitives[PI_POINTS].insert(vi);
-            m_normals[vi]=v;
-
-            continue;
+            out.primitives[PI_POINTS].insert(vi);
         }
-
-        if (vn.getSize()==1) {
+        else if (vn.getSize()==1) {
             // This is just a line with a single neighbor.
-            m_primitives[PI_LINES].insert(vi);
-            m_normals[vi]=v;
+            out.primitives[PI_LINES].insert(vi);
+            out.primitives[PI_LINES].insert(vn[0]);
+        }
+    }
 
-            m_primitives[PI_LINES].insert(vn[0]);
-            m_normals[vn[0]]=m_vertices[vn[0]];
+    // The faces are sorted by their first vertex, so the faces starting in
+    // this range of vertices are consecutive.
+    Mesh::IndexArray const& offsets=c->face_offsets;
+    Mesh::IndexArray const& indices=c->face_indices;
 
-            continue;
-        }
+    int f=c->firstFace(begin),last=c->firstFace(end);
 
-        for (int n=0;n<vn.getSize();++n) {
-            // Get the orbit vertices starting with the edge from vi to its
-            // currently selected neighbor.
-            int o=mesh.orbit(vi,vn[n],polygon);
-            if (o<3 || o>5) {
-                // Only triangular to pentagonal faces are supported right now.
-                continue;
-            }
+    for (;f<last;++f) {
+        unsigned int const* face=&indices[offsets[f]];
+        int o=offsets[f+1]-offsets[f];
 
-            // Make sure to walk each face only once, i.e. rule out permutations
-            // of face indices. Use the address in memory to define a relation
-            // on the universe of vertices.
-            Vec3f const& a=m_vertices[polygon[1]];
-            Vec3f const& b=m_vertices[polygon[2]];
-            if (&v<&a || &v<&b) {
-                continue;
+        if (o==3) {
+            for (int i=0;i<3;++i) {
+                out.primitives[PI_TRIANGLES].insert(face[i]);
             }
+        }
+        else if (o==4) {
+            for (int i=0;i<4;++i) {
+                out.primitives[PI_QUADS].insert(face[i]);
+            }
+        }
+        else if (o==5) {
+            polygon.setSize(o);
+            memcpy(polygon,face,o*sizeof(Mesh::IndexArray::Type));
+            out.polygons.insert(polygon);
+        }
+
+        // Larger faces are skipped as they may be the boundaries of holes,
+        // see compile().
+    }
+}
+
+int PreparedMesh::CompileContext::firstFace(int const vi) const
+{
+    // Binary search for the first face whose first vertex is not below vi.
+    int first=0,last=face_offsets.getSize()-1;
+    while (first<last) {
+        int f=(first+last)/2;
+        if (face_indices[face_offsets[f]]<static_cast<unsigned int>(vi)) {
+            first=f+1;
+        }
+        else {
+            last=f;
+        }
+    }
+    return first;
+}
+
+void PreparedMesh::CompileContext::merge(void* context,int chunk,int begin,int end)
+{
+    G_UNREF_PARAM(chunk)
 
-            // The "normal's" length equals the spanned parallelogram's area.
-            // While this method is always correct for triangular faces, for
-            // other faces it depends on the order of traversal and which of the
-            // face vertices are used for calculation. This is accepted for
-            // performance reasons. To fix it, normalize the "normal" here.
-            Vec3f normal=(a-v)^(b-v);
+    CompileContext* c=static_cast<CompileContext*>(context);
+    Mesh::IndexTable& primitives=c->prepared.m_primitives;
+    Mesh::IndexTable& polygons=c->prepared.m_polygons;
 
-            if (o==3) {
-                m_primitives[PI_TRIANGLES].insert(polygon);
+    for (int ci=begin;ci<end;++ci) {
+        Chunk& in=c->chunks[ci];
 
-                // Accumulate the "normal" for all face vertices.
-                m_normals[polygon[0]]+=normal;
-                m_normals[polygon[1]]+=normal;
-                m_normals[polygon[2]]+=normal;
+        for (int i=0;i<PI_COUNT;++i) {
+            int n=in.primitives[i].getSize();
+            if (n>0) {
+                memcpy(&primitives[i][in.offsets[i]],in.primitives[i],n*sizeof(Mesh::IndexArray::Type));
             }
-            else {
-                // More than 3 vertices require another check.
-                Vec3f const& c=m_vertices[polygon[3]];
-                if (&v<&c) {
-                    continue;
-                }
+        }
+
+        // Move the polygons to their final place instead of copying them.
+        for (int i=0;i<in.polygons.getSize();++i) {
+            polygons[in.polygon_offset+i].swap(in.polygons[i]);
+        }
+    }
+}
+
+void PreparedMesh::CompileContext::accumulate(void* context,int chunk,int begin,int end)
+{
+    CompileContext* c=static_cast<CompileContext*>(context);
+    Mesh::VectorArray const& vertices=c->prepared.m_vertices;
+    Mesh::VectorArray& normals=c->prepared.m_normals;
+    Chunk& out=c->chunks[chunk];
 
-                if (o==4) {
-                    m_primitives[PI_QUADS].insert(polygon);
+    // When updating, accumulate to separate memory to be able to tell which
+    // normals have changed.
+    bool updating=c->sums.getSize()>0;
+    Mesh::VectorArray& sums=updating?c->sums:normals;
 
-                    // Accumulate the "normal" for all face vertices.
-                    m_normals[polygon[0]]+=normal;
-                    m_normals[polygon[1]]+=normal;
-                    m_normals[polygon[2]]+=normal;
-                    m_normals[polygon[3]]+=normal;
+    // Sum up the "normals" of each vertex's corners in face order. This only
+    // touches the faces adjacent to our range of vertices, and makes the
+    // summation order independent of the thread count.
+    Mesh::IndexArray const& offsets=c->prepared.m_corner_offsets;
+    Mesh::IndexArray const& corners=c->prepared.m_corners;
+    Mesh::IndexArray const& faces=c->prepared.m_corner_faces;
+    bool weighted=c->prepared.m_weighting==WEIGHT_ANGLE;
+
+    // If the vertices were reordered, map them back to the mesh's vertices.
+    Mesh::IndexArray const& sources=c->prepared.m_sources;
+
+    // Work on whole blocks of vertices so each vertex is normalized in the same
+    // way no matter where the ranges of the threads are split.
+    begin*=4;
+    end=min(end*4,vertices.getSize());
+
+    for (int vi=begin;vi<end;++vi) {
+        Vec3f n=Vec3f::ZERO();
+
+        int mi=sources.getSize()>0?sources[vi]:vi;
+        if (c->mesh.neighbors[mi].getSize()<=1) {
+            // Point and line vertices have normals that equal the vertices'
+            // directions.
+            n=vertices[vi];
+        }
+        else {
+            for (unsigned int i=offsets[vi];i<offsets[vi+1];++i) {
+                unsigned int corner=corners[i];
+                if (weighted) {
+                    n+=c->normals[faces[corner]]*c->weights[corner];
                 }
                 else {
-                    // More than 4 vertices require another check.
-                    Vec3f const& d=m_vertices[polygon[4]];
-                    if (&v<&d) {
-                        continue;
-                    }
+                    n+=c->normals[faces[corner]];
+                }
+            }
+        }
+
+        sums[vi]=n;
+    }
 
-                    // NOTE: For more than 5 vertices more checks are needed.
-                    m_polygons.insert(polygon);
+    // Normalize the accumulated "normals".
+    normalizeAll(&sums[begin],&sums[begin],end-begin,c->prepared.m_accuracy);
 
-                    // Accumulate the "normal" for all face vertices.
-                    m_normals[polygon[0]]+=normal;
-                    m_normals[polygon[1]]+=normal;
-                    m_normals[polygon[2]]+=normal;
-                    m_normals[polygon[3]]+=normal;
-                    m_normals[polygon[4]]+=normal;
+    out.normals_begin=end;
+    out.normals_end=begin;
+
+    if (!updating) {
+        return;
+    }
+
+    for (int vi=begin;vi<end;++vi) {
+        if (memcmp(&normals[vi],&sums[vi],sizeof(Vec3f))!=0) {
+            if (vi<out.normals_begin) {
+                out.normals_begin=vi;
+            }
+            out.normals_end=vi+1;
+
+            normals[vi]=sums[vi];
+        }
+    }
+}
+
+void PreparedMesh::CompileContext::copy(void* context,int chunk,int begin,int end)
+{
+    CompileContext* c=static_cast<CompileContext*>(context);
+    Mesh::VectorArray const& source=c->mesh.vertices;
+    Mesh::VectorArray& vertices=c->prepared.m_vertices;
+    Mesh::IndexArray const& sources=c->prepared.m_sources;
+    Chunk& out=c->chunks[chunk];
+
+    // Compare the bits as the tuple's comparison operators have tolerances.
+    int first=begin,last=end;
+
+    if (sources.getSize()>0) {
+        for (;first<end && memcmp(&vertices[first],&source[sources[first]],sizeof(Vec3f))==0;++first);
+        for (;last>first && memcmp(&vertices[last-1],&source[sources[last-1]],sizeof(Vec3f))==0;--last);
+
+        for (int vi=first;vi<last;++vi) {
+            vertices[vi]=source[sources[vi]];
+        }
+    }
+    else {
+        // Copy the whole range of changed vertices at once.
+        for (;first<end && memcmp(&vertices[first],&source[first],sizeof(Vec3f))==0;++first);
+        for (;last>first && memcmp(&vertices[last-1],&source[last-1],sizeof(Vec3f))==0;--last);
+
+        if (first<last) {
+            memcpy(&vertices[first],&source[first],(last-first)*sizeof(Vec3f));
+        }
+    }
+
+    out.vertices_begin=first<last?first:end;
+    out.vertices_end=first<last?last:begin;
+
+    // Get the bounding box extents of the copies.
+    minMaxAll(&vertices[begin],end-begin,out.box.min,out.box.max);
+}
+
+void PreparedMesh::CompileContext::faces(void* context,int chunk,int begin,int end)
+{
+    G_UNREF_PARAM(chunk)
+
+    CompileContext* c=static_cast<CompileContext*>(context);
+    Mesh::VectorArray const& vertices=c->prepared.m_vertices;
+    bool weighted=c->prepared.m_weighting==WEIGHT_ANGLE;
+
+    Vec3f* normals=c->normals;
+    float* weights=weighted?c->weights.data():NULL;
+
+    for (int t=PI_TRIANGLES;t<PI_COUNT;++t) {
+        Mesh::IndexArray const& indices=c->prepared.m_primitives[t];
+        int size=t+1,count=indices.getSize()/size;
+
+        int b=max(begin,0),e=min(end,count);
+        if (b<e) {
+            float* angles=weighted?weights+b*size:NULL;
+            faceNormals(vertices,&indices[b*size],e-b,size,normals+b,angles);
+
+            if (weighted) {
+                // Divide the angles by the "normals'" lengths so weighting
+                // the "normals" yields unit normals scaled by the angles.
+                for (int f=b;f<e;++f) {
+                    float length=static_cast<float>(normals[f].length());
+                    float scale=length>0?1.0f/length:0.0f;
+                    for (int i=0;i<size;++i) {
+                        *angles++*=scale;
+                    }
                 }
             }
         }
+
+        normals+=count;
+        if (weighted) {
+            weights+=count*size;
+        }
+
+        begin-=count;
+        end-=count;
+    }
+
+    Mesh::IndexTable const& polygons=c->prepared.m_polygons;
+    for (int p=max(begin,0);p<min(end,polygons.getSize());++p) {
+        Mesh::IndexArray const& polygon=polygons[p];
+        int size=polygon.getSize();
+
+        float* angles=weighted?&c->weights[c->polygon_offsets[p]]:NULL;
+        faceNormals(vertices,polygon,1,size,&normals[p],angles);
+
+        if (weighted) {
+            float length=static_cast<float>(normals[p].length());
+            float scale=length>0?1.0f/length:0.0f;
+            for (int i=0;i<size;++i) {
+                angles[i]*=scale;
+            }
+        }
+    }
+}
+
+void PreparedMesh::CompileContext::sortCorners()
+{
+    Mesh::IndexArray& offsets=prepared.m_corner_offsets;
+    Mesh::IndexArray& corners=prepared.m_corners;
+    Mesh::IndexArray& faces=prepared.m_corner_faces;
+    Mesh::IndexTable const& polygons=prepared.m_polygons;
+
+    int n=prepared.m_vertices.getSize();
+
+    // Count the corners per vertex, and note the face of each corner.
+    offsets.setSize(n+1);
+    memset(offsets,0,(n+1)*sizeof(Mesh::IndexArray::Type));
+
+    int count=0;
+    for (int t=PI_TRIANGLES;t<PI_COUNT;++t) {
+        count+=prepared.m_primitives[t].getSize();
+    }
+    for (int p=0;p<polygons.getSize();++p) {
+        count+=polygons[p].getSize();
+    }
+    faces.setSize(count);
+
+    unsigned int corner=0,face=0;
+    for (int t=PI_TRIANGLES;t<PI_COUNT;++t) {
+        Mesh::IndexArray const& indices=prepared.m_primitives[t];
+        int size=t+1;
+
+        for (int i=0;i<indices.getSize();++i) {
+            ++offsets[indices[i]+1];
+            faces[corner++]=face+i/size;
+        }
+        face+=indices.getSize()/size;
+    }
+
+    for (int p=0;p<polygons.getSize();++p,++face) {
+        Mesh::IndexArray const& polygon=polygons[p];
+        for (int i=0;i<polygon.getSize();++i) {
+            ++offsets[polygon[i]+1];
+            faces[corner++]=face;
+        }
+    }
+
+    for (int vi=0;vi<n;++vi) {
+        offsets[vi+1]+=offsets[vi];
+    }
+
+    // Distribute the corners to their vertices, which keeps them in face order.
+    Mesh::IndexArray next(n);
+    memcpy(next,offsets,n*sizeof(Mesh::IndexArray::Type));
+    corners.setSize(count);
+
+    corner=0;
+    for (int t=PI_TRIANGLES;t<PI_COUNT;++t) {
+        Mesh::IndexArray const& indices=prepared.m_primitives[t];
+        for (int i=0;i<indices.getSize();++i) {
+            corners[next[indices[i]]++]=corner++;
+        }
+    }
+
+    for (int p=0;p<polygons.getSize();++p) {
+        Mesh::IndexArray const& polygon=polygons[p];
+        for (int i=0;i<polygon.getSize();++i) {
+            corners[next[polygon[i]]++]=corner++;
+        }
+    }
+}
+
+int PreparedMesh::CompileContext::calculateNormals(int const threads)
+{
+    // The corners only depend on the topology, so they are kept for updates.
+    if (prepared.m_corner_offsets.getSize()!=prepared.m_vertices.getSize()+1) {
+        sortCorners();
+    }
+
+    bool weighted=prepared.m_weighting==WEIGHT_ANGLE;
+    int count=0,corners=0;
+
+    for (int i=PI_TRIANGLES;i<PI_COUNT;++i) {
+        count+=prepared.m_primitives[i].getSize()/(i+1);
+        corners+=prepared.m_primitives[i].getSize();
+    }
+
+    Mesh::IndexTable const& polygons=prepared.m_polygons;
+    count+=polygons.getSize();
+    normals.setSize(count);
+
+    if (weighted) {
+        // Polygons may have different numbers of corners, so get the offsets
+        // of their weights in advance.
+        polygon_offsets.setSize(polygons.getSize());
+
+        for (int p=0;p<polygons.getSize();++p) {
+            polygon_offsets[p]=corners;
+            corners+=polygons[p].getSize();
+        }
+
+        weights.setSize(corners);
     }
 
-    // Normalize the accumulated "normals" (there are as many normals as vertices).
-    for (int i=0;i<m_vertices.getSize();++i) {
-        m_normals[i].normalize();
+    system::Parallel::run(faces,this,count,threads,4096);
+
+    return system::Parallel::run(accumulate,this,(prepared.m_vertices.getSize()+3)/4,threads,1024);
+}
+
+void PreparedMesh::upload()
+{
+    int n=m_vertices.getSize();
+
+    // All vertices and normals are uploaded.
+    m_vertices_begin=m_normals_begin=0;
+    m_vertices_end=m_normals_end=n;
+
+    if (m_compact) {
+        calculateQuantization(m_center,m_scale);
     }
 
 #ifdef GALE_USE_VBO
+    // Choose the data types to upload with.
+    if (m_compact) {
+        m_vertex_type=GL_SHORT;
+
+        if (GLEX_ARB_vertex_type_2_10_10_10_rev || GLEX_ARB_vertex_type_2_10_10_10_rev_init()) {
+            m_normal_type=GL_INT_2_10_10_10_REV;
+        }
+        else {
+            m_normal_type=GL_SHORT;
+        }
+    }
+    else {
+        m_vertex_type=m_normal_type=GL_FLOAT;
+    }
+
+    // Indices up to 65535 fit into 16 bits.
+    m_index_type=n<=0x10000?GL_UNSIGNED_SHORT:GL_UNSIGNED_INT;
+
     // Allocate buffer object for the vertices and normals.
-    m_vbo_vertnorm.setData(GL_STATIC_DRAW_ARB,size*2,NULL);
+    int vertex_size=m_vertex_type==GL_FLOAT?sizeof(Mesh::VectorArray::Type):3*sizeof(g_int16);
+    m_normal_offset=getNormalOffset(n,m_vertex_type);
+
+    m_vbo_vertnorm.setData(GL_STATIC_DRAW_ARB,m_normal_offset+n*(getVertexSize()-vertex_size),NULL);
 
     // Copy the vertices and normals to the buffer object.
-    m_vbo_vertnorm.setData(size,m_vertices);
-    m_vbo_vertnorm.setData(size,m_normals,size);
+    uploadVertices(0,n);
+    uploadNormals(0,n);
 
-    // Accumulate the sizes of all primitive and polygon index arrays.
-    size=0;
+    // Accumulate the sizes of all index arrays to render, where points and
+    // lines are followed by either the faces or the triangle strip, and then
+    // by the meshlets' triangles, if any.
+    int faces=m_strip_mode?PI_TRIANGLES:PI_COUNT;
+    size_t size=0;
 
-    for (int i=0;i<m_primitives.getSize();++i) {
+    for (int i=0;i<faces;++i) {
         size+=m_primitives[i].getSize();
     }
 
-    for (int i=0;i<m_polygons.getSize();++i) {
-        size+=m_polygons[i].getSize();
+    if (m_strip_mode) {
+        size+=m_strip.getSize();
+    }
+    else {
+        for (int i=0;i<m_polygons.getSize();++i) {
+            size+=m_polygons[i].getSize();
+        }
     }
 
-    size*=sizeof(Mesh::IndexArray::Type);
+    size+=m_meshlets.indices().getSize();
+
+    size*=getIndexSize();
 
     // Allocate buffer object for the primitive and polygon indices.
     m_vbo_primpoly.setData(GL_STATIC_DRAW_ARB,size,NULL);
 
     // Copy the primitive and polygon indices to the buffer object.
     GLintptrARB offset=0;
+    DynamicArray<g_uint16> staging;
 
-    for (int i=0;i<m_primitives.getSize();++i) {
-        size=m_primitives[i].getSize()*sizeof(Mesh::IndexArray::Type);
-        m_vbo_primpoly.setData(size,m_primitives[i],offset);
-        offset+=size;
+    for (int i=0;i<faces;++i) {
+        uploadIndices(m_vbo_primpoly,m_index_type,m_primitives[i],offset,staging);
     }
 
-    for (int i=0;i<m_polygons.getSize();++i) {
-        size=m_polygons[i].getSize()*sizeof(Mesh::IndexArray::Type);
-        m_vbo_primpoly.setData(size,m_polygons[i],offset);
-        offset+=size;
+    if (m_strip_mode) {
+        uploadIndices(m_vbo_primpoly,m_index_type,m_strip,offset,staging);
+    }
+    else {
+        for (int i=0;i<m_polygons.getSize();++i) {
+            uploadIndices(m_vbo_primpoly,m_index_type,m_polygons[i],offset,staging);
+        }
     }
 
+    uploadIndices(m_vbo_primpoly,m_index_type,m_meshlets.indices(),offset,staging);
+
     // Mark the Vertex Array Object as inconsistent.
     m_vao.setDirtyState(true);
 #endif
 }
 
+#ifdef GALE_USE_VBO
+
+void PreparedMesh::uploadVertices(int const begin,int const end)
+{
+    int n=end-begin;
+    if (n<=0) {
+        return;
+    }
+
+    if (m_vertex_type==GL_FLOAT) {
+        size_t size=sizeof(Mesh::VectorArray::Type);
+        m_vbo_vertnorm.setData(n*size,&m_vertices[begin],begin*size);
+        return;
+    }
+
+    // Quantize the positions to the range of the bounding box.
+    DynamicArray<g_int16> packed(n*3);
+    float scale=1.0f/(m_scale*32767.0f);
+
+    for (int i=0;i<n;++i) {
+        packSNorm16((m_vertices[begin+i]-m_center)*scale,&packed[i*3]);
+    }
+
+    size_t size=3*sizeof(g_int16);
+    m_vbo_vertnorm.setData(n*size,packed,begin*size);
+}
+
+void PreparedMesh::uploadNormals(int const begin,int const end)
+{
+    int n=end-begin;
+    if (n<=0) {
+        return;
+    }
+
+    if (m_normal_type==GL_FLOAT) {
+        size_t size=sizeof(Mesh::VectorArray::Type);
+        m_vbo_vertnorm.setData(n*size,&m_normals[begin],m_normal_offset+begin*size);
+    }
+    else if (m_normal_type==GL_SHORT) {
+        DynamicArray<g_int16> packed(n*3);
+        for (int i=0;i<n;++i) {
+            packSNorm16(m_normals[begin+i],&packed[i*3]);
+        }
+
+        size_t size=3*sizeof(g_int16);
+        m_vbo_vertnorm.setData(n*size,packed,m_normal_offset+begin*size);
+    }
+    else {
+        DynamicArray<g_uint32> packed(n);
+        for (int i=0;i<n;++i) {
+            packed[i]=packSNorm1010102(m_normals[begin+i]);
+        }
+
+        size_t size=sizeof(g_uint32);
+        m_vbo_vertnorm.setData(n*size,packed,m_normal_offset+begin*size);
+    }
+}
+
+#endif // GALE_USE_VBO
+
+void PreparedMesh::calculateQuantization(Vec3f& center,float& scale) const
+{
+    center=(box.min+box.max)*0.5f;
+
+    // Use a uniform scale so normals are not distorted by the transformation
+    // that restores the positions.
+    float extent=max(box.getWidth(),box.getHeight(),box.getDepth())*0.5f;
+    if (extent<=0) {
+        extent=1.0f;
+    }
+
+    scale=extent/32767.0f;
+}
+
+void PreparedMesh::faceNormals(Vec3f const* vertices,unsigned int const* indices,int const count,int const size,Vec3f* normals,float* angles)
+{
+    // Newell's method sums the cross products of all edges. Relative to the
+    // first vertex this equals summing the cross products of a triangle fan,
+    // which is more precise. For triangles this is a single cross product, and
+    // for quadrilaterals the sum reduces to the cross product of the diagonals.
+    if (size==3 || size==4) {
+        // Gather the edges of blocks of faces to calculate the cross products
+        // with the batch kernel. The blocks are padded to a multiple of the
+        // SIMD width so all faces are calculated in the same way, no matter
+        // how the faces are split into calls.
+        static int const BLOCK_SIZE=256;
+        Vec3f a[BLOCK_SIZE],b[BLOCK_SIZE],n[BLOCK_SIZE];
+
+        for (int f=0;f<count;f+=BLOCK_SIZE) {
+            int m=min(BLOCK_SIZE,count-f);
+
+            for (int i=0;i<m;++i) {
+                unsigned int const* face=&indices[(f+i)*size];
+                Vec3f const& v=vertices[face[0]];
+
+                if (size==3) {
+                    a[i]=vertices[face[1]]-v;
+                    b[i]=vertices[face[2]]-v;
+                }
+                else {
+                    a[i]=vertices[face[2]]-v;
+                    b[i]=vertices[face[3]]-vertices[face[1]];
+                }
+            }
+
+            int padded=(m+3)&~3;
+            for (int i=m;i<padded;++i) {
+                a[i]=b[i]=Vec3f::ZERO();
+            }
+
+            crossAll(a,b,n,padded);
+            memcpy(normals+f,n,m*sizeof(Vec3f));
+        }
+    }
+    else {
+        for (int f=0;f<count;++f) {
+            unsigned int const* face=&indices[f*size];
+            Vec3f const& v=vertices[face[0]];
+
+            Vec3f n=Vec3f::ZERO();
+
+            Vec3f a=vertices[face[1]]-v;
+            for (int i=2;i<size;++i) {
+                Vec3f b=vertices[face[i]]-v;
+                n+=a^b;
+                a=b;
+            }
+
+            normals[f]=n;
+        }
+    }
+
+    if (!angles) {
+        return;
+    }
+
+    for (int f=0;f<count;++f) {
+        unsigned int const* face=&indices[f*size];
+        Vec3f const& n=normals[f];
+
+        // Get the angle between the edges at each corner from the sine and
+        // cosine, both scaled by the normal's length. Negative sines denote
+        // reflex corners of concave faces.
+        float length=static_cast<float>(n.length());
+
+        for (int i=0;i<size;++i) {
+            Vec3f const& c=vertices[face[i]];
+            Vec3f next=vertices[face[i+1<size?i+1:0]]-c;
+            Vec3f prev=vertices[face[i>0?i-1:size-1]]-c;
+
+            float a=atan2((next^prev)%n,(next%prev)*length);
+            if (a<0) {
+                a+=2*Constf::PI();
+            }
+
+            *angles++=a;
+        }
+    }
+}
+
+void PreparedMesh::setCompactVertices(bool const enable)
+{
+    if (enable==m_compact) {
+        return;
+    }
+
+    m_compact=enable;
+
+    if (m_vertices.getSize()>0) {
+        upload();
+    }
+}
+
+int PreparedMesh::getVertexSize() const
+{
+    int size=m_vertex_type==GL_FLOAT?sizeof(Mesh::VectorArray::Type):3*sizeof(g_int16);
+
+    if (m_normal_type==GL_FLOAT) {
+        size+=sizeof(Mesh::VectorArray::Type);
+    }
+    else if (m_normal_type==GL_SHORT) {
+        size+=3*sizeof(g_int16);
+    }
+    else {
+        size+=sizeof(g_uint32);
+    }
+
+    return size;
+}
+
+size_t PreparedMesh::getNormalOffset(int const vertices,GLenum const type)
+{
+    size_t size=vertices*(type==GL_FLOAT?sizeof(Mesh::VectorArray::Type):3*sizeof(g_int16));
+    return (size+3)&~size_t(3);
+}
+
+void PreparedMesh::compile(Mesh const& mesh,int const threads)
+{
+    // Get an own copy of the vertices.
+    m_vertices=mesh.vertices;
+
+    // Set the number of normals to the number of vertices; even point and line
+    // vertices will have normals that equal the vertices' directions.
+    m_normals.setSize(m_vertices.getSize());
+
+    // Clear all indices as they will be rebuilt now.
+    m_primitives.clear();
+    m_polygons.clear();
+    m_sources.clear();
+    m_strip.clear();
+    m_meshlets.clear();
+    clearCorners();
+
+    // Make room for an index array for each primitive type.
+    m_primitives.setSize(PI_COUNT);
+
+    // If there are no vertices, empty the bounding box and return immediately.
+    if (m_vertices.getSize()<=0) {
+        box.min=box.max=Vec3f::ZERO();
+        return;
+    }
+
+    CompileContext* context=new CompileContext(*this,mesh);
+
+    // Walk all faces once, then sort them by type per range of vertices.
+    mesh.extractFaces(context->face_offsets,context->face_indices,threads);
+    context->chunk_count=system::Parallel::run(CompileContext::classify,context,m_vertices.getSize(),threads,1024);
+
+    // Calculate the offsets of the chunks' buffers by summing up their sizes
+    // in chunk order, and merge the bounding boxes.
+    int sizes[PI_COUNT]={0},polygons=0;
+    box=context->chunks[0].box;
+
+    for (int ci=0;ci<context->chunk_count;++ci) {
+        CompileContext::Chunk& chunk=context->chunks[ci];
+
+        for (int i=0;i<PI_COUNT;++i) {
+            chunk.offsets[i]=sizes[i];
+            sizes[i]+=chunk.primitives[i].getSize();
+        }
+
+        chunk.polygon_offset=polygons;
+        polygons+=chunk.polygons.getSize();
+
+        box.min=box.min.minElements(chunk.box.min);
+        box.max=box.max.maxElements(chunk.box.max);
+    }
+
+    if (context->chunk_count==1) {
+        // There is nothing to merge, so just take over the buffers.
+        CompileContext::Chunk& chunk=context->chunks[0];
+
+        for (int i=0;i<PI_COUNT;++i) {
+            m_primitives[i].swap(chunk.primitives[i]);
+        }
+
+        m_polygons.swap(chunk.polygons);
+    }
+    else {
+        for (int i=0;i<PI_COUNT;++i) {
+            m_primitives[i].setSize(sizes[i]);
+        }
+
+        m_polygons.setSize(polygons);
+
+        system::Parallel::run(CompileContext::merge,context,context->chunk_count,threads);
+    }
+
+    context->calculateNormals(threads);
+
+    delete context;
+
+    if (m_strip_mode) {
+        buildStrip();
+    }
+
+    if (m_meshlet_vertices>0) {
+        partitionMeshlets();
+    }
+
+    upload();
+}
+
+void PreparedMesh::merge(MeshBatcher const& batcher)
+{
+    m_vertices=batcher.getVertices();
+    m_normals=batcher.getNormals();
+
+    m_primitives=batcher.getPrimitives();
+    m_polygons=batcher.getPolygons();
+
+    m_sources.clear();
+    m_strip.clear();
+    m_meshlets.clear();
+    clearCorners();
+
+    box=batcher.box;
+
+    if (m_strip_mode) {
+        buildStrip();
+    }
+
+    if (m_meshlet_vertices>0) {
+        partitionMeshlets();
+    }
+
+    upload();
+}
+
+void PreparedMesh::updateVertices(Mesh const& mesh,int const threads)
+{
+    int n=m_vertices.getSize();
+
+    // Without a matching number of vertices the topology has changed.
+    if (n<=0 || mesh.vertices.getSize()!=n || m_normals.getSize()!=n) {
+        compile(mesh,threads);
+        return;
+    }
+
+    CompileContext* context=new CompileContext(*this,mesh);
+
+    // Copy only the changed vertices and get their bounding box.
+    context->chunk_count=system::Parallel::run(CompileContext::copy,context,n,threads,4096);
+
+    int vertices_begin=n,vertices_end=0;
+    box=context->chunks[0].box;
+
+    for (int ci=0;ci<context->chunk_count;++ci) {
+        CompileContext::Chunk& chunk=context->chunks[ci];
+
+        vertices_begin=min(vertices_begin,chunk.vertices_begin);
+        vertices_end=max(vertices_end,chunk.vertices_end);
+
+        box.min=box.min.minElements(chunk.box.min);
+        box.max=box.max.maxElements(chunk.box.max);
+    }
+
+    if (vertices_begin>=vertices_end) {
+        // Nothing has changed.
+        m_vertices_begin=m_vertices_end=m_normals_begin=m_normals_end=0;
+
+        delete context;
+        return;
+    }
+
+    if (m_meshlets.getSize()>0) {
+        m_meshlets.bound(m_vertices);
+    }
+
+    // Recalculate the normals from the cached face lists.
+    context->sums.setSize(n);
+    int chunks=context->calculateNormals(threads);
+
+    int normals_begin=n,normals_end=0;
+
+    for (int ci=0;ci<chunks;++ci) {
+        CompileContext::Chunk& chunk=context->chunks[ci];
+
+        normals_begin=min(normals_begin,chunk.normals_begin);
+        normals_end=max(normals_end,chunk.normals_end);
+    }
+
+    delete context;
+
+    if (m_compact) {
+        // If the bounding box has changed, all vertices need to be quantized
+        // again.
+        Vec3f center;
+        float scale;
+        calculateQuantization(center,scale);
+
+        if (memcmp(&center,&m_center,sizeof(Vec3f))!=0 || scale!=m_scale) {
+            m_center=center;
+            m_scale=scale;
+
+            vertices_begin=0;
+            vertices_end=n;
+        }
+    }
+
+    m_vertices_begin=vertices_begin;
+    m_vertices_end=vertices_end;
+
+    if (normals_begin<normals_end) {
+        m_normals_begin=normals_begin;
+        m_normals_end=normals_end;
+    }
+    else {
+        m_normals_begin=m_normals_end=0;
+    }
+
+#ifdef GALE_USE_VBO
+    // Only upload the changed ranges.
+    uploadVertices(m_vertices_begin,m_vertices_end);
+    uploadNormals(m_normals_begin,m_normals_end);
+#endif
+}
+
 } // namespace wrapgl
 
 } // namespace gale
@@ -0,0 +1,542 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/wrapgl/preparedmesh.h"
+#include "gale/system/parallel.h"
+
+#ifndef GALE_TINY_CODE
+
+#include <stdio.h>
+
+using namespace gale::global;
+using namespace gale::math;
+using namespace gale::model;
+using namespace gale::system;
+
+namespace gale {
+
+namespace wrapgl {
+
+namespace {
+
+/*
+ * Output helpers
+ */
+
+// The size of the blocks written to the file at once.
+int const BLOCK_SIZE=4*1024*1024;
+
+// The number of items each thread formats at once.
+int const CHUNK_ITEMS=16*1024;
+
+// Buffered sequential writer that writes to a file in large blocks.
+class BlockWriter
+{
+  public:
+
+    BlockWriter(char const* path)
+    :   m_file(fopen(path,"wb"))
+    ,   m_buffer(BLOCK_SIZE)
+    ,   m_size(0)
+    ,   m_failed(m_file==NULL)
+    {}
+
+    ~BlockWriter() {
+        close();
+    }
+
+    // Returns a pointer to at least size bytes of buffer memory to write to,
+    // which have to be committed by calling commit() afterwards.
+    char* reserve(int const size) {
+        if (m_size+size>m_buffer.getSize()) {
+            flush();
+            if (size>m_buffer.getSize()) {
+                m_buffer.setSize(size);
+            }
+        }
+        return m_buffer+m_size;
+    }
+
+    // Marks the reserved buffer memory up to end as written.
+    void commit(char const* end) {
+        m_size=static_cast<int>(end-m_buffer.data());
+    }
+
+    // Writes size bytes of data, bypassing the buffer for large blocks.
+    void write(void const* data,int const size) {
+        // Empty arrays may not have any data to copy from.
+        if (size==0) {
+            return;
+        }
+
+        if (size>=m_buffer.getSize()/2) {
+            flush();
+            if (!m_failed) {
+                m_failed=fwrite(data,1,size,m_file)!=static_cast<size_t>(size);
+            }
+        }
+        else {
+            char* p=reserve(size);
+            memcpy(p,data,size);
+            commit(p+size);
+        }
+    }
+
+    // Writes the given 32-bit unsigned integer.
+    void write(g_uint32 const value) {
+        write(&value,sizeof(value));
+    }
+
+    // Writes all buffered data to the file.
+    void flush() {
+        if (m_size>0 && !m_failed) {
+            m_failed=fwrite(m_buffer,1,m_size,m_file)!=static_cast<size_t>(m_size);
+        }
+        m_size=0;
+    }
+
+    // Flushes and closes the file. Returns whether all data was written.
+    bool close() {
+        if (m_file) {
+            flush();
+            m_failed=(fclose(m_file)!=0) || m_failed;
+            m_file=NULL;
+        }
+        return !m_failed;
+    }
+
+  private:
+
+    FILE* m_file;
+    DynamicArray<char> m_buffer;
+    int m_size;
+    bool m_failed;
+};
+
+/*
+ * Text formatting
+ */
+
+// Writes the unsigned integer value at p and returns the position after it.
+char* formatUInt(char* p,g_uint64 value)
+{
+    char digits[20];
+    int n=0;
+
+    do {
+        digits[n++]=static_cast<char>('0'+value%10);
+        value/=10;
+    } while (value>0);
+
+    while (n>0) {
+        *p++=digits[--n];
+    }
+
+    return p;
+}
+
+// Writes value at p with 9 significant digits, which is enough to restore the
+// exact value when reading it back, and returns the position after it. This is
+// considerably faster than printf() and does not depend on the locale.
+char* formatFloat(char* p,float const value)
+{
+    static double const POWERS[]={
+        1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,1e12,1e13,1e14,1e15,1e16
+    };
+
+    if (value!=value) {
+        memcpy(p,"nan",3);
+        return p+3;
+    }
+
+    double v=value;
+    if (v<0) {
+        *p++='-';
+        v=-v;
+    }
+
+    if (v==0) {
+        *p++='0';
+        return p;
+    }
+
+    if (v>FLT_MAX) {
+        memcpy(p,"inf",3);
+        return p+3;
+    }
+
+    // Estimate the decimal exponent from the binary exponent and correct it.
+    int e;
+    frexp(v,&e);
+    e=((e-1)*77)>>8;
+
+    double scale;
+    if (e>=0 && e<=16) {
+        scale=POWERS[e];
+    }
+    else if (e<0 && e>=-16) {
+        scale=1.0/POWERS[-e];
+    }
+    else {
+        scale=pow(10.0,e);
+    }
+
+    if (v>=scale*10) {
+        ++e;
+        scale*=10;
+    }
+    else if (v<scale) {
+        --e;
+        scale/=10;
+    }
+
+    // Round to 9 significant digits.
+    g_uint64 digits=static_cast<g_uint64>(v/scale*1e8+0.5);
+    if (digits>=1000000000) {
+        digits/=10;
+        ++e;
+    }
+
+    // Strip trailing zeros.
+    int n=9;
+    while (digits%10==0) {
+        digits/=10;
+        --n;
+    }
+
+    char buffer[9];
+    for (int i=n-1;i>=0;--i) {
+        buffer[i]=static_cast<char>('0'+digits%10);
+        digits/=10;
+    }
+
+    if (e>=-5 && e<9) {
+        // Use fixed notation.
+        if (e<0) {
+            *p++='0';
+            *p++='.';
+            for (int i=-1;i>e;--i) {
+                *p++='0';
+            }
+            memcpy(p,buffer,n);
+            p+=n;
+        }
+        else {
+            for (int i=0;i<=e;++i) {
+                *p++=i<n ? buffer[i] : '0';
+            }
+            if (n>e+1) {
+                *p++='.';
+                memcpy(p,buffer+e+1,n-e-1);
+                p+=n-e-1;
+            }
+        }
+    }
+    else {
+        // Use scientific notation.
+        *p++=buffer[0];
+        if (n>1) {
+            *p++='.';
+            memcpy(p,buffer+1,n-1);
+            p+=n-1;
+        }
+        *p++='e';
+        if (e<0) {
+            *p++='-';
+            e=-e;
+        }
+        p=formatUInt(p,e);
+    }
+
+    return p;
+}
+
+// Function pointer type definition for formatting item i of data at p. Returns
+// the position after the item.
+typedef char* (*ItemFormatter)(char* p,void const* data,int const i);
+
+// Arguments for formatting a batch of items in parallel.
+struct FormatContext
+{
+    ItemFormatter format;
+    void const* data;
+    int first;
+    int length;
+    DynamicArray<char> buffers[Parallel::MAX_CHUNKS];
+    int sizes[Parallel::MAX_CHUNKS];
+};
+
+void formatKernel(void* context,int chunk,int begin,int end)
+{
+    FormatContext* c=static_cast<FormatContext*>(context);
+    DynamicArray<char>& buffer=c->buffers[chunk];
+
+    int size=(end-begin)*c->length;
+    if (buffer.getSize()<size) {
+        buffer.setSize(size);
+    }
+
+    char* p=buffer;
+    for (int i=begin;i<end;++i) {
+        p=c->format(p,c->data,c->first+i);
+    }
+    c->sizes[chunk]=static_cast<int>(p-buffer.data());
+}
+
+// Formats count items of data and writes them, where each item is at most
+// length characters long. Unless threads is 1, batches of items are formatted
+// in parallel and written in order, which only requires memory per batch.
+void writeItems(BlockWriter& writer,ItemFormatter format,void const* data,int const count,int const length,int const threads,FormatContext* context)
+{
+    if (threads==1 || count<=CHUNK_ITEMS) {
+        for (int i=0;i<count;++i) {
+            char* p=writer.reserve(length);
+            writer.commit(format(p,data,i));
+        }
+        return;
+    }
+
+    context->format=format;
+    context->data=data;
+    context->length=length;
+
+    int batch=Parallel::getChunkCount(count,threads,1)*CHUNK_ITEMS;
+    for (context->first=0;context->first<count;context->first+=batch) {
+        int chunks=Parallel::run(formatKernel,context,min(batch,count-context->first),threads,CHUNK_ITEMS);
+        for (int i=0;i<chunks;++i) {
+            writer.write(context->buffers[i],context->sizes[i]);
+        }
+    }
+}
+
+// The data required to format OBJ statements.
+struct OBJData
+{
+    Vec3f const* vectors;
+    unsigned int const* indices;
+    int size;
+};
+
+char* formatVector(char* p,char const* keyword,Vec3f const& v)
+{
+    while (*keyword) {
+        *p++=*keyword++;
+    }
+
+    for (int k=0;k<3;++k) {
+        *p++=' ';
+        p=formatFloat(p,v[k]);
+    }
+
+    *p++='\n';
+    return p;
+}
+
+char* formatVertex(char* p,void const* data,int const i)
+{
+    return formatVector(p,"v",static_cast<OBJData const*>(data)->vectors[i]);
+}
+
+char* formatNormal(char* p,void const* data,int const i)
+{
+    return formatVector(p,"vn",static_cast<OBJData const*>(data)->vectors[i]);
+}
+
+char* formatElement(char* p,void const* data,int const i)
+{
+    OBJData const* d=static_cast<OBJData const*>(data);
+    unsigned int const* indices=d->indices+i*d->size;
+
+    // Use the statement matching the number of indices.
+    *p++=d->size==1 ? 'p' : (d->size==2 ? 'l' : 'f');
+
+    for (int k=0;k<d->size;++k) {
+        *p++=' ';
+        p=formatUInt(p,indices[k]+1);
+
+        // Faces also reference the normal of the same index.
+        if (d->size>2) {
+            *p++='/';
+            *p++='/';
+            p=formatUInt(p,indices[k]+1);
+        }
+    }
+
+    *p++='\n';
+    return p;
+}
+
+// The maximum number of characters a formatted float takes.
+int const FLOAT_LENGTH=16;
+
+// The maximum number of characters a formatted index takes.
+int const INDEX_LENGTH=11;
+
+} // namespace
+
+unsigned int const PreparedMesh::Exporter::RAW_MAGIC;
+
+bool PreparedMesh::Exporter::OBJ(PreparedMesh const& mesh,char const* path,int const threads)
+{
+    BlockWriter writer(path);
+
+    FormatContext* context=new FormatContext;
+    OBJData data;
+
+    char const HEADER[]="# Exported by GALE, see https://github.com/sschuberth/gale/.\n";
+    writer.write(HEADER,sizeof(HEADER)-1);
+
+    // Write the vertices and normals.
+    data.vectors=mesh.m_vertices;
+    writeItems(writer,formatVertex,&data,mesh.m_vertices.getSize(),3+3*FLOAT_LENGTH,threads,context);
+
+    data.vectors=mesh.m_normals;
+    writeItems(writer,formatNormal,&data,mesh.m_normals.getSize(),4+3*FLOAT_LENGTH,threads,context);
+
+    // Write the primitives, where the number of indices per primitive equals
+    // the primitive type plus one.
+    for (int i=0;i<PI_COUNT;++i) {
+        data.indices=mesh.m_primitives[i];
+        data.size=i+1;
+        writeItems(writer,formatElement,&data,mesh.m_primitives[i].getSize()/data.size,3+data.size*(2*INDEX_LENGTH+3),threads,context);
+    }
+
+    // Write each polygon separately as their number of indices may vary.
+    for (int i=0;i<mesh.m_polygons.getSize();++i) {
+        data.indices=mesh.m_polygons[i];
+        data.size=mesh.m_polygons[i].getSize();
+        writeItems(writer,formatElement,&data,1,3+data.size*(2*INDEX_LENGTH+3),1,context);
+    }
+
+    delete context;
+    return writer.close();
+}
+
+bool PreparedMesh::Exporter::PLY(PreparedMesh const& mesh,char const* path)
+{
+    BlockWriter writer(path);
+
+    static int const ONE=1;
+    bool little_endian=(*reinterpret_cast<char const*>(&ONE)!=0);
+
+    int faces=mesh.numTriangles()+mesh.numQuads()+mesh.numPolys();
+
+    char header[512];
+    int size=sprintf(
+        header
+    ,   "ply\n"
+        "format binary_%s_endian 1.0\n"
+        "comment Exported by GALE, see https://github.com/sschuberth/gale/.\n"
+        "element vertex %d\n"
+        "property float x\nproperty float y\nproperty float z\n"
+        "property float nx\nproperty float ny\nproperty float nz\n"
+        "element face %d\n"
+        "property list uchar uint vertex_indices\n"
+        "element edge %d\n"
+        "property uint vertex1\nproperty uint vertex2\n"
+        "end_header\n"
+    ,   little_endian ? "little" : "big"
+    ,   mesh.numVertices()
+    ,   faces
+    ,   mesh.numLines()
+    );
+    writer.write(header,size);
+
+    // Interleave the vertices and normals.
+    size=2*sizeof(Mesh::VectorArray::Type);
+    for (int i=0;i<mesh.numVertices();++i) {
+        char* p=writer.reserve(size);
+        memcpy(p,&mesh.m_vertices[i],sizeof(Mesh::VectorArray::Type));
+        memcpy(p+size/2,&mesh.m_normals[i],sizeof(Mesh::VectorArray::Type));
+        writer.commit(p+size);
+    }
+
+    // Prefix each face with its number of indices.
+    for (int t=PI_TRIANGLES;t<=PI_QUADS;++t) {
+        Mesh::IndexArray const& indices=mesh.m_primitives[t];
+        unsigned char n=static_cast<unsigned char>(t+1);
+        size=1+n*sizeof(Mesh::IndexArray::Type);
+
+        for (int i=0;i<indices.getSize();i+=n) {
+            char* p=writer.reserve(size);
+            *p=n;
+            memcpy(p+1,&indices[i],size-1);
+            writer.commit(p+size);
+        }
+    }
+
+    for (int i=0;i<mesh.m_polygons.getSize();++i) {
+        Mesh::IndexArray const& indices=mesh.m_polygons[i];
+        unsigned char n=static_cast<unsigned char>(indices.getSize());
+        writer.write(&n,1);
+        writer.write(indices,n*sizeof(Mesh::IndexArray::Type));
+    }
+
+    Mesh::IndexArray const& lines=mesh.m_primitives[PI_LINES];
+    writer.write(lines,lines.getSize()*sizeof(Mesh::IndexArray::Type));
+
+    return writer.close();
+}
+
+bool PreparedMesh::Exporter::Raw(PreparedMesh const& mesh,char const* path)
+{
+    BlockWriter writer(path);
+
+    // Write the header.
+    writer.write(RAW_MAGIC);
+    writer.write(mesh.numVertices());
+
+    for (int i=0;i<PI_COUNT;++i) {
+        writer.write(mesh.m_primitives[i].getSize());
+    }
+
+    writer.write(mesh.numPolys());
+    for (int i=0;i<mesh.numPolys();++i) {
+        writer.write(mesh.m_polygons[i].getSize());
+    }
+
+    // Write the data, which consists of large blocks except for polygons.
+    writer.write(&mesh.box,sizeof(mesh.box));
+
+    size_t size=mesh.numVertices()*sizeof(Mesh::VectorArray::Type);
+    writer.write(mesh.m_vertices,size);
+    writer.write(mesh.m_normals,size);
+
+    for (int i=0;i<PI_COUNT;++i) {
+        writer.write(mesh.m_primitives[i],mesh.m_primitives[i].getSize()*sizeof(Mesh::IndexArray::Type));
+    }
+
+    for (int i=0;i<mesh.numPolys();++i) {
+        writer.write(mesh.m_polygons[i],mesh.m_polygons[i].getSize()*sizeof(Mesh::IndexArray::Type));
+    }
+
+    return writer.close();
+}
+
+} // namespace wrapgl
+
+} // namespace gale
+
+#endif // GALE_TINY_CODE
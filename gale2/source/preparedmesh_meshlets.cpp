@@ -0,0 +1,74 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/wrapgl/preparedmesh.h"
+
+#ifdef G_OS_WINDOWS
+    #include "gale/wrapgl/camera.h"
+#endif
+
+using namespace gale::model;
+
+namespace gale {
+
+namespace wrapgl {
+
+void PreparedMesh::partitionMeshlets()
+{
+    Mesh::IndexArray triangles;
+    triangulate(triangles);
+
+    m_meshlets.build(m_vertices,m_vertices.getSize(),triangles,triangles.getSize(),m_meshlet_vertices,m_meshlet_triangles);
+}
+
+void PreparedMesh::buildMeshlets(int const max_vertices,int const max_triangles)
+{
+    m_meshlet_vertices=max_vertices;
+    m_meshlet_triangles=max_triangles;
+
+    if (m_meshlet_vertices>0) {
+        partitionMeshlets();
+    }
+    else {
+        m_meshlets.clear();
+    }
+
+    if (m_vertices.getSize()>0) {
+        upload();
+    }
+}
+
+#ifdef G_OS_WINDOWS
+
+int PreparedMesh::cullMeshlets(Camera const& camera,Mesh::IndexArray& visible) const
+{
+    return m_meshlets.cull(!camera.getModelview(),camera.getProjection(),visible);
+}
+
+#endif // G_OS_WINDOWS
+
+} // namespace wrapgl
+
+} // namespace gale
@@ -0,0 +1,511 @@
+/*                                     __
+ *                      .-----..---.-.|  |.-----.
+ *                      |  _  ||  _  ||  ||  -__|
+ *                      |___  ||___._||__||_____|
+ * This file is part of |_____| the Graphics Abstraction Layer & Engine,
+ * see the project page at https://github.com/sschuberth/gale/.
+ *
+ * Copyright (C) 2005-2011  Sebastian Schuberth <sschuberth_AT_gmail_DOT_com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gale/wrapgl/preparedmesh.h"
+
+using namespace gale::global;
+using namespace gale::math;
+using namespace gale::model;
+
+namespace gale {
+
+namespace wrapgl {
+
+namespace {
+
+// Returns the unused triangle with the directed edge from vertex u to v, or -1.
+// The edges starting at each vertex are stored from offsets[u] to offsets[u+1]
+// as their end vertices and the triangles they belong to.
+inline int findTriangle(unsigned int const u,unsigned int const v,int const* offsets,unsigned int const* ends,int const* owners,bool const* used)
+{
+    for (int e=offsets[u];e<offsets[u+1];++e) {
+        if (ends[e]==v && !used[owners[e]]) {
+            return owners[e];
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+int PreparedMesh::countCacheMisses(unsigned int const* indices,int const count,int const cache_size,bool const lru)
+{
+    DynamicArray<unsigned int> cache(cache_size);
+    int used=0,next=0,misses=0;
+
+    for (int i=0;i<count;++i) {
+        unsigned int v=indices[i];
+
+        int c=0;
+        while (c<used && cache[c]!=v) {
+            ++c;
+        }
+
+        if (c<used) {
+            if (lru) {
+                // Move the hit to the front, i.e. the end of the array.
+                memmove(&cache[c],&cache[c+1],(used-c-1)*sizeof(unsigned int));
+                cache[used-1]=v;
+            }
+            continue;
+        }
+
+        ++misses;
+
+        if (used<cache_size) {
+            cache[used++]=v;
+        }
+        else if (lru) {
+            // Evict the least recently used entry at the start of the array.
+            memmove(&cache[0],&cache[1],(used-1)*sizeof(unsigned int));
+            cache[used-1]=v;
+        }
+        else {
+            // Evict the oldest entry by treating the array as a ring buffer.
+            cache[next]=v;
+            next=(next+1)%cache_size;
+        }
+    }
+
+    return misses;
+}
+
+void PreparedMesh::reorderFaces(unsigned int* indices,int const count,int const size,int const cache_size)
+{
+    int faces=count/size;
+    if (faces<=1) {
+        return;
+    }
+
+    int vertices=0;
+    for (int i=0;i<faces*size;++i) {
+        vertices=max(vertices,static_cast<int>(indices[i])+1);
+    }
+
+    // Build the table of faces per vertex; the valences count the faces that
+    // have not been emitted yet.
+    DynamicArray<int> valences(vertices),offsets(vertices+1),adjacency(faces*size);
+    memset(valences,0,vertices*sizeof(int));
+
+    for (int i=0;i<faces*size;++i) {
+        ++valences[indices[i]];
+    }
+
+    offsets[0]=0;
+    for (int v=0;v<vertices;++v) {
+        offsets[v+1]=offsets[v]+valences[v];
+    }
+
+    DynamicArray<int> fill(vertices);
+    memcpy(fill,offsets,vertices*sizeof(int));
+
+    for (int f=0;f<faces;++f) {
+        for (int k=0;k<size;++k) {
+            adjacency[fill[indices[f*size+k]]++]=f;
+        }
+    }
+
+    // Time stamps of when the vertices entered the simulated FIFO cache.
+    DynamicArray<int> stamps(vertices);
+    memset(stamps,0,vertices*sizeof(int));
+    int time=cache_size+1;
+
+    DynamicArray<bool> emitted(faces);
+    memset(emitted,0,faces*sizeof(bool));
+
+    // The vertices of all emitted faces in order, of which the most recent
+    // ones with remaining faces are used to restart when running into a dead
+    // end.
+    DynamicArray<unsigned int> dead_ends(faces*size);
+    int top=0;
+
+    DynamicArray<unsigned int> result(faces*size);
+    int r=0,scan=0;
+
+    int fan=indices[0];
+
+    while (fan>=0) {
+        int candidates=top;
+
+        // Emit all remaining faces around the current fanning vertex.
+        for (int a=offsets[fan];a<offsets[fan+1];++a) {
+            int f=adjacency[a];
+            if (emitted[f]) {
+                continue;
+            }
+            emitted[f]=true;
+
+            for (int k=0;k<size;++k) {
+                unsigned int v=indices[f*size+k];
+
+                result[r++]=v;
+                dead_ends[top++]=v;
+                --valences[v];
+
+                // Add the vertex to the cache if it is not in there anymore.
+                if (time-stamps[v]>cache_size) {
+                    stamps[v]=time++;
+                }
+            }
+        }
+
+        // Choose the next fanning vertex among the vertices just emitted, and
+        // prefer the oldest one that will still be in the cache after emitting
+        // all of its remaining faces.
+        fan=-1;
+        int best=-1;
+
+        for (int i=candidates;i<top;++i) {
+            unsigned int v=dead_ends[i];
+            if (valences[v]<=0) {
+                continue;
+            }
+
+            int priority=0;
+            if (time-stamps[v]+2*valences[v]<=cache_size) {
+                priority=time-stamps[v];
+            }
+
+            if (priority>best) {
+                best=priority;
+                fan=v;
+            }
+        }
+
+        if (fan<0) {
+            // Restart at the most recently used vertex with remaining faces.
+            while (top>0) {
+                unsigned int v=dead_ends[--top];
+                if (valences[v]>0) {
+                    fan=v;
+                    break;
+                }
+            }
+        }
+
+        if (fan<0) {
+            // Restart at the next vertex with remaining faces in index order.
+            while (scan<vertices && valences[scan]<=0) {
+                ++scan;
+            }
+            if (scan<vertices) {
+                fan=scan;
+            }
+        }
+    }
+
+    memcpy(indices,result,faces*size*sizeof(unsigned int));
+}
+
+void PreparedMesh::stripify(unsigned int const* indices,int const count,Mesh::IndexArray& strip)
+{
+    strip.clear();
+
+    int triangles=count/3;
+    if (triangles<=0) {
+        return;
+    }
+
+    int vertices=0;
+    for (int i=0;i<triangles*3;++i) {
+        vertices=max(vertices,static_cast<int>(indices[i])+1);
+    }
+
+    // Build a table of the directed edges starting at each vertex, storing the
+    // edge's end vertex and the triangle it belongs to.
+    DynamicArray<int> offsets(vertices+1),fill(vertices);
+    memset(offsets,0,(vertices+1)*sizeof(int));
+
+    for (int i=0;i<triangles*3;++i) {
+        ++offsets[indices[i]+1];
+    }
+
+    for (int v=0;v<vertices;++v) {
+        offsets[v+1]+=offsets[v];
+    }
+
+    memcpy(fill,offsets,vertices*sizeof(int));
+
+    DynamicArray<unsigned int> ends(triangles*3);
+    DynamicArray<int> owners(triangles*3);
+
+    for (int t=0;t<triangles;++t) {
+        for (int k=0;k<3;++k) {
+            int e=fill[indices[t*3+k]]++;
+            ends[e]=indices[t*3+(k+1)%3];
+            owners[e]=t;
+        }
+    }
+
+    DynamicArray<bool> used(triangles);
+    memset(used,0,triangles*sizeof(bool));
+
+    for (int t=0;t<triangles;++t) {
+        if (used[t]) {
+            continue;
+        }
+        used[t]=true;
+
+        // Choose the rotation of the starting triangle that can be continued,
+        // i.e. whose edge from the last to the second vertex has a neighbor.
+        unsigned int const* face=&indices[t*3];
+        int r=0;
+        while (r<3 && findTriangle(face[(r+2)%3],face[(r+1)%3],offsets,ends,owners,used)<0) {
+            ++r;
+        }
+        r%=3;
+
+        if (strip.getSize()>0) {
+            // Stitch to the previous strip using degenerate triangles, and make
+            // sure the new strip starts at an even position to keep the winding.
+            strip.insert(strip.last());
+            strip.insert(face[r]);
+            if (strip.getSize()%2!=0) {
+                strip.insert(face[r]);
+            }
+        }
+
+        strip.insert(face[r]);
+        strip.insert(face[(r+1)%3]);
+        strip.insert(face[(r+2)%3]);
+
+        for (;;) {
+            // Triangles at odd positions in the strip are rendered with swapped
+            // first vertices, so the shared edge needs to be reversed.
+            int n=strip.getSize();
+            unsigned int p=strip[n-2],q=strip[n-1];
+            if (n%2!=0) {
+                unsigned int tmp=p;
+                p=q;
+                q=tmp;
+            }
+
+            int next=findTriangle(p,q,offsets,ends,owners,used);
+            if (next<0) {
+                break;
+            }
+            used[next]=true;
+
+            // Append the triangle's vertex that is opposite to the edge.
+            unsigned int const* f=&indices[next*3];
+            int k=0;
+            while (f[k]!=p || f[(k+1)%3]!=q) {
+                ++k;
+            }
+            strip.insert(f[(k+2)%3]);
+        }
+    }
+}
+
+void PreparedMesh::triangulate(Mesh::IndexArray& triangles) const
+{
+    triangles.insert(m_primitives[PI_TRIANGLES]);
+
+    // Triangulate quadrilaterals and polygons as fans around their first vertex.
+    Mesh::IndexArray const& quads=m_primitives[PI_QUADS];
+    for (int i=0;i<quads.getSize();i+=4) {
+        unsigned int f[]={quads[i],quads[i+1],quads[i+2],quads[i],quads[i+2],quads[i+3]};
+        triangles.insert(f);
+    }
+
+    for (int p=0;p<m_polygons.getSize();++p) {
+        Mesh::IndexArray const& polygon=m_polygons[p];
+        for (int i=2;i<polygon.getSize();++i) {
+            unsigned int f[]={polygon[0],polygon[i-1],polygon[i]};
+            triangles.insert(f);
+        }
+    }
+}
+
+void PreparedMesh::buildStrip()
+{
+    Mesh::IndexArray triangles;
+    triangulate(triangles);
+
+    stripify(triangles,triangles.getSize(),m_strip);
+}
+
+void PreparedMesh::setStripMode(bool const enable)
+{
+    if (enable==m_strip_mode) {
+        return;
+    }
+
+    m_strip_mode=enable;
+
+    if (m_strip_mode) {
+        buildStrip();
+    }
+    else {
+        m_strip.clear();
+    }
+
+    if (m_vertices.getSize()>0) {
+        upload();
+    }
+}
+
+int PreparedMesh::numIndices() const
+{
+    int count=m_primitives[PI_POINTS].getSize()+m_primitives[PI_LINES].getSize();
+
+    if (m_strip_mode) {
+        return count+m_strip.getSize();
+    }
+
+    count+=m_primitives[PI_TRIANGLES].getSize()+m_primitives[PI_QUADS].getSize();
+    for (int p=0;p<m_polygons.getSize();++p) {
+        count+=m_polygons[p].getSize();
+    }
+
+    return count;
+}
+
+int PreparedMesh::numDrawCalls() const
+{
+    int calls=0;
+
+    if (m_strip_mode) {
+        for (int i=PI_POINTS;i<PI_TRIANGLES;++i) {
+            calls+=m_primitives[i].getSize()>0;
+        }
+        return calls+(m_strip.getSize()>0);
+    }
+
+    for (int i=0;i<PI_COUNT;++i) {
+        calls+=m_primitives[i].getSize()>0;
+    }
+
+    return calls+m_polygons.getSize();
+}
+
+float PreparedMesh::getACMR(int const cache_size,bool const lru) const
+{
+    int triangles=numTriangles()+numQuads()*2;
+    if (triangles==0) {
+        return 0.0f;
+    }
+
+    int misses=0;
+    for (int i=PI_TRIANGLES;i<PI_COUNT;++i) {
+        misses+=countCacheMisses(m_primitives[i],m_primitives[i].getSize(),cache_size,lru);
+    }
+
+    return float(misses)/triangles;
+}
+
+void PreparedMesh::optimize(int const cache_size)
+{
+    int n=m_vertices.getSize();
+    if (n<=0) {
+        return;
+    }
+
+    for (int i=PI_TRIANGLES;i<PI_COUNT;++i) {
+        reorderFaces(m_primitives[i],m_primitives[i].getSize(),i+1,cache_size);
+    }
+
+    // Assign new vertex indices in the order the vertices are first used when
+    // rendering, unused vertices keep their relative order at the end.
+    unsigned int const UNUSED=~0U;
+
+    Mesh::IndexArray remap(n);
+    for (int i=0;i<n;++i) {
+        remap[i]=UNUSED;
+    }
+
+    unsigned int next=0;
+
+    for (int i=0;i<PI_COUNT;++i) {
+        Mesh::IndexArray const& indices=m_primitives[i];
+        for (int k=0;k<indices.getSize();++k) {
+            if (remap[indices[k]]==UNUSED) {
+                remap[indices[k]]=next++;
+            }
+        }
+    }
+
+    for (int p=0;p<m_polygons.getSize();++p) {
+        Mesh::IndexArray const& polygon=m_polygons[p];
+        for (int k=0;k<polygon.getSize();++k) {
+            if (remap[polygon[k]]==UNUSED) {
+                remap[polygon[k]]=next++;
+            }
+        }
+    }
+
+    for (int i=0;i<n;++i) {
+        if (remap[i]==UNUSED) {
+            remap[i]=next++;
+        }
+    }
+
+    // Permute the vertices and normals, and keep track of the mesh vertex each
+    // vertex originates from.
+    Mesh::VectorArray vertices(n),normals(n);
+    Mesh::IndexArray sources(n);
+
+    for (int i=0;i<n;++i) {
+        unsigned int r=remap[i];
+        vertices[r]=m_vertices[i];
+        normals[r]=m_normals[i];
+        sources[r]=m_sources.getSize()>0?m_sources[i]:i;
+    }
+
+    m_vertices.swap(vertices);
+    m_normals.swap(normals);
+    m_sources.swap(sources);
+
+    // The faces are renumbered and reordered, so sort their corners again.
+    clearCorners();
+
+    for (int i=0;i<PI_COUNT;++i) {
+        Mesh::IndexArray& indices=m_primitives[i];
+        for (int k=0;k<indices.getSize();++k) {
+            indices[k]=remap[indices[k]];
+        }
+    }
+
+    for (int p=0;p<m_polygons.getSize();++p) {
+        Mesh::IndexArray& polygon=m_polygons[p];
+        for (int k=0;k<polygon.getSize();++k) {
+            polygon[k]=remap[polygon[k]];
+        }
+    }
+
+    if (m_strip_mode) {
+        buildStrip();
+    }
+
+    if (m_meshlet_vertices>0) {
+        partitionMeshlets();
+    }
+
+    upload();
+}
+
+} // namespace wrapgl
+
+} // namespace gale
@@ -27,6 +27,13 @@
 
 #include "gale/global/platform.h"
 
+#ifdef GALE_USE_VBO
+    #include "GLEX_VERSION_2_0.h"
+    #include "GLEX_ARB_draw_instanced.h"
+    #include "GLEX_ARB_instanced_arrays.h"
+#endif
+
+using namespace gale::global;
 using namespace gale::math;
 using namespace gale::model;
 
@@ -34,12 +41,67 @@ namespace gale {
 
 namespace wrapgl {
 
-void Renderer::draw(PreparedMesh const& prep)
+namespace {
+
+// Issues a single draw call, instanced if the number of instances is positive.
+inline void drawElements(GLenum const mode,GLsizei const count,GLenum const type,GLvoid const* indices,int const instances)
 {
-    if (!prep.hasData()) {
-        return;
+#ifdef GALE_USE_VBO
+    if (instances>0) {
+        glDrawElementsInstancedARB(mode,count,type,indices,instances);
+    }
+    else
+#else
+    G_UNREF_PARAM(instances)
+#endif
+    {
+        glDrawElements(mode,count,type,indices);
+    }
+    G_ASSERT_OPENGL
+}
+
+#ifdef GALE_USE_VBO
+
+// Returns whether instances can be drawn with a single call, which requires a
+// program to be in use that reads the per-instance attributes.
+bool hasInstancing()
+{
+    if (!(GLEX_VERSION_2_0 || GLEX_VERSION_2_0_init())) {
+        return false;
+    }
+
+    if (!(GLEX_ARB_draw_instanced || GLEX_ARB_draw_instanced_init())) {
+        return false;
+    }
+
+    if (!(GLEX_ARB_instanced_arrays || GLEX_ARB_instanced_arrays_init())) {
+        return false;
     }
 
+    GLint program=0;
+    glGetIntegerv(GL_CURRENT_PROGRAM,&program);
+    G_ASSERT_OPENGL
+
+    return program!=0;
+}
+
+// Returns the buffer object to stream the per-instance data to, which is
+// created on first use as it requires a rendering context.
+ArrayBufferObject& instanceBuffer()
+{
+    static ArrayBufferObject* buffer=NULL;
+    if (!buffer) {
+        buffer=new ArrayBufferObject;
+    }
+    return *buffer;
+}
+
+#endif // GALE_USE_VBO
+
+} // namespace
+
+void Renderer::bind(PreparedMesh const& prep,bool const dequantize)
+{
 #ifdef GALE_USE_VBO
     if (prep.m_vao.isValidHandle()) {
         prep.m_vao.bind();
@@ -57,8 +119,8 @@ void Renderer::draw(PreparedMesh const& prep)
         glEnableClientState(GL_NORMAL_ARRAY);
         G_ASSERT_OPENGL
 
-        glVertexPointer(3,GL_FLOAT,0,prep.vertexPointer());
-        glNormalPointer(GL_FLOAT,0,prep.normalPointer());
+        glVertexPointer(3,prep.vertexType(),0,prep.vertexPointer());
+        glNormalPointer(prep.normalType(),0,prep.normalPointer());
         G_ASSERT_OPENGL
 
 #ifdef GALE_USE_VBO
@@ -69,38 +131,299 @@ void Renderer::draw(PreparedMesh const& prep)
         prep.m_vao.setDirtyState(false);
     }
 
-    Mesh::IndexArray::Type const* indices_ptr=NULL;
+    if (dequantize && prep.vertexType()!=GL_FLOAT) {
+        // Restore the positions from their quantized values. As the scaling is
+        // uniform, normals just need to be renormalized.
+        glPushAttrib(GL_ENABLE_BIT|GL_TRANSFORM_BIT);
+        glEnable(GL_NORMALIZE);
+
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glTranslatef(prep.m_center.getX(),prep.m_center.getY(),prep.m_center.getZ());
+        glScalef(prep.m_scale,prep.m_scale,prep.m_scale);
+        G_ASSERT_OPENGL
+    }
+#else
+    G_UNREF_PARAM(dequantize)
 #endif
+}
 
-    // Render the different indexed primitives, if any.
-    for (int i=0;i<PreparedMesh::PI_COUNT;++i) {
+void Renderer::release(PreparedMesh const& prep,bool const dequantize)
+{
 #ifdef GALE_USE_VBO
-        glDrawElements(PreparedMesh::GL_PRIM_TYPE[i],prep.m_primitives[i].getSize(),GL_UNSIGNED_INT,indices_ptr);
-        indices_ptr+=prep.m_primitives[i].getSize();
+    if (dequantize && prep.vertexType()!=GL_FLOAT) {
+        glPopMatrix();
+        glPopAttrib();
+        G_ASSERT_OPENGL
+    }
+
+    if (prep.m_vao.isValidHandle()) {
+        // Make sure no other changes accidently modify the state vector.
+        prep.m_vao.release();
+    }
 #else
-        glDrawElements(PreparedMesh::GL_PRIM_TYPE[i],prep.m_primitives[i].getSize(),GL_UNSIGNED_INT,prep.m_primitives[i]);
+    G_UNREF_PARAM(prep)
+    G_UNREF_PARAM(dequantize)
+#endif
+}
+
+void Renderer::submit(PreparedMesh const& prep,int const instances)
+{
+#ifdef GALE_USE_VBO
+    // Indices may be 16-bit, so advance the offset in bytes.
+    GLubyte const* indices_ptr=NULL;
+    int index_size=prep.getIndexSize();
+#endif
+
+    // Render the different indexed primitives, if any. In strip mode, all faces
+    // are contained in a single triangle strip.
+    int faces=prep.m_strip_mode?PreparedMesh::PI_TRIANGLES:PreparedMesh::PI_COUNT;
+
+    for (int i=0;i<faces;++i) {
+        if (prep.m_primitives[i].getSize()==0) {
+            continue;
+        }
+
+#ifdef GALE_USE_VBO
+        drawElements(PreparedMesh::GL_PRIM_TYPE[i],prep.m_primitives[i].getSize(),prep.indexType(),indices_ptr,instances);
+        indices_ptr+=prep.m_primitives[i].getSize()*index_size;
+#else
+        drawElements(PreparedMesh::GL_PRIM_TYPE[i],prep.m_primitives[i].getSize(),GL_UNSIGNED_INT,prep.m_primitives[i],instances);
+#endif
+    }
+
+    if (prep.m_strip_mode) {
+        if (prep.m_strip.getSize()>0) {
+#ifdef GALE_USE_VBO
+            drawElements(GL_TRIANGLE_STRIP,prep.m_strip.getSize(),prep.indexType(),indices_ptr,instances);
+#else
+            drawElements(GL_TRIANGLE_STRIP,prep.m_strip.getSize(),GL_UNSIGNED_INT,prep.m_strip,instances);
+#endif
+        }
+    }
+    else {
+        // As polygons do not have a fixed number of vertices, each one has its
+        // own index array instead of a single array for all the primitive's
+        // vertices.
+        for (int i=0;i<prep.m_polygons.getSize();++i) {
+#ifdef GALE_USE_VBO
+            drawElements(GL_POLYGON,prep.m_polygons[i].getSize(),prep.indexType(),indices_ptr,instances);
+            indices_ptr+=prep.m_polygons[i].getSize()*index_size;
+#else
+            drawElements(GL_POLYGON,prep.m_polygons[i].getSize(),GL_UNSIGNED_INT,prep.m_polygons[i],instances);
+#endif
+        }
+    }
+}
+
+void Renderer::draw(PreparedMesh const& prep)
+{
+    if (!prep.hasData()) {
+        return;
+    }
+
+    bind(prep);
+    submit(prep);
+    release(prep);
+}
+
+void Renderer::draw(PreparedMesh const& prep,Mesh::IndexArray const& meshlets)
+{
+    if (meshlets.getSize()==0) {
+        return;
+    }
+
+    Meshlets const& m=prep.getMeshlets();
+
+    bind(prep);
+
+#ifdef GALE_USE_VBO
+    // The meshlets' triangles follow all other indices.
+    int index_size=prep.getIndexSize();
+    GLubyte const* indices_ptr=static_cast<GLubyte const*>(NULL)+prep.numIndices()*index_size;
+#endif
+
+    for (int i=0;i<meshlets.getSize();) {
+        int begin=m.getBegin(meshlets[i]),end=m.getEnd(meshlets[i]);
+
+        // Render adjacent meshlets with a single call.
+        for (++i;i<meshlets.getSize() && m.getBegin(meshlets[i])==end;++i) {
+            end=m.getEnd(meshlets[i]);
+        }
+
+#ifdef GALE_USE_VBO
+        glDrawElements(GL_TRIANGLES,end-begin,prep.indexType(),indices_ptr+begin*index_size);
+#else
+        glDrawElements(GL_TRIANGLES,end-begin,GL_UNSIGNED_INT,&m.indices()[begin]);
+#endif
+        G_ASSERT_OPENGL
+    }
+
+    release(prep);
+}
+
+struct Renderer::Backend
+{
+    // Instanced drawing streams the per-instance data to a buffer object,
+    // otherwise the instances are drawn using the modelview matrix and the
+    // current color.
+    explicit Backend(bool const instanced)
+    :   instanced(instanced)
+    ,   dequantize(false)
+    {}
+
+    void bind(PreparedMesh const& prep) {
+        Renderer::bind(prep,false);
+
+        if (instanced) {
+            return;
+        }
+
+        glPushAttrib(GL_CURRENT_BIT|GL_ENABLE_BIT|GL_TRANSFORM_BIT);
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+
+#ifdef GALE_USE_VBO
+        dequantize=prep.vertexType()!=GL_FLOAT;
+        if (dequantize) {
+            glEnable(GL_NORMALIZE);
+        }
 #endif
         G_ASSERT_OPENGL
     }
 
-    // As polygons do not have a fixed number of vertices, each one has its own
-    // index array instead of a single array for all the primitive's vertices.
-    for (int i=0;i<prep.m_polygons.getSize();++i) {
+    void release(PreparedMesh const& prep) {
+        if (instanced) {
 #ifdef GALE_USE_VBO
-        glDrawElements(GL_POLYGON,prep.m_polygons[i].getSize(),GL_UNSIGNED_INT,indices_ptr);
-        indices_ptr+=prep.m_polygons[i].getSize();
+            for (GLuint attrib=INSTANCE_TRANSFORM_ATTRIB;attrib<=INSTANCE_COLOR_ATTRIB;++attrib) {
+                glVertexAttribDivisorARB(attrib,0);
+                glDisableVertexAttribArray(attrib);
+            }
+            G_ASSERT_OPENGL
+
+            // Restore the buffer object the arrays were set up with.
+            prep.m_vbo_vertnorm.bind();
+#endif
+        }
+        else {
+            glPopMatrix();
+            glPopAttrib();
+            G_ASSERT_OPENGL
+        }
+
+        Renderer::release(prep,false);
+    }
+
+    void transform(PreparedMesh const& prep,HMat4f const& transform) {
+        // Start over from the modelview matrix saved by bind().
+        glPopMatrix();
+        glPushMatrix();
+        glMultMatrixf(transform);
+
+#ifdef GALE_USE_VBO
+        if (dequantize) {
+            glTranslatef(prep.m_center.getX(),prep.m_center.getY(),prep.m_center.getZ());
+            glScalef(prep.m_scale,prep.m_scale,prep.m_scale);
+        }
 #else
-        glDrawElements(GL_POLYGON,prep.m_polygons[i].getSize(),GL_UNSIGNED_INT,prep.m_polygons[i]);
+        G_UNREF_PARAM(prep)
 #endif
         G_ASSERT_OPENGL
     }
 
+    void color(Col4f const& color) {
+        glColor4fv(color);
+        G_ASSERT_OPENGL
+    }
+
+    void upload(PreparedMesh const& prep,HMat4f const* transforms,int const count,Col4f const* colors) {
 #ifdef GALE_USE_VBO
-    if (prep.m_vao.isValidHandle()) {
-        // Make sure no other changes accidently modify the state vector.
-        prep.m_vao.release();
+        // Quantized positions need to be restored before applying the instances'
+        // transformations, so combine both on upload.
+        DynamicArray<HMat4f> staging;
+        if (prep.vertexType()!=GL_FLOAT) {
+            float s=prep.m_scale;
+            HMat4f dequantization(Vec3f(s,0,0),Vec3f(0,s,0),Vec3f(0,0,s),prep.m_center);
+
+            staging.setSize(count);
+            for (int i=0;i<count;++i) {
+                staging[i]=transforms[i]*dequantization;
+            }
+            transforms=staging;
+        }
+
+        // Orphan the previous storage so the driver does not need to wait for
+        // pending draw calls to finish using it.
+        GLsizeiptrARB transforms_size=count*sizeof(HMat4f);
+        GLsizeiptrARB colors_size=colors?count*sizeof(Col4f):0;
+
+        ArrayBufferObject& buffer=instanceBuffer();
+        buffer.setData(GL_STREAM_DRAW_ARB,transforms_size+colors_size,NULL);
+        buffer.setData(transforms_size,transforms);
+        if (colors) {
+            buffer.setData(colors_size,colors,transforms_size);
+        }
+
+        // Enabling the attributes after binding the mesh makes them part of its
+        // Vertex Array Object, if any, so release() disables them again.
+        buffer.bind();
+
+        GLubyte const* offset=NULL;
+        for (GLuint c=0;c<4;++c) {
+            GLuint attrib=INSTANCE_TRANSFORM_ATTRIB+c;
+            glEnableVertexAttribArray(attrib);
+            glVertexAttribPointer(attrib,4,GL_FLOAT,GL_FALSE,sizeof(HMat4f),offset+c*4*sizeof(float));
+            glVertexAttribDivisorARB(attrib,1);
+        }
+
+        if (colors) {
+            glEnableVertexAttribArray(INSTANCE_COLOR_ATTRIB);
+            glVertexAttribPointer(INSTANCE_COLOR_ATTRIB,4,GL_FLOAT,GL_FALSE,sizeof(Col4f),offset+transforms_size);
+            glVertexAttribDivisorARB(INSTANCE_COLOR_ATTRIB,1);
+        }
+        G_ASSERT_OPENGL
+#else
+        // Without buffer objects, instances are never drawn with a single call.
+        G_UNREF_PARAM(prep)
+        G_UNREF_PARAM(transforms)
+        G_UNREF_PARAM(count)
+        G_UNREF_PARAM(colors)
+#endif
     }
+
+    void submit(PreparedMesh const& prep,int const instances) {
+        Renderer::submit(prep,instances);
+    }
+
+    bool instanced;  ///< Whether all instances are drawn with a single call.
+    bool dequantize; ///< Whether quantized positions need to be restored per instance.
+};
+
+void Renderer::draw(PreparedMesh const& prep,HMat4f const* transforms,int const count,Col4f const* colors)
+{
+    if (!prep.hasData() || count<=0) {
+        return;
+    }
+
+#ifdef GALE_USE_VBO
+    bool instanced=hasInstancing();
+#else
+    bool instanced=false;
 #endif
+
+    // Set up the mesh only once, then draw the instances in a loop or with a
+    // single call.
+    typedef InstanceBatch<PreparedMesh> Batch;
+
+    Backend backend(instanced);
+    Batch::render(backend,prep,transforms,count,colors,instanced?Batch::MODE_INSTANCED:Batch::MODE_BATCHED);
+}
+
+void Renderer::draw(InstanceBatch<PreparedMesh> const& batch)
+{
+    for (int k=0;k<batch.numGroups();++k) {
+        draw(batch.getMesh(k),batch.getTransforms(k),batch.getCount(k),batch.getColors(k));
+    }
 }
 
 void Renderer::draw(AABB const& box)
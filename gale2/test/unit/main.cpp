@@ -7,17 +7,32 @@
 
 #include <gale/global/dynamicarray.h>
 
+#include <gale/math/alignedvector.h>
+#include <gale/math/batch.h>
 #include <gale/math/biasscale.h>
 #include <gale/math/color.h>
 #include <gale/math/colormodel.h>
+#include <gale/math/expression.h>
+#include <gale/math/fastmath.h>
 #include <gale/math/hmatrix4.h>
+#include <gale/math/interpolator.h>
 #include <gale/math/matrix4.h>
+#include <gale/math/packet.h>
+#include <gale/math/packing.h>
 #include <gale/math/quaternion.h>
 #include <gale/math/random.h>
 
+#include <gale/model/mesh.h>
+#include <gale/model/meshlets.h>
+
 #include <gale/system/cpuinfo.h>
 #include <gale/system/timer.h>
 
+#include <gale/wrapgl/instancebatch.h>
+#include <gale/wrapgl/lodmesh.h>
+#include <gale/wrapgl/meshbatcher.h>
+#include <gale/wrapgl/preparedmesh.h>
+
 #define CATCH_CONFIG_RUNNER
 #include <catch.hpp>
 
@@ -193,6 +208,295 @@ TEST_CASE("Matrix class tests") {
     }
 }
 
+TEST_CASE("Matrix kernel tests") {
+    using namespace gale::math;
+    using namespace gale::system;
+    using gale::meta::OpCmpEqual;
+    using gale::meta::OpCmpEqualRel;
+
+    RandomEcuyerd r;
+
+    Mat4f mf[16];
+    Mat4d md[16];
+    for (int i = 0; i < 16; ++i) {
+        md[i] = Mat4d::random(r);
+        for (int k = 0; k < 16; ++k) {
+            mf[i][k] = static_cast<float>(md[i][k]);
+        }
+    }
+
+    int const max_level = Matrix4KernelSet::maxLevel();
+    INFO("Maximum kernel level is " << max_level);
+
+    SECTION("Correctness") {
+        for (int level = Matrix4KernelSet::LEVEL_SCALAR; level <= max_level; ++level) {
+            CAPTURE(level);
+            Matrix4KernelSet const& set = Matrix4KernelSet::get(static_cast<Matrix4KernelSet::Level>(level));
+            REQUIRE(set.level == level);
+
+            for (int i = 0; i < 15; ++i) {
+                float ef[16], rf[16];
+                double ed[16], rd[16];
+
+                Matrix4ScalarKernels<float>::mulMatMat(ef, mf[i], mf[i + 1]);
+                set.mulMatMatf(rf, mf[i], mf[i + 1]);
+                for (int k = 0; k < 16; ++k) {
+                    REQUIRE(OpCmpEqual::evaluate(rf[k], ef[k], 1e-5f));
+                }
+
+                Matrix4ScalarKernels<float>::mulMatVec(ef, mf[i], mf[i + 1]);
+                set.mulMatVecf(rf, mf[i], mf[i + 1]);
+                Matrix4ScalarKernels<float>::mulVecMat(ef + 4, mf[i], mf[i + 1]);
+                set.mulVecMatf(rf + 4, mf[i], mf[i + 1]);
+                for (int k = 0; k < 8; ++k) {
+                    REQUIRE(OpCmpEqual::evaluate(rf[k], ef[k], 1e-5f));
+                }
+
+                Matrix4ScalarKernels<double>::mulMatMat(ed, md[i], md[i + 1]);
+                set.mulMatMatd(rd, md[i], md[i + 1]);
+                for (int k = 0; k < 16; ++k) {
+                    REQUIRE(OpCmpEqual::evaluate(rd[k], ed[k], 1e-12));
+                }
+
+                Matrix4ScalarKernels<double>::mulMatVec(ed, md[i], md[i + 1]);
+                set.mulMatVecd(rd, md[i], md[i + 1]);
+                Matrix4ScalarKernels<double>::mulVecMat(ed + 4, md[i], md[i + 1]);
+                set.mulVecMatd(rd + 4, md[i], md[i + 1]);
+                for (int k = 0; k < 8; ++k) {
+                    REQUIRE(OpCmpEqual::evaluate(rd[k], ed[k], 1e-12));
+                }
+            }
+        }
+
+        // The operators use the kernels selected at compile time.
+        Mat4d e;
+        Matrix4ScalarKernels<double>::mulMatMat(e, md[0], md[1]);
+        REQUIRE((md[0] * md[1]) == e);
+
+        Vec4d v = md[2].c0, w;
+        Matrix4ScalarKernels<double>::mulMatVec(w, md[0], v);
+        REQUIRE((md[0] * v) == w);
+        Matrix4ScalarKernels<double>::mulVecMat(w, md[0], v);
+        REQUIRE(md[0].mulVecMat(v) == w);
+    }
+
+    SECTION("Inversion and batches") {
+        for (int i = 0; i < 15; ++i) {
+            float ef[16], rf[16];
+            double ed[16], rd[16];
+
+            // The compile time kernels compared to the scalar reference.
+            float df = Matrix4ScalarKernels<float>::adjoint(ef, mf[i]);
+            REQUIRE(OpCmpEqualRel::evaluate(Matrix4Kernels<float>::adjoint(rf, mf[i]), df, 1e-5f, 1e-4f));
+            for (int k = 0; k < 16; ++k) {
+                REQUIRE(OpCmpEqualRel::evaluate(rf[k], ef[k], 1e-5f, 1e-4f));
+            }
+
+            double dd = Matrix4ScalarKernels<double>::adjoint(ed, md[i]);
+            REQUIRE(OpCmpEqualRel::evaluate(Matrix4Kernels<double>::adjoint(rd, md[i]), dd, 1e-12, 1e-10));
+            for (int k = 0; k < 16; ++k) {
+                REQUIRE(OpCmpEqualRel::evaluate(rd[k], ed[k], 1e-12, 1e-10));
+            }
+            REQUIRE(OpCmpEqualRel::evaluate(md[i].determinant(), dd, 1e-12, 1e-10));
+
+            Matrix4Kernels<double>::transpose(rd, md[i]);
+            for (int k = 0; k < 16; ++k) {
+                REQUIRE(rd[k] == md[i](k >> 2, k & 3));
+            }
+
+            Mat4d inv = !md[i];
+            REQUIRE((md[i] * inv) == Mat4d::IDENTITY());
+
+            Mat4d t = md[i];
+            t.transpose();
+            t.transpose();
+            REQUIRE(t == md[i]);
+        }
+
+        HMat4d h = HMat4d::Factory::Rotation(Vec3d::random(r), r.random0ExclN(Constd::PI() * 2));
+        h *= HMat4d::Factory::Translation(Vec3d::random(r), r.randomExcl0N(10.0));
+        h *= HMat4d::Factory::Scaling(r.randomExcl0N(10.0), r.randomExcl0N(10.0), r.randomExcl0N(10.0));
+
+        double ea[16], ra[16];
+        Matrix4ScalarKernels<double>::invertAffine(ea, h);
+        Matrix4Kernels<double>::invertAffine(ra, h);
+        for (int k = 0; k < 16; ++k) {
+            REQUIRE(OpCmpEqualRel::evaluate(ra[k], ea[k], 1e-12, 1e-10));
+        }
+        REQUIRE((h * !h) == HMat4d::IDENTITY());
+
+        HMat4f hf;
+        for (int k = 0; k < 16; ++k) {
+            hf[k] = static_cast<float>(h[k]);
+        }
+        HMat4f hi = !hf;
+        REQUIRE(hi[3] == 0);
+        REQUIRE(hi[15] == 1);
+        REQUIRE((hf * hi).c3.equals(Vec3f::ZERO(), 1e-4f));
+
+        // Batched products compared to the single products.
+        Mat4d bd[15];
+        Mat4d::multiply(bd, md, md + 1, 15);
+        for (int i = 0; i < 15; ++i) {
+            REQUIRE(bd[i] == md[i] * md[i + 1]);
+        }
+        Mat4d::multiply(bd, md[0], md + 1, 15);
+        for (int i = 0; i < 15; ++i) {
+            REQUIRE(bd[i] == md[0] * md[i + 1]);
+        }
+
+        Mat4f bf[15];
+        Mat4f::multiply(bf, mf[15], mf, 15);
+        for (int i = 0; i < 15; ++i) {
+            Mat4f e = mf[15] * mf[i];
+            for (int k = 0; k < 16; ++k) {
+                REQUIRE(OpCmpEqualRel::evaluate(bf[i][k], e[k], 1e-5f, 1e-5f));
+            }
+        }
+
+        HMat4d hm[4] = { h, !h, h * h, HMat4d::IDENTITY() }, hr[4];
+        HMat4d::multiply(hr, hm, hm, 4);
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(hr[i] == hm[i] * hm[i]);
+        }
+        HMat4d::multiply(hr, h, hm, 4);
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(hr[i] == h * hm[i]);
+            REQUIRE(hr[i][15] == 1);
+        }
+    }
+
+    SECTION("Benchmark") {
+        int const N = 4000000;
+        Timer timer;
+        double s;
+
+        for (int level = Matrix4KernelSet::LEVEL_SCALAR; level <= max_level; ++level) {
+            Matrix4KernelSet const& set = Matrix4KernelSet::get(static_cast<Matrix4KernelSet::Level>(level));
+
+            float rf[16];
+            timer.reset();
+            for (int i = 0; i < N; ++i) {
+                set.mulMatMatf(rf, mf[i & 15], mf[(i + 1) & 15]);
+            }
+            timer.stop(s);
+            double pf = N / s;
+
+            double rd[16];
+            timer.reset();
+            for (int i = 0; i < N; ++i) {
+                set.mulMatMatd(rd, md[i & 15], md[(i + 1) & 15]);
+            }
+            timer.stop(s);
+            double pd = N / s;
+
+            timer.reset();
+            for (int i = 0; i < N; ++i) {
+                set.mulMatVecd(rd, md[i & 15], md[(i + 1) & 15]);
+            }
+            timer.stop(s);
+            double pv = N / s;
+
+            INFO("Level " << level << ": " << pf << " Mat4f products, " << pd << " Mat4d products, " << pv << " Mat4d / Vec4d products per second");
+            REQUIRE(pd > 0);
+        }
+
+        // Compare the tuple operators with the generic loop-unrolled path.
+        // Both iterations converge to twice the value of b. As each iteration
+        // depends on the previous one, use more iterations for a measurable time.
+        int const M = N * 16;
+        Vec4d a = md[0].c0, b = md[1].c1, h(0.5, 0.5, 0.5, 0.5);
+        timer.reset();
+        for (int i = 0; i < M; ++i) {
+            a = a * h + b;
+        }
+        timer.stop(s);
+        double pt = M / s;
+
+        double x[4];
+        double const* y = md[1].c1;
+        double const z[4] = { 0.5, 0.5, 0.5, 0.5 };
+        for (int k = 0; k < 4; ++k) {
+            x[k] = md[0].c0[k];
+        }
+        timer.reset();
+        for (int i = 0; i < M; ++i) {
+            gale::meta::LoopFwd<4, gale::meta::OpArithMul>::iterate(x, z);
+            gale::meta::LoopFwd<4, gale::meta::OpArithAdd>::iterate(x, y);
+        }
+        timer.stop(s);
+        double pl = M / s;
+
+        INFO(pt << " Vec4d operator iterations, " << pl << " LoopFwd iterations per second");
+        REQUIRE((a == Vec4d(x[0], x[1], x[2], x[3])));
+
+        // Compare the compile time inversion kernels to the scalar reference.
+        float af[16];
+        double ad[16], ssf = 0, skf = 0, ssd = 0, skd = 0;
+        timer.reset();
+        for (int i = 0; i < N; ++i) {
+            ssf += Matrix4ScalarKernels<float>::adjoint(af, mf[i & 15]);
+        }
+        timer.stop(s);
+        double psf = N / s;
+
+        timer.reset();
+        for (int i = 0; i < N; ++i) {
+            skf += Matrix4Kernels<float>::adjoint(af, mf[i & 15]);
+        }
+        timer.stop(s);
+        double pkf = N / s;
+
+        timer.reset();
+        for (int i = 0; i < N; ++i) {
+            ssd += Matrix4ScalarKernels<double>::adjoint(ad, md[i & 15]);
+        }
+        timer.stop(s);
+        double psd = N / s;
+
+        timer.reset();
+        for (int i = 0; i < N; ++i) {
+            skd += Matrix4Kernels<double>::adjoint(ad, md[i & 15]);
+        }
+        timer.stop(s);
+        double pkd = N / s;
+
+        INFO(psf << " scalar / " << pkf << " SIMD Mat4f adjoints, " << psd << " scalar / " << pkd << " SIMD Mat4d adjoints per second");
+        REQUIRE(OpCmpEqualRel::evaluate(skf, ssf, 1e-3, 1e-3));
+        REQUIRE(OpCmpEqualRel::evaluate(skd, ssd, 1e-9, 1e-9));
+
+        // Batched products of instance transformations.
+        int const B = 1024;
+        HMat4f* hm = new HMat4f[B];
+        HMat4f* hr = new HMat4f[B];
+        for (int i = 0; i < B; ++i) {
+            hm[i] = HMat4f::random(r);
+        }
+
+        timer.reset();
+        for (int j = 0; j < N / B; ++j) {
+            for (int i = 0; i < B; ++i) {
+                Matrix4ScalarKernels<float>::mulAffine(hr[i], hm[j & 15], hm[i]);
+            }
+        }
+        timer.stop(s);
+        double pas = N / s;
+
+        timer.reset();
+        for (int j = 0; j < N / B; ++j) {
+            HMat4f::multiply(hr, hm[j & 15], hm, B);
+        }
+        timer.stop(s);
+        double pab = N / s;
+
+        INFO(pas << " scalar / " << pab << " batched HMat4f products per second");
+        REQUIRE(hr[0] == hm[(N / B - 1) & 15] * hm[0]);
+
+        delete [] hr;
+        delete [] hm;
+    }
+}
+
 TEST_CASE("Random generator tests") {
     using namespace gale::math;
     using namespace gale::system;
@@ -329,6 +633,14 @@ TEST_CASE("CPU class tests") {
     if (CPU.hasSSSE3()) {
         REQUIRE(CPU.hasSSE3());
     }
+
+    if (CPU.isAVXEnabled()) {
+        REQUIRE(CPU.hasAVX());
+    }
+
+    if (CPU.hasAVX2()) {
+        REQUIRE(CPU.hasAVX());
+    }
 }
 
 TEST_CASE("Tuple class tests") {
@@ -566,6 +878,124 @@ TEST_CASE("Tuple class tests") {
     }
 }
 
+// Wraps a float so that none of the SIMD specializations of TupleBase match,
+// and tuples of it always use the generic loop-unrolled path.
+struct GenericFloat {
+    float value;
+
+    GenericFloat() {}
+    GenericFloat(float v) : value(v) {}
+    operator float() const { return value; }
+
+    GenericFloat& operator+=(GenericFloat v) { value += v.value; return *this; }
+    GenericFloat& operator-=(GenericFloat v) { value -= v.value; return *this; }
+    GenericFloat& operator*=(GenericFloat v) { value *= v.value; return *this; }
+    GenericFloat& operator/=(GenericFloat v) { value /= v.value; return *this; }
+
+    friend GenericFloat abs(GenericFloat v) { return fabs(v.value); }
+};
+
+namespace gale {
+
+namespace math {
+
+template<>
+struct Numerics<GenericFloat> : Numerics<float> {};
+
+} // namespace math
+
+} // namespace gale
+
+TEST_CASE("Tuple SIMD path tests") {
+    using namespace gale::math;
+    using gale::meta::OpCmpEqual;
+
+    // Tuple<4, float> uses the SSE specialization if GALE_USE_SSE is defined,
+    // and Tuple<4, double> the AVX specialization if GALE_USE_AVX is defined.
+    // Tuple<4, GenericFloat> always uses the generic path with the same
+    // precision as Tuple<4, float>.
+    RandomEcuyerf e;
+
+    Tuple<4, float> a, b;
+    Tuple<4, double> ra, rb;
+    Tuple<4, GenericFloat> ga, gb;
+    for (int i = 0; i < 4; ++i) {
+        ga[i] = ra[i] = a[i] = e.random0N(200.0f) - 100.0f;
+
+        // Keep the divisors away from zero.
+        float d = 1.0f + e.random0N(99.0f);
+        gb[i] = rb[i] = b[i] = (i & 1) ? -d : d;
+    }
+
+    float const s = 3.7f;
+
+    Tuple<4, float> results[] = {
+        a + b, a - b, a * b, a / b, -a, a * s, a / s, s / b
+    ,   a.minElements(b), a.maxElements(b), lerp(a, b, 0.3f)
+    };
+
+    Tuple<4, double> expected[] = {
+        ra + rb, ra - rb, ra * rb, ra / rb, -ra, ra * s, ra / s, s / rb
+    ,   ra.minElements(rb), ra.maxElements(rb), lerp(ra, rb, 0.3f)
+    };
+
+    Tuple<4, GenericFloat> generic[] = {
+        ga + gb, ga - gb, ga * gb, ga / gb, -ga, ga * s, ga / s, s / gb
+    ,   ga.minElements(gb), ga.maxElements(gb), lerp(ga, gb, 0.3f)
+    };
+
+    int const n = sizeof(results) / sizeof(results[0]);
+    for (int r = 0; r < n; ++r) {
+        CAPTURE(r);
+        for (int i = 0; i < 4; ++i) {
+            CAPTURE(i);
+            REQUIRE(OpCmpEqual::evaluate(results[r][i], static_cast<float>(expected[r][i]), 1e-4f));
+            REQUIRE(OpCmpEqual::evaluate(results[r][i], static_cast<float>(generic[r][i]), 1e-4f));
+        }
+    }
+
+    REQUIRE(OpCmpEqual::evaluate(a.minElement(), static_cast<float>(ra.minElement())));
+    REQUIRE(OpCmpEqual::evaluate(a.maxElement(), static_cast<float>(ra.maxElement())));
+    REQUIRE(OpCmpEqual::evaluate(b.absMinElement(), static_cast<float>(rb.absMinElement())));
+    REQUIRE(OpCmpEqual::evaluate(b.absMaxElement(), static_cast<float>(rb.absMaxElement())));
+
+    REQUIRE(a.minElement() == static_cast<float>(ga.minElement()));
+    REQUIRE(a.maxElement() == static_cast<float>(ga.maxElement()));
+    REQUIRE(b.absMinElement() == static_cast<float>(gb.absMinElement()));
+    REQUIRE(b.absMaxElement() == static_cast<float>(gb.absMaxElement()));
+
+    REQUIRE((a < b) == (ra < rb));
+    REQUIRE((a <= a) == (ra <= ra));
+    REQUIRE((a > b) == (ra > rb));
+    REQUIRE((a >= a) == (ra >= ra));
+
+    REQUIRE((a < b) == (ga < gb));
+    REQUIRE((a <= a) == (ga <= ga));
+    REQUIRE((a > b) == (ga > gb));
+    REQUIRE((a >= a) == (ga >= ga));
+
+    Tuple<4, float> c = a;
+    c[2] += Numerics<float>::ZERO_TOLERANCE() / 2;
+    REQUIRE(c == a);
+    c[2] += 1.0f;
+    REQUIRE(c != a);
+
+    Tuple<4, GenericFloat> gc = ga;
+    gc[2] += Numerics<float>::ZERO_TOLERANCE() / 2;
+    REQUIRE(gc == ga);
+    gc[2] += 1.0f;
+    REQUIRE(gc != ga);
+
+#ifdef GALE_USE_SSE
+    // Round-trip through a 16-byte aligned array.
+    float buffer[8];
+    float* aligned = reinterpret_cast<float*>((reinterpret_cast<size_t>(buffer) + 15) & ~size_t(15));
+    a.store(aligned);
+    c.load(aligned);
+    REQUIRE(c == a);
+#endif
+}
+
 TEST_CASE("Vector class tests") {
     using namespace gale::math;
     using gale::meta::OpCmpEqual;
@@ -631,6 +1061,67 @@ TEST_CASE("Vector class tests") {
         REQUIRE((Vec3i::X() % Vec3i::Z()) == 0);
         REQUIRE((Vec3i::Y() % Vec3i::Z()) == 0);
     }
+
+    SECTION("Constant expressions") {
+        static_assert(Constd::RAD_TO_DEG() * Constd::DEG_TO_RAD() > 0.999999, "Constants are not folded");
+        static_assert(Numf::ZERO_TOLERANCE() < Numf::MAX(), "Numerics are not folded");
+
+        constexpr Vec3f z = Vec3f::Z();
+        constexpr Vec3d n = Vec3d::ZERO();
+        constexpr Vec2i y = Vec2i::Y();
+        constexpr HMat4f m = HMat4f::IDENTITY();
+
+        REQUIRE(z == Vec3f(0, 0, 1));
+        REQUIRE(n == Vec3d(0, 0, 0));
+        REQUIRE(y == Vec2i(0, 1));
+        REQUIRE(m.c2 == z);
+        REQUIRE(m.c3 == Vec3f::ZERO());
+    }
+
+    SECTION("Constants benchmark") {
+        // Emulates constants that are returned by reference to a function-local
+        // static, which requires a guard check on each call.
+        struct Guarded {
+            static Vec3f const& ZERO() {
+                static Vec3f const v(0, 0, 0);
+                return v;
+            }
+        };
+
+        int const N = 1 << 16, M = 256;
+        RandomEcuyerf r;
+        gale::global::DynamicArray<Vec3f> a(N);
+        for (int i = 0; i < N; ++i) {
+            a[i] = Vec3f(r.random01() < 0.5f ? 0.0f : 1.0f, 0, 0);
+        }
+
+        gale::system::Timer timer;
+        double s;
+
+        int cg = 0;
+        timer.reset();
+        for (int k = 0; k < M; ++k) {
+            for (int i = 0; i < N; ++i) {
+                cg += (a[i] - Guarded::ZERO()) == Guarded::ZERO();
+            }
+        }
+        timer.stop(s);
+        double pg = N * double(M) / s;
+
+        int cc = 0;
+        timer.reset();
+        for (int k = 0; k < M; ++k) {
+            for (int i = 0; i < N; ++i) {
+                cc += (a[i] - Vec3f::ZERO()) == Vec3f::ZERO();
+            }
+        }
+        timer.stop(s);
+        double pc = N * double(M) / s;
+
+        INFO(pg << " comparisons per second against a guarded static, " << pc << " against the constant expression");
+        REQUIRE(cg == cc);
+        REQUIRE(cc > 0);
+    }
 }
 
 TEST_CASE("Color class tests") {
@@ -737,6 +1228,2325 @@ TEST_CASE("Color class tests") {
     }
 }
 
+TEST_CASE("Fast math tests") {
+    using namespace gale::math;
+    using namespace gale::meta;
+
+    const int N = 10001;
+
+    float x[N], s[N], c[N], r[N];
+    for (int i = 0; i < N; ++i) {
+        x[i] = -100.0f + i * 0.02f;
+    }
+
+    SECTION("Batch sine and cosine") {
+        sinCosBatch(x, s, c, N, ACCURACY_HIGH);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(OpCmpEqual::evaluate(s[i], static_cast<float>(sin(x[i])), 1e-6f));
+            REQUIRE(OpCmpEqual::evaluate(c[i], static_cast<float>(cos(x[i])), 1e-6f));
+        }
+
+        sinCosBatch(x, s, c, N, ACCURACY_FAST);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(OpCmpEqual::evaluate(s[i], static_cast<float>(sin(x[i])), 4e-4f));
+            REQUIRE(OpCmpEqual::evaluate(c[i], static_cast<float>(cos(x[i])), 4e-4f));
+        }
+    }
+
+    SECTION("Batch power") {
+        for (int i = 0; i < N; ++i) {
+            x[i] = i * 0.01f;
+        }
+
+        powBatch(x, 2.5f, r, N, ACCURACY_HIGH);
+        REQUIRE(r[0] == 0.0f);
+        for (int i = 1; i < N; ++i) {
+            float p = static_cast<float>(pow(x[i], 2.5f));
+            REQUIRE(OpCmpEqual::evaluate(r[i] / p, 1.0f, 1e-5f));
+        }
+
+        powBatch(x, -0.5f, r, N, ACCURACY_FAST);
+        REQUIRE(r[0] == HUGE_VALF);
+        for (int i = 1; i < N; ++i) {
+            float p = static_cast<float>(pow(x[i], -0.5f));
+            REQUIRE(OpCmpEqual::evaluate(r[i] / p, 1.0f, 1e-3f));
+        }
+
+        // Results close to the largest float must not overflow.
+        for (int i = 0; i < N; ++i) {
+            x[i] = 2.0f;
+        }
+        powBatch(x, 127.7f, r, N, ACCURACY_HIGH);
+        REQUIRE(OpCmpEqual::evaluate(r[0] / pow(2.0, 127.7), 1.0, 1e-5));
+
+#ifdef GALE_USE_SSE2
+        // Check both ends of the range, where the input is clamped below.
+        for (int i = 0; i < 100; ++i) {
+            float e = 127.0f + i * 0.0099f;
+            _mm_storeu_ps(r, exp2PS(_mm_set1_ps(e)));
+            REQUIRE(OpCmpEqual::evaluate(r[0] / pow(2.0, e), 1.0, 2e-7));
+
+            _mm_storeu_ps(r, exp2PS(_mm_set1_ps(-e + 1.0f)));
+            REQUIRE(OpCmpEqual::evaluate(r[0] / pow(2.0, -126.0), 1.0, 2e-7));
+
+            _mm_storeu_ps(r, exp2PS(_mm_set1_ps(e - 253.0f)));
+            REQUIRE(OpCmpEqual::evaluate(r[0] / pow(2.0, e - 253.0f), 1.0, 2e-7));
+        }
+#endif
+    }
+
+    SECTION("Reciprocal square root") {
+        for (int i = 0; i < N; ++i) {
+            x[i] = 0.001f + i * i * 0.37f;
+        }
+
+        for (int i = 0; i < N; ++i) {
+            double e = 1.0 / sqrt(static_cast<double>(x[i]));
+            REQUIRE(OpCmpEqual::evaluate(rsqrt(x[i], ACCURACY_EXACT) / e, 1.0, 2e-7));
+            REQUIRE(OpCmpEqual::evaluate(rsqrt(x[i], ACCURACY_HIGH) / e, 1.0, 1e-6));
+            REQUIRE(OpCmpEqual::evaluate(rsqrt(x[i], ACCURACY_FAST) / e, 1.0, 3.7e-4));
+        }
+
+#ifdef GALE_USE_SSE
+        for (int i = 0; i + 4 <= N; i += 4) {
+            __m128 v = _mm_loadu_ps(x + i);
+            _mm_storeu_ps(s, rcpPS(v, ACCURACY_HIGH));
+            _mm_storeu_ps(c, rcpPS(v, ACCURACY_FAST));
+            for (int k = 0; k < 4; ++k) {
+                double e = 1.0 / x[i + k];
+                REQUIRE(OpCmpEqual::evaluate(s[k] / e, 1.0, 1e-6));
+                REQUIRE(OpCmpEqual::evaluate(c[k] / e, 1.0, 3.7e-4));
+            }
+        }
+#endif
+    }
+
+    SECTION("Normalization") {
+        RandomEcuyerf rand;
+
+        int const M = 1 << 16;
+
+        gale::global::DynamicArray<Vec3f> in(M), out(M);
+        for (int i = 0; i < M; ++i) {
+            in[i] = Vec3f::random(rand) * (0.001f + rand.random0N(1000.0f));
+        }
+        in[3] = Vec3f::ZERO();
+
+        Accuracy const accuracies[] = { ACCURACY_EXACT, ACCURACY_HIGH, ACCURACY_FAST };
+        double const bounds[] = { 1e-6, 1e-6, 4e-4 };
+        double rates[3];
+
+        gale::system::Timer timer;
+        double t;
+
+        for (int a = 0; a < 3; ++a) {
+            timer.reset();
+            for (int k = 0; k < 1000; ++k) {
+                normalizeAll(in, out, M, accuracies[a]);
+            }
+            timer.stop(t);
+            rates[a] = 1000.0 * M / t;
+
+            REQUIRE(out[3] == Vec3f::ZERO());
+
+            for (int i = 0; i < M; ++i) {
+                if (i == 3) {
+                    continue;
+                }
+
+                REQUIRE(OpCmpEqual::evaluate(out[i].length(), 1.0, bounds[a]));
+
+                Vec3f v = in[i];
+                double l = v.normalize(accuracies[a]);
+                REQUIRE(OpCmpEqual::evaluate(l / in[i].length(), 1.0, bounds[a]));
+                REQUIRE(OpCmpEqual::evaluate(v.length(), 1.0, bounds[a]));
+                REQUIRE(v.equals(out[i], static_cast<float>(2 * bounds[a])));
+            }
+        }
+
+        INFO(rates[0] << " vectors per second normalized exactly, " << rates[1] << " with high accuracy, " << rates[2] << " fast");
+        REQUIRE(rates[2] > 0);
+    }
+}
+
+TEST_CASE("Mesh importer tests") {
+    using namespace gale::math;
+    using namespace gale::model;
+    using namespace gale::system;
+
+    SECTION("Import a cube from OBJ") {
+        FILE* file = fopen("cube.obj", "w");
+        REQUIRE(file != NULL);
+
+        fputs(
+            "# Unit cube with mixed index formats.\n"
+            "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+            "v 0 0 1\nv 1 0 1\nv 1 1 1\nv 0 1 1\n"
+            "vn 0 0 -1\n"
+            "f 1 4 3 2\nf 5 6 7 8\nf 1//1 2//1 6//1 5//1\n"
+            "f 2/1 3/1 7/1 6/1\nf -5 -1 -2 -6\nf -8 -4 -1 -5",
+            file);
+        fclose(file);
+
+        Mesh* mesh = Mesh::Importer::OBJ("cube.obj");
+        remove("cube.obj");
+
+        REQUIRE(mesh != NULL);
+        REQUIRE(mesh->numVertices() == 8);
+        REQUIRE(mesh->numEdges() == 12);
+        REQUIRE(mesh->numFaces() == 6);
+        REQUIRE(mesh->check() == -1);
+
+        Mesh::IndexArray polygon;
+        REQUIRE(mesh->orbit(0, 3, polygon) == 4);
+        REQUIRE(polygon[2] == 2);
+        REQUIRE(polygon[3] == 1);
+
+        delete mesh;
+    }
+
+    SECTION("Import PLY faces with invalid counts") {
+        FILE* file = fopen("quad.ply", "wb");
+        REQUIRE(file != NULL);
+
+        fprintf(file, "ply\nformat binary_%s_endian 1.0\n", CPU.isLittleEndian() ? "little" : "big");
+        fprintf(file, "element vertex 4\nproperty float x\nproperty float y\nproperty float z\n");
+        fprintf(file, "element face 3\nproperty list char int vertex_indices\nend_header\n");
+
+        float v[] = { 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0 };
+        fwrite(v, sizeof(v), 1, file);
+
+        // Write two triangles and a degenerate face in between.
+        char n[] = { 3, 2, 3 };
+        int f[] = { 0, 1, 2, 0, 3, 0, 2, 3 };
+        fwrite(n, 1, 1, file);
+        fwrite(f, sizeof(int), 3, file);
+        fwrite(n + 1, 1, 1, file);
+        fwrite(f + 3, sizeof(int), 2, file);
+        long end = ftell(file);
+        fwrite(n + 2, 1, 1, file);
+        fwrite(f + 5, sizeof(int), 3, file);
+        fclose(file);
+
+        Mesh* mesh = Mesh::Importer::PLY("quad.ply");
+
+        REQUIRE(mesh != NULL);
+        REQUIRE(mesh->numVertices() == 4);
+        REQUIRE(mesh->numEdges() == 5);
+        REQUIRE(mesh->check() == -1);
+
+        delete mesh;
+
+        // Overwrite the last face's count with a negative one.
+        file = fopen("quad.ply", "r+b");
+        REQUIRE(file != NULL);
+        fseek(file, end, SEEK_SET);
+        n[2] = -3;
+        fwrite(n + 2, 1, 1, file);
+        fclose(file);
+
+        mesh = Mesh::Importer::PLY("quad.ply");
+        REQUIRE(mesh == NULL);
+
+        // Restore the count but make an index negative.
+        file = fopen("quad.ply", "r+b");
+        REQUIRE(file != NULL);
+        fseek(file, end, SEEK_SET);
+        n[2] = 3;
+        f[5] = -1;
+        fwrite(n + 2, 1, 1, file);
+        fwrite(f + 5, sizeof(int), 1, file);
+        fclose(file);
+
+        mesh = Mesh::Importer::PLY("quad.ply");
+        remove("quad.ply");
+
+        REQUIRE(mesh == NULL);
+    }
+
+    SECTION("OBJ and PLY import benchmark") {
+        const int N = 1000;
+
+        // Write a grid of triangles in both formats.
+        FILE* obj = fopen("grid.obj", "w");
+        FILE* ply = fopen("grid.ply", "wb");
+        REQUIRE(obj != NULL);
+        REQUIRE(ply != NULL);
+
+        fprintf(ply, "ply\nformat binary_%s_endian 1.0\n", CPU.isLittleEndian() ? "little" : "big");
+        fprintf(ply, "element vertex %d\nproperty float x\nproperty float y\nproperty float z\n", N * N);
+        fprintf(ply, "element face %d\nproperty list uchar int vertex_indices\nend_header\n", (N - 1) * (N - 1) * 2);
+
+        for (int y = 0; y < N; ++y) {
+            for (int x = 0; x < N; ++x) {
+                float v[] = { x * 0.25f, y * 0.25f, (x ^ y) * 0.125f };
+                fprintf(obj, "v %f %f %f\n", v[0], v[1], v[2]);
+                fwrite(v, sizeof(v), 1, ply);
+            }
+        }
+
+        for (int y = 0; y < N - 1; ++y) {
+            for (int x = 0; x < N - 1; ++x) {
+                int i = y * N + x;
+                fprintf(obj, "f %d %d %d\nf %d %d %d\n", i + 1, i + 2, i + N + 2, i + 1, i + N + 2, i + N + 1);
+
+                unsigned char n = 3;
+                int f[] = { i, i + 1, i + N + 1, i, i + N + 1, i + N };
+                fwrite(&n, sizeof(n), 1, ply);
+                fwrite(f, sizeof(int), 3, ply);
+                fwrite(&n, sizeof(n), 1, ply);
+                fwrite(f + 3, sizeof(int), 3, ply);
+            }
+        }
+
+        double obj_size = ftell(obj) / (1024.0 * 1024.0);
+        double ply_size = ftell(ply) / (1024.0 * 1024.0);
+        fclose(obj);
+        fclose(ply);
+
+        Timer timer;
+        double s;
+
+        timer.start();
+        Mesh* a = Mesh::Importer::OBJ("grid.obj");
+        timer.stop(s);
+        remove("grid.obj");
+
+        INFO(obj_size / s << " MB per second, " << N * N / s << " OBJ vertices per second");
+        REQUIRE(a != NULL);
+        REQUIRE(a->check() == -1);
+        REQUIRE(a->numEdges() == 3 * N * N - 4 * N + 1);
+
+        timer.reset();
+        Mesh* b = Mesh::Importer::PLY("grid.ply");
+        timer.stop(s);
+        remove("grid.ply");
+
+        INFO(ply_size / s << " MB per second, " << N * N / s << " PLY vertices per second");
+        REQUIRE(b != NULL);
+        REQUIRE(b->numVertices() == a->numVertices());
+
+        for (int i = 0; i < a->numVertices(); ++i) {
+            REQUIRE(a->vertices[i] == b->vertices[i]);
+            REQUIRE(a->neighbors[i].getSize() == b->neighbors[i].getSize());
+        }
+
+        delete a;
+        delete b;
+    }
+}
+
+// Collects a sorted key for each face of the mesh that consists of the face
+// size and its vertex indices, starting at the lowest one.
+void getFaceKeys(gale::model::Mesh const& mesh, gale::global::DynamicArray<g_uint64>& keys) {
+    gale::model::Mesh::IndexArray offsets, indices;
+    mesh.extractFaces(offsets, indices);
+
+    keys.clear();
+    for (int f = 0; f < offsets.getSize() - 1; ++f) {
+        g_uint64 key = offsets[f + 1] - offsets[f];
+        for (unsigned int i = offsets[f]; i < offsets[f + 1]; ++i) {
+            key = (key << 8) | indices[i];
+        }
+        keys.insertSorted(key, true);
+    }
+}
+
+TEST_CASE("Mesh exporter tests") {
+    using namespace gale::global;
+    using namespace gale::math;
+    using namespace gale::model;
+    using namespace gale::system;
+    using namespace gale::wrapgl;
+
+    SECTION("Round-trip triangles, quads and pentagons") {
+        // Build an elongated pentagonal pyramid.
+        Mesh::VectorArray vertices;
+        for (int i = 0; i < 5; ++i) {
+            float a = i * 2 * Constf::PI() / 5;
+            vertices.insert(Vec3f(cos(a), sin(a), 0));
+        }
+        for (int i = 0; i < 5; ++i) {
+            vertices.insert(vertices[i] + Vec3f::Z());
+        }
+        vertices.insert(Vec3f(0, 0, 2));
+
+        Mesh::IndexArray offsets(1), indices;
+        offsets[0] = 0;
+        unsigned int base[] = { 4, 3, 2, 1, 0 };
+        indices.insert(base);
+        offsets.insert(indices.getSize());
+        for (unsigned int i = 0; i < 5; ++i) {
+            unsigned int j = (i + 1) % 5;
+            unsigned int side[] = { i, j, j + 5, i + 5 };
+            indices.insert(side);
+            offsets.insert(indices.getSize());
+        }
+        for (unsigned int i = 0; i < 5; ++i) {
+            unsigned int top[] = { i + 5, (i + 1) % 5 + 5, 10 };
+            indices.insert(top);
+            offsets.insert(indices.getSize());
+        }
+
+        Mesh* mesh = Mesh::Importer::Faces(vertices, offsets, indices);
+        REQUIRE(mesh->check() == -1);
+
+        PreparedMesh prepared;
+        prepared.compile(*mesh);
+        REQUIRE(prepared.numTriangles() == 5);
+        REQUIRE(prepared.numQuads() == 5);
+        REQUIRE(prepared.numPolys() == 1);
+
+        DynamicArray<g_uint64> expected, actual;
+        getFaceKeys(*mesh, expected);
+        REQUIRE(expected.getSize() == 11);
+
+        REQUIRE(PreparedMesh::Exporter::OBJ(prepared, "pyramid.obj"));
+        Mesh* obj = Mesh::Importer::OBJ("pyramid.obj");
+        remove("pyramid.obj");
+
+        REQUIRE(PreparedMesh::Exporter::PLY(prepared, "pyramid.ply"));
+        Mesh* ply = Mesh::Importer::PLY("pyramid.ply");
+        remove("pyramid.ply");
+
+        Mesh* imported[] = { obj, ply };
+        for (int m = 0; m < 2; ++m) {
+            REQUIRE(imported[m] != NULL);
+            REQUIRE(imported[m]->check() == -1);
+            REQUIRE(imported[m]->numVertices() == mesh->numVertices());
+
+            // Floats are written with enough digits to restore them exactly.
+            for (int i = 0; i < mesh->numVertices(); ++i) {
+                REQUIRE(memcmp(&imported[m]->vertices[i], &mesh->vertices[i], sizeof(Vec3f)) == 0);
+            }
+
+            getFaceKeys(*imported[m], actual);
+            REQUIRE(actual.getSize() == expected.getSize());
+            for (int i = 0; i < expected.getSize(); ++i) {
+                REQUIRE(actual[i] == expected[i]);
+            }
+
+            delete imported[m];
+        }
+
+        REQUIRE(PreparedMesh::Exporter::Raw(prepared, "pyramid.raw"));
+        FILE* file = fopen("pyramid.raw", "rb");
+        REQUIRE(file != NULL);
+
+        // Magic, vertices, 4 primitive types, polygon count and size.
+        g_uint32 header[8];
+        REQUIRE(fread(header, sizeof(header), 1, file) == 1);
+        REQUIRE(header[0] == PreparedMesh::Exporter::RAW_MAGIC);
+        REQUIRE(header[1] == 11);
+        REQUIRE(header[4] == 15);
+        REQUIRE(header[5] == 20);
+        REQUIRE(header[6] == 1);
+        REQUIRE(header[7] == 5);
+
+        AABB box;
+        REQUIRE(fread(&box, sizeof(box), 1, file) == 1);
+        REQUIRE(box.min == prepared.box.min);
+        REQUIRE(box.max == prepared.box.max);
+
+        Mesh::VectorArray data(2 * 11);
+        REQUIRE(fread(data, sizeof(Vec3f), 2 * 11, file) == 2 * 11);
+        REQUIRE(memcmp(data, prepared.vertexAccess(), 11 * sizeof(Vec3f)) == 0);
+        REQUIRE(memcmp(data + 11, prepared.normalAccess(), 11 * sizeof(Vec3f)) == 0);
+
+        fclose(file);
+        remove("pyramid.raw");
+
+        delete mesh;
+    }
+
+    SECTION("OBJ, PLY and raw export benchmark") {
+        const int N = 1000;
+
+        // Create a grid of quads.
+        Mesh::VectorArray vertices;
+        for (int y = 0; y < N; ++y) {
+            for (int x = 0; x < N; ++x) {
+                vertices.insert(Vec3f(x * 0.25f, y * 0.25f, (x ^ y) * 0.125f));
+            }
+        }
+
+        Mesh::IndexArray offsets(1), indices;
+        offsets[0] = 0;
+        for (unsigned int y = 0; y < N - 1; ++y) {
+            for (unsigned int x = 0; x < N - 1; ++x) {
+                unsigned int i = y * N + x;
+                unsigned int quad[] = { i, i + 1, i + N + 1, i + N };
+                indices.insert(quad);
+                offsets.insert(indices.getSize());
+            }
+        }
+
+        Mesh* mesh = Mesh::Importer::Faces(vertices, offsets, indices);
+        PreparedMesh prepared;
+        prepared.compile(*mesh);
+        delete mesh;
+
+        REQUIRE(prepared.numQuads() == (N - 1) * (N - 1));
+
+        char const* paths[] = { "grid.obj", "grid.ply", "grid.raw" };
+        double rates[3];
+
+        Timer timer;
+        double s;
+
+        for (int i = 0; i < 3; ++i) {
+            timer.reset();
+            bool written = i == 0 ? PreparedMesh::Exporter::OBJ(prepared, paths[i])
+                         : i == 1 ? PreparedMesh::Exporter::PLY(prepared, paths[i])
+                         :          PreparedMesh::Exporter::Raw(prepared, paths[i]);
+            timer.stop(s);
+
+            FILE* file = fopen(paths[i], "rb");
+            REQUIRE(file != NULL);
+            fseek(file, 0, SEEK_END);
+            rates[i] = ftell(file) / (1024.0 * 1024.0) / s;
+            fclose(file);
+
+            REQUIRE(written);
+            if (i == 1) {
+                Mesh* ply = Mesh::Importer::PLY(paths[i]);
+                REQUIRE(ply != NULL);
+                REQUIRE(ply->numVertices() == N * N);
+                REQUIRE(ply->numEdges() == 2 * N * (N - 1));
+                delete ply;
+            }
+            remove(paths[i]);
+        }
+
+        INFO(rates[0] << " / " << rates[1] << " / " << rates[2] << " MB per second written as OBJ / PLY / raw");
+        REQUIRE(rates[2] > 0);
+    }
+}
+
+// Returns a grid of n by n vertices with varying heights, where n - 1 must be
+// a multiple of 4. Each row of cells repeats a pair of triangles, a quad, and
+// a pentagon plus a triangle spanning two cells.
+gale::model::Mesh* createMixedGrid(int const n) {
+    using namespace gale::math;
+    using namespace gale::model;
+
+    Mesh::VectorArray vertices;
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+            vertices.insert(Vec3f(x * 0.25f, y * 0.25f, (x ^ y) * 0.125f));
+        }
+    }
+
+    Mesh::IndexArray offsets(1), indices;
+    offsets[0] = 0;
+    for (unsigned int y = 0; y < unsigned(n - 1); ++y) {
+        for (unsigned int x = 0; x < unsigned(n - 1); x += 4) {
+            unsigned int i = y * n + x;
+            unsigned int faces[] = {
+                i, i + 1, i + n + 1, i, i + n + 1, i + n,
+                i + 1, i + 2, i + n + 2, i + n + 1,
+                i + 2, i + 3, i + 4, i + n + 4, i + n + 3, i + 2, i + n + 3, i + n + 2
+            };
+            unsigned int sizes[] = { 3, 3, 4, 5, 3 };
+
+            int k = 0;
+            for (int f = 0; f < 5; ++f) {
+                for (unsigned int j = 0; j < sizes[f]; ++j) {
+                    indices.insert(faces[k++]);
+                }
+                offsets.insert(indices.getSize());
+            }
+        }
+    }
+
+    return Mesh::Importer::Faces(vertices, offsets, indices);
+}
+
+// Returns whether the raw exports of both prepared meshes are identical.
+bool equalsRaw(gale::wrapgl::PreparedMesh const& a, gale::wrapgl::PreparedMesh const& b) {
+    using gale::wrapgl::PreparedMesh;
+
+    gale::global::DynamicArray<char> data[2];
+    PreparedMesh const* meshes[] = { &a, &b };
+
+    for (int i = 0; i < 2; ++i) {
+        if (!PreparedMesh::Exporter::Raw(*meshes[i], "compare.raw")) {
+            return false;
+        }
+
+        FILE* file = fopen("compare.raw", "rb");
+        fseek(file, 0, SEEK_END);
+        data[i].setSize(ftell(file));
+        fseek(file, 0, SEEK_SET);
+        fread(data[i], 1, data[i].getSize(), file);
+        fclose(file);
+    }
+
+    remove("compare.raw");
+    return data[0].getSize() == data[1].getSize() && memcmp(data[0], data[1], data[0].getSize()) == 0;
+}
+
+TEST_CASE("Prepared mesh compilation tests") {
+    using namespace gale::math;
+    using namespace gale::model;
+    using namespace gale::wrapgl;
+
+    Mesh* mesh = createMixedGrid(201);
+    REQUIRE(mesh->check() == -1);
+
+    SECTION("Results do not depend on the number of threads") {
+        for (int w = PreparedMesh::WEIGHT_AREA; w <= PreparedMesh::WEIGHT_ANGLE; ++w) {
+            PreparedMesh a, b, c;
+            a.setNormalWeighting(PreparedMesh::NormalWeighting(w));
+            b.setNormalWeighting(PreparedMesh::NormalWeighting(w));
+            c.setNormalWeighting(PreparedMesh::NormalWeighting(w));
+
+            a.compile(*mesh, 1);
+            b.compile(*mesh, 4);
+            REQUIRE(a.numTriangles() == 200 * 50 * 3);
+            REQUIRE(a.numQuads() == 200 * 50);
+            REQUIRE(a.numPolys() == 200 * 50);
+            REQUIRE(equalsRaw(a, b));
+
+            // Move some vertices, and update the cached faces' normals.
+            Mesh moved = *mesh;
+            for (int i = 0; i < moved.numVertices(); i += 7) {
+                moved.vertices[i].setZ(moved.vertices[i].getZ() + 0.5f);
+            }
+
+            a.updateVertices(moved, 1);
+            b.updateVertices(moved, 4);
+            c.compile(moved, 3);
+            REQUIRE(equalsRaw(a, b));
+            REQUIRE(equalsRaw(a, c));
+        }
+    }
+
+    SECTION("Normal offsets") {
+        // Normals need to start at a multiple of their data type's size, also
+        // after an odd number of 6-byte quantized positions.
+        REQUIRE(PreparedMesh::getNormalOffset(7, GL_SHORT) == 44);
+        REQUIRE(PreparedMesh::getNormalOffset(8, GL_SHORT) == 48);
+        REQUIRE(PreparedMesh::getNormalOffset(7, GL_FLOAT) == 7 * 12);
+
+        for (int n = 1; n < 16; n += 2) {
+            REQUIRE(PreparedMesh::getNormalOffset(n, GL_SHORT) % 4 == 0);
+            REQUIRE(PreparedMesh::getNormalOffset(n, GL_SHORT) >= size_t(n * 6));
+        }
+    }
+
+    SECTION("Changed ranges and quantization") {
+        int const n = mesh->numVertices();
+
+        PreparedMesh prepared;
+        prepared.setCompactVertices(true);
+        prepared.compile(*mesh, 2);
+
+        int vb, ve, nb, ne;
+        prepared.getChangedVertices(vb, ve);
+        prepared.getChangedNormals(nb, ne);
+        REQUIRE(vb == 0);
+        REQUIRE(ve == n);
+        REQUIRE(nb == 0);
+        REQUIRE(ne == n);
+
+        Vec3f center;
+        float scale;
+        prepared.getQuantization(center, scale);
+        REQUIRE(center == (prepared.box.min + prepared.box.max) * 0.5f);
+        REQUIRE(gale::meta::OpCmpEqual::evaluate(scale * 32767.0f, prepared.box.getWidth() * 0.5f));
+
+        // Nothing changes without moving vertices.
+        prepared.updateVertices(*mesh, 2);
+        prepared.getChangedVertices(vb, ve);
+        prepared.getChangedNormals(nb, ne);
+        REQUIRE(vb == ve);
+        REQUIRE(nb == ne);
+
+        // Moving an inner vertex only changes the normals of its adjacent faces'
+        // vertices, which are at most a row and two columns away.
+        Mesh moved = *mesh;
+        int k = 100 * 201 + 100;
+        moved.vertices[k].setZ(moved.vertices[k].getZ() + 1.0f);
+
+        prepared.updateVertices(moved, 2);
+        prepared.getChangedVertices(vb, ve);
+        prepared.getChangedNormals(nb, ne);
+        REQUIRE(vb == k);
+        REQUIRE(ve == k + 1);
+        REQUIRE(nb >= k - 203);
+        REQUIRE(nb < k);
+        REQUIRE(ne > k + 1);
+        REQUIRE(ne <= k + 204);
+
+        Vec3f c;
+        float s;
+        prepared.getQuantization(c, s);
+        REQUIRE(memcmp(&c, &center, sizeof(c)) == 0);
+        REQUIRE(s == scale);
+
+        // Growing the bounding box quantizes all vertices again.
+        moved.vertices[0].setZ(-100.0f);
+
+        prepared.updateVertices(moved, 2);
+        prepared.getChangedVertices(vb, ve);
+        REQUIRE(vb == 0);
+        REQUIRE(ve == n);
+
+        prepared.getQuantization(c, s);
+        REQUIRE(c.getZ() < center.getZ());
+        REQUIRE(s > scale);
+    }
+
+    delete mesh;
+}
+
+TEST_CASE("Vertex cache optimization tests") {
+    using namespace gale::global;
+    using namespace gale::math;
+    using namespace gale::wrapgl;
+
+    SECTION("Cache simulation") {
+        unsigned int indices[] = { 0, 1, 0, 2, 0 };
+
+        // The FIFO cache evicts vertex 0 although it was just used.
+        REQUIRE(PreparedMesh::countCacheMisses(indices, 5, 2) == 4);
+        REQUIRE(PreparedMesh::countCacheMisses(indices, 5, 2, true) == 3);
+        REQUIRE(PreparedMesh::countCacheMisses(indices, 5, 3) == 3);
+    }
+
+    SECTION("Face reordering") {
+        const int N = 100;
+
+        // Create a grid of triangles in random order.
+        DynamicArray<unsigned int> indices(N * N * 6);
+        for (int y = 0; y < N; ++y) {
+            for (int x = 0; x < N; ++x) {
+                unsigned int i = y * (N + 1) + x;
+                unsigned int f[] = { i, i + 1, i + N + 2, i, i + N + 2, i + N + 1 };
+                memcpy(&indices[(y * N + x) * 6], f, sizeof(f));
+            }
+        }
+
+        RandomEcuyerf r;
+        for (int i = N * N * 2 - 1; i > 0; --i) {
+            int j = r.random(i);
+            for (int k = 0; k < 3; ++k) {
+                unsigned int tmp = indices[i * 3 + k];
+                indices[i * 3 + k] = indices[j * 3 + k];
+                indices[j * 3 + k] = tmp;
+            }
+        }
+
+        DynamicArray<unsigned int> reordered(indices);
+        PreparedMesh::reorderFaces(reordered, reordered.getSize(), 3);
+
+        float before = float(PreparedMesh::countCacheMisses(indices, indices.getSize())) / (N * N * 2);
+        float after = float(PreparedMesh::countCacheMisses(reordered, reordered.getSize())) / (N * N * 2);
+
+        INFO("ACMR before " << before << ", after " << after);
+        REQUIRE(before > 2.5f);
+        REQUIRE(after < 0.7f);
+
+        // All faces need to be preserved including their orientation.
+        DynamicArray<int> counts(N * N * 2);
+        memset(counts, 0, counts.getSize() * sizeof(int));
+        for (int i = 0; i < N * N * 2; ++i) {
+            ++counts[(reordered[i * 3] + reordered[i * 3 + 1] * 3 + reordered[i * 3 + 2] * 7) % counts.getSize()];
+            --counts[(indices[i * 3] + indices[i * 3 + 1] * 3 + indices[i * 3 + 2] * 7) % counts.getSize()];
+        }
+        for (int i = 0; i < counts.getSize(); ++i) {
+            REQUIRE(counts[i] == 0);
+        }
+    }
+}
+
+TEST_CASE("Triangle strip tests") {
+    using namespace gale::global;
+    using namespace gale::model;
+    using namespace gale::wrapgl;
+
+    const int N = 100;
+
+    // Create a grid of triangles.
+    DynamicArray<unsigned int> indices(N * N * 6);
+    for (int y = 0; y < N; ++y) {
+        for (int x = 0; x < N; ++x) {
+            unsigned int i = y * (N + 1) + x;
+            unsigned int f[] = { i, i + 1, i + N + 2, i, i + N + 2, i + N + 1 };
+            memcpy(&indices[(y * N + x) * 6], f, sizeof(f));
+        }
+    }
+
+    Mesh::IndexArray strip;
+    PreparedMesh::stripify(indices, indices.getSize(), strip);
+
+    INFO(strip.getSize() << " strip indices for " << N * N * 2 << " triangles");
+    REQUIRE(strip.getSize() < indices.getSize() / 2);
+
+    // Decode the strip and make sure all triangles are preserved including
+    // their orientation.
+    DynamicArray<int> counts(N * N * 2);
+    memset(counts, 0, counts.getSize() * sizeof(int));
+
+    for (int i = 0; i < N * N * 2; ++i) {
+        unsigned int a = indices[i * 3], b = indices[i * 3 + 1], c = indices[i * 3 + 2];
+        unsigned int m = a < b ? (a < c ? a : c) : (b < c ? b : c);
+        unsigned int key = m == a ? b * 3 + c * 7 : (m == b ? c * 3 + a * 7 : a * 3 + b * 7);
+        --counts[(m + key) % counts.getSize()];
+    }
+
+    int triangles = 0;
+    for (int i = 0; i + 2 < strip.getSize(); ++i) {
+        unsigned int a = strip[i], b = strip[i + 1], c = strip[i + 2];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+
+        if (i % 2 != 0) {
+            unsigned int tmp = a;
+            a = b;
+            b = tmp;
+        }
+
+        unsigned int m = a < b ? (a < c ? a : c) : (b < c ? b : c);
+        unsigned int key = m == a ? b * 3 + c * 7 : (m == b ? c * 3 + a * 7 : a * 3 + b * 7);
+        ++counts[(m + key) % counts.getSize()];
+        ++triangles;
+    }
+
+    REQUIRE(triangles == N * N * 2);
+    for (int i = 0; i < counts.getSize(); ++i) {
+        REQUIRE(counts[i] == 0);
+    }
+}
+
+TEST_CASE("Face normal tests") {
+    using namespace gale::math;
+    using namespace gale::meta;
+    using namespace gale::wrapgl;
+
+    // A non-planar quadrilateral and a concave pentagon in the XY-plane.
+    Vec3f vertices[] = {
+        Vec3f(0, 0, 0), Vec3f(2, 0, 0.5f), Vec3f(2, 1, 0), Vec3f(0, 1, 0.5f),
+        Vec3f(0, 0, 0), Vec3f(2, 0, 0), Vec3f(2, 2, 0), Vec3f(1, 1, 0), Vec3f(0, 2, 0)
+    };
+
+    SECTION("Order independence") {
+        unsigned int quads[] = { 0, 1, 2, 3, 1, 2, 3, 0, 2, 3, 0, 1, 3, 0, 1, 2 };
+        Vec3f normals[4];
+        PreparedMesh::faceNormals(vertices, quads, 4, 4, normals);
+
+        for (int i = 1; i < 4; ++i) {
+            REQUIRE(normals[i] == normals[0]);
+        }
+        REQUIRE(normals[0].getZ() > 0);
+    }
+
+    SECTION("Polygon area and angles") {
+        unsigned int pentagon[] = { 4, 5, 6, 7, 8 };
+        Vec3f normal;
+        float angles[5];
+        PreparedMesh::faceNormals(vertices, pentagon, 1, 5, &normal, angles);
+
+        // The normal's length is twice the area.
+        REQUIRE(normal == Vec3f(0, 0, 6));
+
+        // The interior angles of a simple pentagon sum up to 3 pi.
+        float sum = 0;
+        for (int i = 0; i < 5; ++i) {
+            sum += angles[i];
+        }
+        REQUIRE(OpCmpEqual::evaluate(sum, 3 * Constf::PI(), 1e-5f));
+        REQUIRE(OpCmpEqual::evaluate(angles[3], 1.5f * Constf::PI(), 1e-5f));
+    }
+
+    SECTION("Batches of triangles and quads") {
+        RandomEcuyerf r;
+
+        // Use a number of faces that is neither a multiple of the block size
+        // nor of the SIMD width.
+        const int N = 1003;
+
+        Vec3f points[N + 3];
+        unsigned int indices[N * 4];
+        for (int i = 0; i < N + 3; ++i) {
+            points[i] = Vec3f::random(r) * r.random0N(10.0f);
+        }
+        for (int i = 0; i < N * 4; ++i) {
+            indices[i] = r.random(N + 2);
+        }
+
+        Vec3f normals[N];
+        float weights[N * 4];
+
+        PreparedMesh::faceNormals(points, indices, N, 3, normals, weights);
+        for (int f = 0; f < N; ++f) {
+            unsigned int const* t = &indices[f * 3];
+            Vec3f e = (points[t[1]] - points[t[0]]) ^ (points[t[2]] - points[t[0]]);
+            REQUIRE(normals[f].equals(e, 1e-4f));
+        }
+
+        PreparedMesh::faceNormals(points, indices, N, 4, normals);
+        for (int f = 0; f < N; ++f) {
+            unsigned int const* q = &indices[f * 4];
+            Vec3f e = (points[q[2]] - points[q[0]]) ^ (points[q[3]] - points[q[1]]);
+            REQUIRE(normals[f].equals(e, 1e-4f));
+        }
+
+        // Splitting the faces into several calls yields the same bits.
+        Vec3f split[N];
+        PreparedMesh::faceNormals(points, indices, 5, 4, split);
+        PreparedMesh::faceNormals(points, indices + 5 * 4, N - 5, 4, split + 5);
+        REQUIRE(memcmp(split, normals, sizeof(normals)) == 0);
+    }
+
+    SECTION("Faces of more than 5 vertices are skipped") {
+        // Build a hexagonal prism.
+        gale::model::Mesh::VectorArray vertices;
+        for (int i = 0; i < 12; ++i) {
+            float a = (i % 6) * Constf::PI() / 3;
+            vertices.insert(Vec3f(cos(a), sin(a), float(i / 6)));
+        }
+
+        gale::model::Mesh::IndexArray offsets(1), indices;
+        offsets[0] = 0;
+        unsigned int bottom[] = { 5, 4, 3, 2, 1, 0 }, top[] = { 6, 7, 8, 9, 10, 11 };
+        indices.insert(bottom);
+        offsets.insert(indices.getSize());
+        indices.insert(top);
+        offsets.insert(indices.getSize());
+        for (unsigned int i = 0; i < 6; ++i) {
+            unsigned int j = (i + 1) % 6;
+            unsigned int side[] = { i, j, j + 6, i + 6 };
+            indices.insert(side);
+            offsets.insert(indices.getSize());
+        }
+
+        gale::model::Mesh* prism = gale::model::Mesh::Importer::Faces(vertices, offsets, indices);
+        REQUIRE(prism->check() == -1);
+
+        // The hexagons cannot be told apart from the boundaries of holes.
+        PreparedMesh prepared;
+        prepared.compile(*prism);
+        REQUIRE(prepared.numQuads() == 6);
+        REQUIRE(prepared.numPolys() == 0);
+
+        // The vertex normals are those of the sides only.
+        for (int i = 0; i < 12; ++i) {
+            Vec3f n = prepared.normalAccess()[i];
+            REQUIRE(n == ~Vec3f(vertices[i].getX(), vertices[i].getY(), 0));
+        }
+
+        delete prism;
+    }
+}
+
+TEST_CASE("Mesh simplification tests") {
+    using namespace gale::math;
+    using namespace gale::meta;
+    using namespace gale::model;
+    using namespace gale::wrapgl;
+
+    SECTION("Edge collapse") {
+        Mesh* m = Mesh::Factory::Sphere(1, 4);
+        REQUIRE(m->numFaces() == 5120);
+
+        int triangles = Mesh::Simplifier::EdgeCollapse(*m, 200);
+        REQUIRE(triangles <= 200);
+
+        // The neighborhoods need to be consistent and the topology unchanged.
+        REQUIRE(m->check() == -1);
+        REQUIRE(m->numFaces() == triangles);
+
+        for (int i = 0; i < m->numVertices(); ++i) {
+            REQUIRE(m->neighbors[i].getSize() >= 3);
+            REQUIRE(abs(m->vertices[i].length() - 1) < 0.05);
+        }
+
+        delete m;
+    }
+
+    SECTION("Projected area") {
+        AABB box;
+        box.min = Vec3f(-1, -1, -1);
+        box.max = Vec3f(1, 1, 1);
+
+        Mat4d projection = Mat4d::Factory::PerspectiveProjection(800, 600, Constd::PI() * 0.5, 0.1, 100);
+
+        // Looking at the box from afar, its front face with a distance of 10
+        // covers 60 by 60 pixels.
+        HMat4f view = HMat4f::IDENTITY();
+        view.setPositionVector(Vec3f(0, 0, -11));
+        float area = LODMesh::projectedArea(box, view, projection, 800, 600);
+        REQUIRE(OpCmpEqual::evaluate(area, 60.0f * 60.0f, 1e-2f));
+
+        // Being inside the box covers the whole screen.
+        REQUIRE(LODMesh::projectedArea(box, HMat4f::IDENTITY(), projection, 800, 600) == 800 * 600);
+
+        // Looking away from the box does not cover anything.
+        view.setPositionVector(Vec3f(0, 0, 11));
+        REQUIRE(LODMesh::projectedArea(box, view, projection, 800, 600) == 0);
+    }
+}
+
+TEST_CASE("Meshlet tests") {
+    using namespace gale::math;
+    using namespace gale::model;
+
+    Mesh* m = Mesh::Factory::Sphere(1, 5);
+
+    // Collect the triangles of the sphere.
+    Mesh::IndexArray triangles, polygon;
+    for (int vi = 0; vi < m->numVertices(); ++vi) {
+        for (int n = 0; n < m->neighbors[vi].getSize(); ++n) {
+            m->orbit(vi, m->neighbors[vi][n], polygon);
+            if (polygon[1] > unsigned(vi) && polygon[2] > unsigned(vi)) {
+                triangles.insert(polygon);
+            }
+        }
+    }
+    REQUIRE(triangles.getSize() == 20480 * 3);
+
+    Meshlets meshlets;
+    meshlets.build(m->vertices, m->numVertices(), triangles, triangles.getSize());
+
+    SECTION("Partitioning") {
+        REQUIRE(meshlets.indices().getSize() == triangles.getSize());
+        REQUIRE(meshlets.getEnd(meshlets.getSize() - 1) == triangles.getSize());
+
+        for (int i = 0; i < meshlets.getSize(); ++i) {
+            int begin = meshlets.getBegin(i), end = meshlets.getEnd(i);
+            REQUIRE(end - begin <= 124 * 3);
+
+            Mesh::IndexArray vertices;
+            for (int k = begin; k < end; ++k) {
+                unsigned int vi = meshlets.indices()[k];
+                if (vertices.find(vi) < 0) {
+                    vertices.insert(vi);
+                }
+
+                // All vertices need to be inside the bounds.
+                REQUIRE((m->vertices[vi] - meshlets.getCenter(i)).length() <= meshlets.getRadius(i) + 1e-5f);
+            }
+            REQUIRE(vertices.getSize() <= 64);
+        }
+    }
+
+    SECTION("Culling") {
+        Mat4d projection = Mat4d::Factory::PerspectiveProjection(800, 600, Constd::PI() * 0.25, 0.1, 100);
+        HMat4f view = HMat4f::IDENTITY();
+        Mesh::IndexArray visible;
+
+        // From afar, the back half of the sphere is culled.
+        view.setPositionVector(Vec3f(0, 0, -5));
+        int front = meshlets.cull(view, projection, visible);
+        INFO(front << " of " << meshlets.getSize() << " meshlets visible from afar");
+        REQUIRE(front > meshlets.getSize() * 0.4);
+        REQUIRE(front < meshlets.getSize() * 0.7);
+
+        // Close up, only a cap of the sphere is visible.
+        view.setPositionVector(Vec3f(0, 0, -1.5f));
+        int close = meshlets.cull(view, projection, visible);
+        REQUIRE(close > 0);
+        REQUIRE(close < front);
+
+        // Looking away, nothing is visible.
+        view.setPositionVector(Vec3f(0, 0, 5));
+        REQUIRE(meshlets.cull(view, projection, visible) == 0);
+    }
+
+    delete m;
+}
+
+TEST_CASE("Face extraction tests") {
+    using namespace gale::math;
+    using namespace gale::model;
+
+    SECTION("Extract the faces of closed meshes") {
+        Mesh* cube = Mesh::Factory::Hexahedron();
+
+        Mesh::IndexArray offsets, indices;
+        REQUIRE(cube->extractFaces(offsets, indices) == 6);
+        REQUIRE(indices.getSize() == 24);
+
+        Mesh::IndexArray polygon;
+        for (int f = 0; f < 6; ++f) {
+            REQUIRE(offsets[f + 1] - offsets[f] == 4);
+
+            // Each face starts at its lowest vertex and matches the orbit.
+            unsigned int const* face = &indices[offsets[f]];
+            REQUIRE(cube->orbit(face[0], face[1], polygon) == 4);
+            for (int i = 0; i < 4; ++i) {
+                REQUIRE(face[i] == polygon[i]);
+                REQUIRE(face[i] >= face[0]);
+            }
+        }
+
+        delete cube;
+
+        Mesh* sphere = Mesh::Factory::Sphere(1, 4);
+        REQUIRE(sphere->extractFaces(offsets, indices) == sphere->numFaces());
+        REQUIRE(indices.getSize() == sphere->numFaces() * 3);
+        delete sphere;
+    }
+
+    SECTION("Extract the faces in parallel") {
+        Mesh* sphere = Mesh::Factory::Sphere(1, 6);
+        REQUIRE(sphere->numVertices() > 4 * 1024);
+
+        Mesh::IndexArray offsets, indices;
+        REQUIRE(sphere->extractFaces(offsets, indices, 1) == sphere->numFaces());
+
+        // The faces do not depend on how the vertices are split into ranges.
+        Mesh::IndexArray parallel_offsets, parallel_indices;
+        REQUIRE(sphere->extractFaces(parallel_offsets, parallel_indices, 4) == sphere->numFaces());
+        REQUIRE(parallel_offsets.getSize() == offsets.getSize());
+        for (int f = 0; f < offsets.getSize(); ++f) {
+            REQUIRE(parallel_offsets[f] == offsets[f]);
+        }
+        REQUIRE(parallel_indices.getSize() == indices.getSize());
+        for (int i = 0; i < indices.getSize(); ++i) {
+            REQUIRE(parallel_indices[i] == indices[i]);
+        }
+
+        delete sphere;
+    }
+
+    SECTION("Find connected components") {
+        Mesh* a = Mesh::Factory::Tetrahedron();
+        Mesh* b = Mesh::Factory::Octahedron();
+
+        // Combine both meshes and append an isolated vertex.
+        Mesh mesh(a->vertices);
+        mesh.neighbors = a->neighbors;
+        int n = a->numVertices();
+        for (int vi = 0; vi < b->numVertices(); ++vi) {
+            mesh.vertices.insert(b->vertices[vi]);
+            Mesh::IndexArray vn = b->neighbors[vi];
+            for (int i = 0; i < vn.getSize(); ++i) {
+                vn[i] += n;
+            }
+            mesh.neighbors.insert(vn);
+        }
+        mesh.vertices.insert(Vec3f::ZERO());
+        mesh.neighbors.setSize(mesh.vertices.getSize());
+        REQUIRE(mesh.check() == -1);
+
+        Mesh::IndexArray components;
+        REQUIRE(mesh.connectedComponents(components) == 3);
+        for (int vi = 0; vi < mesh.numVertices(); ++vi) {
+            unsigned int expected = vi < n ? 0 : (vi < n + b->numVertices() ? 1 : 2);
+            REQUIRE(components[vi] == expected);
+        }
+
+        Mesh::IndexArray offsets, indices;
+        REQUIRE(mesh.extractFaces(offsets, indices) == 4 + 8);
+
+        delete b;
+        delete a;
+    }
+}
+
+TEST_CASE("Vertex welding tests") {
+    using namespace gale::math;
+    using namespace gale::model;
+
+    SECTION("Weld a cube made of separate faces") {
+        static const float corners[][3] = {
+            { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+            { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 }
+        };
+        static const unsigned int faces[] = {
+            0, 3, 2, 1,  4, 5, 6, 7,  0, 1, 5, 4,
+            1, 2, 6, 5,  2, 3, 7, 6,  3, 0, 4, 7
+        };
+
+        // Give each face its own slightly displaced vertices.
+        Mesh::VectorArray vertices;
+        Mesh::IndexArray offsets, indices;
+        offsets.insert(0);
+        for (int i = 0; i < 24; ++i) {
+            const float* c = corners[faces[i]];
+            indices.insert(vertices.insert(Vec3f(c[0], c[1], c[2] + (i / 4) * 1e-5f)));
+            if (i % 4 == 3) {
+                offsets.insert(indices.getSize());
+            }
+        }
+
+        Mesh* mesh = Mesh::Importer::Faces(vertices, offsets, indices);
+        REQUIRE(mesh != NULL);
+        REQUIRE(mesh->numVertices() == 24);
+
+        // Nothing is merged below the displacement.
+        REQUIRE(mesh->weld(1e-6f) == 0);
+
+        REQUIRE(mesh->weld(1e-3f) == 16);
+        REQUIRE(mesh->numVertices() == 8);
+        REQUIRE(mesh->numEdges() == 12);
+        REQUIRE(mesh->numFaces() == 6);
+        REQUIRE(mesh->check() == -1);
+
+        Mesh::IndexArray polygon;
+        for (int vi = 0; vi < 8; ++vi) {
+            REQUIRE(mesh->neighbors[vi].getSize() == 3);
+            REQUIRE(mesh->orbit(vi, mesh->neighbors[vi][0], polygon) == 4);
+        }
+
+        delete mesh;
+    }
+
+    SECTION("Weld a sphere split into triangles") {
+        Mesh* sphere = Mesh::Factory::Sphere(1, 4);
+
+        // Duplicate the vertices of each triangle.
+        Mesh::VectorArray vertices;
+        Mesh::IndexArray offsets, indices, polygon;
+        offsets.insert(0);
+        for (int vi = 0; vi < sphere->numVertices(); ++vi) {
+            for (int n = 0; n < sphere->neighbors[vi].getSize(); ++n) {
+                sphere->orbit(vi, sphere->neighbors[vi][n], polygon);
+                if (polygon[1] > unsigned(vi) && polygon[2] > unsigned(vi)) {
+                    for (int i = 0; i < 3; ++i) {
+                        indices.insert(vertices.insert(sphere->vertices[polygon[i]]));
+                    }
+                    offsets.insert(indices.getSize());
+                }
+            }
+        }
+
+        Mesh* mesh = Mesh::Importer::Faces(vertices, offsets, indices);
+        REQUIRE(mesh != NULL);
+
+        // Welding exactly coincident vertices restores the original topology.
+        REQUIRE(mesh->weld(0, 4) == vertices.getSize() - sphere->numVertices());
+        REQUIRE(mesh->numVertices() == sphere->numVertices());
+        REQUIRE(mesh->numEdges() == sphere->numEdges());
+        REQUIRE(mesh->check() == -1);
+
+        delete mesh;
+        delete sphere;
+    }
+}
+
+TEST_CASE("Instance batching tests") {
+    using namespace gale::math;
+    using namespace gale::system;
+    using namespace gale::wrapgl;
+
+    // Stands in for a prepared mesh, which requires a rendering context.
+    struct FakeMesh {
+        int calls;
+        int numDrawCalls() const { return calls; }
+    };
+
+    // Stands in for the renderer's back-end and records the issued calls.
+    struct CountingBackend {
+        int binds, releases, transforms, colors, uploads, submits, instances;
+        double checksum;
+
+        CountingBackend()
+        :   binds(0), releases(0), transforms(0), colors(0), uploads(0), submits(0), instances(0), checksum(0)
+        {}
+
+        void bind(const FakeMesh&) { ++binds; }
+        void release(const FakeMesh&) { ++releases; }
+        void transform(const FakeMesh&, const HMat4f& m) { ++transforms; checksum += m.getPositionVector().getX(); }
+        void color(const Col4f&) { ++colors; }
+        void upload(const FakeMesh&, const HMat4f* m, int count, const Col4f*) {
+            ++uploads;
+            for (int i = 0; i < count; ++i) {
+                checksum += m[i].getPositionVector().getX();
+            }
+        }
+        void submit(const FakeMesh& mesh, int count) { submits += mesh.numDrawCalls(); instances += count > 0 ? count : 1; }
+    };
+
+    const FakeMesh meshes[] = { { 1 }, { 2 }, { 5 } };
+    const int N = 30000;
+
+    InstanceBatch<FakeMesh> batch;
+    for (int i = 0; i < N; ++i) {
+        HMat4f m = HMat4f::Factory::Translation(Vec3f(float(i), 0, 0));
+        if (i % 2) {
+            batch.add(meshes[i % 3], m, Col4f(float(i % 256) / 255, 0, 0, 1));
+        }
+        else {
+            batch.add(meshes[i % 3], m);
+        }
+    }
+
+    Timer timer;
+    double s;
+
+    timer.start();
+    batch.sort();
+    timer.stop(s);
+
+    INFO(N / s << " instances per second grouped");
+    REQUIRE(batch.numInstances() == N);
+    REQUIRE(batch.numGroups() == 3);
+
+    for (int k = 0; k < 3; ++k) {
+        REQUIRE(&batch.getMesh(k) == &meshes[k]);
+        REQUIRE(batch.getCount(k) == N / 3);
+
+        // Instances keep their order within each group.
+        const HMat4f* transforms = batch.getTransforms(k);
+        const Col4f* colors = batch.getColors(k);
+        REQUIRE(colors != NULL);
+
+        for (int i = 0; i < N / 3; ++i) {
+            int original = i * 3 + k;
+            REQUIRE(transforms[i].getPositionVector().getX() == float(original));
+            if (original % 2) {
+                REQUIRE(colors[i].getR() == float(original % 256) / 255);
+            }
+            else {
+                REQUIRE(colors[i] == Col4f::WHITE());
+            }
+        }
+    }
+
+    // Count the calls issued for all three ways of rendering the instances.
+    CountingBackend separate, batched, instanced;
+    batch.render(separate, InstanceBatch<FakeMesh>::MODE_SEPARATE);
+    batch.render(batched, InstanceBatch<FakeMesh>::MODE_BATCHED);
+    batch.render(instanced, InstanceBatch<FakeMesh>::MODE_INSTANCED);
+
+    INFO("Binds: " << separate.binds << " separate, " << batched.binds << " batched, " << instanced.binds << " instanced");
+    INFO("Draw calls: " << separate.submits << " separate, " << batched.submits << " batched, " << instanced.submits << " instanced");
+
+    // Every instance is drawn exactly once with its own transformation.
+    const double checksum = double(N) * (N - 1) / 2;
+    CountingBackend* backends[] = { &separate, &batched, &instanced };
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(backends[i]->instances == N);
+        REQUIRE(backends[i]->checksum == checksum);
+        REQUIRE(backends[i]->releases == backends[i]->binds);
+    }
+
+    REQUIRE(separate.binds == N);
+    REQUIRE(separate.transforms == N);
+    REQUIRE(separate.colors == N);
+    REQUIRE(separate.uploads == 0);
+    REQUIRE(separate.submits == N / 3 * (1 + 2 + 5));
+
+    REQUIRE(batched.binds == 3);
+    REQUIRE(batched.transforms == N);
+    REQUIRE(batched.colors == N);
+    REQUIRE(batched.uploads == 0);
+    REQUIRE(batched.submits == separate.submits);
+
+    REQUIRE(instanced.binds == 3);
+    REQUIRE(instanced.transforms == 0);
+    REQUIRE(instanced.colors == 0);
+    REQUIRE(instanced.uploads == 3);
+    REQUIRE(instanced.submits == 1 + 2 + 5);
+
+    // The statistics agree with the issued calls.
+    for (int i = 0; i < 3; ++i) {
+        const CountingBackend& b = *backends[i];
+        InstanceBatch<FakeMesh>::Statistics s = batch.getStatistics(static_cast<InstanceBatch<FakeMesh>::Mode>(i));
+        REQUIRE(s.state_changes == b.binds + b.releases + b.transforms + b.colors + b.uploads);
+        REQUIRE(s.draw_calls == b.submits);
+    }
+
+    batch.clear();
+    REQUIRE(batch.numInstances() == 0);
+    REQUIRE(batch.numGroups() == 0);
+}
+
+TEST_CASE("Mesh merging tests") {
+    using namespace gale::math;
+    using namespace gale::model;
+    using namespace gale::wrapgl;
+
+    Mesh* meshes[] = {
+        Mesh::Factory::Tetrahedron(),
+        Mesh::Factory::Hexahedron(),
+        Mesh::Factory::Dodecahedron()
+    };
+
+    HMat4f transforms[] = {
+        HMat4f::IDENTITY(),
+        HMat4f::Factory::Translation(Vec3f(10, 0, 0)) * HMat4f::Factory::Scaling(2, 3, 4),
+        HMat4f::Factory::Translation(Vec3f(0, -10, 0)) * HMat4f::Factory::Scaling(-1, 1, 1)
+    };
+
+    MeshBatcher batcher;
+    Mesh::IndexTable primitives[3], polygons[3];
+    Mesh::VectorArray normals[3];
+
+    for (int m = 0; m < 3; ++m) {
+        // Sort the faces by type like a compiled mesh.
+        Mesh::IndexArray offsets, indices;
+        meshes[m]->extractFaces(offsets, indices);
+
+        primitives[m].setSize(MeshBatcher::PRIMITIVE_TYPES);
+        for (int f = 0; f < offsets.getSize() - 1; ++f) {
+            Mesh::IndexArray face;
+            for (unsigned int i = offsets[f]; i < offsets[f + 1]; ++i) {
+                face.insert(indices[i]);
+            }
+
+            if (face.getSize() <= 4) {
+                primitives[m][face.getSize() - 1].insert(face);
+            }
+            else {
+                polygons[m].insert(face);
+            }
+        }
+
+        // The platonic solids are centered, so their vertex directions are normals.
+        normals[m].setSize(meshes[m]->numVertices());
+        for (int i = 0; i < meshes[m]->numVertices(); ++i) {
+            normals[m][i] = ~meshes[m]->vertices[i];
+        }
+
+        REQUIRE(batcher.add(meshes[m]->vertices, normals[m], primitives[m], polygons[m], m > 0 ? &transforms[m] : NULL) == m);
+    }
+
+    REQUIRE(batcher.numSubmeshes() == 3);
+    REQUIRE(batcher.getVertices().getSize() == 4 + 8 + 20);
+    REQUIRE(batcher.getPrimitives()[2].getSize() == 4 * 3);
+    REQUIRE(batcher.getPrimitives()[3].getSize() == 6 * 4);
+    REQUIRE(batcher.getPolygons().getSize() == 12);
+
+    for (int m = 0; m < 3; ++m) {
+        const MeshBatcher::Submesh& s = batcher.getSubmesh(m);
+        const unsigned int offset = s.vertices.begin;
+        REQUIRE(s.vertices.end - s.vertices.begin == meshes[m]->numVertices());
+
+        for (int i = 0; i < meshes[m]->numVertices(); ++i) {
+            Vec3f v = transforms[m] * meshes[m]->vertices[i];
+            REQUIRE(batcher.getVertices()[offset + i] == v);
+            REQUIRE(batcher.box.min <= v);
+            REQUIRE(batcher.box.max >= v);
+
+            // Normals are transformed by the inverse transpose.
+            const Vec3f& n = normals[m][i];
+            Vec3f expected = m == 1 ? ~Vec3f(n.getX() / 2, n.getY() / 3, n.getZ() / 4) : (m == 2 ? Vec3f(-n.getX(), n.getY(), n.getZ()) : n);
+            REQUIRE(batcher.getNormals()[offset + i] == expected);
+        }
+
+        const MeshBatcher::Range* ranges[] = { &s.points, &s.lines, &s.triangles, &s.quads };
+        for (int t = 0; t < MeshBatcher::PRIMITIVE_TYPES; ++t) {
+            REQUIRE(ranges[t]->end - ranges[t]->begin == primitives[m][t].getSize());
+            for (int i = 0; i < primitives[m][t].getSize(); ++i) {
+                REQUIRE(batcher.getPrimitives()[t][ranges[t]->begin + i] == primitives[m][t][i] + offset);
+            }
+        }
+
+        REQUIRE(s.polygons.end - s.polygons.begin == polygons[m].getSize());
+    }
+
+    // The mirrored polygons are reversed to keep facing outwards.
+    const MeshBatcher::Submesh& s = batcher.getSubmesh(2);
+    Vec3f center = transforms[2] * Vec3f::ZERO();
+
+    for (int p = s.polygons.begin; p < s.polygons.end; ++p) {
+        const Mesh::IndexArray& polygon = batcher.getPolygons()[p];
+        const Mesh::IndexArray& original = polygons[2][p - s.polygons.begin];
+
+        REQUIRE(polygon[0] == original[0] + s.vertices.begin);
+        REQUIRE(polygon[1] == original[4] + s.vertices.begin);
+
+        Vec3f normal;
+        PreparedMesh::faceNormals(batcher.getVertices(), polygon, 1, 5, &normal);
+        REQUIRE(normal % (batcher.getVertices()[polygon[0]] - center) > 0);
+    }
+
+    batcher.clear();
+    REQUIRE(batcher.numSubmeshes() == 0);
+    REQUIRE(batcher.getVertices().getSize() == 0);
+
+    for (int m = 0; m < 3; ++m) {
+        delete meshes[m];
+    }
+}
+
+TEST_CASE("Vector batch tests") {
+    using namespace gale::math;
+    using namespace gale::system;
+
+    RandomEcuyerf r;
+
+    // Use a size that is not a multiple of the SIMD width.
+    int const N = 1003;
+
+    Vec3f a[N], b[N];
+    float ax[N], ay[N], az[N], bx[N], by[N], bz[N];
+    for (int i = 0; i < N; ++i) {
+        a[i] = Vec3f::random(r) * r.random0N(10.0f);
+        b[i] = Vec3f::random(r) * r.random0N(10.0f);
+        ax[i] = a[i].getX(); ay[i] = a[i].getY(); az[i] = a[i].getZ();
+        bx[i] = b[i].getX(); by[i] = b[i].getY(); bz[i] = b[i].getZ();
+    }
+    a[7] = Vec3f::ZERO();
+    ax[7] = ay[7] = az[7] = 0.0f;
+
+    Vec3fArrays sa = { ax, ay, az }, sb = { bx, by, bz };
+
+    HMat4f m = HMat4f::Factory::Translation(Vec3f(1, 2, 3)) * HMat4f::Factory::Scaling(2, -1, 3);
+
+    Vec3f out[N];
+    float ox[N], oy[N], oz[N], dots[N];
+    Vec3fArrays so = { ox, oy, oz };
+
+    SECTION("Transformation") {
+        transformPoints(m, a, out, N);
+        transformPoints(m, sa, so, N);
+        for (int i = 0; i < N; ++i) {
+            Vec3f e = m * a[i];
+            REQUIRE(out[i] == e);
+            REQUIRE(Vec3f(ox[i], oy[i], oz[i]) == e);
+        }
+
+        HMat4f inv = m;
+        inv.invert();
+
+        transformNormals(m, b, out, N);
+        transformNormals(m, sb, so, N);
+        for (int i = 0; i < N; ++i) {
+            // Compare to the inverse transpose.
+            Vec3f e = ~Vec3f(inv.c0 % b[i], inv.c1 % b[i], inv.c2 % b[i]);
+            REQUIRE(out[i] == e);
+            REQUIRE(Vec3f(ox[i], oy[i], oz[i]) == e);
+        }
+    }
+
+    SECTION("Products") {
+        normalizeAll(a, out, N);
+        normalizeAll(sa, so, N);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(out[i] == ~a[i]);
+            REQUIRE(Vec3f(ox[i], oy[i], oz[i]) == ~a[i]);
+        }
+
+        dotAll(a, b, dots, N);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(gale::meta::OpCmpEqual::evaluate(dots[i], a[i] % b[i], 1e-5f));
+        }
+        dotAll(sa, sb, dots, N);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(gale::meta::OpCmpEqual::evaluate(dots[i], a[i] % b[i], 1e-5f));
+        }
+
+        // Allow for different rounding if the compiler contracts to FMA.
+        crossAll(a, b, out, N);
+        crossAll(sa, sb, so, N);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(out[i].equals(a[i] ^ b[i], 1e-4f));
+            REQUIRE(Vec3f(ox[i], oy[i], oz[i]).equals(a[i] ^ b[i], 1e-4f));
+        }
+
+        // Work in-place.
+        Vec3f c[N];
+        memcpy(c, a, sizeof(c));
+        crossAll(c, b, c, N);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(c[i].equals(a[i] ^ b[i], 1e-4f));
+        }
+    }
+
+    SECTION("Extremes") {
+        Vec3f min = a[0], max = a[0];
+        for (int i = 1; i < N; ++i) {
+            min = min.minElements(a[i]);
+            max = max.maxElements(a[i]);
+        }
+
+        Vec3f bmin, bmax;
+        REQUIRE(minMaxAll(a, N, bmin, bmax));
+        REQUIRE(bmin == min);
+        REQUIRE(bmax == max);
+
+        REQUIRE(minMaxAll(sa, N, bmin, bmax));
+        REQUIRE(bmin == min);
+        REQUIRE(bmax == max);
+
+        REQUIRE_FALSE(minMaxAll(a, 0, bmin, bmax));
+    }
+
+    SECTION("Multithreading and benchmark") {
+        int const M = 1000000;
+
+        gale::global::DynamicArray<Vec3f> in(M), single(M), multi(M), loop(M);
+        for (int i = 0; i < M; ++i) {
+            in[i] = a[i % N];
+        }
+
+        Timer timer;
+        double s;
+
+        timer.reset();
+        for (int k = 0; k < 10; ++k) {
+            for (int i = 0; i < M; ++i) {
+                loop[i] = m * in[i];
+            }
+        }
+        timer.stop(s);
+        double pl = 10 * M / s;
+
+        timer.reset();
+        for (int k = 0; k < 10; ++k) {
+            transformPoints(m, in, single, M);
+        }
+        timer.stop(s);
+        double ps = 10 * M / s;
+
+        transformPoints(m, in, multi, M, 0);
+
+        INFO(pl << " points per second transformed per element, " << ps << " in a batch");
+        REQUIRE(memcmp(single, loop, M * sizeof(Vec3f)) == 0);
+        REQUIRE(memcmp(single, multi, M * sizeof(Vec3f)) == 0);
+
+        Vec3f min1, max1, min4, max4;
+        minMaxAll(in, M, min1, max1);
+        minMaxAll(in, M, min4, max4, 4);
+        REQUIRE(min1 == min4);
+        REQUIRE(max1 == max4);
+    }
+}
+
+// Returns whether the quaternion at index i in a equals q within tolerance tol.
+bool equalsQuat(gale::math::QuatfArrays const& a, int i, gale::math::Quatf const& q, float tol) {
+    using gale::meta::OpCmpEqual;
+
+    return OpCmpEqual::evaluate(a.w[i], q.real, tol)
+        && OpCmpEqual::evaluate(a.x[i], q.imag.getX(), tol)
+        && OpCmpEqual::evaluate(a.y[i], q.imag.getY(), tol)
+        && OpCmpEqual::evaluate(a.z[i], q.imag.getZ(), tol);
+}
+
+TEST_CASE("Quaternion batch tests") {
+    using namespace gale::math;
+    using namespace gale::system;
+
+    RandomEcuyerf r;
+
+    // Use a size that is not a multiple of the SIMD width.
+    int const N = 1003;
+
+    Quatf a[N], b[N];
+    float aw[N], ax[N], ay[N], az[N], bw[N], bx[N], by[N], bz[N], s[N];
+    float vx[N], vy[N], vz[N];
+    for (int i = 0; i < N; ++i) {
+        a[i] = Quatf::random(r);
+        b[i] = Quatf::random(r);
+        aw[i] = a[i].real; ax[i] = a[i].imag.getX(); ay[i] = a[i].imag.getY(); az[i] = a[i].imag.getZ();
+        bw[i] = b[i].real; bx[i] = b[i].imag.getX(); by[i] = b[i].imag.getY(); bz[i] = b[i].imag.getZ();
+        s[i] = r.random01();
+
+        Vec3f v = Vec3f::random(r) * r.random0N(10.0f);
+        vx[i] = v.getX(); vy[i] = v.getY(); vz[i] = v.getZ();
+    }
+
+    // Include (almost) equal and opposite quaternions.
+    b[5] = a[5];
+    b[6] = -a[6];
+    for (int i = 5; i <= 6; ++i) {
+        bw[i] = b[i].real; bx[i] = b[i].imag.getX(); by[i] = b[i].imag.getY(); bz[i] = b[i].imag.getZ();
+    }
+
+    QuatfArrays sa = { aw, ax, ay, az }, sb = { bw, bx, by, bz };
+    Vec3fArrays sv = { vx, vy, vz };
+
+    float ow[N], ox[N], oy[N], oz[N];
+    QuatfArrays so = { ow, ox, oy, oz };
+    Vec3fArrays sov = { ox, oy, oz };
+
+    SECTION("Interpolation") {
+        nlerpAll(sa, sb, s, so, N);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(equalsQuat(so, i, nlerp(a[i], b[i], s[i]), 1e-5f));
+        }
+
+        nlerpAll(sa, sb, s, so, N, ACCURACY_HIGH);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(equalsQuat(so, i, nlerp(a[i], b[i], s[i]), 1e-5f));
+        }
+
+        // The batch version takes the shorter arc.
+        Quatf e[N];
+        for (int i = 0; i < N; ++i) {
+            e[i] = slerp(a[i], a[i].dot(b[i]) < 0 ? -b[i] : b[i], s[i]);
+        }
+
+        slerpAll(sa, sb, s, so, N, ACCURACY_EXACT);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(equalsQuat(so, i, e[i], 0));
+        }
+
+        slerpAll(sa, sb, s, so, N, ACCURACY_HIGH);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(equalsQuat(so, i, e[i], 5e-6f));
+        }
+
+        slerpAll(sa, sb, s, so, N, ACCURACY_FAST);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(equalsQuat(so, i, e[i], 2.5e-4f));
+        }
+
+        // Work in-place.
+        memcpy(ow, aw, sizeof(ow)); memcpy(ox, ax, sizeof(ox)); memcpy(oy, ay, sizeof(oy)); memcpy(oz, az, sizeof(oz));
+        slerpAll(so, sb, s, so, N, ACCURACY_HIGH);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(equalsQuat(so, i, e[i], 5e-6f));
+        }
+    }
+
+    SECTION("Products") {
+        multiplyAll(sa, sb, so, N);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(equalsQuat(so, i, a[i] * b[i], 1e-5f));
+        }
+
+        rotateAll(sa, sv, sov, N);
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(Vec3f(ox[i], oy[i], oz[i]).equals(a[i] * Vec3f(vx[i], vy[i], vz[i]), 1e-4f));
+        }
+
+        HMat4f m[N], e;
+        getMatrices(sa, m, N);
+        for (int i = 0; i < N; ++i) {
+            a[i].getMatrix(e);
+            for (int k = 0; k < 16; ++k) {
+                REQUIRE(gale::meta::OpCmpEqual::evaluate(m[i][k], e[k], 1e-5f));
+            }
+        }
+    }
+
+    SECTION("Multithreading and benchmark") {
+        int const M = 1000000;
+
+        gale::global::DynamicArray<float> w(M * 13);
+        for (int i = 0; i < M; ++i) {
+            int k = i % N;
+            w[i] = aw[k]; w[M + i] = ax[k]; w[2 * M + i] = ay[k]; w[3 * M + i] = az[k];
+            w[4 * M + i] = bw[k]; w[5 * M + i] = bx[k]; w[6 * M + i] = by[k]; w[7 * M + i] = bz[k];
+            w[8 * M + i] = s[k];
+        }
+
+        QuatfArrays q = { w, w + M, w + 2 * M, w + 3 * M }, p = { w + 4 * M, w + 5 * M, w + 6 * M, w + 7 * M };
+        QuatfArrays single = { w + 9 * M, w + 10 * M, w + 11 * M, w + 12 * M };
+        float const* t = w + 8 * M;
+
+        gale::global::DynamicArray<Quatf> in(M), loop(M);
+        for (int i = 0; i < M; ++i) {
+            in[i] = a[i % N];
+        }
+
+        Timer timer;
+        double sec;
+
+        timer.reset();
+        for (int i = 0; i < M; ++i) {
+            int k = i % N;
+            loop[i] = slerp(in[i], b[k], t[i]);
+        }
+        timer.stop(sec);
+        double pl = M / sec;
+
+        timer.reset();
+        for (int k = 0; k < 10; ++k) {
+            slerpAll(q, p, t, single, M, ACCURACY_HIGH);
+        }
+        timer.stop(sec);
+        double ph = 10 * M / sec;
+
+        timer.reset();
+        for (int k = 0; k < 10; ++k) {
+            slerpAll(q, p, t, single, M, ACCURACY_FAST);
+        }
+        timer.stop(sec);
+        double pf = 10 * M / sec;
+
+        timer.reset();
+        for (int i = 0; i < M; ++i) {
+            loop[i] = nlerp(in[i], b[i % N], t[i]);
+        }
+        timer.stop(sec);
+        double pnl = M / sec;
+
+        timer.reset();
+        for (int k = 0; k < 10; ++k) {
+            nlerpAll(q, p, t, single, M, ACCURACY_HIGH);
+        }
+        timer.stop(sec);
+        double pnb = 10 * M / sec;
+
+        INFO(pl << " / " << ph << " / " << pf << " slerps per second per element / in a high / fast accuracy batch");
+        INFO(pnl << " / " << pnb << " nlerps per second per element / in a high accuracy batch");
+        REQUIRE(equalsQuat(single, M - 1, nlerp(in[M - 1], b[(M - 1) % N], t[M - 1]), 1e-5f));
+
+        // The multithreaded results equal the single-threaded ones.
+        slerpAll(q, p, t, single, M, ACCURACY_HIGH);
+        gale::global::DynamicArray<float> multi(M * 4);
+        QuatfArrays so4 = { multi, multi + M, multi + 2 * M, multi + 3 * M };
+        slerpAll(q, p, t, so4, M, ACCURACY_HIGH, 0);
+        REQUIRE(memcmp(single.w, multi, M * sizeof(float)) == 0);
+        REQUIRE(memcmp(single.z, multi + 3 * M, M * sizeof(float)) == 0);
+
+        HMat4f* m1 = new HMat4f[M];
+        HMat4f* m4 = new HMat4f[M];
+        getMatrices(q, m1, M);
+        getMatrices(q, m4, M, 4);
+        REQUIRE(memcmp(m1, m4, M * sizeof(HMat4f)) == 0);
+        delete [] m4;
+        delete [] m1;
+    }
+}
+
+template<class P>
+void testVectorPacket(gale::math::RandomEcuyerf& r) {
+    using namespace gale::math;
+
+    int const L = Vec3fPacket<P>::Lanes;
+
+    Vec3f a[L], b[L], c[L];
+    float s[L];
+    for (int i = 0; i < L; ++i) {
+        a[i] = Vec3f::random(r) * r.random0N(10.0f);
+        b[i] = Vec3f::random(r) * r.random0N(10.0f);
+        s[i] = r.random01();
+    }
+    a[1] = Vec3f::ZERO();
+
+    Vec3fPacket<P> pa = Vec3fPacket<P>::load(a), pb = Vec3fPacket<P>::load(b);
+    P ps = P::load(s);
+
+    P dots = pa % pb, lengths = pa.length(), lengths2 = pa.length2();
+    for (int i = 0; i < L; ++i) {
+        REQUIRE(pa.get(i) == a[i]);
+        REQUIRE(gale::meta::OpCmpEqual::evaluate(dots[i], a[i] % b[i], 1e-4f));
+        REQUIRE(gale::meta::OpCmpEqual::evaluate(lengths[i], static_cast<float>(a[i].length()), 1e-5f));
+        REQUIRE(gale::meta::OpCmpEqual::evaluate(lengths2[i], a[i].length2(), 1e-4f));
+    }
+
+    // Allow for different rounding if the compiler contracts to FMA.
+    (pa ^ pb).store(c);
+    for (int i = 0; i < L; ++i) {
+        REQUIRE(c[i].equals(a[i] ^ b[i], 1e-4f));
+    }
+
+    (~pa).store(c);
+    for (int i = 0; i < L; ++i) {
+        REQUIRE(c[i] == ~a[i]);
+    }
+
+    lerp(pa, pb, ps).store(c);
+    for (int i = 0; i < L; ++i) {
+        REQUIRE(c[i] == lerp(a[i], b[i], s[i]));
+    }
+
+    pa.minElements(pb).store(c);
+    for (int i = 0; i < L; ++i) {
+        REQUIRE(c[i] == a[i].minElements(b[i]));
+    }
+
+    pa.maxElements(pb).store(c);
+    for (int i = 0; i < L; ++i) {
+        REQUIRE(c[i] == a[i].maxElements(b[i]));
+    }
+
+    // Compare and blend.
+    int less = (pa < pb).bits(), longer = (pa.length2() > pb.length2()).bits();
+    Vec3fPacket<P> longest = select(pa.length2() > pb.length2(), pa, pb);
+    for (int i = 0; i < L; ++i) {
+        REQUIRE(((less >> i) & 1) == (a[i] < b[i]));
+        REQUIRE(((longer >> i) & 1) == (a[i].length2() > b[i].length2()));
+        REQUIRE(longest.get(i) == (a[i].length2() > b[i].length2() ? a[i] : b[i]));
+    }
+
+    REQUIRE(pa.equals(pa).all());
+    REQUIRE((pa.equals(pb) & pa.equals(-pb)).none());
+    REQUIRE((~(pa <= pa)).none());
+    REQUIRE(((pa < pb) | ~(pa < pb)).all());
+    REQUIRE(((pa < pb) ^ (pa < pb)).none());
+
+    // Round-trip through separate coordinate arrays.
+    float x[L], y[L], z[L];
+    pb.store(x, y, z);
+    REQUIRE(Vec3fPacket<P>::load(x, y, z).equals(pb).all());
+}
+
+TEST_CASE("Vector packet tests") {
+    using namespace gale::math;
+    using namespace gale::system;
+
+    RandomEcuyerf r;
+
+    SECTION("Operators") {
+        for (int k = 0; k < 100; ++k) {
+            testVectorPacket<Packet4f>(r);
+            testVectorPacket<Packet8f>(r);
+        }
+    }
+
+    SECTION("Plane benchmark") {
+        int const N = 1 << 16, R = 1000;
+
+        gale::global::DynamicArray<Vec3f> points(N);
+        gale::global::DynamicArray<float> x(N), y(N), z(N);
+        for (int i = 0; i < N; ++i) {
+            points[i] = Vec3f::random(r) * r.random0N(10.0f);
+            x[i] = points[i].getX();
+            y[i] = points[i].getY();
+            z[i] = points[i].getZ();
+        }
+
+        Vec3f normal = Vec3f::random(r);
+
+        Timer timer;
+        double s;
+        int single = 0, packet4 = 0, packet8 = 0;
+
+        // Vary the plane distance to keep the compiler from hoisting the tests.
+        timer.reset();
+        for (int k = 0; k < R; ++k) {
+            float distance = k * 0.001f;
+            for (int i = 0; i < N; ++i) {
+                single += points[i] % normal > distance;
+            }
+        }
+        timer.stop(s);
+        double ps = double(R) * N / s;
+
+        // Count per lane to avoid extracting the mask bits in the loop.
+        Vec3fx4 n4(normal);
+        Packet4f count4(0.0f);
+        timer.reset();
+        for (int k = 0; k < R; ++k) {
+            Packet4f distance(k * 0.001f);
+            for (int i = 0; i < N; i += 4) {
+                count4 += select(Vec3fx4::load(&x[i], &y[i], &z[i]) % n4 > distance, Packet4f(1.0f), Packet4f(0.0f));
+            }
+        }
+        timer.stop(s);
+        for (int l = 0; l < 4; ++l) {
+            packet4 += static_cast<int>(count4[l]);
+        }
+        double p4 = double(R) * N / s;
+
+        Vec3fx8 n8(normal);
+        Packet8f count8(0.0f);
+        timer.reset();
+        for (int k = 0; k < R; ++k) {
+            Packet8f distance(k * 0.001f);
+            for (int i = 0; i < N; i += 8) {
+                count8 += select(Vec3fx8::load(&x[i], &y[i], &z[i]) % n8 > distance, Packet8f(1.0f), Packet8f(0.0f));
+            }
+        }
+        timer.stop(s);
+        for (int l = 0; l < 8; ++l) {
+            packet8 += static_cast<int>(count8[l]);
+        }
+        double p8 = double(R) * N / s;
+
+        INFO(ps << " points per second tested singly, " << p4 << " in packets of 4, " << p8 << " in packets of 8");
+        REQUIRE(std::abs(single - packet4) <= R);
+        REQUIRE(std::abs(single - packet8) <= R);
+    }
+}
+
+TEST_CASE("Vector expression tests") {
+    using namespace gale::math;
+    using namespace gale::system;
+
+    RandomEcuyerf r;
+
+    SECTION("Evaluation") {
+        for (int k = 0; k < 100; ++k) {
+            Vec3f a = Vec3f::random(r), b = Vec3f::random(r), c = Vec3f::random(r);
+            float s = r.random0N(10.0f);
+
+            Vec3f e = lazy(a) * 0.5f + b * s - lazy(c) / 4.0f;
+            REQUIRE(e.equals(a * 0.5f + b * s - c / 4.0f, 1e-5f));
+
+            e = a - lazy(b) * c + -lazy(c);
+            REQUIRE(e.equals(a - b * c - c, 1e-5f));
+
+            Vec3d d = s * lazy(Vec3d(a)) + Vec3d(b);
+            REQUIRE(d.equals(s * Vec3d(a) + Vec3d(b), 1e-12));
+
+            Vec4f f = lazy(Vec4f(a[0], a[1], a[2], s)) * 2.0f - Vec4f(b[0], b[1], b[2], s);
+            REQUIRE(f.equals(Vec4f(a[0], a[1], a[2], s) * 2.0f - Vec4f(b[0], b[1], b[2], s), 1e-5f));
+        }
+
+        Vec2i i = lazy(Vec2i(1, 2)) * 3 - Vec2i(4, 5) + lazy(Vec2i(6, 7)) * Vec2i(2, 2);
+        REQUIRE(i == Vec2i(11, 15));
+
+        // Scalars pass through unchanged.
+        REQUIRE(lazy(2.0f) * 3.0f == 6.0f);
+
+        // Splines need to pass through their control points.
+        gale::global::DynamicArray<Vec3f> points(8);
+        for (int k = 0; k < points.getSize(); ++k) {
+            points[k] = Vec3f::random(r);
+        }
+        for (int k = 0; k < points.getSize(); ++k) {
+            float s = static_cast<float>(k) / (points.getSize() - 1);
+            REQUIRE(Interpolator::CatmullRom(points, s).equals(points[k], 1e-4f));
+            REQUIRE(Interpolator::Hermite(points, points, s).equals(points[k], 1e-4f));
+        }
+    }
+
+    SECTION("Stencil benchmark") {
+        int const N = 1 << 16, R = 500;
+
+        gale::global::DynamicArray<Vec3f> v(N), x(N), y(N);
+        gale::global::DynamicArray<int> n(N * 8);
+        for (int i = 0; i < N; ++i) {
+            v[i] = Vec3f::random(r);
+        }
+        for (int i = 0; i < N * 8; ++i) {
+            n[i] = static_cast<int>(r.random0N(N - 1.0f));
+        }
+
+        Timer timer;
+        double s;
+
+        // Butterfly subdivision stencil using temporary vectors.
+        timer.reset();
+        for (int k = 0; k < R; ++k) {
+            for (int i = 0; i < N; ++i) {
+                int const* j = &n[i * 8];
+                x[i] = v[j[0]] * 0.5f + v[j[1]] * 0.5f
+                     + v[j[2]] * 0.125f  + v[j[3]] * 0.125f
+                     - v[j[4]] * 0.0625f - v[j[5]] * 0.0625f
+                     - v[j[6]] * 0.0625f - v[j[7]] * 0.0625f;
+            }
+        }
+        timer.stop(s);
+        double pt = double(R) * N / s;
+
+        // Same stencil using expressions.
+        timer.reset();
+        for (int k = 0; k < R; ++k) {
+            for (int i = 0; i < N; ++i) {
+                int const* j = &n[i * 8];
+                y[i] = lazy(v[j[0]]) * 0.5f + lazy(v[j[1]]) * 0.5f
+                     + lazy(v[j[2]]) * 0.125f  + lazy(v[j[3]]) * 0.125f
+                     - lazy(v[j[4]]) * 0.0625f - lazy(v[j[5]]) * 0.0625f
+                     - lazy(v[j[6]]) * 0.0625f - lazy(v[j[7]]) * 0.0625f;
+            }
+        }
+        timer.stop(s);
+        double pe = double(R) * N / s;
+
+        INFO(pt << " stencils per second using temporaries, " << pe << " using expressions");
+        for (int i = 0; i < N; ++i) {
+            REQUIRE(x[i].equals(y[i], 1e-5f));
+        }
+    }
+
+    SECTION("Spline benchmark") {
+        // The previous open Catmull-Rom spline evaluation, which creates a
+        // temporary vector for each operation, for comparison.
+        struct Reference {
+            static Vec3f CatmullRom(gale::global::DynamicArray<Vec3f> const& v, float s) {
+                static signed char const w[] = {
+                    -1, 3, -3, 1,
+                    2, -5, 4, -1,
+                    -1, 0, 1, 0,
+                    0, 2, 0, 0
+                };
+
+                int n = v.getSize() - 1;
+
+                float i = n * s;
+                int it = roundToZero(i);
+                s = i - it;
+
+                int i1 = (it > n) ? 0 : it;
+                int i2 = (i1 == n) ? n : i1 + 1;
+                int i0 = (i1 == 0) ? 0 : i1 - 1;
+                int i3 = (i2 == n) ? n : i2 + 1;
+
+                Vec3f const &v0 = v[i0], &v1 = v[i1], &v2 = v[i2], &v3 = v[i3];
+                Vec3f a = 0.5f * (v0 * w[ 0] + v1 * w[ 1] + v2 * w[ 2] + v3 * w[ 3]);
+                Vec3f b = 0.5f * (v0 * w[ 4] + v1 * w[ 5] + v2 * w[ 6] + v3 * w[ 7]);
+                Vec3f c = 0.5f * (v0 * w[ 8] + v1 * w[ 9] + v2 * w[10] + v3 * w[11]);
+                Vec3f d = 0.5f * (v0 * w[12] + v1 * w[13] + v2 * w[14] + v3 * w[15]);
+
+                return ((a * s + b) * s + c) * s + d;
+            }
+        };
+
+        int const N = 1 << 10, M = 1 << 24;
+
+        gale::global::DynamicArray<Vec3f> points(N);
+        for (int i = 0; i < N; ++i) {
+            points[i] = Vec3f::random(r);
+        }
+
+        for (int i = 0; i < M; i += 1001) {
+            float t = static_cast<float>(i) / M;
+            REQUIRE(Interpolator::CatmullRom(points, t).equals(Reference::CatmullRom(points, t), 1e-5f));
+        }
+
+        Timer timer;
+        double s;
+
+        Vec3f sr = Vec3f::ZERO();
+        timer.reset();
+        for (int i = 0; i < M; ++i) {
+            sr += Reference::CatmullRom(points, static_cast<float>(i) / M);
+        }
+        timer.stop(s);
+        double pr = M / s;
+
+        Vec3f se = Vec3f::ZERO();
+        timer.reset();
+        for (int i = 0; i < M; ++i) {
+            se += Interpolator::CatmullRom(points, static_cast<float>(i) / M);
+        }
+        timer.stop(s);
+        double pe = M / s;
+
+        INFO(pr << " spline evaluations per second using temporaries, " << pe << " using expressions");
+        REQUIRE(se.equals(sr, 1.0f));
+    }
+}
+
+TEST_CASE("Aligned vector tests") {
+    using namespace gale::math;
+    using namespace gale::system;
+
+    RandomEcuyerf r;
+
+    SECTION("Operators") {
+        REQUIRE(sizeof(AlignedVec3f) == 16);
+
+        for (int k = 0; k < 100; ++k) {
+            Vec3f a = Vec3f::random(r) * r.random0N(10.0f), b = Vec3f::random(r) * r.random0N(10.0f);
+            float s = r.random0N(10.0f) + 1.0f;
+
+            AlignedVec3f x(a), y(b);
+            REQUIRE(x.packed() == a);
+
+            // Allow for FMA contraction of the scalar code.
+            REQUIRE((x + y).packed().equals(a + b, 1e-5f));
+            REQUIRE((x - y).packed().equals(a - b, 1e-5f));
+            REQUIRE((x * y).packed().equals(a * b, 1e-4f));
+            REQUIRE((-x).packed() == -a);
+            REQUIRE((x * s).packed().equals(a * s, 1e-4f));
+            REQUIRE((s * x).packed().equals(s * a, 1e-4f));
+            REQUIRE((x / s).packed().equals(a / s, 1e-5f));
+            REQUIRE(x.minElements(y).packed() == a.minElements(b));
+            REQUIRE(x.maxElements(y).packed() == a.maxElements(b));
+            REQUIRE(x.minElement() == a.minElement());
+            REQUIRE(x.maxElement() == a.maxElement());
+            REQUIRE(lerp(x, y, 0.25f).packed().equals(lerp(a, b, 0.25f), 1e-5f));
+
+            // Allow for differences in rounding as the summation order differs.
+            REQUIRE(gale::meta::OpCmpEqualRel::evaluate(x % y, a % b, 1e-4f, 1e-5f));
+            REQUIRE((x ^ y).packed().equals(a ^ b, 1e-4f));
+            REQUIRE((~x).packed().equals(~a, 1e-6f));
+            REQUIRE(gale::meta::OpCmpEqualRel::evaluate(x.length(), a.length(), 1e-6, 1e-6));
+
+            REQUIRE((x < y) == (a < b));
+            REQUIRE((x <= y) == (a <= b));
+            REQUIRE((x > y) == (a > b));
+            REQUIRE((x >= y) == (a >= b));
+            REQUIRE(x == x);
+            REQUIRE(x != y);
+
+            // The hidden element needs to stay 0.
+            AlignedVec3f q = x / y;
+            REQUIRE(q.packed().equals(a / b, 1e-3f));
+            REQUIRE(q.data()[3] == 0);
+        }
+
+        REQUIRE(AlignedVec3f::X() < AlignedVec3f(2, 1, 1));
+        REQUIRE((AlignedVec3f::X() ^ AlignedVec3f::Y()) == AlignedVec3f::Z());
+
+        // Like for Vec3f, equality tolerates rounding errors.
+        AlignedVec3f t(1, 2, 3);
+        t.setY(t.getY() + Numf::ZERO_TOLERANCE() / 2);
+        REQUIRE(t == AlignedVec3f(1, 2, 3));
+        REQUIRE(t.packed() == Vec3f(1, 2, 3));
+        t.setY(t.getY() + Numf::ZERO_TOLERANCE());
+        REQUIRE(t != AlignedVec3f(1, 2, 3));
+        REQUIRE(t.packed() != Vec3f(1, 2, 3));
+
+#ifndef G_ARCH_X86_64
+        // Without guaranteed alignment, instances may start at any float.
+        float buffer[4 * 2 + 3];
+        for (int i = 0; i < 4; ++i) {
+            AlignedVec3f* u = new(buffer + i) AlignedVec3f(1, 2, 3);
+            AlignedVec3f* v = new(buffer + i + 4) AlignedVec3f(AlignedVec3f::Y());
+            *u += *v;
+            REQUIRE(*u == AlignedVec3f(1, 3, 3));
+            REQUIRE((*u ^ *v) == AlignedVec3f(-3, 0, 1));
+        }
+#endif
+
+        // Convert arrays from and to the packed layout.
+        gale::global::DynamicArray<Vec3f> p(7), q(7);
+        gale::global::DynamicArray<AlignedVec3f> a(7);
+        for (int i = 0; i < p.getSize(); ++i) {
+            p[i] = Vec3f::random(r);
+        }
+        AlignedVec3f::unpack(a, p, p.getSize());
+        AlignedVec3f::pack(q, a, a.getSize());
+        for (int i = 0; i < p.getSize(); ++i) {
+            REQUIRE(a[i].data()[3] == 0);
+            REQUIRE(a[i].packed() == p[i]);
+            REQUIRE(q[i] == p[i]);
+        }
+    }
+
+    SECTION("Layout benchmark") {
+        // Run the per-vertex and per-face work of subdividing and preparing a
+        // mesh on random triangles, once on the packed and once on the aligned
+        // layout.
+        int const N = 1 << 16, F = 2 * N, R = 50;
+
+        gale::global::DynamicArray<int> faces(F * 3);
+        for (int i = 0; i < F * 3; ++i) {
+            faces[i] = static_cast<int>(r.random0N(N - 1.0f));
+        }
+
+        gale::global::DynamicArray<Vec3f> pv(N), pn(N), pf(F), ps(F);
+        for (int i = 0; i < N; ++i) {
+            pv[i] = Vec3f::random(r);
+        }
+
+        gale::global::DynamicArray<AlignedVec3f> av(N), an(N), af(F), as(F);
+        AlignedVec3f::unpack(av, pv, N);
+
+        Timer timer;
+        double s;
+
+        timer.reset();
+        for (int k = 0; k < R; ++k) {
+            // Loop subdivision edge stencil.
+            for (int f = 0; f < F; ++f) {
+                int const* i = &faces[f * 3];
+                ps[f] = pv[i[0]] * 0.375f + pv[i[1]] * 0.375f + pv[i[2]] * 0.125f + pv[i[(f & 1) * 2]] * 0.125f;
+            }
+
+            // Face normals, accumulated and normalized per vertex.
+            for (int f = 0; f < F; ++f) {
+                int const* i = &faces[f * 3];
+                pf[f] = (pv[i[1]] - pv[i[0]]) ^ (pv[i[2]] - pv[i[0]]);
+            }
+            for (int v = 0; v < N; ++v) {
+                pn[v] = Vec3f::ZERO();
+            }
+            for (int f = 0; f < F; ++f) {
+                int const* i = &faces[f * 3];
+                pn[i[0]] += pf[f];
+                pn[i[1]] += pf[f];
+                pn[i[2]] += pf[f];
+            }
+            for (int v = 0; v < N; ++v) {
+                pn[v].normalize();
+            }
+        }
+        timer.stop(s);
+        double pp = double(R) * F / s;
+
+        timer.reset();
+        for (int k = 0; k < R; ++k) {
+            for (int f = 0; f < F; ++f) {
+                int const* i = &faces[f * 3];
+                as[f] = av[i[0]] * 0.375f + av[i[1]] * 0.375f + av[i[2]] * 0.125f + av[i[(f & 1) * 2]] * 0.125f;
+            }
+
+            for (int f = 0; f < F; ++f) {
+                int const* i = &faces[f * 3];
+                af[f] = (av[i[1]] - av[i[0]]) ^ (av[i[2]] - av[i[0]]);
+            }
+            for (int v = 0; v < N; ++v) {
+                an[v] = AlignedVec3f::ZERO();
+            }
+            for (int f = 0; f < F; ++f) {
+                int const* i = &faces[f * 3];
+                an[i[0]] += af[f];
+                an[i[1]] += af[f];
+                an[i[2]] += af[f];
+            }
+            for (int v = 0; v < N; ++v) {
+                an[v].normalize();
+            }
+        }
+        timer.stop(s);
+        double pa = double(R) * F / s;
+
+        // Converting the results back to the packed layout is required for
+        // uploading them to OpenGL.
+        timer.reset();
+        for (int k = 0; k < R; ++k) {
+            AlignedVec3f::pack(pn, an, N);
+            AlignedVec3f::pack(ps, as, F);
+        }
+        timer.stop(s);
+        double pc = double(R) * F / s;
+
+        INFO(pp << " faces per second using the packed layout, " << pa << " using the aligned layout, " << pc << " converted to the packed layout");
+        for (int v = 0; v < N; ++v) {
+            AlignedVec3f n = an[v];
+            REQUIRE(gale::meta::OpCmpEqualRel::evaluate(n.length2(), pn[v].length2(), 1e-4f, 1e-4f));
+        }
+    }
+}
+
+TEST_CASE("Vector packing tests") {
+    using namespace gale::math;
+    using namespace gale::meta;
+
+    const int N = 100000;
+
+    RandomEcuyerf r;
+
+    SECTION("Normals") {
+        for (int i = 0; i < N; ++i) {
+            Vec3f n = Vec3f::random(r);
+
+            g_int16 p[3];
+            packSNorm16(n, p);
+            Vec3f u = unpackSNorm16(p);
+            for (int k = 0; k < 3; ++k) {
+                REQUIRE(OpCmpEqual::evaluate(u[k], n[k], 1.6e-5f));
+            }
+
+            u = unpackSNorm1010102(packSNorm1010102(n));
+            for (int k = 0; k < 3; ++k) {
+                REQUIRE(OpCmpEqual::evaluate(u[k], n[k], 1e-3f));
+            }
+
+            packOctSNorm16(n, p);
+            u = unpackOctSNorm16(p);
+            REQUIRE((u - n).length() < 7e-5);
+        }
+
+        // The extremes need to be exactly representable.
+        Vec3f x(1, -1, 0);
+        REQUIRE(unpackSNorm1010102(packSNorm1010102(x)) == x);
+    }
+
+    SECTION("Quantized positions") {
+        Vec3f min(-3, 1, 10), max(5, 2, 11);
+        Vec3f center = (min + max) * 0.5f;
+        float extent = 4.0f;
+
+        for (int i = 0; i < N; ++i) {
+            Vec3f v(r.random0N(8) - 3, r.random01() + 1, r.random01() + 10);
+
+            g_int16 p[3];
+            packSNorm16((v - center) / extent, p);
+            Vec3f u = unpackSNorm16(p) * extent + center;
+            for (int k = 0; k < 3; ++k) {
+                REQUIRE(OpCmpEqual::evaluate(u[k], v[k], extent / 32767.0f));
+            }
+        }
+    }
+}
+
 int __cdecl main() {
     int result = Catch::Session().run();
 